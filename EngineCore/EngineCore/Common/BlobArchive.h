@@ -0,0 +1,170 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+/*
+* File format of the caches of compiled objects (pipeline states, shaders). The archive only reads and writes bytes,
+* it does not depend on D3D12 or Windows, each cache maps or reads its file and gives the bytes to Open().
+* Every cache has its own magic, and its version changes with the format of its blobs.
+*
+*  | Header | Entry[NumEntries] sorted by hash | blob | blob | ... |      Entry = { Hash, Offset, Size }, blobs aligned to 8 bytes
+*
+* Open() validates the whole table once, Find() is a binary search in the table and returns a pointer into the bytes,
+* nothing is copied.
+*/
+namespace RHI
+{
+	template <uint32_t ArchiveMagic, uint32_t ArchiveVersion>
+	class BlobArchive
+	{
+	public:
+		static constexpr uint32_t Magic = ArchiveMagic;
+		static constexpr uint32_t Version = ArchiveVersion;
+
+		// The bytes must stay valid while the archive is open. Returns false if they are not an archive of this version
+		bool Open(const void* data, size_t size)
+		{
+			Close();
+
+			Header header;
+			if (data == nullptr || size < sizeof(Header))
+				return false;
+			memcpy(&header, data, sizeof(Header));
+
+			if (header.Magic != Magic || header.Version != Version)
+				return false;
+			if (header.NumEntries > (size - sizeof(Header)) / sizeof(Entry))
+				return false;
+
+			const uint8_t* bytes = static_cast<const uint8_t*>(data);
+			uint64_t previousHash = 0;
+			for (uint64_t i = 0; i < header.NumEntries; ++i)
+			{
+				Entry entry;
+				memcpy(&entry, bytes + sizeof(Header) + i * sizeof(Entry), sizeof(Entry));
+
+				if (i > 0 && entry.Hash <= previousHash)
+					return false;
+				if (entry.Offset > size || entry.Size > size - entry.Offset)
+					return false;
+				previousHash = entry.Hash;
+			}
+
+			m_Data = bytes;
+			m_Size = size;
+			m_NumEntries = static_cast<size_t>(header.NumEntries);
+			return true;
+		}
+
+		void Close()
+		{
+			m_Data = nullptr;
+			m_Size = 0;
+			m_NumEntries = 0;
+		}
+
+		bool IsOpen() const { return m_Data != nullptr; }
+		size_t GetNumEntries() const { return m_NumEntries; }
+
+		// Blob of the hash, nullptr if the archive has none
+		const void* Find(uint64_t hash, size_t& blobSize) const
+		{
+			size_t first = 0, last = m_NumEntries;
+			while (first < last)
+			{
+				size_t middle = first + (last - first) / 2;
+				Entry entry = GetEntry(middle);
+				if (entry.Hash == hash)
+				{
+					blobSize = static_cast<size_t>(entry.Size);
+					return m_Data + entry.Offset;
+				}
+
+				if (entry.Hash < hash)
+					first = middle + 1;
+				else
+					last = middle;
+			}
+
+			blobSize = 0;
+			return nullptr;
+		}
+
+		struct BlobRef
+		{
+			uint64_t Hash;
+			const void* Data;
+			size_t Size;
+		};
+
+		// The blobs of the archive, in hash order
+		BlobRef GetBlob(size_t index) const
+		{
+			Entry entry = GetEntry(index);
+			return BlobRef{ entry.Hash, m_Data + entry.Offset, static_cast<size_t>(entry.Size) };
+		}
+
+		// Bytes of an archive with the blobs. If several blobs have the same hash, the first one is kept
+		static std::vector<uint8_t> Build(std::vector<BlobRef> blobs)
+		{
+			std::stable_sort(blobs.begin(), blobs.end(), [](const BlobRef& lhs, const BlobRef& rhs) { return lhs.Hash < rhs.Hash; });
+			blobs.erase(std::unique(blobs.begin(), blobs.end(), [](const BlobRef& lhs, const BlobRef& rhs) { return lhs.Hash == rhs.Hash; }), blobs.end());
+
+			Header header;
+			header.Magic = Magic;
+			header.Version = Version;
+			header.NumEntries = blobs.size();
+
+			uint64_t dataOffset = AlignOffset(sizeof(Header) + blobs.size() * sizeof(Entry));
+			uint64_t archiveSize = dataOffset;
+			for (const BlobRef& blob : blobs)
+				archiveSize = AlignOffset(archiveSize + blob.Size);
+
+			std::vector<uint8_t> bytes(static_cast<size_t>(archiveSize), 0);
+			memcpy(bytes.data(), &header, sizeof(Header));
+
+			for (size_t i = 0; i < blobs.size(); ++i)
+			{
+				Entry entry{ blobs[i].Hash, dataOffset, blobs[i].Size };
+				memcpy(bytes.data() + sizeof(Header) + i * sizeof(Entry), &entry, sizeof(Entry));
+				if (blobs[i].Size > 0)
+					memcpy(bytes.data() + dataOffset, blobs[i].Data, blobs[i].Size);
+				dataOffset = AlignOffset(dataOffset + blobs[i].Size);
+			}
+
+			return bytes;
+		}
+
+	private:
+		struct Header
+		{
+			uint32_t Magic;
+			uint32_t Version;
+			uint64_t NumEntries;
+		};
+
+		struct Entry
+		{
+			uint64_t Hash;
+			uint64_t Offset;
+			uint64_t Size;
+		};
+
+		static uint64_t AlignOffset(uint64_t offset) { return (offset + 7) & ~uint64_t(7); }
+
+		// The bytes may not be aligned, the entries are copied
+		Entry GetEntry(size_t index) const
+		{
+			Entry entry;
+			memcpy(&entry, m_Data + sizeof(Header) + index * sizeof(Entry), sizeof(Entry));
+			return entry;
+		}
+
+		const uint8_t* m_Data = nullptr;
+		size_t m_Size = 0;
+		size_t m_NumEntries = 0;
+	};
+}
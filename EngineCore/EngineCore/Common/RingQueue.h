@@ -0,0 +1,98 @@
+#pragma once
+
+/*
+* FIFO queue stored in one contiguous array used as a ring. The capacity is a power of two and doubles when the queue is full,
+* it is never reduced, so a queue that is filled and drained every frame stops allocating once it reached its peak size.
+*
+*        Head        Tail
+*         |           |
+*  [      | x x x x x |            ]    Size = Tail - Head (the indices are wrapped with Capacity - 1)
+*/
+template <typename T>
+class RingQueue
+{
+public:
+	RingQueue() = default;
+
+	RingQueue(RingQueue&& rhs) noexcept :
+		m_Elements{ rhs.m_Elements },
+		m_Capacity{ rhs.m_Capacity },
+		m_Head{ rhs.m_Head },
+		m_Size{ rhs.m_Size }
+	{
+		rhs.m_Elements = nullptr;
+		rhs.m_Capacity = 0;
+		rhs.m_Head = 0;
+		rhs.m_Size = 0;
+	}
+
+	RingQueue(const RingQueue&) = delete;
+	RingQueue& operator = (const RingQueue&) = delete;
+	RingQueue& operator = (RingQueue&&) = delete;
+
+	~RingQueue()
+	{
+		Clear();
+		::operator delete(m_Elements);
+	}
+
+	template <typename... ArgsType>
+	T& EmplaceBack(ArgsType&&... args)
+	{
+		if (m_Size == m_Capacity)
+			Grow();
+
+		T* element = new (&m_Elements[(m_Head + m_Size) & (m_Capacity - 1)]) T(std::forward<ArgsType>(args)...);
+		++m_Size;
+		return *element;
+	}
+
+	void PopFront()
+	{
+		assert(!IsEmpty());
+		m_Elements[m_Head].~T();
+		m_Head = (m_Head + 1) & (m_Capacity - 1);
+		--m_Size;
+	}
+
+	T& Front() { assert(!IsEmpty()); return m_Elements[m_Head]; }
+	const T& Front() const { assert(!IsEmpty()); return m_Elements[m_Head]; }
+	T& Back() { assert(!IsEmpty()); return m_Elements[(m_Head + m_Size - 1) & (m_Capacity - 1)]; }
+	const T& Back() const { assert(!IsEmpty()); return m_Elements[(m_Head + m_Size - 1) & (m_Capacity - 1)]; }
+
+	void Clear()
+	{
+		while (!IsEmpty())
+			PopFront();
+		m_Head = 0;
+	}
+
+	bool IsEmpty() const { return m_Size == 0; }
+	size_t GetSize() const { return m_Size; }
+	size_t GetCapacity() const { return m_Capacity; }
+
+private:
+	void Grow()
+	{
+		size_t newCapacity = (m_Capacity == 0) ? 16 : m_Capacity * 2;
+		T* newElements = static_cast<T*>(::operator new(newCapacity * sizeof(T)));
+
+		// The elements are moved to the beginning of the new array
+		for (size_t i = 0; i < m_Size; ++i)
+		{
+			T& element = m_Elements[(m_Head + i) & (m_Capacity - 1)];
+			new (&newElements[i]) T(std::move(element));
+			element.~T();
+		}
+
+		::operator delete(m_Elements);
+		m_Elements = newElements;
+		m_Capacity = newCapacity;
+		m_Head = 0;
+	}
+
+	T* m_Elements = nullptr;
+	size_t m_Capacity = 0;
+	size_t m_Head = 0;
+	size_t m_Size = 0;
+};
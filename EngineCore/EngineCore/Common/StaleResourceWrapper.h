@@ -1,51 +1,53 @@
 #pragma once
 
-// Encapsulate the resources released by the application, you can put different types of resources in the same queue
+// Encapsulate the resources released by the application, you can put different types of resources in the same queue.
+// Small resources (COM pointers, descriptor allocations, buffer ranges...) are stored inside the wrapper,
+// only the larger ones are allocated on the heap
 class StaleResourceWrapper final
 {
 public:
+	static constexpr size_t InlineStorageSize = 64;
+	static constexpr size_t InlineStorageAlignment = alignof(std::max_align_t);
+
 	template <typename ResourceType >
 	static StaleResourceWrapper Create(ResourceType&& resource)
 	{
-		class SpecificStaleResource final : public StaleResourceBase
-		{
-		public:
-			SpecificStaleResource(ResourceType resource) :
-				m_SpecificResource(std::move(resource))
-			{}
-
-			SpecificStaleResource(const SpecificStaleResource&) = delete;
-			SpecificStaleResource(SpecificStaleResource&&) = delete;
-			SpecificStaleResource& operator= (const SpecificStaleResource&) = delete;
-			SpecificStaleResource& operator= (SpecificStaleResource&&) = delete;
-
-			// delete this
-			virtual void Release() override	final
-			{
-				delete this;
-			}
+		// The wrapper owns a copy of the resource (or the resource itself when it is moved), never a reference to it
+		using ObjectType = std::decay_t<ResourceType>;
+		constexpr bool FitsInline = sizeof(SpecificStaleResource<ObjectType, true>) <= InlineStorageSize &&
+			alignof(SpecificStaleResource<ObjectType, true>) <= InlineStorageAlignment &&
+			std::is_nothrow_move_constructible<ObjectType>::value;
 
-		private:
-			ResourceType m_SpecificResource;
-		};
+		StaleResourceWrapper wrapper;
+		if constexpr (FitsInline)
+			wrapper.m_StaleResource = new (wrapper.m_InlineStorage) SpecificStaleResource<ObjectType, true>(std::forward<ResourceType>(resource));
+		else
+			wrapper.m_StaleResource = new SpecificStaleResource<ObjectType, false>(std::forward<ResourceType>(resource));
 
-		return StaleResourceWrapper(new SpecificStaleResource(resource));
+		return wrapper;
 	}
 
-	StaleResourceWrapper(StaleResourceWrapper&& rhs) noexcept :
-		m_StaleResource(rhs.m_StaleResource)
+	StaleResourceWrapper(StaleResourceWrapper&& rhs) noexcept
 	{
-		rhs.m_StaleResource = nullptr;
+		MoveFrom(rhs);
+	}
+
+	StaleResourceWrapper& operator= (StaleResourceWrapper&& rhs) noexcept
+	{
+		if (this != &rhs)
+		{
+			Reset();
+			MoveFrom(rhs);
+		}
+		return *this;
 	}
 
 	StaleResourceWrapper(const StaleResourceWrapper& rhs) = delete;
 	StaleResourceWrapper& operator= (const StaleResourceWrapper&) = delete;
-	StaleResourceWrapper& operator= (const StaleResourceWrapper&&) = delete;
 
 	~StaleResourceWrapper()
 	{
-		if (m_StaleResource != nullptr)
-			m_StaleResource->Release();
+		Reset();
 	}
 
 	void GiveUpOwnership()
@@ -58,15 +60,77 @@ private:
 	class StaleResourceBase
 	{
 	public:
+		// Destroys the resource
 		virtual void Release() = 0;
+		// Moves an inline resource to the storage of another wrapper
+		virtual StaleResourceBase* MoveTo(void* storage) noexcept = 0;
+	};
+
+	template <typename ResourceType, bool Inline>
+	class SpecificStaleResource final : public StaleResourceBase
+	{
+	public:
+		template <typename SrcType>
+		SpecificStaleResource(SrcType&& resource) :
+			m_SpecificResource(std::forward<SrcType>(resource))
+		{}
+
+		SpecificStaleResource(const SpecificStaleResource&) = delete;
+		SpecificStaleResource(SpecificStaleResource&&) = delete;
+		SpecificStaleResource& operator= (const SpecificStaleResource&) = delete;
+		SpecificStaleResource& operator= (SpecificStaleResource&&) = delete;
+
+		virtual void Release() override final
+		{
+			if constexpr (Inline)
+				this->~SpecificStaleResource();
+			else
+				delete this;
+		}
+
+		virtual StaleResourceBase* MoveTo(void* storage) noexcept override final
+		{
+			if constexpr (Inline)
+				return new (storage) SpecificStaleResource(std::move(m_SpecificResource));
+
+			// Heap allocated resources are moved with their pointer
+			assert(false);
+			return nullptr;
+		}
+
+	private:
+		ResourceType m_SpecificResource;
 	};
 
-	// Private constructor, Wrapper object can only be created through Create
-	StaleResourceWrapper(StaleResourceBase* staleResource) :
-		m_StaleResource(staleResource)
+	// Wrapper object can only be created through Create
+	StaleResourceWrapper() noexcept = default;
+
+	bool IsInline() const
 	{
+		return m_StaleResource == reinterpret_cast<const StaleResourceBase*>(m_InlineStorage);
+	}
 
+	void MoveFrom(StaleResourceWrapper& rhs) noexcept
+	{
+		if (rhs.m_StaleResource != nullptr && rhs.IsInline())
+		{
+			m_StaleResource = rhs.m_StaleResource->MoveTo(m_InlineStorage);
+			rhs.m_StaleResource->Release();
+		}
+		else
+		{
+			m_StaleResource = rhs.m_StaleResource;
+		}
+		rhs.m_StaleResource = nullptr;
+	}
+
+	void Reset()
+	{
+		if (m_StaleResource != nullptr)
+			m_StaleResource->Release();
+		m_StaleResource = nullptr;
 	}
 
-	StaleResourceBase* m_StaleResource;
-};
\ No newline at end of file
+	StaleResourceBase* m_StaleResource = nullptr;
+	alignas(InlineStorageAlignment) unsigned char m_InlineStorage[InlineStorageSize];
+};
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <deque>
+
+/*
+* Ring of blocks whose users are retired separately, e.g. the chunks of dynamic descriptors of the command contexts.
+* Blocks are allocated at the tail like RingAllocationsManager, but each block is retired on its own with the point its user
+* must reach (the fence value of the queue that executed the command list), in any order and on any queue.
+* The memory is still reclaimed in ring order: the head only moves over the blocks that are retired and completed, a block
+* still in use holds back the blocks allocated after it.
+*
+*         Head                                         Tail
+*          |                                            |
+*  [       | ctx0: G 12 | ctx1: recording | ctx2: C 5 |                ]
+*
+*   completed { G 12, C 5 } -> the block of ctx0 is released, the block of ctx2 waits for ctx1
+*
+* RetirePointType needs a default constructor, which gives a point that is always completed, and IsCompleted(completed).
+* Not thread safe. Only uses the standard library, see Tests.
+*/
+namespace RHI
+{
+    template <typename RetirePointType>
+    class BlockRingAllocator
+    {
+    public:
+        static constexpr size_t InvalidOffset = static_cast<size_t>(-1);
+
+        struct Block
+        {
+            size_t Offset = InvalidOffset;
+            size_t Size = 0;
+            // Identifies the block in Retire()
+            UINT64 Id = 0;
+        };
+
+        explicit BlockRingAllocator(size_t maxSize) :
+            m_MaxSize(maxSize)
+        {
+        }
+
+        BlockRingAllocator(const BlockRingAllocator&) = delete;
+        BlockRingAllocator& operator = (const BlockRingAllocator&) = delete;
+
+        // Returns false if there is not enough contiguous space
+        bool Allocate(size_t size, Block& block)
+        {
+            assert(size > 0);
+
+            size_t offset = InvalidOffset;
+            size_t addSize = size;
+            if (m_UsedSize < m_MaxSize)
+            {
+                if (m_Tail >= m_Head)
+                {
+                    if (m_Tail + size <= m_MaxSize)
+                    {
+                        offset = m_Tail;
+                    }
+                    else if (size <= m_Head)
+                    {
+                        // Does not fit at the end, the skipped space is released with the block
+                        addSize = (m_MaxSize - m_Tail) + size;
+                        offset = 0;
+                    }
+                }
+                else if (m_Tail + size <= m_Head)
+                {
+                    offset = m_Tail;
+                }
+            }
+
+            if (offset == InvalidOffset)
+                return false;
+
+            m_Tail = offset + size;
+            m_UsedSize += addSize;
+            m_PeakUsedSize = std::max(m_PeakUsedSize, m_UsedSize);
+
+            block.Offset = offset;
+            block.Size = size;
+            block.Id = m_FirstBlockId + m_Blocks.size();
+            m_Blocks.push_back({ m_Tail, addSize, false, RetirePointType{} });
+
+            return true;
+        }
+
+        // The block is released once point is completed, a default point releases it with the next ReleaseCompleted()
+        void Retire(UINT64 blockId, const RetirePointType& point)
+        {
+            assert(blockId >= m_FirstBlockId && blockId - m_FirstBlockId < m_Blocks.size() && "Unknown or released block");
+
+            BlockAttribs& block = m_Blocks[static_cast<size_t>(blockId - m_FirstBlockId)];
+            assert(!block.Retired && "The block is already retired");
+            block.Retired = true;
+            block.Point = point;
+        }
+
+        void ReleaseCompleted(const RetirePointType& completed)
+        {
+            while (!m_Blocks.empty() && m_Blocks.front().Retired && m_Blocks.front().Point.IsCompleted(completed))
+            {
+                const BlockAttribs& oldestBlock = m_Blocks.front();
+                assert(oldestBlock.Size <= m_UsedSize);
+                m_UsedSize -= oldestBlock.Size;
+                m_Head = oldestBlock.Tail;
+                m_Blocks.pop_front();
+                ++m_FirstBlockId;
+            }
+
+            // Start again from the beginning, so that the next allocations do not need to skip the end of the range
+            if (IsEmpty())
+            {
+                m_Head = 0;
+                m_Tail = 0;
+            }
+        }
+
+        bool IsEmpty() const { return m_UsedSize == 0; }
+        size_t GetMaxSize() const { return m_MaxSize; }
+        size_t GetUsedSize() const { return m_UsedSize; }
+        size_t GetPeakUsedSize() const { return m_PeakUsedSize; }
+        // Blocks allocated and not released yet, retired or not
+        size_t GetNumBlocks() const { return m_Blocks.size(); }
+
+    private:
+        struct BlockAttribs
+        {
+            // Tail position after the block
+            size_t Tail;
+            // Size of the block, including skipped space
+            size_t Size;
+            bool Retired;
+            RetirePointType Point;
+        };
+
+        // Blocks in ring order, m_Blocks[0] has the id m_FirstBlockId
+        std::deque<BlockAttribs> m_Blocks;
+        UINT64 m_FirstBlockId = 0;
+
+        size_t m_Head = 0;
+        size_t m_Tail = 0;
+        size_t m_MaxSize = 0;
+        size_t m_UsedSize = 0;
+        size_t m_PeakUsedSize = 0;
+    };
+}
@@ -0,0 +1,279 @@
+#pragma once
+
+#include "VariableSizeAllocationsManager.h"
+
+/*
+* Blocks and ranges of GpuBufferAllocator, without the device: the memory of a block is created by BlockDeviceType.
+*
+*   typename BlockDeviceType::BlockType      resources of one block, released by its destructor
+*   BlockType CreateBlock(UINT64 blockSize)  throws on failure
+*
+* GpuBufferAllocator uses D3D12BufferBlockDevice (one ID3D12Heap and one placed buffer per block), the tests a CPU-only device.
+*
+* Every live range has a record in a slot table, the owners only keep the slot index. Each block maps the offsets of its
+* live ranges to their slots, in offset order: a compaction pass can walk the ranges of a block (ForEachLiveRange()),
+* move one to another block and update its single record.
+*
+*   m_Slots     [ 0: block 0, 256..512 ] [ 1: free ] [ 2: block 1, 0..1024 ] [ 3: block 0, 0..256 ]
+*   Block 0     LiveRanges { 0 -> slot 3, 256 -> slot 0 }        FreeRanges { 512..end }
+*
+* New allocations go to the fullest block that can hold them, so lightly used blocks drain and are released.
+* Not thread safe.
+*/
+namespace RHI
+{
+	template <typename BlockDeviceType>
+	class BufferBlockAllocator
+	{
+	public:
+		using BlockType = typename BlockDeviceType::BlockType;
+
+		static constexpr UINT32 InvalidSlot = static_cast<UINT32>(-1);
+
+		struct Range
+		{
+			UINT32 BlockId = 0;
+			// Reserved in the block, including the alignment padding
+			size_t UnalignedOffset = 0;
+			size_t Size = 0;
+			// Aligned offset of the buffer in the block
+			UINT64 Offset = 0;
+		};
+
+		struct Stats
+		{
+			UINT32 NumBlocks = 0;
+			UINT32 NumAllocations = 0;
+			UINT64 ReservedSize = 0;
+			UINT64 UsedSize = 0;
+			// Largest range that can be allocated without creating a new block
+			UINT64 LargestFreeRange = 0;
+		};
+
+		struct BlockStats
+		{
+			UINT32 NumAllocations = 0;
+			UINT64 UsedSize = 0;
+			// Many free ranges with a small largest range means the block is fragmented
+			UINT64 NumFreeRanges = 0;
+			UINT64 LargestFreeRange = 0;
+		};
+
+		// Buffers larger than maxSubAllocationSize are not sub-allocated
+		BufferBlockAllocator(BlockDeviceType& device, UINT64 blockSize, UINT64 maxSubAllocationSize) :
+			m_Device{ device },
+			m_BlockSize{ blockSize },
+			m_MaxSubAllocationSize{ std::min(maxSubAllocationSize, blockSize) }
+		{
+		}
+
+		BufferBlockAllocator(const BufferBlockAllocator&) = delete;
+		BufferBlockAllocator& operator = (const BufferBlockAllocator&) = delete;
+
+		bool CanSubAllocate(UINT64 size) const { return size > 0 && size <= m_MaxSubAllocationSize; }
+
+		// The alignment does not need to be a power of two (a multiple of the element size for structured buffer views).
+		// Returns the slot of the range, InvalidSlot if the buffer is too large to be sub-allocated
+		UINT32 Allocate(UINT64 size, UINT64 alignment)
+		{
+			assert(alignment > 0);
+
+			if (!CanSubAllocate(size))
+				return InvalidSlot;
+
+			// The range is aligned to the largest power of two that divides the alignment,
+			// and padded so that the offset can be moved forward to the next multiple of the alignment
+			size_t baseAlignment = static_cast<size_t>(alignment & (~alignment + 1));
+			size_t paddedSize = Align(static_cast<size_t>(size + (alignment - baseAlignment)), baseAlignment);
+			if (paddedSize > m_BlockSize)
+				return InvalidSlot;
+
+			// Fullest blocks first
+			m_Candidates.clear();
+			for (UINT32 blockId = 0; blockId < m_Blocks.size(); ++blockId)
+			{
+				const auto& block = m_Blocks[blockId];
+				if (block != nullptr && block->FreeRanges.GetLargestFreeBlockSize() >= paddedSize)
+					m_Candidates.emplace_back(block->FreeRanges.GetFreeSize(), blockId);
+			}
+			std::sort(m_Candidates.begin(), m_Candidates.end());
+
+			VariableSizeAllocationsManager::Allocation allocation = VariableSizeAllocationsManager::Allocation::InvalidAllocation();
+			UINT32 blockId = 0;
+			for (const auto& candidate : m_Candidates)
+			{
+				blockId = candidate.second;
+				allocation = m_Blocks[blockId]->FreeRanges.Allocate(paddedSize, baseAlignment);
+				if (allocation.IsValid())
+					break;
+			}
+
+			if (!allocation.IsValid())
+			{
+				blockId = CreateBlock();
+				allocation = m_Blocks[blockId]->FreeRanges.Allocate(paddedSize, baseAlignment);
+				assert(allocation.IsValid());
+			}
+
+			Block& block = *m_Blocks[blockId];
+			if (block.LiveRanges.empty())
+			{
+				assert(m_NumEmptyBlocks > 0);
+				--m_NumEmptyBlocks;
+			}
+
+			Range range;
+			range.BlockId = blockId;
+			range.UnalignedOffset = allocation.unalignedOffset;
+			range.Size = allocation.size;
+			range.Offset = Align(allocation.unalignedOffset, baseAlignment);
+			range.Offset = (range.Offset + alignment - 1) / alignment * alignment;
+			assert(range.Offset + size <= range.UnalignedOffset + range.Size);
+
+			UINT32 slot = InvalidSlot;
+			if (!m_FreeSlots.empty())
+			{
+				slot = m_FreeSlots.back();
+				m_FreeSlots.pop_back();
+				m_Slots[slot] = range;
+			}
+			else
+			{
+				slot = static_cast<UINT32>(m_Slots.size());
+				m_Slots.push_back(range);
+			}
+
+			block.LiveRanges.emplace(range.UnalignedOffset, slot);
+			return slot;
+		}
+
+		void Free(UINT32 slot)
+		{
+			assert(slot < m_Slots.size());
+			const Range& range = m_Slots[slot];
+
+			assert(range.BlockId < m_Blocks.size() && m_Blocks[range.BlockId] != nullptr);
+			Block& block = *m_Blocks[range.BlockId];
+
+			auto liveRangeIt = block.LiveRanges.find(range.UnalignedOffset);
+			assert(liveRangeIt != block.LiveRanges.end() && liveRangeIt->second == slot);
+			block.LiveRanges.erase(liveRangeIt);
+			block.FreeRanges.Free(range.UnalignedOffset, range.Size);
+
+			if (block.LiveRanges.empty())
+			{
+				// Keep one empty block, release the others
+				if (m_NumEmptyBlocks == 0)
+					++m_NumEmptyBlocks;
+				else
+					m_Blocks[range.BlockId].reset();
+			}
+
+			m_FreeSlots.push_back(slot);
+		}
+
+		const Range& GetRange(UINT32 slot) const
+		{
+			assert(slot < m_Slots.size());
+			return m_Slots[slot];
+		}
+
+		BlockType& GetBlock(UINT32 blockId)
+		{
+			assert(blockId < m_Blocks.size() && m_Blocks[blockId] != nullptr);
+			return m_Blocks[blockId]->Resources;
+		}
+
+		// Released blocks leave a null slot, block ids stay stable
+		UINT32 GetNumBlockIds() const { return static_cast<UINT32>(m_Blocks.size()); }
+		bool IsBlockAlive(UINT32 blockId) const { return blockId < m_Blocks.size() && m_Blocks[blockId] != nullptr; }
+
+		// Calls func(slot) for the live ranges of the block, in offset order
+		template <typename FuncType>
+		void ForEachLiveRange(UINT32 blockId, FuncType&& func) const
+		{
+			assert(IsBlockAlive(blockId));
+			for (const auto& liveRange : m_Blocks[blockId]->LiveRanges)
+				func(liveRange.second);
+		}
+
+		Stats GetStats() const
+		{
+			Stats stats;
+			for (const auto& block : m_Blocks)
+			{
+				if (block == nullptr)
+					continue;
+
+				++stats.NumBlocks;
+				stats.NumAllocations += static_cast<UINT32>(block->LiveRanges.size());
+				stats.ReservedSize += block->FreeRanges.GetMaxSize();
+				stats.UsedSize += block->FreeRanges.GetUsedSize();
+				stats.LargestFreeRange = std::max<UINT64>(stats.LargestFreeRange, block->FreeRanges.GetLargestFreeBlockSize());
+			}
+
+			return stats;
+		}
+
+		BlockStats GetBlockStats(UINT32 blockId) const
+		{
+			assert(IsBlockAlive(blockId));
+			const Block& block = *m_Blocks[blockId];
+
+			BlockStats stats;
+			stats.NumAllocations = static_cast<UINT32>(block.LiveRanges.size());
+			stats.UsedSize = block.FreeRanges.GetUsedSize();
+			stats.NumFreeRanges = block.FreeRanges.GetFreeBlocksNum();
+			stats.LargestFreeRange = block.FreeRanges.GetLargestFreeBlockSize();
+			return stats;
+		}
+
+	private:
+		struct Block
+		{
+			Block(BlockType&& resources, UINT64 size) :
+				Resources{ std::move(resources) },
+				FreeRanges{ static_cast<size_t>(size) }
+			{
+			}
+
+			BlockType Resources;
+			VariableSizeAllocationsManager FreeRanges;
+			// Offsets of the live ranges and their slots, sorted by offset
+			std::map<size_t/*Unaligned offset*/, UINT32/*Slot*/> LiveRanges;
+		};
+
+		UINT32 CreateBlock()
+		{
+			auto block = std::make_unique<Block>(m_Device.CreateBlock(m_BlockSize), m_BlockSize);
+			++m_NumEmptyBlocks;
+
+			// Reuse the slot of a released block
+			for (UINT32 blockId = 0; blockId < m_Blocks.size(); ++blockId)
+			{
+				if (m_Blocks[blockId] == nullptr)
+				{
+					m_Blocks[blockId] = std::move(block);
+					return blockId;
+				}
+			}
+
+			m_Blocks.push_back(std::move(block));
+			return static_cast<UINT32>(m_Blocks.size() - 1);
+		}
+
+		BlockDeviceType& m_Device;
+		const UINT64 m_BlockSize;
+		const UINT64 m_MaxSubAllocationSize;
+
+		std::vector<std::unique_ptr<Block>> m_Blocks;
+		// Number of empty blocks kept alive, so that a buffer created and released every frame does not create a heap every frame
+		UINT32 m_NumEmptyBlocks = 0;
+
+		std::vector<Range> m_Slots;
+		std::vector<UINT32> m_FreeSlots;
+
+		// Kept to avoid an allocation per Allocate()
+		std::vector<std::pair<size_t/*Free size*/, UINT32/*Block id*/>> m_Candidates;
+	};
+}
@@ -3,44 +3,111 @@
 
 namespace RHI
 {
-	CommandAllocatorPool::CommandAllocatorPool(D3D12_COMMAND_LIST_TYPE Type, ID3D12Device* Device)
+	CommandAllocatorPool::CommandAllocatorPool(D3D12_COMMAND_LIST_TYPE Type, ID3D12Device* Device, UINT32 MaxAllocators)
 		: m_CommandListType(Type),
-		m_Device(Device)
+		m_Device(Device),
+		m_MaxAllocators(MaxAllocators)
 	{
 
 	}
 
-	ID3D12CommandAllocator* CommandAllocatorPool::RequestAllocator(UINT64 CompletedFenceValue)
+	ID3D12CommandAllocator* CommandAllocatorPool::RequestAllocator(UINT64 CompletedFenceValue, bool IgnoreCap)
 	{
-		ID3D12CommandAllocator* pAllocator = nullptr;
+		// The set of the calling thread first, then the other sets
+		AllocatorSet& ThreadSet = m_AllocatorSets.GetThreadObject();
+		ID3D12CommandAllocator* pAllocator = TakeCompleted(ThreadSet, CompletedFenceValue);
 
-		if (!m_ReadyAllocators.empty())
+		if (pAllocator == nullptr)
 		{
-			std::pair<uint64_t, ID3D12CommandAllocator*>& AllocatorPair = m_ReadyAllocators.front();
-
-			if (AllocatorPair.first <= CompletedFenceValue)
+			m_AllocatorSets.ForEach([&](AllocatorSet& Set)
 			{
-				pAllocator = AllocatorPair.second;
-				ThrowIfFailed(pAllocator->Reset());
-				m_ReadyAllocators.pop();
-			}
+				if (pAllocator != nullptr || &Set == &ThreadSet)
+					return;
+
+				pAllocator = TakeCompleted(Set, CompletedFenceValue);
+				if (pAllocator != nullptr)
+					++m_NumStolen;
+			});
+		}
+
+		if (pAllocator != nullptr)
+		{
+			++m_NumReused;
+			ThrowIfFailed(pAllocator->Reset());
+			return pAllocator;
 		}
 
 		// If no allocator's were ready to be reused, create a new one
-		if (pAllocator == nullptr)
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		if (m_Allocators.size() >= m_MaxAllocators)
 		{
-			ThrowIfFailed(m_Device->CreateCommandAllocator(m_CommandListType, IID_PPV_ARGS(&pAllocator)));
-			wchar_t AllocatorName[32];
-			swprintf(AllocatorName, 32, L"CommandAllocator %zu", m_Allocators.size());
-			pAllocator->SetName(AllocatorName);
-			m_Allocators.push_back(pAllocator);
+			// Waiting is only possible if the GPU holds some allocators, the others are being recorded
+			if (!IgnoreCap && GetOldestFenceValue() != 0)
+			{
+				++m_NumCapped;
+				return nullptr;
+			}
+
+			if (m_NumCreatedOverCap++ == 0)
+				LOG_WARNING("Command allocator pool exceeds its cap");
 		}
 
+		ThrowIfFailed(m_Device->CreateCommandAllocator(m_CommandListType, IID_PPV_ARGS(&pAllocator)));
+		wchar_t AllocatorName[32];
+		swprintf(AllocatorName, 32, L"CommandAllocator %zu", m_Allocators.size());
+		pAllocator->SetName(AllocatorName);
+		m_Allocators.push_back(pAllocator);
+
 		return pAllocator;
 	}
 
 	void CommandAllocatorPool::DiscardAllocator(uint64_t FenceValue, ID3D12CommandAllocator* Allocator)
 	{
-		m_ReadyAllocators.push(std::make_pair(FenceValue, Allocator));
+		AllocatorSet& Set = m_AllocatorSets.GetThreadObject();
+		std::lock_guard<std::mutex> lock(Set.Mutex);
+		Set.Allocators.emplace_back(FenceValue, Allocator);
+	}
+
+	UINT64 CommandAllocatorPool::GetOldestFenceValue()
+	{
+		UINT64 OldestFenceValue = 0;
+		m_AllocatorSets.ForEach([&OldestFenceValue](AllocatorSet& Set)
+		{
+			std::lock_guard<std::mutex> lock(Set.Mutex);
+			for (const auto& AllocatorPair : Set.Allocators)
+			{
+				if (OldestFenceValue == 0 || AllocatorPair.first < OldestFenceValue)
+					OldestFenceValue = AllocatorPair.first;
+			}
+		});
+		return OldestFenceValue;
+	}
+
+	CommandAllocatorPool::Stats CommandAllocatorPool::GetStats()
+	{
+		Stats stats;
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			stats.NumAllocators = static_cast<UINT32>(m_Allocators.size());
+			stats.NumCreatedOverCap = m_NumCreatedOverCap;
+		}
+		stats.NumReused = m_NumReused.load();
+		stats.NumStolen = m_NumStolen.load();
+		stats.NumCapped = m_NumCapped.load();
+		return stats;
+	}
+
+	ID3D12CommandAllocator* CommandAllocatorPool::TakeCompleted(AllocatorSet& Set, UINT64 CompletedFenceValue)
+	{
+		std::lock_guard<std::mutex> lock(Set.Mutex);
+
+		// One thread discards in fence order, the oldest allocator is the first one
+		if (Set.Allocators.empty() || Set.Allocators.front().first > CompletedFenceValue)
+			return nullptr;
+
+		ID3D12CommandAllocator* pAllocator = Set.Allocators.front().second;
+		Set.Allocators.erase(Set.Allocators.begin());
+		return pAllocator;
 	}
-}
\ No newline at end of file
+}
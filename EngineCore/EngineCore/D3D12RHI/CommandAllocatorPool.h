@@ -1,29 +1,75 @@
 #pragma once
+#include "ThreadLocalCaches.h"
 
 namespace RHI
 {
-	/* 
+	/*
 	* Represent the allocation of storage for GPU commands
 	* A CommandList will be created when the CommandContext is created, and an Allocator will be requested at this time;
 	* when the CommandList of the CommandContext is reset, an Allocator will also be requested.
+	*
+	* The pool is thread safe. Discarded allocators are kept in a set per thread (registered like ThreadLocalCaches), so the
+	* contexts finished on different threads do not contend for one list. The set of a thread that exited is emptied by the others.
+	* A request reuses any allocator whose fence is completed, first from the set of the calling thread, then from the other sets.
+	* A new allocator is only created when none is completed, up to maxAllocators. Past the cap RequestAllocator returns nullptr
+	* and the queue waits for GetOldestFenceValue() instead of growing the pool while the GPU falls behind. The requests made
+	* with a lock held ignore the cap, they must not wait for the GPU.
+	*
+	*   thread 0  | (12) (13) (14) |    thread 1  | (11) (15) |    ...        completed fence 13 : (12) of thread 0 is reused
 	*/
 	class CommandAllocatorPool
 	{
 	public:
-		CommandAllocatorPool(D3D12_COMMAND_LIST_TYPE Type, ID3D12Device* Device);
+		CommandAllocatorPool(D3D12_COMMAND_LIST_TYPE Type, ID3D12Device* Device, UINT32 MaxAllocators = COMMAND_ALLOCATOR_POOL_MAX_SIZE);
 
-		// Check the front Allocator in the Pool, if the current GPU has completed the Allocator command,
-		// it can be reused, otherwise create a new one.
-		ID3D12CommandAllocator* RequestAllocator(UINT64 CompletedFenceValue);
+		// Returns an allocator the GPU has completed, or a new one.
+		// Returns nullptr if the pool reached its cap and the GPU still uses all the discarded allocators, unless IgnoreCap is set
+		ID3D12CommandAllocator* RequestAllocator(UINT64 CompletedFenceValue, bool IgnoreCap = false);
 
 		// When the CommandContext Finish, put Allocator and the current FenceValue into the pool together
 		void DiscardAllocator(uint64_t FenceValue, ID3D12CommandAllocator* Allocator);
 
+		// Smallest fence value of the discarded allocators, 0 if there is none
+		UINT64 GetOldestFenceValue();
+
+		struct Stats
+		{
+			UINT32 NumAllocators = 0;
+			// Allocators created past the cap because no allocator was discarded or the request ignored the cap
+			UINT32 NumCreatedOverCap = 0;
+			UINT64 NumReused = 0;
+			// Reused allocators taken from the set of another thread
+			UINT64 NumStolen = 0;
+			// Requests that returned nullptr because of the cap
+			UINT64 NumCapped = 0;
+		};
+		Stats GetStats();
+
 	private:
+		struct AllocatorSet
+		{
+			std::mutex Mutex;
+			// Discarded allocators and the fence value of their last command list, in discard order
+			std::vector<std::pair<uint64_t, ID3D12CommandAllocator*>> Allocators;
+		};
+
+		// Removes the oldest completed allocator from the set, nullptr if there is none
+		static ID3D12CommandAllocator* TakeCompleted(AllocatorSet& Set, UINT64 CompletedFenceValue);
+
 		const D3D12_COMMAND_LIST_TYPE m_CommandListType;
 
 		ID3D12Device* m_Device;
+		const UINT32 m_MaxAllocators;
+
+		ThreadLocalObjects<AllocatorSet> m_AllocatorSets;
+
+		// Guards m_Allocators and m_NumCreatedOverCap. Locked before the sets
+		std::mutex m_Mutex;
 		std::vector<Microsoft::WRL::ComPtr<ID3D12CommandAllocator>> m_Allocators;
-		std::queue<std::pair<uint64_t, ID3D12CommandAllocator*>> m_ReadyAllocators;
+		UINT32 m_NumCreatedOverCap = 0;
+
+		std::atomic<UINT64> m_NumReused{ 0 };
+		std::atomic<UINT64> m_NumStolen{ 0 };
+		std::atomic<UINT64> m_NumCapped{ 0 };
 	};
-}
\ No newline at end of file
+}
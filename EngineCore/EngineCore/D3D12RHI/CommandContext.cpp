@@ -4,41 +4,59 @@
 #include "RenderDevice.h"
 #include "DescriptorHeap.h"
 #include "PipelineState.h"
+#include "PipelineStateCompiler.h"
 #include "GpuBuffer.h"
 #include "GpuTexture.h"
 #include "DynamicResource.h"
 #include "GpuResourceDescriptor.h"
+#include "UploadManager.h"
 
 namespace RHI
 {
-	CommandContext* CommandContextManager::AllocateCommandContext(D3D12_COMMAND_LIST_TYPE type)
+	CommandContextManager::CommandContextManager() :
+		m_RecordingWorkers{ std::max(2u, std::thread::hardware_concurrency()) - 1 }
+	{
+	}
+
+	CommandContext* CommandContextManager::AllocateCommandContext(D3D12_COMMAND_LIST_TYPE type, bool WaitAtCap)
 	{
 		CommandContext* context = nullptr;
+		bool isNewContext = false;
+		{
+			std::lock_guard<std::mutex> lock(m_ContextAllocationMutex);
 
-		auto& avaliableCommandContexts = m_AvailableCommandContexts[type];
+			auto& avaliableCommandContexts = m_AvailableCommandContexts[type];
 
-		if (avaliableCommandContexts.empty())
-		{
-			context = new CommandContext(type);
-			m_CommandContextPool[type].emplace_back(context);
-			context->Initialize();
-		}
-		else
-		{
-			context = avaliableCommandContexts.front();
-			avaliableCommandContexts.pop();
-			context->Reset();
+			if (avaliableCommandContexts.empty())
+			{
+				context = new CommandContext(type);
+				m_CommandContextPool[type].emplace_back(context);
+				isNewContext = true;
+			}
+			else
+			{
+				context = avaliableCommandContexts.front();
+				avaliableCommandContexts.pop();
+			}
 		}
 
 		assert(context != nullptr);
 		assert(context->m_Type == type);
 
+		// The other threads allocate their contexts while this one waits for an allocator
+		if (isNewContext)
+			context->Initialize(WaitAtCap);
+		else
+			context->Reset(WaitAtCap);
+
 		return context;
 	}
 
 	void CommandContextManager::FreeCommandContext(CommandContext* usedContext)
 	{
 		assert(usedContext != nullptr);
+
+		std::lock_guard<std::mutex> lock(m_ContextAllocationMutex);
 		m_AvailableCommandContexts[usedContext->m_Type].push(usedContext);
 	}
 
@@ -48,7 +66,7 @@ namespace RHI
 		: m_Type(type),
 		m_CommandList(nullptr),
 		m_CurrentAllocator(nullptr),
-		m_DynamicGPUDescriptorAllocator(RenderDevice::GetSingleton().GetGPUDescriptorHeap(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV), 128, "DynamicDescriptorMgr"),
+		m_DynamicGPUDescriptorAllocator(RenderDevice::GetSingleton().GetGPUDescriptorHeap(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV), DynamicDescriptorChunkSize, "DynamicDescriptorMgr"),
 		m_DynamicResourceHeap(RenderDevice::GetSingleton().GetDynamicResourceAllocator(), DYNAMIC_RESOURCE_PAGE_SIZE)
 	{
 		
@@ -56,29 +74,52 @@ namespace RHI
 
 	CommandContext::~CommandContext()
 	{
-		m_DynamicGPUDescriptorAllocator.ReleaseAllocations();
 		m_DynamicResourceHeap.ReleaseAllocatedPages();
 	}
 
-	void CommandContext::Initialize()
+	void CommandContext::Initialize(bool WaitAtCap)
 	{
 		// Creating the new command list
-		CommandListManager::GetSingleton().CreateNewCommandList(m_Type, m_CommandList.GetAddressOf(), &m_CurrentAllocator);
+		CommandListManager::GetSingleton().CreateNewCommandList(m_Type, m_CommandList.GetAddressOf(), &m_CurrentAllocator, WaitAtCap);
 	}
 
-	void CommandContext::Reset()
+	void CommandContext::Reset(bool WaitAtCap)
 	{
 		assert(m_CommandList != nullptr && m_CurrentAllocator == nullptr);
 
-		m_CurrentAllocator = CommandListManager::GetSingleton().GetQueue(m_Type).RequestAllocator();
+		CommandQueue& Queue = CommandListManager::GetSingleton().GetQueue(m_Type);
+
+		// The previous command list may still wait in the coalesced submission of the queue
+		if (m_LastFenceValue >= Queue.GetNextFenceValue())
+			Queue.FlushSubmissions();
+
+		m_CurrentAllocator = Queue.RequestAllocator(WaitAtCap);
 		m_CommandList->Reset(m_CurrentAllocator, nullptr);
 
+		m_NumBarriersToFlush = 0;
+		m_BarrierStats = BarrierStats{};
+		assert(m_SplitBarriers.empty());
+		m_StateTracker.Reset();
+
 		// TODO
 	}
 
 	CommandContext& CommandContext::Begin(const std::wstring ID)
 	{
-		CommandContext* newContext = CommandContextManager::GetSingleton().AllocateCommandContext(D3D12_COMMAND_LIST_TYPE_DIRECT);
+		return Begin(D3D12_COMMAND_LIST_TYPE_DIRECT, ID);
+	}
+
+	CommandContext& CommandContext::Begin(D3D12_COMMAND_LIST_TYPE Type, const std::wstring& ID)
+	{
+		CommandContext* newContext = CommandContextManager::GetSingleton().AllocateCommandContext(Type);
+		newContext->SetID(ID);
+
+		return *newContext;
+	}
+
+	CommandContext& CommandContext::BeginUnderLock(D3D12_COMMAND_LIST_TYPE Type, const std::wstring& ID)
+	{
+		CommandContext* newContext = CommandContextManager::GetSingleton().AllocateCommandContext(Type, false);
 		newContext->SetID(ID);
 
 		return *newContext;
@@ -86,34 +127,163 @@ namespace RHI
 
 	uint64_t CommandContext::Finish(bool WaitForCompletion, bool releaseDynamic)
 	{
-		assert(m_Type == D3D12_COMMAND_LIST_TYPE_DIRECT || m_Type == D3D12_COMMAND_LIST_TYPE_COMPUTE);
+		D3D12_COMMAND_LIST_TYPE Type = m_Type;
 
-		FlushResourceBarriers();
+		// Release dynamic resources at the end of each frame, the dynamic descriptors are retired by every submission
+		if (releaseDynamic)
+			m_DynamicResourceHeap.ReleaseAllocatedPages();
 
-		assert(m_CurrentAllocator != nullptr);
+		// The context is given back to the manager, it must not be used after this
+		CommandContext* Context = this;
+		uint64_t FenceValue = Submit(&Context, 1);
 
-		CommandQueue& Queue = CommandListManager::GetSingleton().GetQueue(m_Type);
+		if (releaseDynamic)
+		{
+			assert(Type == D3D12_COMMAND_LIST_TYPE_DIRECT && "The frame must end on the graphics queue");
+			CommandListManager::GetSingleton().FinishFrame();
+			RenderDevice::GetSingleton().FinishFrame();
+		}
+
+		if (WaitForCompletion)
+			CommandListManager::GetSingleton().WaitForFence(FenceValue, Type);
+
+		return FenceValue;
+	}
+
+	uint64_t CommandContext::FinishParallel(CommandContext* const* Contexts, UINT NumContexts, bool WaitForCompletion)
+	{
+		if (NumContexts == 0)
+			return 0;
+
+		D3D12_COMMAND_LIST_TYPE Type = Contexts[0]->m_Type;
+		uint64_t FenceValue = Submit(Contexts, NumContexts);
+
+		if (WaitForCompletion)
+			CommandListManager::GetSingleton().WaitForFence(FenceValue, Type);
+
+		return FenceValue;
+	}
+
+	uint64_t CommandContext::RecordParallel(D3D12_COMMAND_LIST_TYPE Type, UINT NumContexts,
+		const std::function<void(CommandContext&, UINT)>& RecordFunc, bool WaitForCompletion)
+	{
+		if (NumContexts == 0)
+			return 0;
+
+		std::vector<CommandContext*> Contexts(NumContexts);
+		for (UINT i = 0; i < NumContexts; ++i)
+			Contexts[i] = &Begin(Type);
+
+		// The calling thread records the first context, the workers of the manager the others
+		CommandContextManager::GetSingleton().GetRecordingWorkers().ParallelFor(NumContexts,
+			[&RecordFunc, &Contexts](uint32_t i) { RecordFunc(*Contexts[i], i); });
+
+		return FinishParallel(Contexts.data(), NumContexts, WaitForCompletion);
+	}
+
+	uint64_t CommandContext::Submit(CommandContext* const* Contexts, UINT NumContexts)
+	{
+		assert(NumContexts > 0);
+
+		D3D12_COMMAND_LIST_TYPE Type = Contexts[0]->m_Type;
+		CommandQueue& Queue = CommandListManager::GetSingleton().GetQueue(Type);
+
+		// The resources of the pending uploads must be ready before the graphics queue uses them
+		UploadManager* Uploads = UploadManager::GetSingletonPtr();
+		if (Type == D3D12_COMMAND_LIST_TYPE_DIRECT && Uploads != nullptr && Uploads->HasPendingUploads())
+			Uploads->Flush();
+
+		for (UINT i = 0; i < NumContexts; ++i)
+		{
+			CommandContext& Context = *Contexts[i];
+			assert(Context.m_Type == Type && "The contexts submitted together must use the same queue");
+			assert(Context.m_CurrentAllocator != nullptr);
+
+			Context.EndSplitBarriers();
+			Context.FlushResourceBarriers();
+		}
 
 		// Clean Release Queue
 		RenderDevice::GetSingleton().PurgeReleaseQueue(false);
 
-		// Release dynamic resources at the end of each frame
-		if (releaseDynamic)
+		// The fix-up lists are reset before the global states are locked. Their allocators ignore the cap of the pool:
+		// Submit may be called with a lock held (UploadManager), and the contexts already hold the allocators of their lists.
+		// A context whose first uses all turn out to be in the right state closes its fix-up list unused
+		for (UINT i = 0; i < NumContexts; ++i)
 		{
-			m_DynamicGPUDescriptorAllocator.ReleaseAllocations();
+			CommandContext& Context = *Contexts[i];
+			if (!Context.m_StateTracker.HasPendingTransitions())
+				continue;
 
-			m_DynamicResourceHeap.ReleaseAllocatedPages();
+			if (Context.m_FixupCommandList == nullptr)
+			{
+				CommandListManager::GetSingleton().CreateNewCommandList(Type, Context.m_FixupCommandList.GetAddressOf(), &Context.m_FixupAllocator, false);
+				Context.m_FixupCommandList->SetName(L"Barrier Fixup CommandList");
+			}
+			else
+			{
+				Context.m_FixupAllocator = Queue.RequestAllocator(false);
+				Context.m_FixupCommandList->Reset(Context.m_FixupAllocator, nullptr);
+			}
+		}
+
+		uint64_t FenceValue = 0;
+		{
+			// The global states are resolved and updated in the order the command lists are submitted
+			std::lock_guard<std::mutex> StateLock(ResourceStateTracker::GetGlobalStateMutex());
+
+			// Each context is preceded by the barriers that bring the resources it uses to the states of its first uses
+			std::vector<ID3D12CommandList*> Lists;
+			Lists.reserve(NumContexts * 2);
+			for (UINT i = 0; i < NumContexts; ++i)
+			{
+				CommandContext& Context = *Contexts[i];
+
+				Context.m_TrackedBarriers.clear();
+				Context.m_StateTracker.ResolvePendingBarriers(Context.m_TrackedBarriers);
+
+				if (!Context.m_TrackedBarriers.empty())
+				{
+					// Note: the states of a compute list fix-up must be valid on the compute queue, 
+					// a resource left in a graphics-only state has to be transitioned on the graphics queue first
+					assert(Context.m_FixupAllocator != nullptr);
+					Context.m_FixupCommandList->ResourceBarrier((UINT)Context.m_TrackedBarriers.size(), Context.m_TrackedBarriers.data());
+					Lists.push_back(Context.m_FixupCommandList.Get());
+				}
+				else if (Context.m_FixupAllocator != nullptr)
+				{
+					ThrowIfFailed(Context.m_FixupCommandList->Close());
+				}
+				Lists.push_back(Context.m_CommandList.Get());
+
+				Context.m_StateTracker.CommitFinalStates();
+				Context.m_StateTracker.Reset();
+			}
+
+			FenceValue = Queue.ExecuteCommandLists((UINT)Lists.size(), Lists.data());
 		}
 
-		uint64_t FenceValue = Queue.ExecuteCommandList(m_CommandList.Get());
-		Queue.DiscardAllocator(FenceValue, m_CurrentAllocator);
-		m_CurrentAllocator = nullptr;
+		// The dynamic descriptors of the contexts can be reused once this queue has executed their command lists
+		FenceTimelinePoint RetirePoint;
+		RetirePoint.Values[GetCommandQueueIndex(Type)] = FenceValue;
+
+		for (UINT i = 0; i < NumContexts; ++i)
+		{
+			CommandContext& Context = *Contexts[i];
 
+			Context.m_DynamicGPUDescriptorAllocator.RetireAllocations(RetirePoint);
 
-		if (WaitForCompletion)
-			CommandListManager::GetSingleton().WaitForFence(FenceValue, m_Type);
+			Queue.DiscardAllocator(FenceValue, Context.m_CurrentAllocator);
+			Context.m_CurrentAllocator = nullptr;
+			Context.m_LastFenceValue = FenceValue;
+			if (Context.m_FixupAllocator != nullptr)
+			{
+				Queue.DiscardAllocator(FenceValue, Context.m_FixupAllocator);
+				Context.m_FixupAllocator = nullptr;
+			}
 
-		CommandContextManager::GetSingleton().FreeCommandContext(this);
+			CommandContextManager::GetSingleton().FreeCommandContext(&Context);
+		}
 
 		return FenceValue;
 	}
@@ -122,16 +292,26 @@ namespace RHI
 	// Resource Initialization
 	void CommandContext::InitializeBuffer(GpuBuffer& Dest, const void* Data, size_t NumBytes, size_t DestOffset)
 	{
-		CommandContext& InitContext = CommandContext::Begin();
+		UploadManager* Uploads = UploadManager::GetSingletonPtr();
+		if (Uploads != nullptr && Uploads->CanUpload(NumBytes))
+		{
+			Uploads->UploadBuffer(Dest, Data, NumBytes, DestOffset);
+			return;
+		}
+
+		CommandContext& InitContext = BeginBufferInitialization(Dest);
 
 		// Copy to UploadBuffer, the UploadBuffer here will be automatically released, and SafeRelease will be called in the destructor
 		GpuUploadBuffer uploadBuffer(1, (UINT32)NumBytes);
 		void* dataPtr = uploadBuffer.Map();
 		memcpy(dataPtr, Data, NumBytes);
 
-		InitContext.TransitionResource(Dest, D3D12_RESOURCE_STATE_COPY_DEST, true);
-		InitContext.m_CommandList->CopyBufferRegion(Dest.GetResource(), DestOffset, uploadBuffer.GetResource(), 0, NumBytes);
-		InitContext.TransitionResource(Dest, D3D12_RESOURCE_STATE_GENERIC_READ, true);
+		if (!Dest.m_IsSubAllocated)
+			InitContext.TransitionResource(Dest, D3D12_RESOURCE_STATE_COPY_DEST, true);
+		InitContext.m_CommandList->CopyBufferRegion(Dest.GetResource(), Dest.GetBufferOffset() + DestOffset,
+			uploadBuffer.GetResource(), uploadBuffer.GetBufferOffset(), NumBytes);
+		if (!Dest.m_IsSubAllocated)
+			InitContext.TransitionResource(Dest, D3D12_RESOURCE_STATE_GENERIC_READ, true);
 
 		// Excute the Command List and wait it to finish so we can release the upload buffer
 		InitContext.Finish(true);
@@ -139,40 +319,278 @@ namespace RHI
 
 	void CommandContext::InitializeBuffer(GpuBuffer& Dest, const GpuUploadBuffer& Src, size_t SrcOffset, size_t NumBytes, size_t DestOffset)
 	{
-		CommandContext& InitContext = CommandContext::Begin();
+		CommandContext& InitContext = BeginBufferInitialization(Dest);
 
 		size_t MaxBytes = std::min<size_t>(Dest.GetBufferSize() - DestOffset, Src.GetBufferSize() - SrcOffset);
 		NumBytes = std::min<size_t>(MaxBytes, NumBytes);
 
-		InitContext.TransitionResource(Dest, D3D12_RESOURCE_STATE_COPY_DEST, true);
-		InitContext.m_CommandList->CopyBufferRegion(Dest.GetResource(), DestOffset, (ID3D12Resource*)Src.GetResource(), SrcOffset, NumBytes);
-		InitContext.TransitionResource(Dest, D3D12_RESOURCE_STATE_GENERIC_READ, true);
+		if (!Dest.m_IsSubAllocated)
+			InitContext.TransitionResource(Dest, D3D12_RESOURCE_STATE_COPY_DEST, true);
+		InitContext.m_CommandList->CopyBufferRegion(Dest.GetResource(), Dest.GetBufferOffset() + DestOffset,
+			(ID3D12Resource*)Src.GetResource(), Src.GetBufferOffset() + SrcOffset, NumBytes);
+		if (!Dest.m_IsSubAllocated)
+			InitContext.TransitionResource(Dest, D3D12_RESOURCE_STATE_GENERIC_READ, true);
 		// Execute the command list and wait for it to finish so we can release the upload buffer
 		InitContext.Finish(true);
 	}
 
+	CommandContext& CommandContext::BeginBufferInitialization(GpuBuffer& Dest)
+	{
+		// A shared block is never transitioned: the copy goes to a copy queue list of its own, the buffer is promoted to COPY_DEST
+		// and decays back to COMMON when the list is done, before any other list can read it (see GpuBufferAllocator::GetResourceState)
+		if (Dest.m_IsSubAllocated)
+		{
+			assert(Dest.GetHeapType() == D3D12_HEAP_TYPE_DEFAULT);
+			return CommandContext::Begin(D3D12_COMMAND_LIST_TYPE_COPY);
+		}
+
+		return CommandContext::Begin();
+	}
+
 	void CommandContext::InitializeTexture(GpuResource& Dest, UINT NumSubresources, D3D12_SUBRESOURCE_DATA SubData[])
 	{
+		UINT64 uploadBufferSize = GetRequiredIntermediateSize(Dest.GetResource(), 0, NumSubresources);
+
+		UploadManager* Uploads = UploadManager::GetSingletonPtr();
+		if (Uploads != nullptr && Uploads->CanUpload(uploadBufferSize))
+		{
+			Uploads->UploadTexture(Dest, 0, NumSubresources, SubData);
+			return;
+		}
+
 		CommandContext& InitContext = CommandContext::Begin();
 
-		UINT64 uploadBufferSize = GetRequiredIntermediateSize(Dest.GetResource(), 0, NumSubresources);
 		GpuUploadBuffer uploadBuffer(1, (UINT32)uploadBufferSize);
 
-		UpdateSubresources(InitContext.m_CommandList.Get(), Dest.GetResource(), uploadBuffer.GetResource(), 0, 0, NumSubresources, SubData);
+		// The copy is recorded directly in the command list, the state it needs must be known before
+		InitContext.TransitionResource(Dest, D3D12_RESOURCE_STATE_COPY_DEST, true);
+		UpdateSubresources(InitContext.m_CommandList.Get(), Dest.GetResource(), uploadBuffer.GetResource(), uploadBuffer.GetBufferOffset(), 0, NumSubresources, SubData);
 		InitContext.TransitionResource(Dest, D3D12_RESOURCE_STATE_GENERIC_READ);
 
 		// Execute the command list and wait for it to finish so we can release the upload buffer
 		InitContext.Finish(true);
 	}
 
+	// The read-only states can be combined, a resource in GENERIC_READ can be used as a vertex buffer without a barrier
+	static bool IsReadStateIncluded(D3D12_RESOURCE_STATES currentState, D3D12_RESOURCE_STATES newState)
+	{
+		return currentState != D3D12_RESOURCE_STATE_COMMON && newState != D3D12_RESOURCE_STATE_COMMON &&
+			(currentState & ~D3D12_RESOURCE_STATE_GENERIC_READ) == 0 &&
+			(currentState & newState) == newState;
+	}
+
+	ResourceStateTracker::TrackedResource CommandContext::GetTrackedResource(GpuResource& Resource)
+	{
+		ResourceStateTracker::TrackedResource Tracked;
+		Tracked.Resource = Resource.GetResource();
+		Tracked.GlobalState = Resource.m_UsageState;
+		Tracked.NumSubresources = Resource.GetNumSubresources();
+		return Tracked;
+	}
+
 	void CommandContext::TransitionResource(GpuResource& Resource, D3D12_RESOURCE_STATES NewState, bool FlushImmediate /*= false*/)
 	{
-		// TODO
+		TransitionSubresource(Resource, D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, NewState, FlushImmediate);
 	}
 
-	void CommandContext::FlushResourceBarriers()
+	void CommandContext::TransitionSubresource(GpuResource& Resource, UINT Subresource, D3D12_RESOURCE_STATES NewState, bool FlushImmediate /*= false*/)
 	{
-		// TODO
+		++m_BarrierStats.NumTransitions;
+
+		// The buffers sharing a block are used in the state of the block, see GpuBufferAllocator::GetResourceState.
+		// A barrier would change the state of every buffer of the block, only the read states are reached by promotion:
+		// the writes to a shared buffer are copies in a list of their own (see BeginBufferInitialization and UploadManager)
+		if (Resource.m_IsSubAllocated)
+		{
+			assert((NewState & ~D3D12_RESOURCE_STATE_GENERIC_READ) == 0 && "A sub-allocated buffer can not be transitioned to a write state");
+			++m_BarrierStats.NumElided;
+			if (FlushImmediate)
+				FlushResourceBarriers();
+			return;
+		}
+
+		// A split transition to another state must be ended first
+		D3D12_RESOURCE_STATES TransitioningState = (D3D12_RESOURCE_STATES)-1;
+		if (GetSplitBarrierState(Resource, TransitioningState) &&
+			(TransitioningState != NewState || Subresource != D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES))
+		{
+			TransitionResource(Resource, TransitioningState);
+			TransitioningState = (D3D12_RESOURCE_STATES)-1;
+		}
+
+		ResourceStateTracker::TrackedResource Tracked = GetTrackedResource(Resource);
+		D3D12_RESOURCE_STATES OldState;
+		bool IsStateKnown = m_StateTracker.GetLocalState(Tracked, Subresource, OldState);
+
+		if (m_Type == D3D12_COMMAND_LIST_TYPE_COMPUTE)
+		{
+			assert(!IsStateKnown || (OldState & VALID_COMPUTE_QUEUE_RESOURCE_STATES) == OldState);
+			assert((NewState & VALID_COMPUTE_QUEUE_RESOURCE_STATES) == NewState);
+		}
+		else if (m_Type == D3D12_COMMAND_LIST_TYPE_COPY)
+		{
+			assert(!IsStateKnown || (OldState & VALID_COPY_QUEUE_RESOURCE_STATES) == OldState);
+			assert((NewState & VALID_COPY_QUEUE_RESOURCE_STATES) == NewState);
+		}
+
+		m_TrackedBarriers.clear();
+
+		if (NewState == TransitioningState)
+		{
+			// End of the split barrier started by BeginResourceTransition
+			m_StateTracker.TransitionResource(Tracked, NewState, Subresource, m_TrackedBarriers);
+			assert(m_TrackedBarriers.size() == 1);
+			for (D3D12_RESOURCE_BARRIER& Barrier : m_TrackedBarriers)
+			{
+				if (m_NumBarriersToFlush == MaxPendingBarriers)
+					FlushResourceBarriers();
+
+				Barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_END_ONLY;
+				m_ResourceBarrierBuffer[m_NumBarriersToFlush++] = Barrier;
+			}
+
+			RemoveSplitBarrier(Resource);
+		}
+		else if (IsStateKnown && (OldState == NewState || IsReadStateIncluded(OldState, NewState)))
+		{
+			++m_BarrierStats.NumElided;
+			// Writes of two UAV passes still have to be ordered
+			if (NewState == D3D12_RESOURCE_STATE_UNORDERED_ACCESS)
+				InsertUAVBarrier(Resource, FlushImmediate);
+		}
+		else
+		{
+			// The first use of a subresource does not record a barrier, it is resolved in Finish
+			m_StateTracker.TransitionResource(Tracked, NewState, Subresource, m_TrackedBarriers);
+			if (m_TrackedBarriers.empty())
+				++m_BarrierStats.NumElided;
+
+			for (const D3D12_RESOURCE_BARRIER& Barrier : m_TrackedBarriers)
+				AddTransitionBarrier(Barrier);
+		}
+
+		if (FlushImmediate || m_NumBarriersToFlush == MaxPendingBarriers)
+			FlushResourceBarriers();
+	}
+
+	void CommandContext::AddTransitionBarrier(const D3D12_RESOURCE_BARRIER& Barrier)
+	{
+		// Merge with a pending transition of the same subresource: A->B then B->C is A->C, A->B then B->A is nothing
+		UINT32 PendingIndex = 0;
+		for (; PendingIndex < m_NumBarriersToFlush; ++PendingIndex)
+		{
+			const D3D12_RESOURCE_BARRIER& PendingBarrier = m_ResourceBarrierBuffer[PendingIndex];
+			if (PendingBarrier.Type == D3D12_RESOURCE_BARRIER_TYPE_TRANSITION &&
+				PendingBarrier.Flags == D3D12_RESOURCE_BARRIER_FLAG_NONE &&
+				PendingBarrier.Transition.pResource == Barrier.Transition.pResource &&
+				PendingBarrier.Transition.Subresource == Barrier.Transition.Subresource &&
+				PendingBarrier.Transition.StateAfter == Barrier.Transition.StateBefore)
+				break;
+		}
+
+		if (PendingIndex < m_NumBarriersToFlush)
+		{
+			++m_BarrierStats.NumElided;
+
+			D3D12_RESOURCE_BARRIER& PendingBarrier = m_ResourceBarrierBuffer[PendingIndex];
+			PendingBarrier.Transition.StateAfter = Barrier.Transition.StateAfter;
+			if (PendingBarrier.Transition.StateBefore == PendingBarrier.Transition.StateAfter)
+			{
+				// Keep the order of the other barriers
+				for (UINT32 i = PendingIndex + 1; i < m_NumBarriersToFlush; ++i)
+					m_ResourceBarrierBuffer[i - 1] = m_ResourceBarrierBuffer[i];
+				--m_NumBarriersToFlush;
+			}
+		}
+		else
+		{
+			if (m_NumBarriersToFlush == MaxPendingBarriers)
+				FlushResourceBarriers();
+
+			m_ResourceBarrierBuffer[m_NumBarriersToFlush++] = Barrier;
+		}
+	}
+
+	void CommandContext::BeginResourceTransition(GpuResource& Resource, D3D12_RESOURCE_STATES NewState, bool FlushImmediate /*= false*/)
+	{
+		// If it's already transitioning, finish that transition
+		D3D12_RESOURCE_STATES TransitioningState;
+		if (GetSplitBarrierState(Resource, TransitioningState))
+			TransitionResource(Resource, TransitioningState);
+
+		// A split barrier needs the state before the transition, 
+		// the first use of a resource (or one with different subresource states) is a regular transition
+		D3D12_RESOURCE_STATES OldState;
+		if (!m_StateTracker.GetLocalState(GetTrackedResource(Resource), D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, OldState))
+		{
+			TransitionResource(Resource, NewState, FlushImmediate);
+			return;
+		}
+
+		if (OldState != NewState && !IsReadStateIncluded(OldState, NewState))
+		{
+			if (m_NumBarriersToFlush == MaxPendingBarriers)
+				FlushResourceBarriers();
+
+			D3D12_RESOURCE_BARRIER& BarrierDesc = m_ResourceBarrierBuffer[m_NumBarriersToFlush++];
+			BarrierDesc.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+			BarrierDesc.Flags = D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY;
+			BarrierDesc.Transition.pResource = Resource.GetResource();
+			BarrierDesc.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+			BarrierDesc.Transition.StateBefore = OldState;
+			BarrierDesc.Transition.StateAfter = NewState;
+
+			// The tracked state is updated by the end of the transition
+			m_SplitBarriers.push_back({ &Resource, NewState });
+			++m_BarrierStats.NumSplitBarriers;
+		}
+
+		if (FlushImmediate || m_NumBarriersToFlush == MaxPendingBarriers)
+			FlushResourceBarriers();
+	}
+
+	bool CommandContext::GetSplitBarrierState(const GpuResource& Resource, D3D12_RESOURCE_STATES& NewState) const
+	{
+		for (const SplitBarrier& Barrier : m_SplitBarriers)
+		{
+			if (Barrier.Resource == &Resource)
+			{
+				NewState = Barrier.NewState;
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	void CommandContext::RemoveSplitBarrier(const GpuResource& Resource)
+	{
+		auto BarrierIt = std::find_if(m_SplitBarriers.begin(), m_SplitBarriers.end(),
+			[&Resource](const SplitBarrier& Barrier) { return Barrier.Resource == &Resource; });
+		assert(BarrierIt != m_SplitBarriers.end());
+		m_SplitBarriers.erase(BarrierIt);
+	}
+
+	void CommandContext::EndSplitBarriers()
+	{
+		// TransitionResource removes the barrier it ends
+		while (!m_SplitBarriers.empty())
+			TransitionResource(*m_SplitBarriers.back().Resource, m_SplitBarriers.back().NewState);
+	}
+
+	void CommandContext::InsertUAVBarrier(GpuResource& Resource, bool FlushImmediate /*= false*/)
+	{
+		if (m_NumBarriersToFlush == MaxPendingBarriers)
+			FlushResourceBarriers();
+
+		D3D12_RESOURCE_BARRIER& BarrierDesc = m_ResourceBarrierBuffer[m_NumBarriersToFlush++];
+		BarrierDesc.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
+		BarrierDesc.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+		BarrierDesc.UAV.pResource = Resource.GetResource();
+		++m_BarrierStats.NumUAVBarriers;
+
+		if (FlushImmediate || m_NumBarriersToFlush == MaxPendingBarriers)
+			FlushResourceBarriers();
 	}
 
 	DescriptorHeapAllocation CommandContext::AllocateDynamicGPUVisibleDescriptor(UINT Count /*= 1*/)
@@ -252,6 +670,20 @@ namespace RHI
 		m_CommandList->IASetPrimitiveTopology(Topology);
 	}
 
+	void GraphicsContext::SetPipelineState(const PipelineState& PSO)
+	{
+		m_CommandList->SetPipelineState(PSO.GetD3D12PipelineState());
+		m_CommandList->SetGraphicsRootSignature(PSO.GetD3D12RootSignature());
+	}
+
+	const PipelineState* GraphicsContext::SetPipelineState(const AsyncPipelineState& PSO)
+	{
+		const PipelineState* BoundPSO = PSO.GetPipelineStateOrFallback();
+		if (BoundPSO != nullptr)
+			SetPipelineState(*BoundPSO);
+		return BoundPSO;
+	}
+
 	void GraphicsContext::SetRenderTargets(UINT NumRTVs, GpuResourceDescriptor* RTVs[], GpuResourceDescriptor* DSV /*= nullptr*/)
 	{
 		std::unique_ptr<D3D12_CPU_DESCRIPTOR_HANDLE[]> RTVHandles = nullptr;
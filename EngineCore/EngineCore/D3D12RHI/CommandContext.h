@@ -2,13 +2,17 @@
 #include "GpuBuffer.h"
 #include "GpuTexture.h"
 #include "DescriptorHeap.h"
+#include "DescriptorTableCache.h"
 #include "DynamicResource.h"
+#include "WorkerPool.h"
 
 namespace RHI
 {
 	class CommandContext;
 	class GraphicsContext;
 	class ComputeContext;
+	class PipelineState;
+	class AsyncPipelineState;
 
 	// Compute command only support those transition states
 #define VALID_COMPUTE_QUEUE_RESOURCE_STATES \
@@ -17,15 +21,31 @@ namespace RHI
 		| D3D12_RESOURCE_STATE_COPY_DEST \
 		| D3D12_RESOURCE_STATE_COPY_SOURCE )
 
+	// Copy command only support those transition states
+#define VALID_COPY_QUEUE_RESOURCE_STATES \
+		( D3D12_RESOURCE_STATE_COPY_DEST \
+		| D3D12_RESOURCE_STATE_COPY_SOURCE )
+
+	// Thread safe, contexts can be allocated and freed by the threads recording command lists
 	class CommandContextManager : public Singleton<CommandContextManager>
 	{
 	public:
-		CommandContext* AllocateCommandContext(D3D12_COMMAND_LIST_TYPE type);
+		CommandContextManager();
+
+		// The context is reset after the allocation lock is released, requesting its allocator may wait for the GPU.
+		// See CommandQueue::RequestAllocator for WaitAtCap
+		CommandContext* AllocateCommandContext(D3D12_COMMAND_LIST_TYPE type, bool WaitAtCap = true);
 		void FreeCommandContext(CommandContext* usedContext);
 
+		// Threads of CommandContext::RecordParallel, the thread that calls it records too
+		WorkerPool& GetRecordingWorkers() { return m_RecordingWorkers; }
+
 	private:
+		std::mutex m_ContextAllocationMutex;
 		std::vector<std::unique_ptr<CommandContext>> m_CommandContextPool[4];
 		std::queue<CommandContext*> m_AvailableCommandContexts[4];
+
+		WorkerPool m_RecordingWorkers;
 	};
 
 	/*
@@ -38,6 +58,7 @@ namespace RHI
 	class CommandContext
 	{
 		friend class CommandContextManager;
+		friend class UploadManager;
 	public:
 		~CommandContext();
 
@@ -47,8 +68,18 @@ namespace RHI
 
 		// Begin function : creating a command.
 		static CommandContext& Begin(const std::wstring ID = L"");
+		// Direct, compute or copy command list. A context is recorded by one thread at a time
+		static CommandContext& Begin(D3D12_COMMAND_LIST_TYPE Type, const std::wstring& ID = L"");
 		uint64_t Finish(bool WaitForCompletion = false, bool releaseDynamic = false);
 
+		// Submits the contexts (of the same type) in order with one ExecuteCommandLists call, the contexts are finished
+		static uint64_t FinishParallel(CommandContext* const* Contexts, UINT NumContexts, bool WaitForCompletion = false);
+		// Begins NumContexts contexts, records them in parallel with RecordFunc(Context, Index) on the worker threads
+		// of CommandContextManager, and submits them in index order. RecordFunc must not finish the context
+		// nor call RecordParallel
+		static uint64_t RecordParallel(D3D12_COMMAND_LIST_TYPE Type, UINT NumContexts,
+			const std::function<void(CommandContext&, UINT)>& RecordFunc, bool WaitForCompletion = false);
+
 		GraphicsContext& GetGraphicsContext()
 		{
 			assert(m_Type != D3D12_COMMAND_LIST_TYPE_COMPUTE && "Cannot convert async compute context to graphics");
@@ -60,28 +91,74 @@ namespace RHI
 			return reinterpret_cast<ComputeContext&>(*this);
 		}
 
-		// Resources Initialization
+		// Resources Initialization, the data is uploaded asynchronously if the UploadManager exists
 		static void InitializeBuffer(GpuBuffer& Dest, const void* Data, size_t NumBytes, size_t DestOffset = 0);
 		static void InitializeBuffer(GpuBuffer& Dest, const GpuUploadBuffer& Src, size_t SrcOffset, size_t NumBytes = -1, size_t DestOffset = 0);
 		static void InitializeTexture(GpuResource& Dest, UINT NumSubresources, D3D12_SUBRESOURCE_DATA SubData[]);
 
-		// 
+		// Barriers are batched and recorded with one ResourceBarrier call when a command that depends on them is recorded.
+		// A transition that is cancelled or extended by a later one before the flush is merged with it, 
+		// a read-only state that is already included in the current read state does not need a barrier.
+		// The first transition of a resource in the command list is resolved against its global state when the list is submitted
 		void TransitionResource(GpuResource& Resource, D3D12_RESOURCE_STATES NewState, bool FlushImmediate = false);
+		// Transition of one mip level / array slice / plane, see D3D12CalcSubresource
+		void TransitionSubresource(GpuResource& Resource, UINT Subresource, D3D12_RESOURCE_STATES NewState, bool FlushImmediate = false);
+		// Split barrier: the transition starts here and ends with TransitionResource(Resource, NewState),
+		// the GPU can overlap it with the commands recorded in between. The split barriers still open are ended when the
+		// context is submitted
+		void BeginResourceTransition(GpuResource& Resource, D3D12_RESOURCE_STATES NewState, bool FlushImmediate = false);
+		void InsertUAVBarrier(GpuResource& Resource, bool FlushImmediate = false);
 		inline void FlushResourceBarriers(void);
 
+		// Barrier counts of the current recording
+		struct BarrierStats
+		{
+			UINT32 NumTransitions = 0;
+			// Transitions that did not need a barrier or were merged with a pending one
+			UINT32 NumElided = 0;
+			UINT32 NumSplitBarriers = 0;
+			UINT32 NumUAVBarriers = 0;
+			UINT32 NumBarriersFlushed = 0;
+			// ResourceBarrier calls
+			UINT32 NumFlushes = 0;
+		};
+		const BarrierStats& GetBarrierStats() const { return m_BarrierStats; }
+
 		// Dynamic Descriptor is allocated on GPUDescriptorHeap and released in Finish
 		DescriptorHeapAllocation AllocateDynamicGPUVisibleDescriptor(UINT Count = 1);
+		// Dynamic descriptor tables already uploaded by this command list
+		DescriptorTableCache& GetDynamicDescriptorTableCache() { return m_DynamicDescriptorTableCache; }
+		// Changes when the dynamic descriptors allocated so far are retired, the cached tables must then be dropped
+		UINT64 GetDynamicDescriptorGeneration() const { return m_DynamicGPUDescriptorAllocator.GetRetireCount(); }
 
 		// Dynamic resource Allocate
 		D3D12DynamicAllocation AllocateDynamicSpace(size_t NumBytes, size_t Alignment);
 	private:
 		CommandContext(D3D12_COMMAND_LIST_TYPE type);
 
+		// Begins a context with a lock held (UploadManager): its allocator is created past the cap of the pool instead of
+		// waiting for the GPU
+		static CommandContext& BeginUnderLock(D3D12_COMMAND_LIST_TYPE Type, const std::wstring& ID);
+		// Context of the copy that initializes the buffer, a copy queue context for a sub-allocated buffer
+		static CommandContext& BeginBufferInitialization(GpuBuffer& Dest);
+
 		// Call when the CommandContext is created. This function will create a new commandList and request an Allocator
-		void Initialize();
+		void Initialize(bool WaitAtCap);
 
 		// Called when the CommandContext is reused to reset the rendering state
-		void Reset();
+		void Reset(bool WaitAtCap);
+
+		// Resolves the barriers of the contexts, executes them and gives them back to the manager, returns the fence value
+		static uint64_t Submit(CommandContext* const* Contexts, UINT NumContexts);
+
+		static ResourceStateTracker::TrackedResource GetTrackedResource(GpuResource& Resource);
+		// Returns false if no split barrier of the resource is open in this context
+		bool GetSplitBarrierState(const GpuResource& Resource, D3D12_RESOURCE_STATES& NewState) const;
+		void RemoveSplitBarrier(const GpuResource& Resource);
+		// Ends the split barriers still open, before the context is submitted
+		void EndSplitBarriers();
+		// Adds a transition barrier to the pending barriers, merged with a pending transition of the same subresource
+		void AddTransitionBarrier(const D3D12_RESOURCE_BARRIER& Barrier);
 
 	protected:
 		void SetID(const std::wstring& ID) { m_ID = ID; }
@@ -93,11 +170,36 @@ namespace RHI
 		ID3D12CommandAllocator* m_CurrentAllocator;
 
 		// Dynamic Descriptor
+		static constexpr UINT32 DynamicDescriptorChunkSize = 256;
 		DynamicSuballocationsManager m_DynamicGPUDescriptorAllocator;
+		DescriptorTableCache m_DynamicDescriptorTableCache;
 
 		// Dynamic Resource
 		DynamicResourceHeap m_DynamicResourceHeap;
 
+		// Pending barriers
+		static constexpr UINT32 MaxPendingBarriers = 16;
+		D3D12_RESOURCE_BARRIER m_ResourceBarrierBuffer[MaxPendingBarriers];
+		UINT32 m_NumBarriersToFlush = 0;
+		BarrierStats m_BarrierStats;
+
+		// Split barriers begun and not ended yet in this command list, a resource can be transitioning in several contexts
+		struct SplitBarrier
+		{
+			GpuResource* Resource;
+			D3D12_RESOURCE_STATES NewState;
+		};
+		std::vector<SplitBarrier> m_SplitBarriers;
+
+		// Resource states in this command list, the first uses are resolved against the global states in Finish
+		ResourceStateTracker m_StateTracker;
+		std::vector<D3D12_RESOURCE_BARRIER> m_TrackedBarriers;
+		// Records the barriers resolved in Finish, executed just before m_CommandList
+		Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> m_FixupCommandList;
+		ID3D12CommandAllocator* m_FixupAllocator = nullptr;
+		// Fence value of the last submission, the command lists cannot be reset before they are submitted
+		uint64_t m_LastFenceValue = 0;
+
 		std::wstring m_ID;
 	};
 
@@ -122,6 +224,12 @@ namespace RHI
 		void SetScissor(const D3D12_RECT& rect);
 		void SetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY Topology);
 
+		// Pipeline state and its root signature
+		void SetPipelineState(const PipelineState& PSO);
+		// The compiled pipeline, or its fallback while it is pending. Returns the pipeline bound,
+		// nullptr if there is none yet and the draws must be skipped
+		const PipelineState* SetPipelineState(const AsyncPipelineState& PSO);
+
 		void SetRenderTargets(UINT NumRTVs, GpuResourceDescriptor* RTVs[], GpuResourceDescriptor* DSV = nullptr);
 
 		// Vertex Buffer、Index Buffer
@@ -145,6 +253,20 @@ namespace RHI
 	class ComputeContext : public CommandContext
 	{
 	public:
-		
+		static ComputeContext& Begin(const std::wstring& ID = L"")
+		{
+			return CommandContext::Begin(D3D12_COMMAND_LIST_TYPE_COMPUTE, ID).GetComputeContext();
+		}
 	};
+
+	inline void CommandContext::FlushResourceBarriers(void)
+	{
+		if (m_NumBarriersToFlush > 0)
+		{
+			m_CommandList->ResourceBarrier(m_NumBarriersToFlush, m_ResourceBarrierBuffer);
+			m_BarrierStats.NumBarriersFlushed += m_NumBarriersToFlush;
+			++m_BarrierStats.NumFlushes;
+			m_NumBarriersToFlush = 0;
+		}
+	}
 }
\ No newline at end of file
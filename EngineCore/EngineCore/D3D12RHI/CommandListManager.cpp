@@ -14,17 +14,18 @@ namespace RHI
 
 	void CommandListManager::CreateNewCommandList(D3D12_COMMAND_LIST_TYPE type,
 		ID3D12GraphicsCommandList** cmdList,
-		ID3D12CommandAllocator** allocator)
+		ID3D12CommandAllocator** allocator,
+		bool WaitAtCap)
 	{
 		assert(type != D3D12_COMMAND_LIST_TYPE_BUNDLE && "Bundles are not yet supported");
 
 		switch (type)
 		{
-		case D3D12_COMMAND_LIST_TYPE_DIRECT: *allocator = m_GraphicsQueue.RequestAllocator();
+		case D3D12_COMMAND_LIST_TYPE_DIRECT: *allocator = m_GraphicsQueue.RequestAllocator(WaitAtCap);
 			break;
-		case D3D12_COMMAND_LIST_TYPE_COMPUTE: *allocator = m_ComputeQueue.RequestAllocator();
+		case D3D12_COMMAND_LIST_TYPE_COMPUTE: *allocator = m_ComputeQueue.RequestAllocator(WaitAtCap);
 			break;
-		case D3D12_COMMAND_LIST_TYPE_COPY: *allocator = m_CopyQueue.RequestAllocator();
+		case D3D12_COMMAND_LIST_TYPE_COPY: *allocator = m_CopyQueue.RequestAllocator(WaitAtCap);
 			break;
 		default:
 			break;
@@ -33,4 +34,46 @@ namespace RHI
 		ThrowIfFailed(m_Device->CreateCommandList(1, type, *allocator, nullptr, IID_PPV_ARGS(cmdList)));
 		(*cmdList)->SetName(L"CommandList");
 	}
+
+	bool CommandListManager::WaitForFences(const FenceTimelinePoint& point)
+	{
+		CommandQueue* queues[COMMAND_QUEUE_COUNT] = { &m_GraphicsQueue, &m_ComputeQueue, &m_CopyQueue };
+
+		ID3D12Fence* fences[COMMAND_QUEUE_COUNT];
+		UINT64 values[COMMAND_QUEUE_COUNT];
+		UINT32 numFences = 0;
+		for (UINT32 i = 0; i < COMMAND_QUEUE_COUNT; ++i)
+		{
+			if (point.Values[i] == 0 || queues[i]->IsFenceComplete(point.Values[i]))
+				continue;
+
+			queues[i]->PrepareWait(point.Values[i]);
+			fences[numFences] = queues[i]->m_pFence.Get();
+			values[numFences] = point.Values[i];
+			++numFences;
+		}
+
+		if (numFences == 0)
+			return true;
+
+		return RHI::WaitForFences(numFences, fences, values, m_GraphicsQueue.GetWaitPolicy());
+	}
+
+	bool CommandListManager::IdleGPU(void)
+	{
+		// All the queues are signaled first, the CPU then blocks once until the slowest one is done
+		FenceTimelinePoint point;
+		point.Values[COMMAND_QUEUE_GRAPHICS] = m_GraphicsQueue.IncrementFence();
+		point.Values[COMMAND_QUEUE_COMPUTE] = m_ComputeQueue.IncrementFence();
+		point.Values[COMMAND_QUEUE_COPY] = m_CopyQueue.IncrementFence();
+
+		return WaitForFences(point);
+	}
+
+	void CommandListManager::SetFenceWaitPolicy(const FenceWaitPolicy& policy)
+	{
+		m_GraphicsQueue.SetWaitPolicy(policy);
+		m_ComputeQueue.SetWaitPolicy(policy);
+		m_CopyQueue.SetWaitPolicy(policy);
+	}
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 #include "CommandQueue.h"
+#include "FenceTimeline.h"
 
 namespace RHI
 {
@@ -12,9 +13,11 @@ namespace RHI
 	public:
 		CommandListManager(ID3D12Device* device);
 
+		// See CommandQueue::RequestAllocator for WaitAtCap
 		void CreateNewCommandList(D3D12_COMMAND_LIST_TYPE type,
 			ID3D12GraphicsCommandList** cmdList,
-			ID3D12CommandAllocator** allocator);
+			ID3D12CommandAllocator** allocator,
+			bool WaitAtCap = true);
 
 		CommandQueue& GetQueue(D3D12_COMMAND_LIST_TYPE type = D3D12_COMMAND_LIST_TYPE_DIRECT)
 		{
@@ -32,17 +35,35 @@ namespace RHI
 		}
 
 		// The CPU will wait for a fence to reach a specified value
-		void WaitForFence(uint64_t fenceValue, D3D12_COMMAND_LIST_TYPE type)
+		bool WaitForFence(uint64_t fenceValue, D3D12_COMMAND_LIST_TYPE type)
 		{
 			return GetQueue(type).WaitForFence(fenceValue);
 		}
 
+		// The CPU waits for the fences of several queues at once, the values of the queues not waited for are 0.
+		// Returns false if the timeout of the wait policy expired
+		bool WaitForFences(const FenceTimelinePoint& point);
+
 		// The CPU will wait for all command queues to empty (so that the GPU is idle)
-		void IdleGPU(void)
+		bool IdleGPU(void);
+
+		// Spin time and timeout of the CPU waits on every queue
+		void SetFenceWaitPolicy(const FenceWaitPolicy& policy);
+
+		// Batch the command lists finished on each queue into one submission, see CommandQueue::SetSubmissionCoalescing
+		void SetSubmissionCoalescing(bool enable)
+		{
+			m_GraphicsQueue.SetSubmissionCoalescing(enable);
+			m_ComputeQueue.SetSubmissionCoalescing(enable);
+			m_CopyQueue.SetSubmissionCoalescing(enable);
+		}
+
+		// End of the frame: the batched command lists are submitted and the submission counters restart
+		void FinishFrame(void)
 		{
-			m_GraphicsQueue.WaitForIdle();
-			m_ComputeQueue.WaitForIdle();
-			m_CopyQueue.WaitForIdle();
+			m_GraphicsQueue.FinishFrame();
+			m_ComputeQueue.FinishFrame();
+			m_CopyQueue.FinishFrame();
 		}
 
 		// Getters
@@ -19,67 +19,176 @@ namespace RHI
 		// Fence
 		ThrowIfFailed(device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_pFence)));
 		m_pFence->SetName(L"CommandListManager::m_pFence");
-
-		// Fence Event
-		m_FenceEventHandle = CreateEvent(nullptr, false, false, nullptr);
-		assert(m_FenceEventHandle != NULL);
 	}
 
 	CommandQueue::~CommandQueue()
 	{
-		CloseHandle(m_FenceEventHandle);
 	}
 
 	UINT64 CommandQueue::IncrementFence(void)
 	{
-		m_CommandQueue->Signal(m_pFence.Get(), m_NextFenceValue);
-		return m_NextFenceValue++;
+		std::lock_guard<std::mutex> lock(m_SubmissionMutex);
+		SubmitPendingLists();
+		return SignalNextFence();
 	}
 
 	bool CommandQueue::IsFenceComplete(UINT64 FenceValue)
 	{
-		// Avoid querying the fence value by testing against the last one seen.
-		// The max() is to protect against an unlikely race condition that could cause the last
-		// completed fence value to regress.
-		if (FenceValue > m_LastCompletedFenceValue)
-			m_LastCompletedFenceValue = std::max(m_LastCompletedFenceValue, m_pFence->GetCompletedValue());
+		// Avoid querying the fence value by testing against the last one seen
+		if (FenceValue > m_LastCompletedFenceValue.load(std::memory_order_acquire))
+			UpdateLastCompletedFenceValue(m_pFence->GetCompletedValue());
 
-		return FenceValue <= m_LastCompletedFenceValue;
+		return FenceValue <= m_LastCompletedFenceValue.load(std::memory_order_acquire);
 	}
 
-	void CommandQueue::WaitForFence(UINT64 FenceValue)
+	bool CommandQueue::WaitForFence(UINT64 FenceValue)
 	{
 		if (IsFenceComplete(FenceValue))
-			return;
+			return true;
+
+		PrepareWait(FenceValue);
+
+		ID3D12Fence* Fence = m_pFence.Get();
+		if (!WaitForFences(1, &Fence, &FenceValue, m_WaitPolicy))
+			return false;
 
-		m_pFence->SetEventOnCompletion(FenceValue, m_FenceEventHandle);
-		WaitForSingleObject(m_FenceEventHandle, INFINITE);
-		m_LastCompletedFenceValue = FenceValue;
+		UpdateLastCompletedFenceValue(FenceValue);
+		return true;
+	}
+
+	void CommandQueue::UpdateLastCompletedFenceValue(UINT64 FenceValue)
+	{
+		// Another thread may have seen a later value in the meantime
+		UINT64 LastCompletedFenceValue = m_LastCompletedFenceValue.load(std::memory_order_relaxed);
+		while (FenceValue > LastCompletedFenceValue &&
+			!m_LastCompletedFenceValue.compare_exchange_weak(LastCompletedFenceValue, FenceValue, std::memory_order_release, std::memory_order_relaxed))
+		{
+		}
+	}
+
+	void CommandQueue::PrepareWait(UINT64 FenceValue)
+	{
+		// The fence is signaled after the coalesced command lists
+		std::lock_guard<std::mutex> lock(m_SubmissionMutex);
+		if (FenceValue >= m_NextFenceValue.load())
+			SubmitPendingLists();
+		assert(FenceValue < m_NextFenceValue.load() && "Waiting for a fence value that is never signaled");
 	}
 
 	UINT64 CommandQueue::ExecuteCommandList(ID3D12CommandList* List)
 	{
-		ThrowIfFailed(((ID3D12GraphicsCommandList*)List)->Close());
+		return ExecuteCommandLists(1, &List);
+	}
+
+	UINT64 CommandQueue::ExecuteCommandLists(UINT NumLists, ID3D12CommandList* const* Lists)
+	{
+		for (UINT i = 0; i < NumLists; ++i)
+			ThrowIfFailed(((ID3D12GraphicsCommandList*)Lists[i])->Close());
+
+		std::lock_guard<std::mutex> lock(m_SubmissionMutex);
+
+		m_FrameStats.NumCommandLists += NumLists;
+
+		// The lists are submitted with the next batch, and the fence value signaled after it
+		if (m_CoalesceSubmissions)
+		{
+			m_PendingLists.insert(m_PendingLists.end(), Lists, Lists + NumLists);
+			return m_NextFenceValue.load();
+		}
+
+		// Kickoff the command lists
+		m_CommandQueue->ExecuteCommandLists(NumLists, Lists);
+		++m_FrameStats.NumSubmissions;
+
+		return SignalNextFence();
+	}
+
+	UINT64 CommandQueue::GetLastExecutedFenceValue(void)
+	{
+		std::lock_guard<std::mutex> lock(m_SubmissionMutex);
+		return m_PendingLists.empty() ? m_NextFenceValue.load() - 1 : m_NextFenceValue.load();
+	}
+
+	void CommandQueue::SetSubmissionCoalescing(bool Enable)
+	{
+		std::lock_guard<std::mutex> lock(m_SubmissionMutex);
+		if (!Enable)
+			SubmitPendingLists();
+		m_CoalesceSubmissions = Enable;
+	}
 
-		// Kickoff the command list
-		m_CommandQueue->ExecuteCommandLists(1, &List);
+	UINT64 CommandQueue::FlushSubmissions(void)
+	{
+		std::lock_guard<std::mutex> lock(m_SubmissionMutex);
+		return SubmitPendingLists();
+	}
 
+	void CommandQueue::WaitForQueue(CommandQueue& Other, UINT64 FenceValue)
+	{
+		assert(&Other != this);
+
+		// The fence value may belong to a coalesced submission of the other queue
+		if (FenceValue >= Other.GetNextFenceValue())
+			Other.FlushSubmissions();
+
+		std::lock_guard<std::mutex> lock(m_SubmissionMutex);
+		// The lists already executed do not depend on the other queue
+		SubmitPendingLists();
+		m_CommandQueue->Wait(Other.m_pFence.Get(), FenceValue);
+	}
+
+	void CommandQueue::FinishFrame(void)
+	{
+		std::lock_guard<std::mutex> lock(m_SubmissionMutex);
+		SubmitPendingLists();
+		m_LastFrameStats = m_FrameStats;
+		m_FrameStats = SubmissionStats{};
+	}
+
+	UINT64 CommandQueue::SubmitPendingLists(void)
+	{
+		if (m_PendingLists.empty())
+			return m_NextFenceValue.load() - 1;
+
+		m_CommandQueue->ExecuteCommandLists((UINT)m_PendingLists.size(), m_PendingLists.data());
+		++m_FrameStats.NumSubmissions;
+		m_PendingLists.clear();
+
+		return SignalNextFence();
+	}
+
+	UINT64 CommandQueue::SignalNextFence(void)
+	{
 		// Signal the next fence value (with the GPU)
-		m_CommandQueue->Signal(m_pFence.Get(), m_NextFenceValue);
+		m_CommandQueue->Signal(m_pFence.Get(), m_NextFenceValue.load());
+		++m_FrameStats.NumSignals;
 
-		// And increment the fence value.  
-		return m_NextFenceValue++;
+		// And increment the fence value, the mutex orders the signals
+		return m_NextFenceValue.fetch_add(1, std::memory_order_acq_rel);
 	}
 
-	ID3D12CommandAllocator* CommandQueue::RequestAllocator(void)
+	ID3D12CommandAllocator* CommandQueue::RequestAllocator(bool WaitAtCap)
 	{
-		uint64_t CompletedFence = m_pFence->GetCompletedValue();
+		ID3D12CommandAllocator* Allocator = m_AllocatorPool.RequestAllocator(m_pFence->GetCompletedValue(), !WaitAtCap);
+
+		// The pool reached its cap, wait for the oldest allocator instead of creating another one
+		while (Allocator == nullptr)
+		{
+			UINT64 OldestFenceValue = m_AllocatorPool.GetOldestFenceValue();
+			if (OldestFenceValue != 0)
+				WaitForFence(OldestFenceValue);
+
+			Allocator = m_AllocatorPool.RequestAllocator(m_pFence->GetCompletedValue());
+		}
 
-		return m_AllocatorPool.RequestAllocator(CompletedFence);
+		m_RecordingLists.Begin(Allocator);
+		return Allocator;
 	}
 
 	void CommandQueue::DiscardAllocator(uint64_t fenceValue, ID3D12CommandAllocator* allocator)
 	{
+		// The list is executed, GetLastExecutedFenceValue covers it
+		m_RecordingLists.End(allocator);
 		m_AllocatorPool.DiscardAllocator(fenceValue, allocator);
 	}
 }
\ No newline at end of file
@@ -1,5 +1,7 @@
 #pragma once
 #include "CommandAllocatorPool.h"
+#include "FenceWait.h"
+#include "FenceTimeline.h"
 
 namespace RHI
 {
@@ -13,28 +15,87 @@ namespace RHI
 
 		UINT64 IncrementFence(void);
 		bool IsFenceComplete(UINT64 FenceValue);
-		void WaitForFence(UINT64 FenceValue);
-		void WaitForIdle(void) { WaitForFence(IncrementFence()); }
+		// Spins then blocks, see FenceWait.h. Returns false if the timeout of the wait policy expired
+		bool WaitForFence(UINT64 FenceValue);
+		bool WaitForIdle(void) { return WaitForFence(IncrementFence()); }
 
-		UINT64 GetNextFenceValue() const { return m_NextFenceValue; }
+		void SetWaitPolicy(const FenceWaitPolicy& Policy) { m_WaitPolicy = Policy; }
+		const FenceWaitPolicy& GetWaitPolicy() const { return m_WaitPolicy; }
+
+		UINT64 GetNextFenceValue() const { return m_NextFenceValue.load(std::memory_order_acquire); }
 		UINT64 GetCompletedFenceValue() const { return m_pFence->GetCompletedValue(); }
+		// Fence value signaled after the command lists executed so far, including the coalesced lists that are not submitted yet
+		UINT64 GetLastExecutedFenceValue(void);
+
+		// A command list is recorded from RequestAllocator until its allocator is discarded, once the list is executed.
+		// An object released now waits for the lists begun before the ticket (see DeferredReleaseQueue)
+		UINT64 GetRecordingTicket(void) { return m_RecordingLists.GetNextTicket(); }
+		bool AreListsExecuted(UINT64 Ticket) { return m_RecordingLists.AreExecuted(Ticket); }
+
+		// Coalescing: while enabled, the executed command lists are only closed and kept, they are submitted together
+		// with one fence signal by FlushSubmissions, or when the CPU waits for their fence.
+		// All the lists of a batch share the fence value returned when they are executed
+		void SetSubmissionCoalescing(bool Enable);
+		// Submits the coalesced command lists, returns the last signaled fence value
+		UINT64 FlushSubmissions(void);
+
+		// GPU-side wait: the command lists submitted to this queue after the call wait until Other reaches FenceValue
+		void WaitForQueue(CommandQueue& Other, UINT64 FenceValue);
+
+		struct SubmissionStats
+		{
+			// ID3D12CommandQueue::ExecuteCommandLists calls
+			UINT32 NumSubmissions = 0;
+			UINT32 NumCommandLists = 0;
+			UINT32 NumSignals = 0;
+		};
+		// Flushes the submissions and starts counting the submissions of the next frame
+		void FinishFrame(void);
+		SubmissionStats GetLastFrameStats() const { return m_LastFrameStats; }
+		CommandAllocatorPool::Stats GetAllocatorStats() { return m_AllocatorPool.GetStats(); }
+
 	private:
 		UINT64 ExecuteCommandList(ID3D12CommandList* List);
+		// The lists are closed and executed in order, the returned fence value is signaled once all of them are done
+		UINT64 ExecuteCommandLists(UINT NumLists, ID3D12CommandList* const* Lists);
 
-		ID3D12CommandAllocator* RequestAllocator(void);
+		// Waits for the GPU while the allocator pool is at its cap, must not be called with a lock held.
+		// WaitAtCap = false creates the allocator past the cap instead, for the lists begun under a lock
+		ID3D12CommandAllocator* RequestAllocator(bool WaitAtCap = true);
 		void DiscardAllocator(uint64_t fenceValue, ID3D12CommandAllocator* allocator);
 
+		// The coalesced command lists are submitted if FenceValue is signaled after them
+		void PrepareWait(UINT64 FenceValue);
+
+		// Must be called with m_SubmissionMutex locked
+		UINT64 SubmitPendingLists(void);
+		UINT64 SignalNextFence(void);
+
+		// Raises the last completed fence value, concurrent updates never make it regress
+		void UpdateLastCompletedFenceValue(UINT64 FenceValue);
+
 		// CommandQueue
 		Microsoft::WRL::ComPtr<ID3D12CommandQueue> m_CommandQueue;
 		
 		const D3D12_COMMAND_LIST_TYPE m_Type;
-		// CommandPool 
+		// CommandPool, thread safe
 		CommandAllocatorPool m_AllocatorPool;
+		// The lists whose allocator is not discarded yet
+		RecordingLists m_RecordingLists;
+		// Command contexts are finished on several threads
+		std::mutex m_SubmissionMutex;
+
+		// Closed command lists waiting for the coalesced submission
+		bool m_CoalesceSubmissions = false;
+		std::vector<ID3D12CommandList*> m_PendingLists;
+		SubmissionStats m_FrameStats;
+		SubmissionStats m_LastFrameStats;
 
 		// Fences
 		Microsoft::WRL::ComPtr<ID3D12Fence> m_pFence;
-		UINT64 m_NextFenceValue;
-		UINT64 m_LastCompletedFenceValue;
-		HANDLE m_FenceEventHandle;
+		// Only incremented with m_SubmissionMutex locked, read without it
+		std::atomic<UINT64> m_NextFenceValue;
+		std::atomic<UINT64> m_LastCompletedFenceValue;
+		FenceWaitPolicy m_WaitPolicy;
 	};
 }
\ No newline at end of file
@@ -91,12 +91,20 @@ namespace RHI
 		if (allocation.IsNull())
 			return;
 
-		auto descriptorOffset = (allocation.GetCpuHandle().ptr - m_FirstCPUHandle.ptr) / m_DescriptorIncrementSize;
-		m_FreeBlockManager.Free(descriptorOffset, allocation.GetNumHandles());
+		FreeRange(allocation.GetCpuHandle(), static_cast<UINT32>(allocation.GetNumHandles()));
 
 		allocation.Reset();
 	}
 
+	void DescriptorHeapAllocationManager::FreeRange(D3D12_CPU_DESCRIPTOR_HANDLE firstHandle, UINT32 numHandles)
+	{
+		assert(firstHandle.ptr >= m_FirstCPUHandle.ptr && "The range does not belong to this manager");
+
+		auto descriptorOffset = (firstHandle.ptr - m_FirstCPUHandle.ptr) / m_DescriptorIncrementSize;
+		assert(descriptorOffset + numHandles <= m_NumDescriptorsInAllocation && "The range does not belong to this manager");
+		m_FreeBlockManager.Free(descriptorOffset, numHandles);
+	}
+
 	// ---------------------- CPU DESCRIPTOR HEAP --------------------
 	CPUDescriptorHeap::CPUDescriptorHeap(RenderDevice& renderDevice,
 		UINT32 numDescriptorsInHeap,
@@ -113,6 +121,17 @@ namespace RHI
 
 	CPUDescriptorHeap::~CPUDescriptorHeap()
 	{
+		// The GPU is idle when the heap is destroyed, the open bucket can be returned immediately
+		std::vector<StaleRange> ranges;
+		{
+			std::lock_guard<std::mutex> lock(m_StaleRangesMutex);
+			TakePendingFrees();
+			ranges.swap(m_StaleRanges);
+		}
+		FreeStaleRanges(ranges);
+
+		SetConcurrentMode(false);
+
 		assert((m_CurrentSize == 0) && "Not all allocations released");
 		assert((m_AvailableHeaps.size() == m_HeapPool.size()) && "Not all descriptor heap pools are released");
 	}
@@ -120,6 +139,28 @@ namespace RHI
 	// When allocating a new descriptor, the CPUDescriptorHeap goes throght the list of managers that have avaliable descriptor and try 
 	// to process the request. If there are no avaliable managers to handle the request, create a new descriptor heap manager.
 	DescriptorHeapAllocation CPUDescriptorHeap::Allocate(uint32_t count)
+	{
+		DescriptorHeapAllocation allocation;
+		if (count == 1 && IsConcurrentMode())
+		{
+			allocation = AllocateFromThreadCache();
+		}
+		else
+		{
+			std::lock_guard<std::mutex> lock(m_HeapPoolMutex);
+			allocation = AllocateFromPool(count);
+		}
+
+		UINT32 currentSize = m_CurrentSize.fetch_add(static_cast<UINT32>(allocation.GetNumHandles())) + static_cast<UINT32>(allocation.GetNumHandles());
+		UINT32 maxSize = m_MaxSize.load(std::memory_order_relaxed);
+		while (currentSize > maxSize && !m_MaxSize.compare_exchange_weak(maxSize, currentSize, std::memory_order_relaxed))
+		{
+		}
+
+		return allocation;
+	}
+
+	DescriptorHeapAllocation CPUDescriptorHeap::AllocateFromPool(UINT32 count)
 	{
 		DescriptorHeapAllocation allocation;
 
@@ -165,52 +206,237 @@ namespace RHI
 			allocation = m_HeapPool[m_HeapPool.size() - 1].Allocate(count);
 		}
 
-		m_CurrentSize += static_cast<UINT32>(allocation.GetNumHandles());
-		m_MaxSize = std::max(m_MaxSize, m_CurrentSize);
-
 		return allocation;
 	}
 
+	DescriptorHeapAllocation CPUDescriptorHeap::AllocateFromThreadCache()
+	{
+		CachedDescriptor descriptor;
+		bool cached = m_ThreadCaches.Pop(descriptor, [this](std::vector<CachedDescriptor>& descriptors)
+		{
+			// Refill the cache with one contiguous range, single descriptors of the range are released one by one later,
+			// the allocations manager merges them back
+			DescriptorHeapAllocation batch;
+			{
+				std::lock_guard<std::mutex> lock(m_HeapPoolMutex);
+				batch = AllocateFromPool(ThreadCacheBatchSize);
+			}
+
+			// Push in reverse order, so that the descriptors are handed out in increasing address order
+			for (UINT32 i = ThreadCacheBatchSize; i > 0; --i)
+				descriptors.push_back({ batch.GetCpuHandle(i - 1), batch.GetDescriptorHeap(), static_cast<UINT16>(batch.GetAllocationManagerId()) });
+
+			// The descriptors are owned by the cache now
+			batch.Reset();
+		});
+
+		// The mode was disabled in the meantime
+		if (!cached)
+		{
+			std::lock_guard<std::mutex> lock(m_HeapPoolMutex);
+			return AllocateFromPool(1);
+		}
+
+		D3D12_GPU_DESCRIPTOR_HANDLE nullGpuHandle = { 0 };
+		return DescriptorHeapAllocation(*this, descriptor.DescriptorHeap, descriptor.CpuHandle, nullGpuHandle, 1, descriptor.AllocationManagerId);
+	}
+
+	void CPUDescriptorHeap::ReturnCachedDescriptors(const std::vector<CachedDescriptor>& descriptors)
+	{
+		D3D12_GPU_DESCRIPTOR_HANDLE nullGpuHandle = { 0 };
+		for (const auto& descriptor : descriptors)
+		{
+			DescriptorHeapAllocation allocation(*this, descriptor.DescriptorHeap, descriptor.CpuHandle, nullGpuHandle, 1, descriptor.AllocationManagerId);
+			m_HeapPool[descriptor.AllocationManagerId].FreeAllocation(std::move(allocation));
+			m_AvailableHeaps.insert(descriptor.AllocationManagerId);
+		}
+	}
+
+	void CPUDescriptorHeap::SetConcurrentMode(bool enable)
+	{
+		if (enable)
+		{
+			m_ThreadCaches.Enable();
+			return;
+		}
+
+		// Waits for the allocations and refills in progress on the other threads
+		m_ThreadCaches.Disable([this](std::vector<CachedDescriptor>& descriptors)
+		{
+			std::lock_guard<std::mutex> lock(m_HeapPoolMutex);
+			ReturnCachedDescriptors(descriptors);
+		});
+	}
+
+	struct CPUDescriptorHeap::StaleRangeBucket
+	{
+		std::vector<StaleRange> Ranges;
+		CPUDescriptorHeap* Heap;
+
+		StaleRangeBucket(std::vector<StaleRange>&& _Ranges, CPUDescriptorHeap& _Heap)noexcept :
+			Ranges{ std::move(_Ranges) },
+			Heap{ &_Heap }
+		{
+		}
+
+		StaleRangeBucket(const StaleRangeBucket&) = delete;
+		StaleRangeBucket& operator= (const StaleRangeBucket&) = delete;
+		StaleRangeBucket& operator= (StaleRangeBucket&&) = delete;
+
+		StaleRangeBucket(StaleRangeBucket&& rhs)noexcept :
+			Ranges{ std::move(rhs.Ranges) },
+			Heap{ rhs.Heap }
+		{
+			rhs.Heap = nullptr;
+		}
+
+		~StaleRangeBucket()
+		{
+			if (Heap != nullptr)
+				Heap->FreeStaleRanges(Ranges);
+		}
+	};
+
 	void CPUDescriptorHeap::Free(DescriptorHeapAllocation&& allocation)
 	{
-		struct StaleAllocation
+		if (IsConcurrentMode())
 		{
-			DescriptorHeapAllocation Allocation;
-			CPUDescriptorHeap* Heap;
+			// Loader threads do not take the bucket mutex, only push the allocation to the stack here.
+			// Nodes are never popped one by one (TakePendingFrees takes the whole stack), so there is no ABA problem
+			PendingFree* node = new PendingFree{ std::move(allocation), nullptr };
+			node->Next = m_PendingFrees.load(std::memory_order_relaxed);
+			while (!m_PendingFrees.compare_exchange_weak(node->Next, node, std::memory_order_release, std::memory_order_relaxed))
+			{
+			}
+			return;
+		}
 
-			StaleAllocation(DescriptorHeapAllocation&& _Allocation, CPUDescriptorHeap& _Heap)noexcept :
-				Allocation{ std::move(_Allocation) },
-				Heap{ &_Heap }
+		std::lock_guard<std::mutex> lock(m_StaleRangesMutex);
+		AddStaleRange(std::move(allocation));
+	}
+
+	void CPUDescriptorHeap::ReleasePendingFrees()
+	{
+		std::vector<StaleRange> ranges;
+		{
+			std::lock_guard<std::mutex> lock(m_StaleRangesMutex);
+			TakePendingFrees();
+			if (m_StaleRanges.empty())
+				return;
+
+			// Close the bucket, the next one starts with a spare vector
+			ranges.swap(m_StaleRanges);
+			if (!m_SpareStaleRanges.empty())
 			{
+				m_StaleRanges.swap(m_SpareStaleRanges.back());
+				m_SpareStaleRanges.pop_back();
 			}
+		}
 
-			StaleAllocation(const StaleAllocation&) = delete;
-			StaleAllocation& operator= (const StaleAllocation&) = delete;
-			StaleAllocation& operator= (StaleAllocation&&) = delete;
+		// The bucket is stamped with the current fence values, which are not smaller than the ones at the time of Free()
+		m_RenderDevice.SafeReleaseDeviceObject(StaleRangeBucket{ std::move(ranges), *this }, COMMAND_QUEUE_MASK_GRAPHICS | COMMAND_QUEUE_MASK_COMPUTE);
+	}
 
-			StaleAllocation(StaleAllocation&& rhs)noexcept :
-				Allocation{ std::move(rhs.Allocation) },
-				Heap{ rhs.Heap }
+	void CPUDescriptorHeap::AddStaleRange(DescriptorHeapAllocation&& allocation)
+	{
+		if (allocation.IsNull())
+			return;
+
+		m_StaleRanges.push_back({ allocation.GetCpuHandle().ptr, static_cast<UINT32>(allocation.GetNumHandles()), static_cast<UINT16>(allocation.GetAllocationManagerId()) });
+
+		// The descriptors are owned by the bucket now
+		allocation.Reset();
+	}
+
+	void CPUDescriptorHeap::TakePendingFrees()
+	{
+		PendingFree* pendingFree = m_PendingFrees.exchange(nullptr, std::memory_order_acquire);
+		while (pendingFree != nullptr)
+		{
+			PendingFree* next = pendingFree->Next;
+			AddStaleRange(std::move(pendingFree->Allocation));
+			delete pendingFree;
+			pendingFree = next;
+		}
+	}
+
+	void CPUDescriptorHeap::FreeStaleRanges(std::vector<StaleRange>& ranges)
+	{
+		if (ranges.empty())
+			return;
+
+		// Sort by manager and address, so that the ranges adjacent in a heap are next to each other
+		std::sort(ranges.begin(), ranges.end(), [](const StaleRange& lhs, const StaleRange& rhs)
+		{
+			return lhs.AllocationManagerId != rhs.AllocationManagerId ? lhs.AllocationManagerId < rhs.AllocationManagerId : lhs.CpuHandle < rhs.CpuHandle;
+		});
+
+		// Merge the adjacent ranges in place, the managers only see the merged ranges
+		UINT32 numHandles = 0;
+		size_t numMergedRanges = 0;
+		for (const StaleRange& range : ranges)
+		{
+			numHandles += range.NumHandles;
+
+			if (numMergedRanges > 0)
 			{
-				rhs.Heap = nullptr;
+				StaleRange& lastRange = ranges[numMergedRanges - 1];
+				if (lastRange.AllocationManagerId == range.AllocationManagerId &&
+					lastRange.CpuHandle + static_cast<SIZE_T>(lastRange.NumHandles) * m_DescriptorSize == range.CpuHandle)
+				{
+					lastRange.NumHandles += range.NumHandles;
+					continue;
+				}
 			}
 
-			~StaleAllocation()
+			ranges[numMergedRanges++] = range;
+		}
+		ranges.resize(numMergedRanges);
+
+		// Logged before the handles can be allocated again, the descriptor table caches only drop the tables using these ranges
+		{
+			std::lock_guard<std::mutex> lock(m_FreedRangeLogMutex);
+			UINT64 epoch = m_FreeEpoch.load(std::memory_order_relaxed);
+			for (const StaleRange& range : ranges)
 			{
-				if (Heap != nullptr)
-					Heap->FreeAllocation(std::move(Allocation));
+				m_FreedRangeLog[epoch % FreedRangeLogSize] = { range.CpuHandle, range.CpuHandle + static_cast<SIZE_T>(range.NumHandles) * m_DescriptorSize };
+				++epoch;
 			}
-		};
+			m_FreeEpoch.store(epoch, std::memory_order_release);
+		}
 
-		m_RenderDevice.SafeReleaseDeviceObject(StaleAllocation{ std::move(allocation), *this });
+		m_CurrentSize.fetch_sub(numHandles);
+		{
+			std::lock_guard<std::mutex> lock(m_HeapPoolMutex);
+			for (const StaleRange& range : ranges)
+			{
+				D3D12_CPU_DESCRIPTOR_HANDLE firstHandle = { range.CpuHandle };
+				m_HeapPool[range.AllocationManagerId].FreeRange(firstHandle, range.NumHandles);
+				m_AvailableHeaps.insert(range.AllocationManagerId);
+			}
+		}
+
+		// Keep the vector for a later bucket
+		ranges.clear();
+		std::lock_guard<std::mutex> lock(m_StaleRangesMutex);
+		if (m_SpareStaleRanges.size() < MaxSpareStaleRanges)
+			m_SpareStaleRanges.emplace_back(std::move(ranges));
 	}
 
-	void CPUDescriptorHeap::FreeAllocation(DescriptorHeapAllocation&& allocation)
+	bool CPUDescriptorHeap::GetFreedRanges(UINT64& epoch, std::vector<FreedRange>& ranges)
 	{
-		auto managerID = allocation.GetAllocationManagerId();
-		m_CurrentSize -= static_cast<UINT32>(allocation.GetNumHandles());
-		m_HeapPool[managerID].FreeAllocation(std::move(allocation));
-		m_AvailableHeaps.insert(managerID);
+		std::lock_guard<std::mutex> lock(m_FreedRangeLogMutex);
+		UINT64 currentEpoch = m_FreeEpoch.load(std::memory_order_relaxed);
+		if (currentEpoch - epoch > FreedRangeLogSize)
+		{
+			epoch = currentEpoch;
+			return false;
+		}
+
+		for (; epoch < currentEpoch; ++epoch)
+			ranges.push_back(m_FreedRangeLog[epoch % FreedRangeLogSize]);
+
+		return true;
 	}
 
 	// ---------------------------- GPU DESCRIPTOR HEAP -------------------------
@@ -239,14 +465,68 @@ namespace RHI
 	},
 	m_DescriptorSize{ renderDevice.GetD3D12Device()->GetDescriptorHandleIncrementSize(type) },
 	m_HeapAllocationManager{ renderDevice, *this, 0, m_DescriptorHeap, 0, numDescriptorsInHeap },
-	m_DynamicAllocationsManager{ renderDevice, *this, 1, m_DescriptorHeap, numDescriptorsInHeap, numDynamicDescriptors }
+	m_DynamicRing{ numDynamicDescriptors }
 	{
+		// The dynamic space follows the static space in the same D3D12 heap
+		m_FirstDynamicCPUHandle = m_DescriptorHeap->GetCPUDescriptorHandleForHeapStart();
+		m_FirstDynamicCPUHandle.ptr += static_cast<SIZE_T>(m_DescriptorSize) * numDescriptorsInHeap;
 
+		m_FirstDynamicGPUHandle = m_DescriptorHeap->GetGPUDescriptorHandleForHeapStart();
+		m_FirstDynamicGPUHandle.ptr += static_cast<UINT64>(m_DescriptorSize) * numDescriptorsInHeap;
 	}
 
 	GPUDescriptorHeap::~GPUDescriptorHeap()
 	{
+		// Chunks that were not reclaimed yet are finished, the GPU is idle at this point
+		FenceTimelinePoint lastPoint;
+		for (auto& value : lastPoint.Values)
+			value = std::numeric_limits<UINT64>::max();
+
+		m_DynamicRing.ReleaseCompleted(lastPoint);
+		assert(m_DynamicRing.IsEmpty() && "All dynamic descriptors must be released, a command context still holds chunks");
+	}
 
+	bool GPUDescriptorHeap::AllocateDynamicChunk(UINT32 count, DynamicRing::Block& chunk)
+	{
+		std::lock_guard<std::mutex> lock(m_DynamicRingMutex);
+		return m_DynamicRing.Allocate(count, chunk);
+	}
+
+	void GPUDescriptorHeap::RetireDynamicChunks(const std::vector<DynamicRing::Block>& chunks, const FenceTimelinePoint& retirePoint)
+	{
+		std::lock_guard<std::mutex> lock(m_DynamicRingMutex);
+		for (const auto& chunk : chunks)
+			m_DynamicRing.Retire(chunk.Id, retirePoint);
+	}
+
+	DescriptorHeapAllocation GPUDescriptorHeap::GetDynamicAllocation(size_t offset, UINT32 count, IDescriptorAllocator& owner)
+	{
+		auto CPUHandle = m_FirstDynamicCPUHandle;
+		CPUHandle.ptr += offset * m_DescriptorSize;
+
+		auto GPUHandle = m_FirstDynamicGPUHandle;
+		GPUHandle.ptr += offset * m_DescriptorSize;
+
+		// Manager ID 1 is the dynamic space
+		return DescriptorHeapAllocation(owner, m_DescriptorHeap.Get(), CPUHandle, GPUHandle, count, 1);
+	}
+
+	void GPUDescriptorHeap::ReleaseCompletedDynamic(const FenceTimelinePoint& completedPoint)
+	{
+		std::lock_guard<std::mutex> lock(m_DynamicRingMutex);
+		m_DynamicRing.ReleaseCompleted(completedPoint);
+	}
+
+	UINT32 GPUDescriptorHeap::GetDynamicDescriptorsInUse()
+	{
+		std::lock_guard<std::mutex> lock(m_DynamicRingMutex);
+		return static_cast<UINT32>(m_DynamicRing.GetUsedSize());
+	}
+
+	UINT32 GPUDescriptorHeap::GetPeakDynamicDescriptors()
+	{
+		std::lock_guard<std::mutex> lock(m_DynamicRingMutex);
+		return static_cast<UINT32>(m_DynamicRing.GetPeakUsedSize());
 	}
 
 	void GPUDescriptorHeap::Free(DescriptorHeapAllocation&& allocation)
@@ -279,22 +559,14 @@ namespace RHI
 			{
 				if (Heap != nullptr)
 				{
-					auto MgrId = Allocation.GetAllocationManagerId();
-					assert((MgrId == 0 || MgrId == 1) && "Unexpected allocation manager ID");
-
-					if (MgrId == 0)
-					{
-						Heap->m_HeapAllocationManager.FreeAllocation(std::move(Allocation));
-					}
-					else
-					{
-						Heap->m_DynamicAllocationsManager.FreeAllocation(std::move(Allocation));
-					}
+					// Dynamic allocations are owned by DynamicSuballocationsManager and never come here
+					assert(Allocation.GetAllocationManagerId() == 0 && "Unexpected allocation manager ID");
+					Heap->m_HeapAllocationManager.FreeAllocation(std::move(Allocation));
 				}
 			}
 		};
 
-		m_RenderDevice.SafeReleaseDeviceObject(StaleAllocation{ std::move(allocation), *this });
+		m_RenderDevice.SafeReleaseDeviceObject(StaleAllocation{ std::move(allocation), *this }, COMMAND_QUEUE_MASK_GRAPHICS | COMMAND_QUEUE_MASK_COMPUTE);
 	}
 
 	// ---------------------------- DynamicSuballocationsManager ------------------------
@@ -302,63 +574,52 @@ namespace RHI
 		UINT32 dynamicChunkSize,
 		std::string managerName) :
 		m_ParentGPUHeap{ parentGPUHeap },
-		m_DynamicChunkSize{ dynamicChunkSize },
-		m_ManagerName{ managerName }
+		m_ManagerName{ managerName },
+		m_DynamicChunkSize{ dynamicChunkSize }
 	{
 
 	}
 
 	DynamicSuballocationsManager::~DynamicSuballocationsManager()
 	{
-		assert(m_Chunks.empty() && m_CurrDescriptorCount == 0 && m_CurrChunkSize == 0 && "All dynamic suballocations must be released!");
+		// Chunks of a command list that was never submitted, the GPU did not use them
+		if (!m_Chunks.empty())
+			RetireAllocations(FenceTimelinePoint{});
 	}
 
-	// Release all allocated Chunks, these Chunks will be added to the release queue, and will eventually be recycled by ParentGPUHeap
-	void DynamicSuballocationsManager::ReleaseAllocations()
+	// The descriptors stay in the ring of the parent heap until the queue that executes the command list reaches retirePoint
+	void DynamicSuballocationsManager::RetireAllocations(const FenceTimelinePoint& retirePoint)
 	{
-		for (auto& Allocation : m_Chunks)
+		if (!m_Chunks.empty())
 		{
-			m_ParentGPUHeap.Free(std::move(Allocation));
+			m_ParentGPUHeap.RetireDynamicChunks(m_Chunks, retirePoint);
+			m_Chunks.clear();
 		}
-		m_Chunks.clear();
+
+		m_CurrOffsetInChunk = 0;
 		m_CurrDescriptorCount = 0;
-		m_CurrChunkSize = 0;
+		++m_RetireCount;
 	}
 
-	// May waste chunck space, for example, the penultimate still has free memory, but it not enought to store this allocation
-	// This will create a new Chunk, and all subsequent allocations will be performed in this new Chunk, 
-	// thus wasting part of the free memory of the previous Chunk
 	DescriptorHeapAllocation DynamicSuballocationsManager::Allocate(UINT32 count)
 	{
-		// If there is not a Chunk or the last Chunk dont have enougth space, allocate a Chunck large enought
-		if (m_Chunks.empty() || m_CurrentOffsetInChunk + count > m_Chunks.back().GetNumHandles())
+		if (m_Chunks.empty() || m_CurrOffsetInChunk + count > m_Chunks.back().Size)
 		{
-			auto newChunkSize = std::max(m_DynamicChunkSize, count);
-			auto newChunk = m_ParentGPUHeap.AllocateDynamic(newChunkSize);
-			if (newChunk.IsNull())
+			// Larger tables get a chunk of their own size
+			GPUDescriptorHeap::DynamicRing::Block chunk;
+			if (!m_ParentGPUHeap.AllocateDynamicChunk(std::max(count, m_DynamicChunkSize), chunk))
 			{
 				LOG_ERROR("GPU Descriptor heap is full.");
 				return DescriptorHeapAllocation();
 			}
 
-			m_Chunks.emplace_back(std::move(newChunk));
-			m_CurrentOffsetInChunk = 0;
-
-			m_CurrChunkSize += newChunkSize;
-			m_PeakSuballocationsTotalSize = std::max(m_PeakSuballocationsTotalSize, m_CurrChunkSize);
+			m_Chunks.push_back(chunk);
+			m_CurrOffsetInChunk = 0;
 		}
 
-		auto& currentSuballocation = m_Chunks.back();
-
-		auto managerID = currentSuballocation.GetAllocationManagerId();
+		auto allocation = m_ParentGPUHeap.GetDynamicAllocation(m_Chunks.back().Offset + m_CurrOffsetInChunk, count, *this);
+		m_CurrOffsetInChunk += count;
 
-		DescriptorHeapAllocation allocation(*this,
-			currentSuballocation.GetDescriptorHeap(),
-			currentSuballocation.GetCpuHandle(m_CurrentOffsetInChunk),
-			currentSuballocation.GetGpuHandle(m_CurrentOffsetInChunk),
-			count,
-			static_cast<UINT16>(managerID));
-		m_CurrentOffsetInChunk += count;
 		m_CurrDescriptorCount += count;
 		m_PeakDescriptorCount = std::max(m_PeakDescriptorCount, m_CurrDescriptorCount);
 
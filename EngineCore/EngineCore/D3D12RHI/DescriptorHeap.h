@@ -1,6 +1,9 @@
 #pragma once
 
-#include "VariableSizeAllocationsManager.h"
+#include "TLSFAllocationsManager.h"
+#include "BlockRingAllocator.h"
+#include "FenceTimeline.h"
+#include "ThreadLocalCaches.h"
 
 /*
 * Descriptor are structure (small block of memory) which tell shader where to find the resource, and how interprete data resource(GPU).
@@ -17,6 +20,13 @@ namespace RHI
 	class DescriptorHeapAllocation;
 	class DynamicSuballocationsManager;
 
+	// Manager of the free descriptor ranges of a heap, selected by DESCRIPTOR_HEAP_TLSF_ALLOCATOR
+#if DESCRIPTOR_HEAP_TLSF_ALLOCATOR
+	using DescriptorFreeBlockManager = TLSFAllocationsManager;
+#else
+	using DescriptorFreeBlockManager = VariableSizeAllocationsManager;
+#endif
+
 	class IDescriptorAllocator
 	{
 	public:
@@ -161,7 +171,8 @@ namespace RHI
 	* Is the main workhorse class that manages allocations in D3D12 descriptor heap using variable-size GPU allocations manager
 	* In CPU-Only Descriptor Heap, a completer descriptor is managed
 	* In GPU-Only Descriptor Heap, because there is only 1 Descriptor Heap, only manages part of it
-	* Use VariableSizeAllocationsManager to manage free memory in heap
+	* Use DescriptorFreeBlockManager to manage free memory in heap. With TLSFAllocationsManager (the default),
+	* Allocate() and Free() are O(1) with no heap allocation
 	*  |  X  X  X  X  O  O  O  X  X  O  O  X  O  O  O  O  |  D3D12 descriptor heap
 	*
 	*  X - used descriptor
@@ -213,10 +224,13 @@ namespace RHI
 
 		DescriptorHeapAllocation Allocate(UINT32 count);
 		void FreeAllocation(DescriptorHeapAllocation&& allocation);
+		// Releases numHandles descriptors starting at firstHandle, the range may span several allocations
+		void FreeRange(D3D12_CPU_DESCRIPTOR_HANDLE firstHandle, UINT32 numHandles);
 
 		size_t GetNumAvailableDescriptors() { return m_FreeBlockManager.GetFreeSize(); }
 		UINT32 GetMaxDescriptors()         const { return m_NumDescriptorsInAllocation; }
 		size_t GetMaxAllocatedSize()       const { return m_MaxAllocatedNum; }
+		size_t GetLargestFreeRange()       const { return m_FreeBlockManager.GetLargestFreeBlockSize(); }
 
 	private:
 		IDescriptorAllocator& m_ParentAllocator;
@@ -228,7 +242,7 @@ namespace RHI
 		const D3D12_DESCRIPTOR_HEAP_DESC m_HeapDesc;
 
 		// Allocations manager used to handle descriptor allocations within the heap
-		VariableSizeAllocationsManager m_FreeBlockManager;
+		DescriptorFreeBlockManager m_FreeBlockManager;
 
 		// First CPU descriptor handle in the available descriptor range
 		D3D12_CPU_DESCRIPTOR_HANDLE m_FirstCPUHandle = { 0 };
@@ -257,6 +271,24 @@ namespace RHI
 	*  O - available descriptor
 	* Render Device contains four CPUDescriptorHeap objects, corresponding to the four Descriptor Heaps of D3D12
 	* (SRV_CBV_UAV, Sampler, RTV, DSV).
+	*
+	* Allocate() and Free() can be called from any thread. m_HeapPool and m_AvailableHeaps are guarded by m_HeapPoolMutex.
+	* In concurrent mode (SetConcurrentMode(true)), used by loader threads that create many views in parallel:
+	* - single descriptor requests are served from the thread_local cache of the calling thread (ThreadLocalCaches), without lock.
+	*   An empty cache refills ThreadCacheBatchSize descriptors at once from the shared managers, so the pool mutex is taken once per batch
+	* - Free() only pushes the allocation to a lock-free stack, the render thread moves the stack to the open bucket
+	*   in ReleasePendingFrees() (called from RenderDevice::PurgeReleaseQueue())
+	*
+	*  thread 0 cache  | O O O |    thread 1 cache  | O O |     ...           m_PendingFrees --> X --> X --> null
+	*          \                         /
+	*           '----- m_HeapPool[0], m_HeapPool[1], ... -----'
+	*
+	* Released allocations do not go to the release queue one by one. They are added to an open bucket of stale ranges,
+	* which ReleasePendingFrees() closes before every submission and pushes to the release queue as a single object,
+	* so all the ranges of a bucket wait for the same fence values. When the bucket is purged the ranges are sorted by
+	* manager and offset, adjacent ranges are merged, and the merged ranges are returned to the managers under one lock.
+	*
+	*   bucket (fence N)   [m1: 40-41] [m0: 7-8] [m0: 5-6] [m0: 6-7]   --> sorted, merged -->   [m0: 5-8] [m1: 40-41]
 	*/
 	class CPUDescriptorHeap final : public IDescriptorAllocator
 	{
@@ -276,11 +308,77 @@ namespace RHI
 		virtual DescriptorHeapAllocation Allocate(uint32_t count) override final;
 		virtual void Free(DescriptorHeapAllocation&& allocation) override final;
 		virtual UINT32 GetDescriptorSize() const override final { return m_DescriptorSize; }
+
+		// Enables per-thread descriptor caches and the lock-free free path. Disabling the mode waits for the allocations in progress
+		// on the other threads and returns the cached descriptors to the heap. Called by one thread at a time
+		void SetConcurrentMode(bool enable);
+		bool IsConcurrentMode() const { return m_ThreadCaches.IsEnabled(); }
+
+		// Moves the allocations released since the last call to the release queue of the render device, as one bucket.
+		// Thread safe: called by RenderDevice::PurgeReleaseQueue() on every submission, from any recording thread
+		// (including UploadManager with its lock held), it only takes the lock of the stale ranges
+		void ReleasePendingFrees();
+
+		UINT32 GetCurrentSize() const { return m_CurrentSize.load(std::memory_order_relaxed); }
+		UINT32 GetMaxSize() const { return m_MaxSize.load(std::memory_order_relaxed); }
+		// CPU handles [Begin, End) returned to the heap, a new view may be created at these handles
+		struct FreedRange
+		{
+			SIZE_T Begin;
+			SIZE_T End;
+		};
+
+		// Number of ranges returned to the heap so far
+		UINT64 GetFreeEpoch() const { return m_FreeEpoch.load(std::memory_order_acquire); }
+		// Appends the ranges returned after the first "epoch" ones and moves epoch to the current value.
+		// Returns false if some of them are not in the log anymore, every handle must then be considered reused
+		bool GetFreedRanges(UINT64& epoch, std::vector<FreedRange>& ranges);
+
 	private:
-		void FreeAllocation(DescriptorHeapAllocation&& allocation);
+		// Descriptors released by the application, waiting in a bucket for the GPU
+		struct StaleRange
+		{
+			SIZE_T CpuHandle;
+			UINT32 NumHandles;
+			UINT16 AllocationManagerId;
+		};
+
+		// Bucket of stale ranges in the release queue of the render device
+		struct StaleRangeBucket;
+
+		// Descriptor owned by a thread cache, not yet handed out to the application
+		struct CachedDescriptor
+		{
+			D3D12_CPU_DESCRIPTOR_HANDLE CpuHandle;
+			ID3D12DescriptorHeap* DescriptorHeap;
+			UINT16 AllocationManagerId;
+		};
+
+		// Node of the lock-free stack of released allocations
+		struct PendingFree
+		{
+			DescriptorHeapAllocation Allocation;
+			PendingFree* Next;
+		};
+
+		static constexpr UINT32 ThreadCacheBatchSize = 32;
+
+		// m_HeapPoolMutex must be locked
+		DescriptorHeapAllocation AllocateFromPool(UINT32 count);
+		DescriptorHeapAllocation AllocateFromThreadCache();
+		// m_HeapPoolMutex must be locked
+		void ReturnCachedDescriptors(const std::vector<CachedDescriptor>& descriptors);
+		// m_StaleRangesMutex must be locked
+		void AddStaleRange(DescriptorHeapAllocation&& allocation);
+		// m_StaleRangesMutex must be locked. Moves the pending frees to the open bucket
+		void TakePendingFrees();
+		// Sorts and merges the ranges of a bucket and returns them to the managers
+		void FreeStaleRanges(std::vector<StaleRange>& ranges);
 
 		RenderDevice& m_RenderDevice;
 
+		// Guards m_HeapPool, m_AvailableHeaps and m_HeapDesc
+		std::mutex m_HeapPoolMutex;
 		// Pool of descriptor heap managers
 		std::vector<DescriptorHeapAllocationManager> m_HeapPool;
 		// Indices of avaliable descriptor heap managers
@@ -289,8 +387,26 @@ namespace RHI
 		D3D12_DESCRIPTOR_HEAP_DESC m_HeapDesc;
 		const UINT m_DescriptorSize = 0;
 
-		UINT32 m_MaxSize = 0;
-		UINT32 m_CurrentSize = 0;
+		// Enabled in concurrent mode. The cached descriptors are returned to the managers when the mode is disabled
+		ThreadLocalCaches<CachedDescriptor> m_ThreadCaches;
+		std::atomic<PendingFree*> m_PendingFrees{ nullptr };
+
+		// Guards the open bucket and the spare range vectors
+		std::mutex m_StaleRangesMutex;
+		std::vector<StaleRange> m_StaleRanges;
+		// Vectors of the purged buckets, reused by the next buckets
+		std::vector<std::vector<StaleRange>> m_SpareStaleRanges;
+		static constexpr size_t MaxSpareStaleRanges = 4;
+
+		// Descriptors held by the application, descriptors in the thread caches are not counted
+		std::atomic<UINT32> m_MaxSize{ 0 };
+		std::atomic<UINT32> m_CurrentSize{ 0 };
+
+		// Last merged ranges returned to the managers, range n is at m_FreedRangeLog[n % FreedRangeLogSize]
+		static constexpr UINT64 FreedRangeLogSize = 256;
+		std::mutex m_FreedRangeLogMutex;
+		std::array<FreedRange, FreedRangeLogSize> m_FreedRangeLog;
+		std::atomic<UINT64> m_FreeEpoch{ 0 };
 	};
 
 	/*
@@ -299,15 +415,18 @@ namespace RHI
 	* " GPUDescriptorHeap object contains only single D3D12 descriptor heap ".
 	* The space is broken in 2 part : 1- keep rarely changing descriptor handle(corresponding to static and mutable variables),
 	* 2 - used to hold the dynamic descriptor handle(everal threads record commands simultaneously == problem bottleneck).
-	* Fisrt stage : command contex allocates a chunck of descriptor from the shared dynamic part of GPU descriptor heap.
-	* Second stage : is suballoction from that chunk.
+	* The dynamic space is a ring of chunks: command contexts take chunks at the tail and suballocate from them.
+	* When a context is submitted, its chunks are retired with the fence value of the queue that executes its command list
+	* (RetireDynamicChunks()), and the chunks whose fence is reached are reclaimed in ring order (ReleaseCompletedDynamic(),
+	* called from PurgeReleaseQueue()). A context still recording holds back the chunks allocated after its own.
 	*
-	*   static and mutable handles      ||                 dynamic space
-	*                                   ||    chunk 0     chunk 1     chunk 2     unused
-	*| X O O X X O X O O O O X X X X O  ||  | X X X O | | X X O O | | O O O O |  O O O O  ||
-	*                                             |         |
-	*                                   suballocation       suballocation
-	*                                  within chunk 0       within chunk 1
+	*   static and mutable handles      ||                 dynamic space (ring)
+	*                                   ||      head                                         tail
+	*                                   ||       | ctx0: G 12 | ctx1: recording | ctx2: C 5 |
+	*| X O O X X O X O O O O X X X X O  ||  O O  | X X X X X  | X X X X X X     | X X X X   | O O O O  ||
+	*                                                  |                               |
+	*                                        released when the graphics      released after the chunk of ctx1,
+	*                                        queue reaches fence 12          once the compute queue reaches 5
 	* Render Device contains two GPUDescriptorHeap objects (SRV_CBV_UAV and Sampler)
 	*
 	* Device Context is used to allocate Dynamic Resource Descriptor
@@ -359,15 +478,23 @@ namespace RHI
 		// Getters
 		const D3D12_DESCRIPTOR_HEAP_DESC& GetHeapDesc() const { return m_HeapDesc; }
 		UINT32 GetMaxStaticDescriptors() const { return m_HeapAllocationManager.GetMaxDescriptors(); }
-		UINT32 GetMaxDynamicDescriptors() const { return m_DynamicAllocationsManager.GetMaxDescriptors(); }
+		UINT32 GetMaxDynamicDescriptors() const { return static_cast<UINT32>(m_DynamicRing.GetMaxSize()); }
+		UINT32 GetDynamicDescriptorsInUse();
+		UINT32 GetPeakDynamicDescriptors();
 
 		ID3D12DescriptorHeap* GetD3D12DescriptorHeap() { return m_DescriptorHeap.Get(); }
 
+		// Reclaims the retired dynamic chunks whose fence values are reached
+		void ReleaseCompletedDynamic(const FenceTimelinePoint& completedPoint);
+
 	private:
-		DescriptorHeapAllocation AllocateDynamic(UINT32 count)
-		{
-			return m_DynamicAllocationsManager.Allocate(count);
-		}
+		using DynamicRing = BlockRingAllocator<FenceTimelinePoint>;
+
+		bool AllocateDynamicChunk(UINT32 count, DynamicRing::Block& chunk);
+		// The chunks are reused once retirePoint is reached, a default point releases chunks the GPU never used
+		void RetireDynamicChunks(const std::vector<DynamicRing::Block>& chunks, const FenceTimelinePoint& retirePoint);
+		// Descriptors [offset, offset + count) of the dynamic space. The allocation is owned by "owner", its Free() must not release them
+		DescriptorHeapAllocation GetDynamicAllocation(size_t offset, UINT32 count, IDescriptorAllocator& owner);
 
 		RenderDevice& m_RenderDevice;
 
@@ -379,17 +506,22 @@ namespace RHI
 
 		// static/mutable manager
 		DescriptorHeapAllocationManager m_HeapAllocationManager;
-		// Dynamic manager
-		DescriptorHeapAllocationManager m_DynamicAllocationsManager;
+		// Dynamic ring, command contexts allocate from several threads
+		std::mutex m_DynamicRingMutex;
+		DynamicRing m_DynamicRing;
+		// First descriptor handles of the dynamic space
+		D3D12_CPU_DESCRIPTOR_HANDLE m_FirstDynamicCPUHandle = { 0 };
+		D3D12_GPU_DESCRIPTOR_HANDLE m_FirstDynamicGPUHandle = { 0 };
 
 		friend class DynamicSuballocationsManager;
 	};
 
 	/*
-	* Responsible to allocate short living dynamic descriptor handle use in the current frame only
-	* Maintains a list of chunks allocated from the main GPU descriptor heap as well as the offset within the current chunk
-	* Because the request Chunk needs to be locked, but the sub-allocation in the Chunk is not required,
-	* so that each thread can allocate dynamic Descriptors in parallel. At the end of each frame, all allocations will be discarded
+	* Responsible to allocate short living dynamic descriptor handle used by one command list.
+	* Chunks of the dynamic ring of the GPU descriptor heap are allocated when needed and suballocated linearly, so the ring lock is
+	* only taken once per chunk. Allocations are never released separately: when the command list is submitted, all the chunks
+	* are retired with the fence value of its queue (RetireAllocations()).
+	* Also keeps the number of descriptors used by the context since its last submission and its peak
 	*/
 	class DynamicSuballocationsManager final : public IDescriptorAllocator
 	{
@@ -403,39 +535,36 @@ namespace RHI
 
 		~DynamicSuballocationsManager();
 
-		void ReleaseAllocations();
+		// The command list using the descriptors was submitted, they are reclaimed by the parent heap once retirePoint is reached
+		void RetireAllocations(const FenceTimelinePoint& retirePoint);
 
 		virtual DescriptorHeapAllocation Allocate(UINT32 count) override final;
 		virtual void Free(DescriptorHeapAllocation&& Allocation) override final
 		{
 			// Dynamic allocation is not released separately, 
-			// it releases the entire Chunk through ReleaseAllocations() at the end of each frame
+			// the chunks are retired together when the command list is submitted
 			Allocation.Reset();
 		}
 
 		virtual UINT32 GetDescriptorSize() const override final { return m_ParentGPUHeap.GetDescriptorSize(); }
 
-		size_t GetSuballocationCount() const { return m_Chunks.size(); }
+		UINT32 GetCurrentDescriptorCount() const { return m_CurrDescriptorCount; }
+		UINT32 GetPeakDescriptorCount() const { return m_PeakDescriptorCount; }
+		// Number of RetireAllocations() calls, the descriptors allocated before may already be reused
+		UINT64 GetRetireCount() const { return m_RetireCount; }
 	private:
 		GPUDescriptorHeap& m_ParentGPUHeap;
 		const std::string m_ManagerName;
+		const UINT32 m_DynamicChunkSize;
 
-		// Assigned chunk
-		std::vector<DescriptorHeapAllocation> m_Chunks;
-
-		// last chunck offset, After the Offset is the Descriptor that has not yet been allocated
-		UINT32 m_CurrentOffsetInChunk = 0;
-
-		// Initialize each chunk size
-		UINT32 m_DynamicChunkSize = 0;
+		// Chunks allocated since the last submission, descriptors are taken from the last one
+		std::vector<GPUDescriptorHeap::DynamicRing::Block> m_Chunks;
+		UINT32 m_CurrOffsetInChunk = 0;
 
-		// The number of all Descriptors currently allocated
+		// The number of Descriptors allocated since the last submission
 		UINT32 m_CurrDescriptorCount = 0;
-		// Current chunkc size
-		UINT32 m_CurrChunkSize = 0;
-		// Peak number of Descriptors allocated in Chunk
+		// Peak number of Descriptors allocated by one command list
 		UINT32 m_PeakDescriptorCount = 0;
-		// The peak size of the allocated Chunk
-		UINT32 m_PeakSuballocationsTotalSize = 0;
+		UINT64 m_RetireCount = 0;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,101 @@
+#include "../pch.h"
+#include "DescriptorTableCache.h"
+
+namespace RHI
+{
+	void DescriptorTableCache::Validate(UINT64 dynamicDescriptorGeneration, CPUDescriptorHeap& cpuDescriptorHeap)
+	{
+		if (dynamicDescriptorGeneration != m_DynamicDescriptorGeneration)
+		{
+			m_LastListStats = m_CurrentListStats;
+			m_CurrentListStats = CommandListStats{};
+			m_DynamicDescriptorGeneration = dynamicDescriptorGeneration;
+			Clear();
+		}
+
+		if (cpuDescriptorHeap.GetFreeEpoch() != m_CpuDescriptorFreeEpoch)
+		{
+			m_FreedRanges.clear();
+			if (cpuDescriptorHeap.GetFreedRanges(m_CpuDescriptorFreeEpoch, m_FreedRanges))
+				DropFreedTables();
+			else
+				Clear();
+		}
+	}
+
+	size_t DescriptorTableCache::ComputeTableHash(const D3D12_CPU_DESCRIPTOR_HANDLE* handles, UINT32 count)
+	{
+		size_t hash = ComputeHash(count);
+		for (UINT32 i = 0; i < count; ++i)
+			HashCombine(hash, handles[i].ptr);
+
+		return hash;
+	}
+
+	bool DescriptorTableCache::Find(size_t hash, const D3D12_CPU_DESCRIPTOR_HANDLE* handles, UINT32 count, D3D12_GPU_DESCRIPTOR_HANDLE& gpuHandle)
+	{
+		auto tableIt = m_Tables.find(hash);
+		if (tableIt != m_Tables.end() && tableIt->second.NumHandles == count)
+		{
+			const CachedTable& table = tableIt->second;
+
+			bool sameHandles = true;
+			for (UINT32 i = 0; i < count && sameHandles; ++i)
+				sameHandles = m_Handles[table.FirstHandle + i] == handles[i].ptr;
+
+			if (sameHandles)
+			{
+				gpuHandle = table.GpuHandle;
+				++m_CurrentListStats.Hits;
+				return true;
+			}
+		}
+
+		++m_CurrentListStats.Misses;
+		return false;
+	}
+
+	void DescriptorTableCache::Insert(size_t hash, const D3D12_CPU_DESCRIPTOR_HANDLE* handles, UINT32 count, D3D12_GPU_DESCRIPTOR_HANDLE gpuHandle)
+	{
+		// On hash collision the most recent table wins
+		CachedTable& table = m_Tables[hash];
+		table.GpuHandle = gpuHandle;
+		table.FirstHandle = static_cast<UINT32>(m_Handles.size());
+		table.NumHandles = count;
+
+		for (UINT32 i = 0; i < count; ++i)
+			m_Handles.push_back(handles[i].ptr);
+	}
+
+	void DescriptorTableCache::DropFreedTables()
+	{
+		for (auto tableIt = m_Tables.begin(); tableIt != m_Tables.end();)
+		{
+			const CachedTable& table = tableIt->second;
+
+			bool freed = false;
+			for (UINT32 i = 0; i < table.NumHandles && !freed; ++i)
+			{
+				SIZE_T handle = m_Handles[table.FirstHandle + i];
+				for (const auto& range : m_FreedRanges)
+				{
+					if (handle >= range.Begin && handle < range.End)
+					{
+						freed = true;
+						break;
+					}
+				}
+			}
+
+			// The handles of a dropped table stay in m_Handles until the cache is cleared
+			tableIt = freed ? m_Tables.erase(tableIt) : std::next(tableIt);
+		}
+	}
+
+	void DescriptorTableCache::Clear()
+	{
+		// Keep the memory, the cache is refilled every frame
+		m_Tables.clear();
+		m_Handles.clear();
+	}
+}
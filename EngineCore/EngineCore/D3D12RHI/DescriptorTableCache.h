@@ -0,0 +1,68 @@
+#pragma once
+#include "DescriptorHeap.h"
+
+namespace RHI
+{
+	/*
+	* Remembers the dynamic descriptor tables uploaded to the shader visible heap by the command list being recorded.
+	* A table is identified by the CPU descriptor handles it was copied from, if the same handles are bound again
+	* (same material drawn several times, same set of views in consecutive draws) the GPU range uploaded the first time is reused
+	* and nothing is allocated or copied.
+	*
+	*  draw 0 : { SRV a, SRV b, CBV c }  -- miss -->  allocate 3 dynamic descriptors, copy, remember  hash(a, b, c) -> GPU handle
+	*  draw 1 : { SRV a, SRV b, CBV c }  -- hit  -->  bind the remembered GPU handle
+	*
+	* Entries are only valid while the dynamic descriptors they point to are alive and the CPU descriptors keep the same content:
+	* the cache is emptied when the dynamic descriptors of the context are retired (its command list was submitted), and the tables
+	* using CPU descriptors that were returned to the heap are dropped (a new view may be created at the same handle).
+	* A table is therefore only reused within one command list, the lists of a frame upload their tables again.
+	*/
+	class DescriptorTableCache
+	{
+	public:
+		// Stats of one command list: the cache is emptied at every submission, not once per frame
+		struct CommandListStats
+		{
+			UINT32 Hits = 0;
+			UINT32 Misses = 0;
+			UINT32 DescriptorsCopied = 0;
+		};
+
+		// Must be called before the lookups of a draw, drops the entries that can not be trusted anymore
+		void Validate(UINT64 dynamicDescriptorGeneration, CPUDescriptorHeap& cpuDescriptorHeap);
+
+		static size_t ComputeTableHash(const D3D12_CPU_DESCRIPTOR_HANDLE* handles, UINT32 count);
+
+		bool Find(size_t hash, const D3D12_CPU_DESCRIPTOR_HANDLE* handles, UINT32 count, D3D12_GPU_DESCRIPTOR_HANDLE& gpuHandle);
+		void Insert(size_t hash, const D3D12_CPU_DESCRIPTOR_HANDLE* handles, UINT32 count, D3D12_GPU_DESCRIPTOR_HANDLE gpuHandle);
+
+		void AddCopiedDescriptors(UINT32 count) { m_CurrentListStats.DescriptorsCopied += count; }
+
+		const CommandListStats& GetCurrentListStats() const { return m_CurrentListStats; }
+		const CommandListStats& GetLastListStats() const { return m_LastListStats; }
+
+	private:
+		void Clear();
+		// Drops the tables with a handle in m_FreedRanges
+		void DropFreedTables();
+
+		struct CachedTable
+		{
+			D3D12_GPU_DESCRIPTOR_HANDLE GpuHandle;
+			// Range in m_Handles, used to reject hash collisions
+			UINT32 FirstHandle;
+			UINT32 NumHandles;
+		};
+
+		std::unordered_map<size_t, CachedTable> m_Tables;
+		// CPU handles of all cached tables
+		std::vector<SIZE_T> m_Handles;
+
+		UINT64 m_DynamicDescriptorGeneration = 0;
+		UINT64 m_CpuDescriptorFreeEpoch = 0;
+		std::vector<CPUDescriptorHeap::FreedRange> m_FreedRanges;
+
+		CommandListStats m_CurrentListStats;
+		CommandListStats m_LastListStats;
+	};
+}
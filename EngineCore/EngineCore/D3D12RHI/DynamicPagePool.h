@@ -0,0 +1,337 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <memory>
+#include <string>
+
+/*
+* Pool of the upload pages of DynamicResourceAllocator, taken and returned concurrently by the command contexts recording
+* on different threads. The available pages are kept in lock-free stacks, one per page size (BasePageSize * 2^n).
+* The memory of a page is created by PageDeviceType:
+*
+*   typename PageDeviceType::PageType     movable, default constructible (invalid page), GetSize(), IsValid(),
+*                                          the memory is released by its destructor
+*   PageType CreatePage(UINT64 size)       throws on failure
+*
+* DynamicResourceAllocator uses D3D12 upload buffers, the tests and benchmarks a CPU-only device.
+*
+* Only the page sizes up to BasePageSize * 2^(NumSizeClasses - 1) are pooled, larger requests get a dedicated page of their
+* own size that is destroyed when it is released.
+* The resident upload memory (pages in use + pooled pages) never goes over MaxResidentSize: a new page first destroys pooled
+* pages to make room, and is not created if the pages in use already take the budget.
+* Every PageIdleFrames frames, the pages that stayed in the pool during the whole period (the lowest number of pooled pages
+* of the period, per size) are destroyed. The trim only pops these pages, the contexts keep taking and returning pages meanwhile.
+*/
+namespace RHI
+{
+	template <typename PageDeviceType>
+	class DynamicPagePool
+	{
+	public:
+		using PageType = typename PageDeviceType::PageType;
+
+		struct Stats
+		{
+			// Upload memory of all pages alive, in use by the contexts or pooled
+			UINT64 ResidentSize = 0;
+			UINT64 PeakResidentSize = 0;
+			UINT64 PooledSize = 0;
+			UINT32 NumResidentPages = 0;
+			UINT32 NumPooledPages = 0;
+			UINT64 NumPagesCreated = 0;
+			UINT64 NumPagesTrimmed = 0;
+			// Pages not created because of the resident budget
+			UINT64 NumFailedPages = 0;
+		};
+
+		// Page sizes from BasePageSize to BasePageSize * 2^(NumSizeClasses - 1) are recycled, larger pages are dedicated
+		static constexpr UINT32 NumSizeClasses = 4;
+		// Pages beyond this number are destroyed when they are released
+		static constexpr UINT32 MaxPooledPages = 256;
+
+		DynamicPagePool(PageDeviceType& device, UINT64 basePageSize, UINT64 maxResidentSize, UINT32 pageIdleFrames) :
+			m_Device{ device },
+			m_BasePageSize{ basePageSize },
+			m_MaxResidentSize{ maxResidentSize },
+			m_PageIdleFrames{ std::max(pageIdleFrames, 1u) },
+			m_Nodes{ new PageNode[MaxPooledPages] }
+		{
+			for (UINT32 i = 0; i < MaxPooledPages; i++)
+				m_FreeNodes.Push(m_Nodes.get(), i);
+		}
+
+		~DynamicPagePool()
+		{
+			assert(std::all_of(std::begin(m_SizeClasses), std::end(m_SizeClasses), [](const SizeClass& sizeClass) { return sizeClass.AvailablePages.IsEmpty(); }) &&
+				"Not all pages are destroyed, the pool must be explicitly destroyed with Destroy()");
+		}
+
+		DynamicPagePool(const DynamicPagePool&) = delete;
+		DynamicPagePool& operator = (const DynamicPagePool&) = delete;
+
+		// Smallest pooled page that is at least sizeInBytes large, or a new page.
+		// Returns an invalid page if the pages in use already take the resident budget
+		PageType AllocatePage(UINT64 sizeInBytes)
+		{
+			UINT32 sizeClass = GetSizeClass(sizeInBytes);
+			for (UINT32 i = sizeClass; i < NumSizeClasses; ++i)
+			{
+				PageType page;
+				if (PopPooledPage(i, page))
+				{
+					assert(page.GetSize() >= sizeInBytes);
+					return page;
+				}
+			}
+
+			// Create pages of the size of their class, so that they can be recycled
+			UINT64 pageSize = (sizeClass < NumSizeClasses) ? (m_BasePageSize << sizeClass) : sizeInBytes;
+			return CreatePage(pageSize);
+		}
+
+		// Called when the GPU is done with a page
+		void RecyclePage(PageType&& page)
+		{
+			UINT64 pageSize = page.GetSize();
+			UINT32 sizeClass = GetSizeClass(pageSize);
+			// Over the budget, give the memory back instead of pooling it
+			if (sizeClass < NumSizeClasses && (m_BasePageSize << sizeClass) == pageSize &&
+				m_ResidentSize.load(std::memory_order_relaxed) <= m_MaxResidentSize)
+			{
+				UINT32 nodeIndex = m_FreeNodes.Pop(m_Nodes.get());
+				if (nodeIndex != InvalidNode)
+				{
+					m_Nodes[nodeIndex].Page = std::move(page);
+					m_PooledSize.fetch_add(pageSize);
+					m_NumPooledPages.fetch_add(1);
+					// Counted before the push and after the pop, so that the count is never below the size of the stack
+					m_SizeClasses[sizeClass].NumPooledPages.fetch_add(1);
+					m_SizeClasses[sizeClass].AvailablePages.Push(m_Nodes.get(), nodeIndex);
+					return;
+				}
+			}
+
+			// The page can not be pooled and is destroyed here, the GPU is already done with it
+			DestroyPage(std::move(page));
+		}
+
+		// Destroys the pages that were not needed during the last PageIdleFrames frames. Called once all the contexts of
+		// the frame are submitted, from one thread; the other threads keep taking and returning pages
+		void FinishFrame()
+		{
+			UINT64 frameIndex = m_FrameIndex.fetch_add(1) + 1;
+			if (frameIndex % m_PageIdleFrames != 0)
+				return;
+
+			for (UINT32 sizeClass = 0; sizeClass < NumSizeClasses; ++sizeClass)
+			{
+				// The next period starts from the current number of pooled pages
+				SizeClass& pages = m_SizeClasses[sizeClass];
+				UINT32 numIdlePages = pages.LowWaterMark.exchange(pages.NumPooledPages.load());
+				for (UINT32 i = 0; i < numIdlePages; ++i)
+				{
+					PageType page;
+					if (!PopPooledPage(sizeClass, page))
+						break;
+
+					m_NumPagesTrimmed.fetch_add(1);
+					DestroyPage(std::move(page));
+				}
+			}
+		}
+
+		// Destroys the pooled pages, the pages in use must have been recycled
+		void Destroy()
+		{
+			for (UINT32 sizeClass = 0; sizeClass < NumSizeClasses; ++sizeClass)
+			{
+				PageType page;
+				while (PopPooledPage(sizeClass, page))
+					DestroyPage(std::move(page));
+			}
+		}
+
+		Stats GetStats() const
+		{
+			Stats stats;
+			stats.ResidentSize = m_ResidentSize.load();
+			stats.PeakResidentSize = m_PeakResidentSize.load();
+			stats.PooledSize = m_PooledSize.load();
+			stats.NumResidentPages = m_NumResidentPages.load();
+			stats.NumPooledPages = m_NumPooledPages.load();
+			stats.NumPagesCreated = m_NumPagesCreated.load();
+			stats.NumPagesTrimmed = m_NumPagesTrimmed.load();
+			stats.NumFailedPages = m_NumFailedPages.load();
+			return stats;
+		}
+
+		// Largest pooled page size, larger requests get a dedicated page
+		UINT64 GetMaxPageSize() const { return m_BasePageSize << (NumSizeClasses - 1); }
+
+	private:
+		static constexpr UINT32 InvalidNode = static_cast<UINT32>(-1);
+
+		struct PageNode
+		{
+			PageType Page;
+			std::atomic<UINT32> Next{ 0 };
+		};
+
+		// Treiber stack of nodes. The head packs the index of the top node + 1 (0 means empty) with a tag that changes
+		// on every operation, so a pop can not succeed on a head that was popped and pushed back in between (ABA)
+		class PageStack
+		{
+		public:
+			void Push(PageNode* nodes, UINT32 nodeIndex)
+			{
+				UINT64 head = m_Head.load(std::memory_order_relaxed);
+				UINT64 newHead;
+				do
+				{
+					nodes[nodeIndex].Next.store(static_cast<UINT32>(head & 0xFFFFFFFF), std::memory_order_relaxed);
+					newHead = (((head >> 32) + 1) << 32) | (nodeIndex + 1);
+				} while (!m_Head.compare_exchange_weak(head, newHead, std::memory_order_release, std::memory_order_relaxed));
+			}
+
+			UINT32 Pop(PageNode* nodes)
+			{
+				UINT64 head = m_Head.load(std::memory_order_acquire);
+				while ((head & 0xFFFFFFFF) != 0)
+				{
+					UINT32 nodeIndex = static_cast<UINT32>(head & 0xFFFFFFFF) - 1;
+					// The node may be popped by another thread meanwhile, then the tag has changed and the exchange fails
+					UINT64 newHead = (((head >> 32) + 1) << 32) | nodes[nodeIndex].Next.load(std::memory_order_relaxed);
+					if (m_Head.compare_exchange_weak(head, newHead, std::memory_order_acquire, std::memory_order_acquire))
+						return nodeIndex;
+				}
+
+				return InvalidNode;
+			}
+
+			bool IsEmpty() const { return (m_Head.load(std::memory_order_acquire) & 0xFFFFFFFF) == 0; }
+
+		private:
+			std::atomic<UINT64> m_Head{ 0 };
+		};
+
+		struct SizeClass
+		{
+			PageStack AvailablePages;
+			std::atomic<UINT32> NumPooledPages{ 0 };
+			// Lowest NumPooledPages since the last trim: this many pages were not needed during the whole period
+			std::atomic<UINT32> LowWaterMark{ 0 };
+		};
+
+		UINT32 GetSizeClass(UINT64 sizeInBytes) const
+		{
+			UINT32 sizeClass = 0;
+			while (sizeClass < NumSizeClasses && (m_BasePageSize << sizeClass) < sizeInBytes)
+				++sizeClass;
+
+			return sizeClass;
+		}
+
+		bool PopPooledPage(UINT32 sizeClass, PageType& page)
+		{
+			SizeClass& pages = m_SizeClasses[sizeClass];
+			UINT32 nodeIndex = pages.AvailablePages.Pop(m_Nodes.get());
+			if (nodeIndex == InvalidNode)
+				return false;
+
+			page = std::move(m_Nodes[nodeIndex].Page);
+			m_FreeNodes.Push(m_Nodes.get(), nodeIndex);
+
+			UINT32 numPooledPages = pages.NumPooledPages.fetch_sub(1) - 1;
+			UINT32 lowWaterMark = pages.LowWaterMark.load(std::memory_order_relaxed);
+			while (numPooledPages < lowWaterMark && !pages.LowWaterMark.compare_exchange_weak(lowWaterMark, numPooledPages))
+			{
+			}
+
+			m_PooledSize.fetch_sub(page.GetSize());
+			m_NumPooledPages.fetch_sub(1);
+			return true;
+		}
+
+		// Destroys one pooled page, the largest first. Returns false if the pool is empty
+		bool DestroyPooledPage()
+		{
+			for (UINT32 sizeClass = NumSizeClasses; sizeClass-- > 0;)
+			{
+				PageType page;
+				if (PopPooledPage(sizeClass, page))
+				{
+					DestroyPage(std::move(page));
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		PageType CreatePage(UINT64 pageSize)
+		{
+			// The memory is reserved before the page is created, so that threads creating pages together stay within the budget
+			UINT64 residentSize = m_ResidentSize.load(std::memory_order_relaxed);
+			for (;;)
+			{
+				if (residentSize + pageSize > m_MaxResidentSize)
+				{
+					if (!DestroyPooledPage())
+					{
+						m_NumFailedPages.fetch_add(1);
+						LOG_ERROR("Dynamic upload memory budget exceeded: " + std::to_string(residentSize) + " bytes in use, " +
+							std::to_string(pageSize) + " bytes requested");
+						return PageType{};
+					}
+					residentSize = m_ResidentSize.load(std::memory_order_relaxed);
+				}
+				else if (m_ResidentSize.compare_exchange_weak(residentSize, residentSize + pageSize))
+					break;
+			}
+
+			PageType page = m_Device.CreatePage(pageSize);
+
+			residentSize += pageSize;
+			UINT64 peakResidentSize = m_PeakResidentSize.load(std::memory_order_relaxed);
+			while (peakResidentSize < residentSize && !m_PeakResidentSize.compare_exchange_weak(peakResidentSize, residentSize))
+			{
+			}
+			m_NumResidentPages.fetch_add(1);
+			m_NumPagesCreated.fetch_add(1);
+
+			return page;
+		}
+
+		void DestroyPage(PageType&& page)
+		{
+			PageType destroyedPage(std::move(page));
+			m_ResidentSize.fetch_sub(destroyedPage.GetSize());
+			m_NumResidentPages.fetch_sub(1);
+		}
+
+		PageDeviceType& m_Device;
+
+		const UINT64 m_BasePageSize;
+		const UINT64 m_MaxResidentSize;
+		const UINT32 m_PageIdleFrames;
+
+		// The idle pages are trimmed every m_PageIdleFrames frames
+		std::atomic<UINT64> m_FrameIndex{ 0 };
+
+		std::atomic<UINT64> m_ResidentSize{ 0 };
+		std::atomic<UINT64> m_PeakResidentSize{ 0 };
+		std::atomic<UINT64> m_PooledSize{ 0 };
+		std::atomic<UINT32> m_NumResidentPages{ 0 };
+		std::atomic<UINT32> m_NumPooledPages{ 0 };
+		std::atomic<UINT64> m_NumPagesCreated{ 0 };
+		std::atomic<UINT64> m_NumPagesTrimmed{ 0 };
+		std::atomic<UINT64> m_NumFailedPages{ 0 };
+
+		std::unique_ptr<PageNode[]> m_Nodes;
+		// Nodes that do not hold a page
+		PageStack m_FreeNodes;
+		SizeClass m_SizeClasses[NumSizeClasses];
+	};
+}
@@ -39,31 +39,13 @@ namespace RHI
         m_pd3d12Buffer->Map(0, nullptr, &m_CPUVirtualAddress);
 	}
 
-    DynamicResourceAllocator::DynamicResourceAllocator(UINT32 NumPagesToReserve, UINT64 PageSize)
-    {
-        for (UINT32 i = 0; i < NumPagesToReserve; i++)
-        {
-            D3D12DynamicPage Page(PageSize);
-            auto Size = Page.GetSize();
-            m_AvailablePages.emplace(Size, std::move(Page));
-        }
-    }
+    // ------------------- Dynamic Resource Allocator -----------------------------
 
-    D3D12DynamicPage DynamicResourceAllocator::AllocatePage(UINT64 SizeInBytes)
+    DynamicResourceAllocator::DynamicResourceAllocator(UINT32 NumPagesToReserve, UINT64 PageSize, UINT64 MaxResidentSize, UINT32 PageIdleFrames) :
+        m_PagePool{ m_PageDevice, PageSize, MaxResidentSize, PageIdleFrames }
     {
-        // Returns the iterator of the first Page that is larger than SizeInBytes
-        auto PageIt = m_AvailablePages.lower_bound(SizeInBytes);
-        if (PageIt != m_AvailablePages.end())
-        {
-            assert(PageIt->first >= SizeInBytes);
-            D3D12DynamicPage Page(std::move(PageIt->second));
-            m_AvailablePages.erase(PageIt);
-            return Page;
-        }
-        else
-        {
-            return D3D12DynamicPage{ SizeInBytes };
-        }
+        for (UINT32 i = 0; i < NumPagesToReserve; i++)
+            m_PagePool.RecyclePage(m_PagePool.AllocatePage(PageSize));
     }
 
     void DynamicResourceAllocator::ReleasePages(std::vector<D3D12DynamicPage>& Pages)
@@ -93,10 +75,7 @@ namespace RHI
             ~StalePage()
             {
                 if (Mgr != nullptr)
-                {
-                    auto PageSize = Page.GetSize();
-                    Mgr->m_AvailablePages.emplace(PageSize, std::move(Page));
-                }
+                    Mgr->m_PagePool.RecyclePage(std::move(Page));
             }
         };
         for (auto& Page : Pages)
@@ -107,12 +86,11 @@ namespace RHI
 
     void DynamicResourceAllocator::Destroy()
     {
-        m_AvailablePages.clear();
+        m_PagePool.Destroy();
     }
 
     DynamicResourceAllocator::~DynamicResourceAllocator()
     {
-        assert(m_AvailablePages.empty() && "Not all pages are destroyed. Dynamic memory manager must be explicitly destroyed with Destroy() method");
     }
 
     // ------------------- Dynamic Resource Heap -----------------------------
@@ -130,9 +108,21 @@ namespace RHI
         // If it is the first allocation, or the size of the current Page is not enough for this allocation, create a Page
         if (m_CurrOffset == InvalidOffset || SizeInBytes + (Align(m_CurrOffset, Alignment) - m_CurrOffset) > m_AvailableSize)
         {
+            // Make the pages of the period add up to the recent high-water mark, without going over the largest pooled page size
+            UINT64 TargetSize = (m_HighWaterMark > m_CurrAllocatedSize) ? m_HighWaterMark - m_CurrAllocatedSize : 0;
+            UINT64 MaxPageSize = m_GlobalDynamicAllocator.GetMaxPageSize();
+
             auto NewPageSize = m_BasePageSize;
-            while (NewPageSize < SizeInBytes)
-                NewPageSize *= 2;
+            if (SizeInBytes > MaxPageSize)
+            {
+                // Dedicated page, destroyed once the GPU is done with it
+                NewPageSize = Align(SizeInBytes, m_BasePageSize);
+            }
+            else
+            {
+                while (NewPageSize < SizeInBytes || (NewPageSize < TargetSize && NewPageSize < MaxPageSize))
+                    NewPageSize *= 2;
+            }
 
             auto NewPage = m_GlobalDynamicAllocator.AllocatePage(NewPageSize);
             if (NewPage.IsValid())
@@ -177,6 +167,10 @@ namespace RHI
 
     void DynamicResourceHeap::ReleaseAllocatedPages()
     {
+        m_UsedSizeHistory[m_HistoryIndex] = m_CurrUsedAlignedSize;
+        m_HistoryIndex = (m_HistoryIndex + 1) % HighWaterMarkPeriods;
+        m_HighWaterMark = *std::max_element(m_UsedSizeHistory.begin(), m_UsedSizeHistory.end());
+
         m_GlobalDynamicAllocator.ReleasePages(m_AllocatedPages);
         m_AllocatedPages.clear();
 
@@ -186,4 +180,16 @@ namespace RHI
         m_CurrUsedSize = 0;
         m_CurrUsedAlignedSize = 0;
     }
+
+    DynamicResourceHeap::Stats DynamicResourceHeap::GetStats() const
+    {
+        Stats stats;
+        stats.CurrAllocatedSize = m_CurrAllocatedSize;
+        stats.CurrUsedSize = m_CurrUsedSize;
+        stats.PeakAllocatedSize = m_PeakAllocatedSize;
+        stats.PeakUsedSize = m_PeakUsedSize;
+        stats.HighWaterMark = m_HighWaterMark;
+        stats.NumPages = static_cast<UINT32>(m_AllocatedPages.size());
+        return stats;
+    }
 }
\ No newline at end of file
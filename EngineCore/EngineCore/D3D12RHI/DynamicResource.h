@@ -1,4 +1,5 @@
 #pragma once
+#include "DynamicPagePool.h"
 
 // https://github.com/DiligentGraphics/DiligentCore/blob/master/Graphics/GraphicsEngineD3D12/include/D3D12DynamicHeap.hpp
 // http://diligentgraphics.com/2016/04/20/implementing-dynamic-resources-with-direct3d12/
@@ -35,13 +36,14 @@ namespace RHI
 	class D3D12DynamicPage
 	{
 	public:
+		D3D12DynamicPage() noexcept {}
 		D3D12DynamicPage(UINT64 Size);
 
 		D3D12DynamicPage(D3D12DynamicPage&&) = default;
+		D3D12DynamicPage& operator= (D3D12DynamicPage&&) = default;
 
 		D3D12DynamicPage(const D3D12DynamicPage&) = delete;
 		D3D12DynamicPage& operator= (const D3D12DynamicPage&) = delete;
-		D3D12DynamicPage& operator= (D3D12DynamicPage&&) = delete;
 
 		void* GetCPUAddress(UINT64 offset)
 		{
@@ -76,11 +78,25 @@ namespace RHI
 		D3D12_GPU_VIRTUAL_ADDRESS m_GPUVirtualAddress = 0;
 	};
 
+	// Creates the pages of the DynamicPagePool of DynamicResourceAllocator
+	class D3D12DynamicPageDevice
+	{
+	public:
+		using PageType = D3D12DynamicPage;
+
+		D3D12DynamicPage CreatePage(UINT64 Size) { return D3D12DynamicPage{ Size }; }
+	};
+
 	// Manage all the memory used by dynamic resources, there is only one copy globally
+	// Command contexts recording on different threads take and return pages concurrently through a lock-free DynamicPagePool.
+	// The current page of a context is only used by the thread recording the context, so allocations inside a page never
+	// synchronize (see DynamicResourceHeap)
 	class DynamicResourceAllocator
 	{
 	public:
-		DynamicResourceAllocator(UINT32 NumPagesToReserve, UINT64 PageSize);
+		using Stats = DynamicPagePool<D3D12DynamicPageDevice>::Stats;
+
+		DynamicResourceAllocator(UINT32 NumPagesToReserve, UINT64 PageSize, UINT64 MaxResidentSize, UINT32 PageIdleFrames);
 		~DynamicResourceAllocator();
 
 		DynamicResourceAllocator(const DynamicResourceAllocator&) = delete;
@@ -88,19 +104,43 @@ namespace RHI
 		DynamicResourceAllocator& operator= (const DynamicResourceAllocator&) = delete;
 		DynamicResourceAllocator& operator= (DynamicResourceAllocator&&) = delete;
 
+		// The pages are recycled once the GPU is done with them
 		void ReleasePages(std::vector<D3D12DynamicPage>& Pages);
 
 		void Destroy();
 
-		D3D12DynamicPage AllocatePage(UINT64 SizeInBytes);
+		D3D12DynamicPage AllocatePage(UINT64 SizeInBytes) { return m_PagePool.AllocatePage(SizeInBytes); }
+
+		// Destroys the pooled pages that have been idle for too long. Called once all the contexts of the frame are submitted
+		void FinishFrame() { m_PagePool.FinishFrame(); }
+
+		Stats GetStats() const { return m_PagePool.GetStats(); }
+		UINT64 GetMaxPageSize() const { return m_PagePool.GetMaxPageSize(); }
+
 	private:
-		std::multimap<UINT64/*Page Size*/, D3D12DynamicPage, std::less<UINT64>> m_AvailablePages;
+		D3D12DynamicPageDevice m_PageDevice;
+		DynamicPagePool<D3D12DynamicPageDevice> m_PagePool;
 	};
 
 	// Dynamic resource
+	// New pages are sized from the high-water mark of the recent periods (one period ends with ReleaseAllocatedPages),
+	// so that a context usually needs a single page, and a single large upload is forgotten after HighWaterMarkPeriods.
+	// The pages follow the high-water mark up to the largest pooled page size (a few base pages), an allocation larger than
+	// that gets a dedicated page of its own size
 	class DynamicResourceHeap
 	{
 	public:
+		struct Stats
+		{
+			UINT64 CurrAllocatedSize = 0;
+			UINT64 CurrUsedSize = 0;
+			UINT64 PeakAllocatedSize = 0;
+			UINT64 PeakUsedSize = 0;
+			// Largest aligned size used during one of the last HighWaterMarkPeriods periods
+			UINT64 HighWaterMark = 0;
+			UINT32 NumPages = 0;
+		};
+
 		DynamicResourceHeap(DynamicResourceAllocator& DynamicMemAllocator, UINT64 PageSize): 
 			m_GlobalDynamicAllocator{ DynamicMemAllocator },
 			m_BasePageSize{ PageSize } {  }
@@ -116,7 +156,10 @@ namespace RHI
 
 		void ReleaseAllocatedPages();
 
+		Stats GetStats() const;
+
 		static constexpr UINT64 InvalidOffset = static_cast<UINT64>(-1);
+		static constexpr UINT32 HighWaterMarkPeriods = 64;
 	private:
 		DynamicResourceAllocator& m_GlobalDynamicAllocator;
 
@@ -139,5 +182,10 @@ namespace RHI
 		// peak
 		UINT64 m_PeakUsedSize = 0;
 		UINT64 m_PeakAlignedSize = 0;
+
+		// Aligned size used during the last periods
+		std::array<UINT64, HighWaterMarkPeriods> m_UsedSizeHistory = {};
+		UINT32 m_HistoryIndex = 0;
+		UINT64 m_HighWaterMark = 0;
 	};
 }
\ No newline at end of file
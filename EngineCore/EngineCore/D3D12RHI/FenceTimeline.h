@@ -0,0 +1,256 @@
+#pragma once
+#include "../Common/RingQueue.h"
+
+/*
+* Every command queue has its own fence, a point of the timeline is one fence value per queue.
+* An object released by the CPU may still be used by the command lists of several queues: it is kept with the point that
+* the queues it was used on must reach, and handed back once the completed values of all those queues are past that point.
+* The timeline does not read the fences, the completed values are given to PopCompleted, so it can be driven by simulated fences.
+*
+*   Push(GRAPHICS | COPY, {G:12, C:0, Copy:4}, obj)      completed {G:12, C:7, Copy:3}  -> obj is kept
+*                                                         completed {G:13, C:7, Copy:4}  -> obj is handed back
+*
+* An object released while command lists are being recorded may be used by them, and their fence values are not known yet:
+* DeferredReleaseQueue keeps the object with the recording tickets of the queues until those lists are executed.
+*/
+namespace RHI
+{
+	enum COMMAND_QUEUE_INDEX : UINT32
+	{
+		COMMAND_QUEUE_GRAPHICS = 0,
+		COMMAND_QUEUE_COMPUTE,
+		COMMAND_QUEUE_COPY,
+		COMMAND_QUEUE_COUNT
+	};
+
+	enum COMMAND_QUEUE_MASK : UINT32
+	{
+		COMMAND_QUEUE_MASK_GRAPHICS = 1u << COMMAND_QUEUE_GRAPHICS,
+		COMMAND_QUEUE_MASK_COMPUTE = 1u << COMMAND_QUEUE_COMPUTE,
+		COMMAND_QUEUE_MASK_COPY = 1u << COMMAND_QUEUE_COPY,
+		COMMAND_QUEUE_MASK_ALL = COMMAND_QUEUE_MASK_GRAPHICS | COMMAND_QUEUE_MASK_COMPUTE | COMMAND_QUEUE_MASK_COPY
+	};
+
+	inline COMMAND_QUEUE_INDEX GetCommandQueueIndex(D3D12_COMMAND_LIST_TYPE type)
+	{
+		switch (type)
+		{
+		case D3D12_COMMAND_LIST_TYPE_COMPUTE: return COMMAND_QUEUE_COMPUTE;
+		case D3D12_COMMAND_LIST_TYPE_COPY: return COMMAND_QUEUE_COPY;
+		default: return COMMAND_QUEUE_GRAPHICS;
+		}
+	}
+
+	struct FenceTimelinePoint
+	{
+		UINT64 Values[COMMAND_QUEUE_COUNT] = {};
+
+		// The values of the queues that are not used are 0
+		bool IsCompleted(const FenceTimelinePoint& completed) const
+		{
+			for (UINT32 i = 0; i < COMMAND_QUEUE_COUNT; ++i)
+			{
+				if (Values[i] > completed.Values[i])
+					return false;
+			}
+			return true;
+		}
+	};
+
+	// Not thread safe
+	template <typename ObjectType>
+	class FenceTimelineQueue
+	{
+	public:
+		// Only the values of the queues in queueMask are kept
+		void Push(UINT32 queueMask, const FenceTimelinePoint& point, ObjectType&& object)
+		{
+			assert(queueMask != 0 && (queueMask & ~COMMAND_QUEUE_MASK_ALL) == 0);
+
+			FenceTimelinePoint maskedPoint;
+			for (UINT32 i = 0; i < COMMAND_QUEUE_COUNT; ++i)
+				maskedPoint.Values[i] = (queueMask & (1u << i)) != 0 ? point.Values[i] : 0;
+
+			auto& queue = m_Queues[queueMask];
+			assert((queue.IsEmpty() || queue.Back().first.IsCompleted(maskedPoint)) && "The points must be pushed in the order of the timeline");
+			queue.EmplaceBack(maskedPoint, std::move(object));
+		}
+
+		// Moves the objects whose point is completed to completedObjects
+		void PopCompleted(const FenceTimelinePoint& completed, std::vector<ObjectType>& completedObjects)
+		{
+			for (auto& queue : m_Queues)
+			{
+				while (!queue.IsEmpty() && queue.Front().first.IsCompleted(completed))
+				{
+					completedObjects.emplace_back(std::move(queue.Front().second));
+					queue.PopFront();
+				}
+			}
+		}
+
+		size_t GetSize() const
+		{
+			size_t size = 0;
+			for (const auto& queue : m_Queues)
+				size += queue.GetSize();
+			return size;
+		}
+
+		bool IsEmpty() const { return GetSize() == 0; }
+
+	private:
+		// One queue per combination of queues: in each of them the points only grow, so the objects are handed back in order.
+		// The queues are contiguous rings, releasing an object does not allocate once they reached their peak size
+		RingQueue<std::pair<FenceTimelinePoint, ObjectType>> m_Queues[COMMAND_QUEUE_MASK_ALL + 1];
+	};
+
+	// Command lists of one queue that are being recorded, each one with the ticket taken when it began. Thread safe,
+	// the lists begin and end under a lock, the tickets are read without it
+	class RecordingLists
+	{
+	public:
+		void Begin(const void* list)
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			UINT64 ticket = m_NextTicket.load(std::memory_order_relaxed);
+			m_Lists.emplace_back(ticket, list);
+			// The oldest ticket is already this one if no other list is recorded
+			m_NextTicket.store(ticket + 1, std::memory_order_seq_cst);
+		}
+
+		// The list is executed, its fence value is known
+		void End(const void* list)
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			auto it = std::find_if(m_Lists.begin(), m_Lists.end(), [list](const auto& entry) { return entry.second == list; });
+			assert(it != m_Lists.end());
+			m_Lists.erase(it);
+
+			UINT64 oldestTicket = m_NextTicket.load(std::memory_order_relaxed);
+			for (const auto& entry : m_Lists)
+				oldestTicket = std::min(oldestTicket, entry.first);
+			m_OldestTicket.store(oldestTicket, std::memory_order_seq_cst);
+		}
+
+		// Ticket of the next list that begins
+		UINT64 GetNextTicket() const { return m_NextTicket.load(std::memory_order_seq_cst); }
+
+		// The lists that began before ticket are all executed
+		bool AreExecuted(UINT64 ticket) const { return m_OldestTicket.load(std::memory_order_seq_cst) >= ticket; }
+
+	private:
+		std::mutex m_Mutex;
+		std::atomic<UINT64> m_NextTicket{ 0 };
+		// Ticket of the oldest list being recorded, m_NextTicket if there is none
+		std::atomic<UINT64> m_OldestTicket{ 0 };
+		// A few lists per thread recording, searched linearly
+		std::vector<std::pair<UINT64, const void*>> m_Lists;
+	};
+
+	/*
+	* Release queue of the objects that the command lists being recorded may use. Release() keeps the recording ticket of every
+	* queue of the mask, ResolvePending() gives the object the last executed fence values of the queues once all the lists that
+	* were being recorded are executed, and the object then waits in the timeline for the GPU. An object released while the queues
+	* of its mask record nothing goes to the timeline at once, a queue that stays idle is never waited for.
+	* The queues (indexed by COMMAND_QUEUE_INDEX) have GetRecordingTicket(), AreListsExecuted(ticket) and GetLastExecutedFenceValue().
+	* Not thread safe.
+	*/
+	template <typename ObjectType>
+	class DeferredReleaseQueue
+	{
+	public:
+		template <typename QueueType>
+		void Release(UINT32 queueMask, QueueType* const* queues, ObjectType&& object)
+		{
+			assert(queueMask != 0 && (queueMask & ~COMMAND_QUEUE_MASK_ALL) == 0);
+
+			FenceTimelinePoint tickets;
+			for (UINT32 i = 0; i < COMMAND_QUEUE_COUNT; ++i)
+			{
+				if ((queueMask & (1u << i)) != 0)
+					tickets.Values[i] = queues[i]->GetRecordingTicket();
+			}
+
+			auto& pending = m_Pending[queueMask];
+			if (pending.IsEmpty() && AreListsExecuted(queueMask, queues, tickets))
+				m_Timeline.Push(queueMask, GetLastExecutedPoint(queueMask, queues), std::move(object));
+			else
+				pending.EmplaceBack(tickets, std::move(object));
+		}
+
+		// Called before PopCompleted, the objects are resolved in the order they were released
+		template <typename QueueType>
+		void ResolvePending(QueueType* const* queues)
+		{
+			for (UINT32 queueMask = 1; queueMask <= COMMAND_QUEUE_MASK_ALL; ++queueMask)
+			{
+				auto& pending = m_Pending[queueMask];
+				while (!pending.IsEmpty() && AreListsExecuted(queueMask, queues, pending.Front().first))
+				{
+					m_Timeline.Push(queueMask, GetLastExecutedPoint(queueMask, queues), std::move(pending.Front().second));
+					pending.PopFront();
+				}
+			}
+		}
+
+		void PopCompleted(const FenceTimelinePoint& completed, std::vector<ObjectType>& completedObjects)
+		{
+			m_Timeline.PopCompleted(completed, completedObjects);
+		}
+
+		// Every object, the pending ones included. The GPU must be idle and nothing recorded
+		void PopAll(std::vector<ObjectType>& objects)
+		{
+			FenceTimelinePoint lastPoint;
+			for (auto& value : lastPoint.Values)
+				value = std::numeric_limits<UINT64>::max();
+			m_Timeline.PopCompleted(lastPoint, objects);
+
+			for (auto& pending : m_Pending)
+			{
+				for (; !pending.IsEmpty(); pending.PopFront())
+					objects.emplace_back(std::move(pending.Front().second));
+			}
+		}
+
+		size_t GetSize() const
+		{
+			size_t size = m_Timeline.GetSize();
+			for (const auto& pending : m_Pending)
+				size += pending.GetSize();
+			return size;
+		}
+
+		bool IsEmpty() const { return GetSize() == 0; }
+
+	private:
+		template <typename QueueType>
+		static bool AreListsExecuted(UINT32 queueMask, QueueType* const* queues, const FenceTimelinePoint& tickets)
+		{
+			for (UINT32 i = 0; i < COMMAND_QUEUE_COUNT; ++i)
+			{
+				if ((queueMask & (1u << i)) != 0 && !queues[i]->AreListsExecuted(tickets.Values[i]))
+					return false;
+			}
+			return true;
+		}
+
+		template <typename QueueType>
+		static FenceTimelinePoint GetLastExecutedPoint(UINT32 queueMask, QueueType* const* queues)
+		{
+			FenceTimelinePoint point;
+			for (UINT32 i = 0; i < COMMAND_QUEUE_COUNT; ++i)
+			{
+				if ((queueMask & (1u << i)) != 0)
+					point.Values[i] = queues[i]->GetLastExecutedFenceValue();
+			}
+			return point;
+		}
+
+		// Objects waiting for the lists being recorded when they were released, with the tickets of the queues. One ring per mask
+		// like the timeline, an object waiting for a long recording does not hold back the objects of the other queues
+		RingQueue<std::pair<FenceTimelinePoint, ObjectType>> m_Pending[COMMAND_QUEUE_MASK_ALL + 1];
+		FenceTimelineQueue<ObjectType> m_Timeline;
+	};
+}
\ No newline at end of file
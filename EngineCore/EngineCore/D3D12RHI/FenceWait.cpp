@@ -0,0 +1,81 @@
+#include "../pch.h"
+#include "FenceWait.h"
+
+namespace RHI
+{
+	// Every thread blocks on its own events, several threads may wait on the same fence
+	struct ThreadFenceEvents
+	{
+		static constexpr UINT32 MaxEvents = MAXIMUM_WAIT_OBJECTS;
+
+		HANDLE Events[MaxEvents] = {};
+
+		~ThreadFenceEvents()
+		{
+			Discard();
+		}
+
+		void SetEventOnCompletion(UINT32 Index, ID3D12Fence& Fence, UINT64 Value)
+		{
+			if (Events[Index] == nullptr)
+			{
+				Events[Index] = CreateEvent(nullptr, false, false, nullptr);
+				assert(Events[Index] != NULL);
+			}
+			ThrowIfFailed(Fence.SetEventOnCompletion(Value, Events[Index]));
+		}
+
+		FenceEventResult Wait(UINT32 NumEvents, UINT32 TimeoutMilliseconds)
+		{
+			DWORD Timeout = TimeoutMilliseconds == FENCE_WAIT_NO_TIMEOUT ? INFINITE : TimeoutMilliseconds;
+			DWORD Result = WaitForMultipleObjects(NumEvents, Events, true, Timeout);
+			if (Result == WAIT_TIMEOUT)
+				return FenceEventResult::Timeout;
+			return Result == WAIT_FAILED ? FenceEventResult::Failed : FenceEventResult::Signaled;
+		}
+
+		void Discard()
+		{
+			for (HANDLE& Event : Events)
+			{
+				if (Event != nullptr)
+					CloseHandle(Event);
+				Event = nullptr;
+			}
+		}
+	};
+
+	static thread_local ThreadFenceEvents s_FenceEvents;
+
+	static FenceWaitCounters s_FenceWaitCounters;
+
+	bool WaitForFences(UINT32 NumFences, ID3D12Fence* const* Fences, const UINT64* Values, const FenceWaitPolicy& Policy)
+	{
+		FenceWaitResult Result = WaitForFences(NumFences, Fences, Values, Policy, s_FenceEvents, s_FenceWaitCounters);
+		if (Result == FenceWaitResult::Timeout)
+		{
+			std::string Message = "Fence wait timed out after " + std::to_string(Policy.TimeoutMilliseconds) + " ms:";
+			for (UINT32 i = 0; i < NumFences; ++i)
+			{
+				UINT64 CompletedValue = Fences[i]->GetCompletedValue();
+				if (CompletedValue < Values[i])
+					Message += " fence " + std::to_string(i) + " completed " + std::to_string(CompletedValue) + ", waiting for " + std::to_string(Values[i]) + ";";
+			}
+			LOG_ERROR(Message);
+			return false;
+		}
+
+		if (Result == FenceWaitResult::Failed)
+		{
+			LOG_ERROR("Failed to wait for the fence events");
+			return false;
+		}
+
+		return true;
+	}
+
+	FenceWaitStats GetFenceWaitStats()
+	{
+		return s_FenceWaitCounters.GetStats();
+	}
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+/*
+* CPU waits on fences. A wait first spins for a short bounded time and polls the completed values, so a GPU that is about to
+* finish wakes the thread without a round trip through the kernel event. Only then the events are set and the thread blocks,
+* once for all the fences of the wait (one per queue), until they are all complete or the timeout expires.
+*
+*   poll poll poll ... poll   | SetEventOnCompletion x N, WaitForMultipleObjects(all)
+*   <--- SpinMicroseconds --->|<--------------- up to TimeoutMilliseconds --------------->
+*
+* The wait is a template on the fence and on the events it blocks on, the engine instantiates it with ID3D12Fence and the Win32
+* events (FenceWait.cpp). A stand-in fence signaled by a CPU thread can run the whole wait, blocking and timeout included,
+* e.g. to measure the wake-up latency of a policy without a GPU.
+*
+* FenceType has GetCompletedValue(). EventsType has MaxEvents, SetEventOnCompletion(Index, Fence, Value), which registers its
+* event Index on the fence, Wait(NumEvents, TimeoutMilliseconds), which blocks until the first NumEvents events are all set,
+* and Discard(), which drops the registered events after a timeout.
+*/
+namespace RHI
+{
+	constexpr UINT32 FENCE_WAIT_NO_TIMEOUT = std::numeric_limits<UINT32>::max();
+
+	struct FenceWaitPolicy
+	{
+		// 0 : block immediately
+		UINT32 SpinMicroseconds = 50;
+		// FENCE_WAIT_NO_TIMEOUT : no timeout
+		UINT32 TimeoutMilliseconds = FENCE_WAIT_NO_TIMEOUT;
+	};
+
+	struct FenceWaitStats
+	{
+		UINT64 NumWaits = 0;
+		// Waits completed while spinning
+		UINT64 NumSpinWakeUps = 0;
+		UINT64 NumBlockingWaits = 0;
+		UINT64 NumTimeouts = 0;
+	};
+
+	// Updated by the waits of all the threads
+	struct FenceWaitCounters
+	{
+		std::atomic<UINT64> NumWaits{ 0 };
+		std::atomic<UINT64> NumSpinWakeUps{ 0 };
+		std::atomic<UINT64> NumBlockingWaits{ 0 };
+		std::atomic<UINT64> NumTimeouts{ 0 };
+
+		FenceWaitStats GetStats() const
+		{
+			FenceWaitStats Stats;
+			Stats.NumWaits = NumWaits.load();
+			Stats.NumSpinWakeUps = NumSpinWakeUps.load();
+			Stats.NumBlockingWaits = NumBlockingWaits.load();
+			Stats.NumTimeouts = NumTimeouts.load();
+			return Stats;
+		}
+	};
+
+	enum class FenceWaitResult
+	{
+		Complete,
+		Timeout,
+		// The events could not be waited for
+		Failed
+	};
+
+	enum class FenceEventResult
+	{
+		Signaled,
+		Timeout,
+		Failed
+	};
+
+	// Polls the fences until every fence reached its value or the spin time is over. Returns true if all the fences are complete
+	template <typename FenceType>
+	bool SpinWaitForFences(UINT32 NumFences, FenceType* const* Fences, const UINT64* Values, UINT32 SpinMicroseconds)
+	{
+		const auto SpinEnd = std::chrono::steady_clock::now() + std::chrono::microseconds(SpinMicroseconds);
+		for (;;)
+		{
+			bool AllComplete = true;
+			for (UINT32 i = 0; i < NumFences && AllComplete; ++i)
+				AllComplete = Fences[i]->GetCompletedValue() >= Values[i];
+
+			if (AllComplete)
+				return true;
+			if (std::chrono::steady_clock::now() >= SpinEnd)
+				return false;
+
+			std::this_thread::yield();
+		}
+	}
+
+	// Waits until every fence reached its value, spinning first then blocking on Events. On a timeout the events are
+	// discarded, the fences still hold them and they must not wake up a later wait
+	template <typename FenceType, typename EventsType>
+	FenceWaitResult WaitForFences(UINT32 NumFences, FenceType* const* Fences, const UINT64* Values, const FenceWaitPolicy& Policy,
+		EventsType& Events, FenceWaitCounters& Counters)
+	{
+		assert(NumFences <= EventsType::MaxEvents);
+		++Counters.NumWaits;
+
+		if (SpinWaitForFences(NumFences, Fences, Values, Policy.SpinMicroseconds))
+		{
+			++Counters.NumSpinWakeUps;
+			return FenceWaitResult::Complete;
+		}
+
+		++Counters.NumBlockingWaits;
+		const auto WaitStart = std::chrono::steady_clock::now();
+
+		// An event set by an earlier registration may wake the thread too early, the values are checked again after every wake-up
+		for (;;)
+		{
+			UINT32 NumEvents = 0;
+			for (UINT32 i = 0; i < NumFences; ++i)
+			{
+				if (Fences[i]->GetCompletedValue() < Values[i])
+					Events.SetEventOnCompletion(NumEvents++, *Fences[i], Values[i]);
+			}
+
+			if (NumEvents == 0)
+				return FenceWaitResult::Complete;
+
+			UINT32 Timeout = FENCE_WAIT_NO_TIMEOUT;
+			if (Policy.TimeoutMilliseconds != FENCE_WAIT_NO_TIMEOUT)
+			{
+				auto Elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - WaitStart).count();
+				Timeout = Elapsed >= Policy.TimeoutMilliseconds ? 0 : Policy.TimeoutMilliseconds - static_cast<UINT32>(Elapsed);
+			}
+
+			FenceEventResult Result = Events.Wait(NumEvents, Timeout);
+			if (Result == FenceEventResult::Timeout)
+			{
+				++Counters.NumTimeouts;
+				Events.Discard();
+				return FenceWaitResult::Timeout;
+			}
+
+			if (Result == FenceEventResult::Failed)
+				return FenceWaitResult::Failed;
+		}
+	}
+
+	// The wait of the D3D12 fences, on the events of the calling thread. Returns false if the timeout of the policy expired,
+	// the fences that were not complete are logged
+	bool WaitForFences(UINT32 NumFences, ID3D12Fence* const* Fences, const UINT64* Values, const FenceWaitPolicy& Policy = FenceWaitPolicy());
+
+	// Counters of all the D3D12 fence waits since the start
+	FenceWaitStats GetFenceWaitStats();
+}
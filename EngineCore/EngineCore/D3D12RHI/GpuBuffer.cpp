@@ -12,26 +12,20 @@ namespace RHI
 		m_ElementCount = numElements;
 		m_ElementSize = elementSize;
 		m_BufferSize = elementSize * numElements;
-		m_UsageState = initialState;
+		*m_UsageState = initialState;
 		m_HeapType = heapType;
 	}
 
-	void GpuBuffer::CreateBufferResource(const void* initData)
+	GpuBuffer::~GpuBuffer()
 	{
-		D3D12_RESOURCE_DESC ResourceDesc = DescribeBuffer();
-
-		D3D12_HEAP_PROPERTIES HeapProps;
-		HeapProps.Type = m_HeapType;
-		HeapProps.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
-		HeapProps.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
-		HeapProps.CreationNodeMask = 1;
-		HeapProps.VisibleNodeMask = 1;
-
-		ID3D12Device* device = RenderDevice::GetSingleton().GetD3D12Device();
-		ThrowIfFailed(device->CreateCommittedResource(&HeapProps, D3D12_HEAP_FLAG_NONE,
-			&ResourceDesc, m_UsageState, nullptr, IID_PPV_ARGS(&m_pResource)));
+		// The range is given back to the shared buffer once the GPU is done with it
+		if (!m_Allocation.IsNull())
+			RenderDevice::GetSingleton().SafeReleaseDeviceObject(std::move(m_Allocation));
+	}
 
-		m_GpuVirtualAddress = m_pResource->GetGPUVirtualAddress();
+	void GpuBuffer::CreateBufferResource(const void* initData)
+	{
+		AllocateBufferResource();
 
 		// If initData is provided, the data will uploaded to the upload heap, and then copy to buffer
 		if (initData != nullptr)
@@ -40,7 +34,37 @@ namespace RHI
 
 	void GpuBuffer::CreateBufferResource(const GpuUploadBuffer& srcData, UINT32 srcOffset)
 	{
+		AllocateBufferResource();
+
+		// If initData is provided, the data will uploaded to the upload heap, and then copy to buffer
+		CommandContext::InitializeBuffer(*this, srcData, srcOffset);
+	}
+
+	void GpuBuffer::AllocateBufferResource()
+	{
+		RenderDevice& renderDevice = RenderDevice::GetSingleton();
+
+		if (m_HeapType == D3D12_HEAP_TYPE_DEFAULT || m_HeapType == D3D12_HEAP_TYPE_UPLOAD)
+		{
+			// The buffers of a block are never transitioned, a buffer created in a state they can not be used in gets its own resource
+			GpuBufferAllocator& bufferAllocator = renderDevice.GetGpuBufferAllocator(m_HeapType);
+			if (bufferAllocator.CanShareBlock(m_UsageState->GetState()))
+				m_Allocation = bufferAllocator.Allocate(m_BufferSize, GetSubAllocationAlignment());
+
+			if (!m_Allocation.IsNull())
+			{
+				m_pResource = m_Allocation.GetResource();
+				m_BufferOffset = m_Allocation.GetOffset();
+				m_IsSubAllocated = true;
+				// The uploads to a buffer in COMMON go to the copy queue (see UploadManager)
+				*m_UsageState = bufferAllocator.GetResourceState();
+				m_GpuVirtualAddress = m_pResource->GetGPUVirtualAddress() + m_BufferOffset;
+				return;
+			}
+		}
+
 		D3D12_RESOURCE_DESC ResourceDesc = DescribeBuffer();
+
 		D3D12_HEAP_PROPERTIES HeapProps;
 		HeapProps.Type = m_HeapType;
 		HeapProps.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
@@ -48,14 +72,24 @@ namespace RHI
 		HeapProps.CreationNodeMask = 1;
 		HeapProps.VisibleNodeMask = 1;
 
-		ID3D12Device* d3dDevice = RenderDevice::GetSingleton().GetD3D12Device();
-		ThrowIfFailed(d3dDevice->CreateCommittedResource(&HeapProps, D3D12_HEAP_FLAG_NONE,
-			&ResourceDesc, m_UsageState, nullptr, IID_PPV_ARGS(&m_pResource)));
+		ID3D12Device* device = renderDevice.GetD3D12Device();
+		ThrowIfFailed(device->CreateCommittedResource(&HeapProps, D3D12_HEAP_FLAG_NONE,
+			&ResourceDesc, m_UsageState->GetState(), nullptr, IID_PPV_ARGS(&m_pResource)));
 
+		m_BufferOffset = 0;
 		m_GpuVirtualAddress = m_pResource->GetGPUVirtualAddress();
+	}
 
-		// If initData is provided, the data will uploaded to the upload heap, and then copy to buffer
-		CommandContext::InitializeBuffer(*this, srcData, srcOffset);
+	UINT64 GpuBuffer::GetSubAllocationAlignment() const
+	{
+		assert(m_ElementSize != 0);
+
+		// Constant buffer views need 256 bytes, textures copied from the upload heap need 512 bytes
+		UINT64 alignment = (m_HeapType == D3D12_HEAP_TYPE_UPLOAD) ?
+			D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT : D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT;
+
+		// Structured buffer views start at an element index, so the offset must also be a multiple of the element size
+		return std::lcm<UINT64>(alignment, m_ElementSize);
 	}
 
 	D3D12_VERTEX_BUFFER_VIEW GpuBuffer::CreateVBV(size_t offset, uint32_t size, uint32_t stride) const
@@ -96,6 +130,7 @@ namespace RHI
 		SRVDesc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
 		SRVDesc.Format = DXGI_FORMAT_UNKNOWN;
 		SRVDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+		SRVDesc.Buffer.FirstElement = m_BufferOffset / m_ElementSize;
 		SRVDesc.Buffer.NumElements = m_ElementCount;
 		SRVDesc.Buffer.StructureByteStride = m_ElementSize;
 		SRVDesc.Buffer.Flags = D3D12_BUFFER_SRV_FLAG_NONE;
@@ -2,6 +2,7 @@
 
 #include "GpuResource.h"
 #include "DynamicResource.h"
+#include "GpuBufferAllocator.h"
 
 // https://docs.microsoft.com/en-us/windows/win32/direct3d12/uploading-resources
 // https://docs.microsoft.com/en-us/windows/win32/direct3d12/resource-binding-flow-of-control
@@ -16,11 +17,14 @@ namespace RHI
 	* Upload state : CPU WRITE, GPU READ
 	* Dynamic state : Dynamic buffer, CPU READ, GPU WRITE
 	* 1- Creating the Committed Resource (CreateCommittedResource), 2 - Resource Barrier
+	* Small Default and Upload buffers are sub-allocated from a shared buffer of the GpuBufferAllocator instead,
+	* m_pResource is then the shared buffer and the data of this buffer starts at m_BufferOffset
 	*/
 	class GpuBuffer : public GpuResource
 	{
 	public:
 		GpuBuffer(UINT32 numElements, UINT32 elementSize, D3D12_RESOURCE_STATES initialState, D3D12_HEAP_TYPE heapType);
+		virtual ~GpuBuffer();
 
 		// Descriptor
 		virtual D3D12_GPU_VIRTUAL_ADDRESS GetGpuVirtualAddress() const { return m_GpuVirtualAddress; }
@@ -39,6 +43,9 @@ namespace RHI
 		UINT64 GetBufferSize() const { return m_BufferSize; }
 		UINT32 GetElementCount() const { return m_ElementCount; }
 		UINT32 GetElementSize() const { return m_ElementSize; }
+		// Offset of the buffer in GetResource(), not 0 if the buffer is sub-allocated
+		UINT64 GetBufferOffset() const { return m_BufferOffset; }
+		D3D12_HEAP_TYPE GetHeapType() const { return m_HeapType; }
 
 	protected:
 		// Create Buffer resources
@@ -47,6 +54,10 @@ namespace RHI
 
 		D3D12_RESOURCE_DESC DescribeBuffer();
 
+		// Sub-allocate the buffer if it is small enough, otherwise create a committed resource
+		void AllocateBufferResource();
+		UINT64 GetSubAllocationAlignment() const;
+
 		// address of GPU buffer
 		D3D12_GPU_VIRTUAL_ADDRESS m_GpuVirtualAddress = D3D12_GPU_VIRTUAL_ADDRESS_NULL;
 		D3D12_HEAP_TYPE m_HeapType;
@@ -54,19 +65,24 @@ namespace RHI
 		UINT64 m_BufferSize;
 		UINT32 m_ElementCount;
 		UINT32 m_ElementSize;
+
+		// Not null if the buffer is a range of a shared buffer
+		GpuBufferAllocation m_Allocation;
+		UINT64 m_BufferOffset = 0;
 	};
 
 	class GpuDefaultBuffer : public GpuBuffer
 	{
 	public:
+		// Created in GENERIC_READ, the state it is left in after the initialization, so that it can be sub-allocated
 		GpuDefaultBuffer(UINT32 numElements, UINT32 elementSize, const void* initialData)
-			: GpuBuffer(numElements, elementSize, D3D12_RESOURCE_STATE_COMMON, D3D12_HEAP_TYPE_DEFAULT) 
+			: GpuBuffer(numElements, elementSize, D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_HEAP_TYPE_DEFAULT) 
 		{
 			CreateBufferResource(initialData);
 		}
 
 		GpuDefaultBuffer(UINT32 NumElements, UINT32 ElementSize, const GpuUploadBuffer& srcData, UINT32 srcOffset) :
-			GpuBuffer(NumElements, ElementSize, D3D12_RESOURCE_STATE_COMMON, D3D12_HEAP_TYPE_DEFAULT)
+			GpuBuffer(NumElements, ElementSize, D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_HEAP_TYPE_DEFAULT)
 		{
 			CreateBufferResource(srcData, srcOffset);
 		}
@@ -84,13 +100,13 @@ namespace RHI
 		void* Map(void)
 		{
 			void* Memory;
-			m_pResource->Map(0, &CD3DX12_RANGE(0, m_BufferSize), &Memory);
-			return Memory;
+			m_pResource->Map(0, &CD3DX12_RANGE(m_BufferOffset, m_BufferOffset + m_BufferSize), &Memory);
+			return reinterpret_cast<UINT8*>(Memory) + m_BufferOffset;
 		}
 
 		void UnMap(size_t begin = 0, size_t end = -1)
 		{
-			m_pResource->Unmap(0, &CD3DX12_RANGE(begin, std::min(end, m_BufferSize)));
+			m_pResource->Unmap(0, &CD3DX12_RANGE(m_BufferOffset + begin, m_BufferOffset + std::min(end, m_BufferSize)));
 		}
 	};
 
@@ -0,0 +1,130 @@
+#include "../pch.h"
+#include "GpuBufferAllocator.h"
+
+namespace RHI
+{
+	// -------------------------- GPU BUFFER ALLOCATION ---------------------------------------
+	GpuBufferAllocation& GpuBufferAllocation::operator = (GpuBufferAllocation&& rhs) noexcept
+	{
+		if (this == &rhs)
+			return *this;
+
+		if (m_pAllocator != nullptr)
+			m_pAllocator->Free(std::move(*this));
+
+		m_pAllocator = rhs.m_pAllocator;
+		m_pResource = rhs.m_pResource;
+		m_Offset = rhs.m_Offset;
+		m_Slot = rhs.m_Slot;
+
+		rhs.Reset();
+
+		return *this;
+	}
+
+	GpuBufferAllocation::~GpuBufferAllocation()
+	{
+		if (m_pAllocator != nullptr)
+			m_pAllocator->Free(std::move(*this));
+	}
+
+	// -------------------------- D3D12 BUFFER BLOCK DEVICE ---------------------------------------
+	D3D12BufferBlockDevice::BlockType D3D12BufferBlockDevice::CreateBlock(UINT64 blockSize)
+	{
+		BlockType block;
+
+		D3D12_HEAP_DESC heapDesc = {};
+		heapDesc.SizeInBytes = blockSize;
+		heapDesc.Properties.Type = m_HeapType;
+		heapDesc.Properties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+		heapDesc.Properties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+		heapDesc.Properties.CreationNodeMask = 1;
+		heapDesc.Properties.VisibleNodeMask = 1;
+		heapDesc.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+		heapDesc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+		ThrowIfFailed(m_D3D12Device->CreateHeap(&heapDesc, IID_PPV_ARGS(&block.Heap)));
+
+		D3D12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(blockSize);
+		ThrowIfFailed(m_D3D12Device->CreatePlacedResource(block.Heap.Get(), 0, &bufferDesc,
+			m_BufferState, nullptr, IID_PPV_ARGS(&block.Buffer)));
+		block.Buffer->SetName(L"GpuBufferAllocator Block");
+
+		return block;
+	}
+
+	// -------------------------- GPU BUFFER ALLOCATOR ---------------------------------------
+	GpuBufferAllocator::GpuBufferAllocator(ID3D12Device* d3d12Device, D3D12_HEAP_TYPE heapType, UINT64 blockSize, UINT64 maxSubAllocationSize) :
+		m_HeapType{ heapType },
+		m_Device{ d3d12Device, heapType, GetResourceState() },
+		m_Blocks{ m_Device, blockSize, maxSubAllocationSize }
+	{
+		assert(m_HeapType == D3D12_HEAP_TYPE_DEFAULT || m_HeapType == D3D12_HEAP_TYPE_UPLOAD);
+		assert(blockSize % D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT == 0);
+	}
+
+	GpuBufferAllocator::~GpuBufferAllocator()
+	{
+		Stats stats = GetStats();
+		if (stats.NumAllocations != 0)
+			LOG_WARNING("Buffers are still sub-allocated when the allocator is destroyed");
+	}
+
+	GpuBufferAllocation GpuBufferAllocator::Allocate(UINT64 size, UINT64 alignment)
+	{
+		if (!CanSubAllocate(size))
+			return GpuBufferAllocation{};
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		UINT32 slot = m_Blocks.Allocate(size, alignment);
+		if (slot == BufferBlockAllocator<D3D12BufferBlockDevice>::InvalidSlot)
+			return GpuBufferAllocation{};
+
+		const auto& range = m_Blocks.GetRange(slot);
+		return GpuBufferAllocation{ *this, m_Blocks.GetBlock(range.BlockId).Buffer.Get(), range.Offset, slot };
+	}
+
+	void GpuBufferAllocator::Free(GpuBufferAllocation&& allocation)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Blocks.Free(allocation.GetSlot());
+		}
+
+		allocation.Reset();
+	}
+
+	GpuBufferAllocator::Stats GpuBufferAllocator::GetStats()
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return m_Blocks.GetStats();
+	}
+
+	void GpuBufferAllocator::DumpStats()
+	{
+		Stats stats = GetStats();
+
+		std::string message = (m_HeapType == D3D12_HEAP_TYPE_UPLOAD) ? "Upload" : "Default";
+		message += " buffer allocator: " + std::to_string(stats.NumBlocks) + " blocks, " +
+			std::to_string(stats.NumAllocations) + " buffers, " +
+			std::to_string(stats.UsedSize) + " / " + std::to_string(stats.ReservedSize) + " bytes used, largest free range " +
+			std::to_string(stats.LargestFreeRange) + " bytes";
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		for (UINT32 blockId = 0; blockId < m_Blocks.GetNumBlockIds(); ++blockId)
+		{
+			if (!m_Blocks.IsBlockAlive(blockId))
+				continue;
+
+			// Many free ranges with a small largest range means the block is fragmented
+			auto blockStats = m_Blocks.GetBlockStats(blockId);
+			message += "\n  Block " + std::to_string(blockId) + ": " +
+				std::to_string(blockStats.NumAllocations) + " buffers, " +
+				std::to_string(blockStats.UsedSize) + " bytes used, " +
+				std::to_string(blockStats.NumFreeRanges) + " free ranges, largest " +
+				std::to_string(blockStats.LargestFreeRange) + " bytes";
+		}
+
+		LOG(message);
+	}
+}
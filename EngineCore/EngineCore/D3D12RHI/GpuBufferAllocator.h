@@ -0,0 +1,163 @@
+#pragma once
+
+#include "BufferBlockAllocator.h"
+
+/*
+* Small buffers do not get their own committed resource (every committed resource is at least 64 KB and is a separate
+* kernel allocation), they are sub-allocated from large blocks instead.
+* A block is one ID3D12Heap with a single buffer placed over the whole heap, the buffers of the application are ranges
+* of that shared ID3D12Resource. The blocks and ranges are managed by a BufferBlockAllocator, this class adds the D3D12 device and the lock.
+*
+*   Block 0  [ VB | CB |   free   | IB |      free       ]   <- one ID3D12Heap + one placed ID3D12Resource
+*   Block 1  [ CB | CB | VB |            free            ]
+*
+* The shared buffers are never transitioned (see GetResourceState()): the blocks of the default heap stay in COMMON and hold
+* the buffers created in COMMON, COPY_DEST or a read state, the blocks of the upload heap stay in GENERIC_READ. A buffer
+* created in another state gets its own committed resource (see CanShareBlock() and GpuBuffer).
+*/
+namespace RHI
+{
+	class GpuBufferAllocator;
+
+	// A range of a shared buffer resource, the range is given back to its block when the object is destroyed.
+	// The owner is responsible for keeping it alive while the GPU may still access the range (see GpuBuffer)
+	class GpuBufferAllocation
+	{
+		friend class GpuBufferAllocator;
+	public:
+		GpuBufferAllocation() noexcept {}
+
+		GpuBufferAllocation(GpuBufferAllocator& allocator,
+			ID3D12Resource* resource,
+			UINT64 offset,
+			UINT32 slot) noexcept :
+			m_pAllocator{ &allocator },
+			m_pResource{ resource },
+			m_Offset{ offset },
+			m_Slot{ slot }
+		{
+		}
+
+		GpuBufferAllocation(GpuBufferAllocation&& rhs) noexcept :
+			m_pAllocator{ rhs.m_pAllocator },
+			m_pResource{ rhs.m_pResource },
+			m_Offset{ rhs.m_Offset },
+			m_Slot{ rhs.m_Slot }
+		{
+			rhs.Reset();
+		}
+
+		GpuBufferAllocation& operator = (GpuBufferAllocation&& rhs) noexcept;
+
+		GpuBufferAllocation(const GpuBufferAllocation&) = delete;
+		GpuBufferAllocation& operator = (const GpuBufferAllocation&) = delete;
+
+		~GpuBufferAllocation();
+
+		bool IsNull() const { return m_pAllocator == nullptr; }
+
+		// Shared buffer of the block, the range starts at GetOffset()
+		ID3D12Resource* GetResource() const { return m_pResource; }
+		UINT64 GetOffset() const { return m_Offset; }
+		// Record of the range in the allocator
+		UINT32 GetSlot() const { return m_Slot; }
+
+	private:
+		void Reset()
+		{
+			m_pAllocator = nullptr;
+			m_pResource = nullptr;
+			m_Offset = 0;
+			m_Slot = 0;
+		}
+
+		GpuBufferAllocator* m_pAllocator = nullptr;
+		// The block owns the resource
+		ID3D12Resource* m_pResource = nullptr;
+		// Aligned offset of the buffer in m_pResource
+		UINT64 m_Offset = 0;
+		UINT32 m_Slot = 0;
+	};
+
+	// Creates the blocks of a GpuBufferAllocator: one ID3D12Heap with a single buffer placed over the whole heap
+	class D3D12BufferBlockDevice
+	{
+	public:
+		struct BlockType
+		{
+			Microsoft::WRL::ComPtr<ID3D12Heap> Heap;
+			Microsoft::WRL::ComPtr<ID3D12Resource> Buffer;
+		};
+
+		D3D12BufferBlockDevice(ID3D12Device* d3d12Device, D3D12_HEAP_TYPE heapType, D3D12_RESOURCE_STATES bufferState) :
+			m_D3D12Device{ d3d12Device },
+			m_HeapType{ heapType },
+			m_BufferState{ bufferState }
+		{
+		}
+
+		BlockType CreateBlock(UINT64 blockSize);
+
+	private:
+		ID3D12Device* m_D3D12Device;
+		const D3D12_HEAP_TYPE m_HeapType;
+		const D3D12_RESOURCE_STATES m_BufferState;
+	};
+
+	// Sub-allocates buffers of one heap type, thread safe
+	class GpuBufferAllocator
+	{
+	public:
+		using Stats = BufferBlockAllocator<D3D12BufferBlockDevice>::Stats;
+
+		// Buffers larger than maxSubAllocationSize must use a committed resource
+		GpuBufferAllocator(ID3D12Device* d3d12Device, D3D12_HEAP_TYPE heapType, UINT64 blockSize, UINT64 maxSubAllocationSize);
+		~GpuBufferAllocator();
+
+		GpuBufferAllocator(const GpuBufferAllocator&) = delete;
+		GpuBufferAllocator(GpuBufferAllocator&&) = delete;
+		GpuBufferAllocator& operator = (const GpuBufferAllocator&) = delete;
+		GpuBufferAllocator& operator = (GpuBufferAllocator&&) = delete;
+
+		// The alignment does not need to be a power of two (a multiple of the element size for structured buffer views).
+		// Returns a null allocation if the buffer is too large to be sub-allocated
+		GpuBufferAllocation Allocate(UINT64 size, UINT64 alignment);
+
+		bool CanSubAllocate(UINT64 size) const { return m_Blocks.CanSubAllocate(size); }
+
+		Stats GetStats();
+		// Writes the stats of the allocator and of every block to the log
+		void DumpStats();
+
+		D3D12_HEAP_TYPE GetHeapType() const { return m_HeapType; }
+		// State of the shared buffers, they are never transitioned: one barrier would change the state of all the buffers of a block.
+		// The blocks of the default heap stay in COMMON, a buffer is implicitly promoted to the state of its use in a command list
+		// and decays back to COMMON once the command lists submitted with it are done. A buffer written by the GPU must not be
+		// read in the same submission. The upload heap is always in GENERIC_READ
+		D3D12_RESOURCE_STATES GetResourceState() const
+		{
+			return (m_HeapType == D3D12_HEAP_TYPE_DEFAULT) ? D3D12_RESOURCE_STATE_COMMON : D3D12_RESOURCE_STATE_GENERIC_READ;
+		}
+
+		// A buffer created in this state can share a block: its first use does not need a barrier
+		bool CanShareBlock(D3D12_RESOURCE_STATES state) const
+		{
+			if (m_HeapType == D3D12_HEAP_TYPE_UPLOAD)
+				return state == D3D12_RESOURCE_STATE_GENERIC_READ;
+
+			return state == D3D12_RESOURCE_STATE_COMMON || state == D3D12_RESOURCE_STATE_COPY_DEST ||
+				(state & ~D3D12_RESOURCE_STATE_GENERIC_READ) == 0;
+		}
+
+	private:
+		friend class GpuBufferAllocation;
+
+		void Free(GpuBufferAllocation&& allocation);
+
+		const D3D12_HEAP_TYPE m_HeapType;
+		D3D12BufferBlockDevice m_Device;
+
+		std::mutex m_Mutex;
+		BufferBlockAllocator<D3D12BufferBlockDevice> m_Blocks;
+	};
+}
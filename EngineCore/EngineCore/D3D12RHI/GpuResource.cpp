@@ -8,4 +8,24 @@ namespace RHI
 	{
 		RenderDevice::GetSingleton().SafeReleaseDeviceObject(m_pResource);
 	}
+
+	UINT GpuResource::GetNumSubresources()
+	{
+		if (m_NumSubresources == 0)
+		{
+			D3D12_RESOURCE_DESC desc = m_pResource->GetDesc();
+			if (desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
+			{
+				m_NumSubresources = 1;
+			}
+			else
+			{
+				UINT arraySize = (desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE3D) ? 1 : desc.DepthOrArraySize;
+				UINT planeCount = D3D12GetFormatPlaneCount(RenderDevice::GetSingleton().GetD3D12Device(), desc.Format);
+				m_NumSubresources = desc.MipLevels * arraySize * std::max(planeCount, 1u);
+			}
+		}
+
+		return m_NumSubresources;
+	}
 }
\ No newline at end of file
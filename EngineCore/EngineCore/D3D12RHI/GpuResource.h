@@ -1,4 +1,5 @@
 #pragma once
+#include "ResourceStateTracker.h"
 
 /*
 * The base class of all resources on the GPU
@@ -21,6 +22,7 @@ namespace RHI
 		friend class CommandContext;
 		friend class GraphicsContext;
 		friend class ComputeContext;
+		friend class UploadManager;
 	public:
 		virtual ~GpuResource();
 
@@ -30,9 +32,19 @@ namespace RHI
 		ID3D12Resource* GetResource() { return m_pResource.Get(); }
 		const ID3D12Resource* GetResource() const { return m_pResource.Get(); }
 
+		// Mip levels x array slices x planes, 1 for buffers
+		UINT GetNumSubresources();
+
 	protected:
 		Microsoft::WRL::ComPtr<ID3D12Resource> m_pResource;
-		D3D12_RESOURCE_STATES m_UsageState;
-		D3D12_RESOURCE_STATES m_TransitioningState = (D3D12_RESOURCE_STATES)-1;
+		// Global state of each subresource, as of the last submitted command list (see ResourceStateTracker).
+		// Shared with the command lists that use the resource until they are submitted
+		std::shared_ptr<SubresourceStates> m_UsageState = std::make_shared<SubresourceStates>();
+		// The resource is shared with other GpuResources and is never transitioned, it is only written by copies in a list of
+		// their own (see GpuBufferAllocator::GetResourceState and CommandContext::BeginBufferInitialization)
+		bool m_IsSubAllocated = false;
+
+	private:
+		UINT m_NumSubresources = 0;
 	};
 }
\ No newline at end of file
@@ -298,7 +298,8 @@ namespace RHI
 	GpuTexture2D::GpuTexture2D(UINT32 width, UINT32 height, DXGI_FORMAT format, UINT64 RowPitchBytes, const void* InitialData)
 		: GpuTexture(width, height, D3D12_RESOURCE_DIMENSION_TEXTURE2D, format)
 	{
-		m_UsageState = D3D12_RESOURCE_STATE_COPY_DEST;
+		// Created in the COMMON state so that the data can be uploaded by the copy queue
+		*m_UsageState = D3D12_RESOURCE_STATE_COMMON;
 
 		D3D12_RESOURCE_DESC texDesc = {};
 		texDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
@@ -320,7 +321,7 @@ namespace RHI
 		HeapProps.VisibleNodeMask = 1;
 
 		ThrowIfFailed(RenderDevice::GetSingleton().GetD3D12Device()->CreateCommittedResource(&HeapProps, D3D12_HEAP_FLAG_NONE, &texDesc,
-			m_UsageState, nullptr, IID_PPV_ARGS(&m_pResource)));
+			m_UsageState->GetState(), nullptr, IID_PPV_ARGS(&m_pResource)));
 
 		D3D12_SUBRESOURCE_DATA texResource;
 		texResource.pData = InitialData;
@@ -351,7 +352,7 @@ namespace RHI
 		: GpuTexture((UINT32)desc.Width, (UINT32)desc.Height, D3D12_RESOURCE_DIMENSION_TEXTURE2D, desc.Format),
 		m_ClearColor(clearColor)
 	{
-		m_UsageState = D3D12_RESOURCE_STATE_PRESENT;
+		*m_UsageState = D3D12_RESOURCE_STATE_PRESENT;
 		m_pResource.Attach(resource);
 	}
 
@@ -384,10 +385,10 @@ namespace RHI
 
 		CD3DX12_HEAP_PROPERTIES HeapProps(D3D12_HEAP_TYPE_DEFAULT);
 
-		m_UsageState = D3D12_RESOURCE_STATE_COMMON;
+		*m_UsageState = D3D12_RESOURCE_STATE_COMMON;
 
 		ThrowIfFailed(RenderDevice::GetSingleton().GetD3D12Device()->CreateCommittedResource(&HeapProps, D3D12_HEAP_FLAG_NONE,
-			&Desc, m_UsageState, &ClearValue, IID_PPV_ARGS(&m_pResource)));
+			&Desc, m_UsageState->GetState(), &ClearValue, IID_PPV_ARGS(&m_pResource)));
 	}
 
 	std::shared_ptr<GpuResourceDescriptor> GpuRenderTextureColor::CreateSRV()
@@ -456,10 +457,10 @@ namespace RHI
 
 		CD3DX12_HEAP_PROPERTIES HeapProps(D3D12_HEAP_TYPE_DEFAULT);
 
-		m_UsageState = D3D12_RESOURCE_STATE_COMMON;
+		*m_UsageState = D3D12_RESOURCE_STATE_COMMON;
 
 		ThrowIfFailed(RenderDevice::GetSingleton().GetD3D12Device()->CreateCommittedResource(&HeapProps, D3D12_HEAP_FLAG_NONE,
-			&Desc, m_UsageState, &ClearValue, IID_PPV_ARGS(&m_pResource)));
+			&Desc, m_UsageState->GetState(), &ClearValue, IID_PPV_ARGS(&m_pResource)));
 	}
 
 	std::shared_ptr<RHI::GpuResourceDescriptor> GpuRenderTextureDepth::CreateDSV()
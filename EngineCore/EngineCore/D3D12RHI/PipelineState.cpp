@@ -6,11 +6,13 @@ namespace RHI
 {
 	PipelineState::PipelineState(RenderDevice* renderDevice, const PipelineStateDesc& desc)
 		: m_RenderDevice(renderDevice),
-		m_RootSignature(renderDevice)
+		m_RootSignature(renderDevice),
+		m_Desc(desc),
+		m_VariableTable(desc.VariableConfig)
 	{
 		auto pd3d12Device = m_RenderDevice->GetD3D12Device();
 
-		D3D12_GRAPHICS_PIPELINE_STATE_DESC d3d12PSODesc;
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC d3d12PSODesc = {};
 		// Status of external settings
 		d3d12PSODesc.InputLayout = m_Desc.GraphicsPipeline.GraphicPipelineState.InputLayout;
 		d3d12PSODesc.RasterizerState = m_Desc.GraphicsPipeline.GraphicPipelineState.RasterizerState;
@@ -30,7 +32,8 @@ namespace RHI
 		// PSO Shader configuration
 		// TODO 
 		
-		// Root Signature
+		// Root Signature, shared with the other PSOs that have the same root parameters
+		m_RootSignature.Finalize(pd3d12Device);
 		d3d12PSODesc.pRootSignature = m_RootSignature.GetD3D12RootSignature();
 
 		d3d12PSODesc.NodeMask = 0;
@@ -38,14 +41,13 @@ namespace RHI
 		d3d12PSODesc.CachedPSO.CachedBlobSizeInBytes = 0;
 		d3d12PSODesc.Flags = D3D12_PIPELINE_STATE_FLAG_NONE;
 
-		// Creating PSO 
-		ThrowIfFailed(pd3d12Device->CreateGraphicsPipelineState(&d3d12PSODesc, IID_PPV_ARGS(&m_D3D12PSO)));
+		// Creating PSO, with the blob compiled by a previous run if the pipeline state cache has one
+		auto& pipelineStateCache = m_RenderDevice->GetPipelineStateCache();
+		UINT64 pipelineHash = PipelineStateCache::ComputePipelineHash(d3d12PSODesc, m_RootSignature.GetHash());
+		m_D3D12PSO = pipelineStateCache.CreateGraphicsPipelineState(pd3d12Device, d3d12PSODesc, pipelineHash);
 
-		// Set name
+		// Set name, the root signature is named by the cache
 		m_D3D12PSO->SetName(m_Desc.Name.c_str());
-		std::wstring rootSignatureName(L"RootSignature For PSO ");
-		rootSignatureName.append(m_Desc.Name);
-		m_RootSignature.GetD3D12RootSignature()->SetName(rootSignatureName.c_str());
 
 		// TODO
 	}
@@ -53,6 +55,6 @@ namespace RHI
 	PipelineState::~PipelineState()
 	{
 		if (m_D3D12PSO)
-			m_RenderDevice->SafeReleaseDeviceObject(std::move(m_D3D12PSO));
+			m_RenderDevice->SafeReleaseDeviceObject(std::move(m_D3D12PSO), COMMAND_QUEUE_MASK_GRAPHICS | COMMAND_QUEUE_MASK_COMPUTE);
 	}
 }
\ No newline at end of file
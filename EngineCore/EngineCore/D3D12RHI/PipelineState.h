@@ -1,6 +1,7 @@
 #pragma once
 
 #include "RootSignature.h"
+#include "ShaderObject/ShaderVariableTable.h"
 
 namespace RHI
 {
@@ -14,20 +15,6 @@ namespace RHI
 		D3D12_GRAPHICS_PIPELINE_STATE_DESC GraphicPipelineState;
 	};
 
-	struct ShaderResourceVariableDesc
-	{
-		SHADER_TYPE ShaderType = SHADER_TYPE_UNKNOWN;
-		std::string Name;
-		SHADER_RESOURCE_VARIABLE_TYPE Type;
-	};
-
-	struct ShaderVariableConfig
-	{
-		SHADER_RESOURCE_VARIABLE_TYPE DefaultVariableType = SHADER_RESOURCE_VARIABLE_TYPE_STATIC;
-
-		std::vector<ShaderResourceVariableDesc> Variables;
-	};
-
 	struct PipelineStateDesc
 	{
 		std::wstring Name = L"Default PSO";
@@ -35,6 +22,9 @@ namespace RHI
 		PIPELINE_TYPE PipelineType;
 
 		GraphicsPipelineDesc GraphicsPipeline;
+
+		// Variable types of the shader resources, indexed by name in a ShaderVariableTable when the PSO is created
+		ShaderVariableConfig VariableConfig;
 	};
 
 	class PipelineState
@@ -48,6 +38,7 @@ namespace RHI
 		ID3D12RootSignature* GetD3D12RootSignature() const { return m_RootSignature.GetD3D12RootSignature(); }
 		const RootSignature* GetRootSignature() const { return &m_RootSignature; }
 		RenderDevice* GetRenderDevice() const { return m_RenderDevice; }
+		const ShaderVariableTable& GetVariableTable() const { return m_VariableTable; }
 	private:
 		// PSO
 		Microsoft::WRL::ComPtr<ID3D12PipelineState> m_D3D12PSO;
@@ -55,5 +46,7 @@ namespace RHI
 		RootSignature m_RootSignature;
 		RenderDevice* m_RenderDevice;
 		PipelineStateDesc m_Desc;
+		// Built from m_Desc.VariableConfig, the shader resource layouts find the types of their variables in it
+		ShaderVariableTable m_VariableTable;
 	};
 }
\ No newline at end of file
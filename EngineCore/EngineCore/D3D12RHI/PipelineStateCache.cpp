@@ -0,0 +1,265 @@
+#include "../pch.h"
+#include "PipelineStateCache.h"
+
+namespace RHI
+{
+	template <typename T>
+	static void HashValue(UINT64& hash, const T& value)
+	{
+		hash = ComputeFNV1aHash(&value, sizeof(T), hash);
+	}
+
+	static void HashShader(UINT64& hash, const D3D12_SHADER_BYTECODE& shader)
+	{
+		HashValue(hash, static_cast<UINT64>(shader.BytecodeLength));
+		if (shader.pShaderBytecode != nullptr)
+			hash = ComputeFNV1aHash(shader.pShaderBytecode, shader.BytecodeLength, hash);
+	}
+
+	PipelineStateCache::~PipelineStateCache()
+	{
+		UnmapFile();
+	}
+
+	bool PipelineStateCache::LoadFromFile(const std::wstring& fileName)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		UnmapFile();
+
+		m_File = CreateFileW(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (m_File == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(m_File, &fileSize) || fileSize.QuadPart == 0)
+		{
+			UnmapFile();
+			return false;
+		}
+
+		m_FileMapping = CreateFileMappingW(m_File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (m_FileMapping != nullptr)
+			m_MappedData = MapViewOfFile(m_FileMapping, FILE_MAP_READ, 0, 0, 0);
+
+		if (m_MappedData == nullptr || !m_Archive.Open(m_MappedData, static_cast<size_t>(fileSize.QuadPart)))
+		{
+			LOG_WARNING("The pipeline state cache file is invalid or outdated, it is ignored");
+			UnmapFile();
+			return false;
+		}
+
+		return true;
+	}
+
+	bool PipelineStateCache::SaveToFile(const std::wstring& fileName)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		// The blobs created in this run come first, they replace the blobs rejected by the driver
+		std::vector<PipelineCacheArchive::BlobRef> blobs;
+		blobs.reserve(m_NewBlobs.size() + m_Archive.GetNumEntries());
+		for (const auto& blob : m_NewBlobs)
+			blobs.push_back({ blob.first, blob.second->GetBufferPointer(), blob.second->GetBufferSize() });
+		for (size_t i = 0; i < m_Archive.GetNumEntries(); ++i)
+			blobs.push_back(m_Archive.GetBlob(i));
+
+		// The bytes are copied before the view is closed, the file may be the mapped one
+		std::vector<uint8_t> bytes = PipelineCacheArchive::Build(std::move(blobs));
+		bool reopen = m_Archive.IsOpen();
+		UnmapFile();
+
+		bool saved = false;
+		{
+			std::ofstream file(fileName, std::ios::binary | std::ios::trunc);
+			if (file)
+			{
+				file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+				saved = static_cast<bool>(file);
+			}
+		}
+
+		// The blobs of the previous runs are now in the new file
+		if (saved && reopen)
+		{
+			m_File = CreateFileW(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (m_File != INVALID_HANDLE_VALUE)
+				m_FileMapping = CreateFileMappingW(m_File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (m_FileMapping != nullptr)
+				m_MappedData = MapViewOfFile(m_FileMapping, FILE_MAP_READ, 0, 0, 0);
+			if (m_MappedData == nullptr || !m_Archive.Open(m_MappedData, bytes.size()))
+				UnmapFile();
+			else
+				m_NewBlobs.clear();
+		}
+
+		return saved;
+	}
+
+	UINT64 PipelineStateCache::ComputePipelineHash(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, size_t rootSignatureHash)
+	{
+		// The states are hashed field by field, the padding of the structures is not initialized
+		UINT64 hash = ComputeFNV1aHash(nullptr, 0);
+		HashValue(hash, static_cast<UINT64>(rootSignatureHash));
+
+		HashShader(hash, desc.VS);
+		HashShader(hash, desc.PS);
+		HashShader(hash, desc.DS);
+		HashShader(hash, desc.HS);
+		HashShader(hash, desc.GS);
+
+		const D3D12_BLEND_DESC& blend = desc.BlendState;
+		HashValue(hash, blend.AlphaToCoverageEnable);
+		HashValue(hash, blend.IndependentBlendEnable);
+		for (const D3D12_RENDER_TARGET_BLEND_DESC& target : blend.RenderTarget)
+		{
+			HashValue(hash, target.BlendEnable);
+			HashValue(hash, target.LogicOpEnable);
+			HashValue(hash, target.SrcBlend);
+			HashValue(hash, target.DestBlend);
+			HashValue(hash, target.BlendOp);
+			HashValue(hash, target.SrcBlendAlpha);
+			HashValue(hash, target.DestBlendAlpha);
+			HashValue(hash, target.BlendOpAlpha);
+			HashValue(hash, target.LogicOp);
+			HashValue(hash, target.RenderTargetWriteMask);
+		}
+		HashValue(hash, desc.SampleMask);
+
+		const D3D12_RASTERIZER_DESC& rasterizer = desc.RasterizerState;
+		HashValue(hash, rasterizer.FillMode);
+		HashValue(hash, rasterizer.CullMode);
+		HashValue(hash, rasterizer.FrontCounterClockwise);
+		HashValue(hash, rasterizer.DepthBias);
+		HashValue(hash, rasterizer.DepthBiasClamp);
+		HashValue(hash, rasterizer.SlopeScaledDepthBias);
+		HashValue(hash, rasterizer.DepthClipEnable);
+		HashValue(hash, rasterizer.MultisampleEnable);
+		HashValue(hash, rasterizer.AntialiasedLineEnable);
+		HashValue(hash, rasterizer.ForcedSampleCount);
+		HashValue(hash, rasterizer.ConservativeRaster);
+
+		const D3D12_DEPTH_STENCIL_DESC& depthStencil = desc.DepthStencilState;
+		HashValue(hash, depthStencil.DepthEnable);
+		HashValue(hash, depthStencil.DepthWriteMask);
+		HashValue(hash, depthStencil.DepthFunc);
+		HashValue(hash, depthStencil.StencilEnable);
+		HashValue(hash, depthStencil.StencilReadMask);
+		HashValue(hash, depthStencil.StencilWriteMask);
+		for (const D3D12_DEPTH_STENCILOP_DESC* face : { &depthStencil.FrontFace, &depthStencil.BackFace })
+		{
+			HashValue(hash, face->StencilFailOp);
+			HashValue(hash, face->StencilDepthFailOp);
+			HashValue(hash, face->StencilPassOp);
+			HashValue(hash, face->StencilFunc);
+		}
+
+		// The semantic names are hashed by content, the pointers change from one run to the next
+		HashValue(hash, desc.InputLayout.NumElements);
+		for (UINT i = 0; i < desc.InputLayout.NumElements; ++i)
+		{
+			const D3D12_INPUT_ELEMENT_DESC& element = desc.InputLayout.pInputElementDescs[i];
+			if (element.SemanticName != nullptr)
+				hash = ComputeFNV1aHash(element.SemanticName, strlen(element.SemanticName) + 1, hash);
+			HashValue(hash, element.SemanticIndex);
+			HashValue(hash, element.Format);
+			HashValue(hash, element.InputSlot);
+			HashValue(hash, element.AlignedByteOffset);
+			HashValue(hash, element.InputSlotClass);
+			HashValue(hash, element.InstanceDataStepRate);
+		}
+
+		HashValue(hash, desc.IBStripCutValue);
+		HashValue(hash, desc.PrimitiveTopologyType);
+		HashValue(hash, desc.NumRenderTargets);
+		for (UINT i = 0; i < desc.NumRenderTargets; ++i)
+			HashValue(hash, desc.RTVFormats[i]);
+		HashValue(hash, desc.DSVFormat);
+		HashValue(hash, desc.SampleDesc.Count);
+		HashValue(hash, desc.SampleDesc.Quality);
+		HashValue(hash, desc.NodeMask);
+		HashValue(hash, desc.Flags);
+
+		return hash;
+	}
+
+	Microsoft::WRL::ComPtr<ID3D12PipelineState> PipelineStateCache::CreateGraphicsPipelineState(ID3D12Device* d3d12Device,
+		const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, UINT64 pipelineHash)
+	{
+		auto createStart = std::chrono::steady_clock::now();
+		Microsoft::WRL::ComPtr<ID3D12PipelineState> d3d12PSO;
+
+		// The blob is copied under the lock: SaveToFile unmaps the file, it can not truncate a file that still has a view
+		std::vector<uint8_t> cachedBlobBytes;
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			++m_Stats.NumRequests;
+
+			size_t blobSize = 0;
+			const void* blob = m_Archive.Find(pipelineHash, blobSize);
+			if (blob != nullptr && m_NewBlobs.find(pipelineHash) == m_NewBlobs.end())
+			{
+				const uint8_t* blobBytes = static_cast<const uint8_t*>(blob);
+				cachedBlobBytes.assign(blobBytes, blobBytes + blobSize);
+			}
+		}
+
+		// The driver creates the PSO without the lock, from the cached blob first
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC cachedDesc = desc;
+		if (!cachedBlobBytes.empty())
+		{
+			cachedDesc.CachedPSO.pCachedBlob = cachedBlobBytes.data();
+			cachedDesc.CachedPSO.CachedBlobSizeInBytes = cachedBlobBytes.size();
+
+			// D3D12_ERROR_ADAPTER_NOT_FOUND or D3D12_ERROR_DRIVER_VERSION_MISMATCH, the PSO is compiled again
+			HRESULT hr = d3d12Device->CreateGraphicsPipelineState(&cachedDesc, IID_PPV_ARGS(d3d12PSO.GetAddressOf()));
+			double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - createStart).count();
+
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			if (SUCCEEDED(hr))
+			{
+				++m_Stats.NumHits;
+				m_Stats.HitMilliseconds += milliseconds;
+				return d3d12PSO;
+			}
+
+			++m_Stats.NumRejected;
+		}
+
+		cachedDesc.CachedPSO.pCachedBlob = nullptr;
+		cachedDesc.CachedPSO.CachedBlobSizeInBytes = 0;
+		ThrowIfFailed(d3d12Device->CreateGraphicsPipelineState(&cachedDesc, IID_PPV_ARGS(d3d12PSO.GetAddressOf())));
+
+		Microsoft::WRL::ComPtr<ID3DBlob> cachedBlob;
+		if (FAILED(d3d12PSO->GetCachedBlob(cachedBlob.GetAddressOf())))
+			cachedBlob = nullptr;
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if (cachedBlob)
+			m_NewBlobs.emplace(pipelineHash, std::move(cachedBlob));
+		m_Stats.MissMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - createStart).count();
+
+		return d3d12PSO;
+	}
+
+	PipelineStateCache::Stats PipelineStateCache::GetStats()
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return m_Stats;
+	}
+
+	void PipelineStateCache::UnmapFile()
+	{
+		m_Archive.Close();
+
+		if (m_MappedData != nullptr)
+			UnmapViewOfFile(m_MappedData);
+		if (m_FileMapping != nullptr)
+			CloseHandle(m_FileMapping);
+		if (m_File != INVALID_HANDLE_VALUE)
+			CloseHandle(m_File);
+
+		m_MappedData = nullptr;
+		m_FileMapping = nullptr;
+		m_File = INVALID_HANDLE_VALUE;
+	}
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include "../Common/BlobArchive.h"
+
+/*
+* Persistent cache of the compiled pipeline states. A PSO is keyed by a hash of its D3D12 description (states, formats,
+* input layout, the bytecode of the shaders) and of its root signature. The blob returned by GetCachedBlob() after a full
+* creation is kept, and SaveToFile() writes all the blobs in a BlobArchive file. At the next launch LoadFromFile()
+* maps the file, and the PSOs found in it are created with CachedPSO, which skips the driver compilation.
+* A blob rejected by the driver (other driver version or adapter) is ignored and the PSO is created again from scratch.
+*
+*   desc + root signature --hash--> archive (mapped file) --blob--> CreateGraphicsPipelineState(CachedPSO)
+*                                   new blobs of this run  <--GetCachedBlob()-- full creation
+*/
+namespace RHI
+{
+	using PipelineCacheArchive = BlobArchive<0x43535050, 1>; // "PPSC"
+
+	class PipelineStateCache
+	{
+	public:
+		PipelineStateCache() = default;
+		~PipelineStateCache();
+
+		PipelineStateCache(const PipelineStateCache&) = delete;
+		PipelineStateCache& operator = (const PipelineStateCache&) = delete;
+
+		// Maps the file written by SaveToFile. A file written by another version is ignored
+		bool LoadFromFile(const std::wstring& fileName);
+		// Writes the blobs of the mapped file and the blobs created in this run
+		bool SaveToFile(const std::wstring& fileName);
+
+		static UINT64 ComputePipelineHash(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, size_t rootSignatureHash);
+
+		// Creates the PSO with the cached blob of the hash if there is one, and keeps the blob of a full creation
+		Microsoft::WRL::ComPtr<ID3D12PipelineState> CreateGraphicsPipelineState(ID3D12Device* d3d12Device,
+			const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, UINT64 pipelineHash);
+
+		struct Stats
+		{
+			UINT32 NumRequests = 0;
+			// PSOs created from a cached blob
+			UINT32 NumHits = 0;
+			// Cached blobs rejected by the driver
+			UINT32 NumRejected = 0;
+			double HitMilliseconds = 0.0;
+			double MissMilliseconds = 0.0;
+		};
+		Stats GetStats();
+
+	private:
+		void UnmapFile();
+
+		std::mutex m_Mutex;
+
+		// Blobs of the previous runs
+		HANDLE m_File = INVALID_HANDLE_VALUE;
+		HANDLE m_FileMapping = nullptr;
+		const void* m_MappedData = nullptr;
+		PipelineCacheArchive m_Archive;
+
+		// Blobs of the PSOs created from scratch in this run
+		std::unordered_map<UINT64, Microsoft::WRL::ComPtr<ID3DBlob>> m_NewBlobs;
+
+		Stats m_Stats;
+	};
+}
@@ -0,0 +1,173 @@
+#include "../pch.h"
+#include "PipelineStateCompiler.h"
+
+namespace RHI
+{
+	AsyncPipelineState::AsyncPipelineState(const PipelineStateDesc& desc, PSO_COMPILE_PRIORITY priority, const PipelineState* fallback) :
+		m_Desc{ desc },
+		m_Fallback{ fallback },
+		m_Priority{ priority },
+		m_RequestTime{ std::chrono::steady_clock::now() }
+	{
+	}
+
+	PipelineStateCompiler::PipelineStateCompiler(RenderDevice& renderDevice, UINT32 numThreads) :
+		m_RenderDevice{ renderDevice }
+	{
+		assert(numThreads > 0);
+
+		m_Workers.reserve(numThreads);
+		for (UINT32 i = 0; i < numThreads; ++i)
+			m_Workers.emplace_back(&PipelineStateCompiler::WorkerThread, this);
+	}
+
+	PipelineStateCompiler::~PipelineStateCompiler()
+	{
+		Shutdown();
+	}
+
+	std::shared_ptr<AsyncPipelineState> PipelineStateCompiler::Request(const PipelineStateDesc& desc,
+		PSO_COMPILE_PRIORITY priority, const PipelineState* fallback)
+	{
+		if (fallback == nullptr)
+			fallback = m_DefaultPipelineState.load();
+
+		auto handle = std::make_shared<AsyncPipelineState>(desc, priority, fallback);
+
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			if (m_Shutdown)
+			{
+				handle->m_Status.store(AsyncPipelineState::STATUS_FAILED, std::memory_order_release);
+				return handle;
+			}
+
+			m_Jobs.push(Job{ priority, m_NextSequence++, handle });
+			++m_NumQueued;
+			m_Stats.MaxQueueDepth = std::max(m_Stats.MaxQueueDepth, m_NumQueued);
+		}
+
+		m_JobAvailable.notify_one();
+		return handle;
+	}
+
+	void PipelineStateCompiler::SetPriority(const std::shared_ptr<AsyncPipelineState>& handle, PSO_COMPILE_PRIORITY priority)
+	{
+		if (handle->m_Priority.exchange(priority) >= priority)
+			return;
+
+		// The entry with the old priority stays in the queue, the first one taken by a worker compiles the handle
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if (!m_Shutdown && !handle->m_Taken.load())
+			m_Jobs.push(Job{ priority, m_NextSequence++, handle });
+	}
+
+	void PipelineStateCompiler::WaitForIdle()
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_Idle.wait(lock, [this]() { return m_NumQueued == 0 && m_NumCompiling == 0; });
+	}
+
+	void PipelineStateCompiler::Shutdown()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			if (m_Shutdown)
+				return;
+			m_Shutdown = true;
+		}
+
+		m_JobAvailable.notify_all();
+		for (auto& worker : m_Workers)
+			worker.join();
+		m_Workers.clear();
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		while (!m_Jobs.empty())
+		{
+			AsyncPipelineState& handle = *m_Jobs.top().Handle;
+			if (!handle.m_Taken.exchange(true))
+				handle.m_Status.store(AsyncPipelineState::STATUS_FAILED, std::memory_order_release);
+			m_Jobs.pop();
+		}
+		m_NumQueued = 0;
+		m_Idle.notify_all();
+	}
+
+	PipelineStateCompiler::Stats PipelineStateCompiler::GetStats()
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		Stats stats = m_Stats;
+		stats.QueueDepth = m_NumQueued;
+		return stats;
+	}
+
+	void PipelineStateCompiler::WorkerThread()
+	{
+		for (;;)
+		{
+			std::shared_ptr<AsyncPipelineState> handle;
+			{
+				std::unique_lock<std::mutex> lock(m_Mutex);
+				m_JobAvailable.wait(lock, [this]() { return m_Shutdown || !m_Jobs.empty(); });
+				if (m_Shutdown)
+					return;
+
+				handle = m_Jobs.top().Handle;
+				m_Jobs.pop();
+
+				// Entry left by SetPriority, the handle was taken with its new priority
+				if (handle->m_Taken.exchange(true))
+					continue;
+
+				--m_NumQueued;
+				++m_NumCompiling;
+			}
+
+			Compile(*handle);
+
+			{
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				--m_NumCompiling;
+				if (m_NumQueued == 0 && m_NumCompiling == 0)
+					m_Idle.notify_all();
+			}
+		}
+	}
+
+	void PipelineStateCompiler::Compile(AsyncPipelineState& handle)
+	{
+		auto compileStart = std::chrono::steady_clock::now();
+
+		bool compiled = false;
+		try
+		{
+			handle.m_PipelineState = std::make_unique<PipelineState>(&m_RenderDevice, handle.m_Desc);
+			compiled = true;
+		}
+		catch (const DxException& e)
+		{
+			LOG_ERROR("Failed to compile a pipeline state asynchronously, HRESULT " + std::to_string(e.ErrorCode));
+		}
+
+		auto compileEnd = std::chrono::steady_clock::now();
+
+		// The pipeline state is published by the release store of the status
+		handle.m_Status.store(compiled ? AsyncPipelineState::STATUS_READY : AsyncPipelineState::STATUS_FAILED, std::memory_order_release);
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if (compiled)
+		{
+			double latency = std::chrono::duration<double, std::milli>(compileEnd - handle.m_RequestTime).count();
+			++m_Stats.NumCompiled;
+			m_Stats.TotalLatencyMilliseconds += latency;
+			m_Stats.MaxLatencyMilliseconds = std::max(m_Stats.MaxLatencyMilliseconds, latency);
+			m_Stats.TotalCompileMilliseconds += std::chrono::duration<double, std::milli>(compileEnd - compileStart).count();
+		}
+		else
+		{
+			++m_Stats.NumFailed;
+		}
+	}
+}
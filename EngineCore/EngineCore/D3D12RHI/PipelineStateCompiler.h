@@ -0,0 +1,143 @@
+#pragma once
+#include "PipelineState.h"
+
+/*
+* Compiles the pipeline states on worker threads, so that a new material does not stall the frame that needs it.
+* Request() returns a handle at once, the PipelineState is built by a worker in the order of the priorities
+* (then of the requests). While the handle is pending, GraphicsContext::SetPipelineState binds its fallback pipeline.
+*
+*   Request(desc, priority) -> AsyncPipelineState [PENDING] --worker--> [READY] PipelineState
+*                                                            \--------> [FAILED]
+*
+* The shader bytecode and the input layout pointed to by the desc must stay valid until the handle is no longer pending.
+*/
+namespace RHI
+{
+	class RenderDevice;
+	class PipelineStateCompiler;
+
+	enum PSO_COMPILE_PRIORITY
+	{
+		PSO_COMPILE_PRIORITY_LOW = 0,
+		PSO_COMPILE_PRIORITY_NORMAL,
+		// Materials visible in the current frame
+		PSO_COMPILE_PRIORITY_HIGH
+	};
+
+	class AsyncPipelineState
+	{
+		friend class PipelineStateCompiler;
+	public:
+		enum STATUS
+		{
+			STATUS_PENDING = 0,
+			STATUS_READY,
+			STATUS_FAILED
+		};
+
+		AsyncPipelineState(const PipelineStateDesc& desc, PSO_COMPILE_PRIORITY priority, const PipelineState* fallback);
+
+		STATUS GetStatus() const { return m_Status.load(std::memory_order_acquire); }
+		bool IsReady() const { return GetStatus() == STATUS_READY; }
+		bool IsPending() const { return GetStatus() == STATUS_PENDING; }
+
+		// nullptr until the handle is ready
+		const PipelineState* GetPipelineState() const { return IsReady() ? m_PipelineState.get() : nullptr; }
+		// The compiled pipeline, or the fallback while the handle is pending or if the compilation failed
+		const PipelineState* GetPipelineStateOrFallback() const
+		{
+			const PipelineState* pipelineState = GetPipelineState();
+			return pipelineState != nullptr ? pipelineState : m_Fallback;
+		}
+
+		PSO_COMPILE_PRIORITY GetPriority() const { return m_Priority.load(std::memory_order_relaxed); }
+
+	private:
+		PipelineStateDesc m_Desc;
+		const PipelineState* m_Fallback;
+
+		std::atomic<STATUS> m_Status{ STATUS_PENDING };
+		std::atomic<PSO_COMPILE_PRIORITY> m_Priority;
+		// Set by the worker that takes the job, the queue may hold several entries of the handle after a reprioritization
+		std::atomic<bool> m_Taken{ false };
+		std::unique_ptr<PipelineState> m_PipelineState;
+
+		std::chrono::steady_clock::time_point m_RequestTime;
+	};
+
+	class PipelineStateCompiler
+	{
+	public:
+		PipelineStateCompiler(RenderDevice& renderDevice, UINT32 numThreads);
+		~PipelineStateCompiler();
+
+		PipelineStateCompiler(const PipelineStateCompiler&) = delete;
+		PipelineStateCompiler& operator = (const PipelineStateCompiler&) = delete;
+
+		// fallback is bound while the handle is pending, the default pipeline state if it is nullptr
+		std::shared_ptr<AsyncPipelineState> Request(const PipelineStateDesc& desc,
+			PSO_COMPILE_PRIORITY priority = PSO_COMPILE_PRIORITY_NORMAL, const PipelineState* fallback = nullptr);
+
+		// Moves a pending handle ahead of the lower priorities, e.g. when its material becomes visible
+		void SetPriority(const std::shared_ptr<AsyncPipelineState>& handle, PSO_COMPILE_PRIORITY priority);
+
+		// Fallback of the requests that do not give one. It must share the root signature layout of the materials it replaces
+		void SetDefaultPipelineState(const PipelineState* pipelineState) { m_DefaultPipelineState.store(pipelineState); }
+		const PipelineState* GetDefaultPipelineState() const { return m_DefaultPipelineState.load(); }
+
+		// Blocks until all the requests are compiled, e.g. at the end of a loading screen
+		void WaitForIdle();
+
+		// The workers finish the jobs being compiled, the queued handles are marked as failed
+		void Shutdown();
+
+		struct Stats
+		{
+			UINT32 QueueDepth = 0;
+			UINT32 MaxQueueDepth = 0;
+			UINT32 NumCompiled = 0;
+			UINT32 NumFailed = 0;
+			// From the request to the ready status, includes the time spent in the queue
+			double TotalLatencyMilliseconds = 0.0;
+			double MaxLatencyMilliseconds = 0.0;
+			double TotalCompileMilliseconds = 0.0;
+
+			double GetAverageLatencyMilliseconds() const { return NumCompiled > 0 ? TotalLatencyMilliseconds / NumCompiled : 0.0; }
+		};
+		Stats GetStats();
+
+	private:
+		struct Job
+		{
+			PSO_COMPILE_PRIORITY Priority;
+			UINT64 Sequence;
+			std::shared_ptr<AsyncPipelineState> Handle;
+
+			// Highest priority first, then the oldest request
+			bool operator < (const Job& rhs) const
+			{
+				return Priority != rhs.Priority ? Priority < rhs.Priority : Sequence > rhs.Sequence;
+			}
+		};
+
+		void WorkerThread();
+		void Compile(AsyncPipelineState& handle);
+
+		RenderDevice& m_RenderDevice;
+		std::atomic<const PipelineState*> m_DefaultPipelineState{ nullptr };
+
+		std::mutex m_Mutex;
+		std::condition_variable m_JobAvailable;
+		std::condition_variable m_Idle;
+		std::priority_queue<Job> m_Jobs;
+		UINT64 m_NextSequence = 0;
+		// Handles not taken by a worker yet, the queue may hold more entries than that
+		UINT32 m_NumQueued = 0;
+		UINT32 m_NumCompiling = 0;
+		bool m_Shutdown = false;
+
+		std::vector<std::thread> m_Workers;
+
+		Stats m_Stats;
+	};
+}
@@ -17,13 +17,34 @@ namespace RHI
 		{*this, 16384, 32768, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE},
 		{*this, 128, 1920, D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER, D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE}
 	},
-		m_DynamicResAllocator(1, DYNAMIC_RESOURCE_PAGE_SIZE)
+		m_GpuBufferAllocators
 	{
-
+		{d3d12Device, D3D12_HEAP_TYPE_DEFAULT, 8 * 1024 * 1024, 1024 * 1024},
+		{d3d12Device, D3D12_HEAP_TYPE_UPLOAD, 4 * 1024 * 1024, 512 * 1024}
+	},
+		m_DynamicResAllocator(1, DYNAMIC_RESOURCE_PAGE_SIZE, DYNAMIC_RESOURCE_MAX_RESIDENT_SIZE, DYNAMIC_RESOURCE_PAGE_IDLE_FRAMES),
+		m_RootSignatureCache(*this),
+		// A quarter of the cores, the others record and submit the frames
+		m_PipelineStateCompiler(*this, std::max(1u, std::thread::hardware_concurrency() / 4))
+	{
+		// Registers the UploadManager singleton, CommandContext uploads the initial data of the resources with it
+		m_UploadManager = std::make_unique<UploadManager>(d3d12Device);
 	}
 
 	RenderDevice::~RenderDevice()
 	{
+		// Submits the last uploads and waits for them
+		m_UploadManager.reset();
+
+		// No pipeline state is created once the release queue is drained
+		m_PipelineStateCompiler.Shutdown();
+
+		// The GPU is idle, the stale pages and ranges are given back before the allocators are destroyed
+		{
+			std::vector<StaleResourceWrapper> staleObjects;
+			m_ReleaseQueue.PopAll(staleObjects);
+		}
+
 		m_DynamicResAllocator.Destroy();
 	}
 
@@ -41,27 +62,79 @@ namespace RHI
 		return m_GPUDescriptorHeaps[type].Allocate(Count);
 	}
 
+	void RenderDevice::SetConcurrentDescriptorAllocation(bool enable)
+	{
+		for (auto& heap : m_CPUDescriptorHeaps)
+			heap.SetConcurrentMode(enable);
+	}
+
+	void RenderDevice::FinishFrame()
+	{
+		m_DynamicResAllocator.FinishFrame();
+	}
+
 	void RenderDevice::PurgeReleaseQueue(bool forceRelease)
 	{
-		UINT64 graphicCompletedFenceValue = CommandListManager::GetSingleton().GetGraphicsQueue().GetCompletedFenceValue();
+		// The descriptors released since the last submission are added to the release queue here, one bucket per heap
+		for (auto& heap : m_CPUDescriptorHeaps)
+			heap.ReleasePendingFrees();
+
+		CommandListManager& listManager = CommandListManager::GetSingleton();
+
+		FenceTimelinePoint completedPoint;
+		completedPoint.Values[COMMAND_QUEUE_GRAPHICS] = listManager.GetGraphicsQueue().GetCompletedFenceValue();
+		completedPoint.Values[COMMAND_QUEUE_COMPUTE] = listManager.GetComputeQueue().GetCompletedFenceValue();
+		completedPoint.Values[COMMAND_QUEUE_COPY] = listManager.GetCopyQueue().GetCompletedFenceValue();
 
 		if (forceRelease)
 		{
-			graphicCompletedFenceValue = std::numeric_limits<UINT64>::max();
-			//computeCompletedFenceValue = std::numeric_limits<UINT64>::max();
-			//copyCompletedFenceValue = std::numeric_limits<UINT64>::max();
+			for (auto& value : completedPoint.Values)
+				value = std::numeric_limits<UINT64>::max();
 		}
 
-		while (!m_ReleaseQueue.empty())
+		for (auto& heap : m_GPUDescriptorHeaps)
+			heap.ReleaseCompletedDynamic(completedPoint);
+
+		CommandQueue* queues[COMMAND_QUEUE_COUNT];
+		GetCommandQueues(queues);
+
+		// The objects are destroyed after the lock is released, their destructors may release other objects
+		std::vector<StaleResourceWrapper> completedObjects;
 		{
-			auto& firstObj = m_ReleaseQueue.front();
-			if (std::get<0>(firstObj) <= graphicCompletedFenceValue)
-				m_ReleaseQueue.pop_front();
+			std::lock_guard<std::mutex> lock(m_ReleaseQueueMutex);
+			if (forceRelease)
+			{
+				m_ReleaseQueue.PopAll(completedObjects);
+			}
 			else
-				break;
+			{
+				m_ReleaseQueue.ResolvePending(queues);
+				m_ReleaseQueue.PopCompleted(completedPoint, completedObjects);
+			}
 		}
 	}
 
+	void RenderDevice::GetCommandQueues(CommandQueue* (&queues)[COMMAND_QUEUE_COUNT])
+	{
+		CommandListManager& listManager = CommandListManager::GetSingleton();
+
+		queues[COMMAND_QUEUE_GRAPHICS] = &listManager.GetGraphicsQueue();
+		queues[COMMAND_QUEUE_COMPUTE] = &listManager.GetComputeQueue();
+		queues[COMMAND_QUEUE_COPY] = &listManager.GetCopyQueue();
+	}
+
+	CPUDescriptorHeap& RenderDevice::GetCPUDescriptorHeap(D3D12_DESCRIPTOR_HEAP_TYPE Type)
+	{
+		assert(Type >= D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV && Type < D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES);
+		return m_CPUDescriptorHeaps[Type];
+	}
+
+	GpuBufferAllocator& RenderDevice::GetGpuBufferAllocator(D3D12_HEAP_TYPE heapType)
+	{
+		assert(heapType == D3D12_HEAP_TYPE_DEFAULT || heapType == D3D12_HEAP_TYPE_UPLOAD);
+		return m_GpuBufferAllocators[heapType == D3D12_HEAP_TYPE_DEFAULT ? 0 : 1];
+	}
+
 	GPUDescriptorHeap& RenderDevice::GetGPUDescriptorHeap(D3D12_DESCRIPTOR_HEAP_TYPE Type)
 	{
 		assert(Type == D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV || Type == D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER);
@@ -3,10 +3,17 @@
 #include "CommandQueue.h"
 #include "CommandListManager.h"
 #include "DynamicResource.h"
+#include "GpuBufferAllocator.h"
+#include "FenceTimeline.h"
+#include "RootSignatureCache.h"
+#include "PipelineStateCache.h"
+#include "PipelineStateCompiler.h"
+#include "UploadManager.h"
 #include "../Common/StaleResourceWrapper.h"
 
 namespace RHI
 {
+	// The CommandListManager (the queues) is created before the RenderDevice and destroyed after it
 	class RenderDevice : public Singleton<RenderDevice>
 	{
 	public:
@@ -18,18 +25,35 @@ namespace RHI
 		// When binding resources to Shader, assign Descriptor in GPU Descriptor Heap
 		DescriptorHeapAllocation AllocateGPUDescriptors(D3D12_DESCRIPTOR_HEAP_TYPE type, UINT Count = 1);
 
-		// Safely release the GPU object. It will only be released when the GPU is no longer in use. The object passed in must be moved
+		// Let loader threads allocate and release CPU descriptors (resource views) in parallel, see CPUDescriptorHeap
+		void SetConcurrentDescriptorAllocation(bool enable);
+
+		// Safely release the GPU object. It will only be released when the GPU is no longer in use. The object passed in must be moved.
+		// queueMask is the set of queues that may use the object (COMMAND_QUEUE_MASK)
 		template <typename DeviceObjectType>
-		void SafeReleaseDeviceObject(DeviceObjectType&& object);
+		void SafeReleaseDeviceObject(DeviceObjectType&& object, UINT32 queueMask = COMMAND_QUEUE_MASK_ALL);
 
 		void PurgeReleaseQueue(bool forceRelease);
 
+		// Idle dynamic upload pages are trimmed. The dynamic GPU descriptors are not tied to the frame,
+		// they are retired when their command list is submitted and reclaimed in PurgeReleaseQueue
+		void FinishFrame();
+
 		// Gettes
 		ID3D12Device* GetD3D12Device() { return m_D3D12Device.Get(); }
+		CPUDescriptorHeap& GetCPUDescriptorHeap(D3D12_DESCRIPTOR_HEAP_TYPE Type);
 		GPUDescriptorHeap& GetGPUDescriptorHeap(D3D12_DESCRIPTOR_HEAP_TYPE Type);
 		DynamicResourceAllocator& GetDynamicResourceAllocator() { return m_DynamicResAllocator; }
+		// Only Default and Upload buffers are sub-allocated
+		GpuBufferAllocator& GetGpuBufferAllocator(D3D12_HEAP_TYPE heapType);
+		RootSignatureCache& GetRootSignatureCache() { return m_RootSignatureCache; }
+		PipelineStateCache& GetPipelineStateCache() { return m_PipelineStateCache; }
+		PipelineStateCompiler& GetPipelineStateCompiler() { return m_PipelineStateCompiler; }
 
 	private:
+		// Queues indexed by COMMAND_QUEUE_INDEX, for the release queue
+		static void GetCommandQueues(CommandQueue* (&queues)[COMMAND_QUEUE_COUNT]);
+
 		Microsoft::WRL::ComPtr<ID3D12Device> m_D3D12Device;
 
 		DynamicResourceAllocator m_DynamicResAllocator;
@@ -45,21 +69,42 @@ namespace RHI
 		// and will be copied to the GPUDescriptorHeap before the drawing command is executed
 		GPUDescriptorHeap m_GPUDescriptorHeaps[2];
 
+		// Shared buffers for small Default and Upload buffers, declared before the release queue
+		// because the stale buffer ranges in the queue are returned to them
+		GpuBufferAllocator m_GpuBufferAllocators[2];
+
+		// Root signatures shared by the pipeline states
+		RootSignatureCache m_RootSignatureCache;
+
+		// Compiled pipeline states of the previous runs
+		PipelineStateCache m_PipelineStateCache;
+
 		// Queue responsible for releasing resource
-		// When calling SafeReleaseDeviceObject to release a respirce, the resource will be added to m_StaleResources
-		// When a CommandList is submitted, the number of the next CommandList and the resources in m_StaleResources will be added to m_ReleaseQueue,
+		// When calling SafeReleaseDeviceObject to release a respirce, the resource is added to m_ReleaseQueue, it waits for the
+		// command lists being recorded on the queues that may use it, then for their fence values (see DeferredReleaseQueue).
 		// At the end of each frame, call PurgeReleaseQueue to release resources that can be 
-		// safely released (that is, all resources with a recorded Cmd number smaller than the number of CmdList completed by the GPU)
-		using ReleaseQueueElementType = std::tuple<UINT64/*Graphic Queue Fence*/, StaleResourceWrapper>;
-		std::deque<ReleaseQueueElementType> m_ReleaseQueue;
+		// safely released (that is, all resources whose fence values have been reached by the GPU on all their queues)
+		DeferredReleaseQueue<StaleResourceWrapper> m_ReleaseQueue;
+		// Objects can be released by the threads recording command lists
+		std::mutex m_ReleaseQueueMutex;
+
+		// Declared last, its workers create pipeline states with the other members
+		PipelineStateCompiler m_PipelineStateCompiler;
+
+		// Created with the device, destroyed first: its last batch is submitted while the queues and the allocators still exist
+		std::unique_ptr<UploadManager> m_UploadManager;
 	};
 
 	template<typename DeviceObjectType>
-	inline void RenderDevice::SafeReleaseDeviceObject(DeviceObjectType&& object)
+	inline void RenderDevice::SafeReleaseDeviceObject(DeviceObjectType&& object, UINT32 queueMask)
 	{
-		auto wrapper = StaleResourceWrapper::Create(object);
+		auto wrapper = StaleResourceWrapper::Create(std::forward<DeviceObjectType>(object));
+
+		CommandQueue* queues[COMMAND_QUEUE_COUNT];
+		GetCommandQueues(queues);
 
-		uint64_t graphicNextFenceValue = CommandListManager::GetSingleton().GetGraphicsQueue().GetNextFenceValue();
-		m_ReleaseQueue.emplace_back(graphicNextFenceValue, std::move(wrapper));
+		// The fence values are read under the lock, so that the points are pushed in the order of the timeline
+		std::lock_guard<std::mutex> lock(m_ReleaseQueueMutex);
+		m_ReleaseQueue.Release(queueMask, queues, std::move(wrapper));
 	}
 }
\ No newline at end of file
@@ -0,0 +1,168 @@
+#include "../pch.h"
+#include "ResourceStateTracker.h"
+
+namespace RHI
+{
+	void ResourceStateTracker::TransitionResource(const TrackedResource& resource, D3D12_RESOURCE_STATES stateAfter, UINT subresource,
+		std::vector<D3D12_RESOURCE_BARRIER>& barriers)
+	{
+		assert(resource.GlobalState != nullptr);
+
+		auto localIt = m_LocalStates.find(resource.GlobalState.get());
+		if (localIt == m_LocalStates.end())
+		{
+			localIt = m_LocalStates.emplace(resource.GlobalState.get(), LocalState{}).first;
+			localIt->second.Resource = resource;
+		}
+
+		LocalState& local = localIt->second;
+		if (local.AllKnown)
+		{
+			AppendTransitions(resource, local.States, stateAfter, subresource, barriers);
+			local.States.SetState(stateAfter, subresource);
+			return;
+		}
+
+		if (subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES)
+		{
+			if (local.KnownSubresources.empty())
+			{
+				m_PendingTransitions.push_back({ resource, D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, stateAfter });
+			}
+			else
+			{
+				// The known subresources are transitioned here, the others are used for the first time
+				for (UINT i = 0; i < resource.NumSubresources; ++i)
+				{
+					auto knownIt = local.KnownSubresources.find(i);
+					if (knownIt == local.KnownSubresources.end())
+						m_PendingTransitions.push_back({ resource, i, stateAfter });
+					else if (knownIt->second != stateAfter)
+						barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(resource.Resource, knownIt->second, stateAfter, i));
+				}
+			}
+
+			local.AllKnown = true;
+			local.States.SetState(stateAfter);
+			local.KnownSubresources.clear();
+			return;
+		}
+
+		auto knownIt = local.KnownSubresources.find(subresource);
+		if (knownIt == local.KnownSubresources.end())
+		{
+			m_PendingTransitions.push_back({ resource, subresource, stateAfter });
+			local.KnownSubresources.emplace(subresource, stateAfter);
+		}
+		else
+		{
+			if (knownIt->second != stateAfter)
+				barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(resource.Resource, knownIt->second, stateAfter, subresource));
+			knownIt->second = stateAfter;
+		}
+
+		// Every subresource has been used
+		if (local.KnownSubresources.size() == resource.NumSubresources)
+		{
+			for (const auto& known : local.KnownSubresources)
+				local.States.SetState(known.second, known.first);
+			local.AllKnown = true;
+			local.KnownSubresources.clear();
+		}
+	}
+
+	bool ResourceStateTracker::GetLocalState(const TrackedResource& resource, UINT subresource, D3D12_RESOURCE_STATES& state) const
+	{
+		const SubresourceStates* knownStates = nullptr;
+
+		auto localIt = m_LocalStates.find(resource.GlobalState.get());
+		if (localIt == m_LocalStates.end())
+		{
+			return false;
+		}
+		else if (localIt->second.AllKnown)
+		{
+			knownStates = &localIt->second.States;
+		}
+		else if (subresource != D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES)
+		{
+			auto knownIt = localIt->second.KnownSubresources.find(subresource);
+			if (knownIt != localIt->second.KnownSubresources.end())
+			{
+				state = knownIt->second;
+				return true;
+			}
+		}
+
+		if (knownStates == nullptr)
+			return false;
+		if (subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES && !knownStates->IsUniform())
+			return false;
+
+		state = knownStates->GetState(subresource);
+		return true;
+	}
+
+	void ResourceStateTracker::ResolvePendingBarriers(std::vector<D3D12_RESOURCE_BARRIER>& barriers) const
+	{
+		// A subresource has at most one pending transition, the order does not matter
+		for (const auto& pending : m_PendingTransitions)
+			AppendTransitions(pending.Resource, *pending.Resource.GlobalState, pending.StateAfter, pending.Subresource, barriers);
+	}
+
+	void ResourceStateTracker::CommitFinalStates()
+	{
+		for (const auto& localState : m_LocalStates)
+		{
+			const LocalState& local = localState.second;
+			if (local.AllKnown)
+			{
+				*local.Resource.GlobalState = local.States;
+			}
+			else
+			{
+				for (const auto& known : local.KnownSubresources)
+					local.Resource.GlobalState->SetState(known.second, known.first);
+			}
+		}
+	}
+
+	void ResourceStateTracker::Reset()
+	{
+		m_LocalStates.clear();
+		m_PendingTransitions.clear();
+	}
+
+	std::mutex& ResourceStateTracker::GetGlobalStateMutex()
+	{
+		static std::mutex globalStateMutex;
+		return globalStateMutex;
+	}
+
+	void ResourceStateTracker::AppendTransitions(const TrackedResource& resource, const SubresourceStates& states,
+		D3D12_RESOURCE_STATES stateAfter, UINT subresource, std::vector<D3D12_RESOURCE_BARRIER>& barriers)
+	{
+		if (subresource != D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES)
+		{
+			D3D12_RESOURCE_STATES stateBefore = states.GetState(subresource);
+			if (stateBefore != stateAfter)
+				barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(resource.Resource, stateBefore, stateAfter, subresource));
+		}
+		else if (states.IsUniform())
+		{
+			D3D12_RESOURCE_STATES stateBefore = states.GetState();
+			if (stateBefore != stateAfter)
+				barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(resource.Resource, stateBefore, stateAfter));
+		}
+		else
+		{
+			// One barrier per subresource that is not in the new state
+			for (UINT i = 0; i < resource.NumSubresources; ++i)
+			{
+				D3D12_RESOURCE_STATES stateBefore = states.GetState(i);
+				if (stateBefore != stateAfter)
+					barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(resource.Resource, stateBefore, stateAfter, i));
+			}
+		}
+	}
+}
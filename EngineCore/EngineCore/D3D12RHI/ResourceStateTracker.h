@@ -0,0 +1,121 @@
+#pragma once
+
+/*
+* Resource states are tracked per subresource (mip level / array slice / plane), and per command list:
+* a command list being recorded does not know the global state of a resource, because the command lists recorded before it
+* may not be submitted yet (parallel recording). Instead it remembers the state each subresource must be in at its first use
+* (pending transitions), and the state it leaves it in (final states).
+* When the command list is submitted, the global states are known: the pending transitions are resolved against them
+* and executed in a small command list just before, then the final states become the global states.
+*
+*   Global:       Tex mip0 = SRV, mip1 = SRV
+*   Command list: mip1 -> RTV (pending, no barrier recorded)   mip1 RTV -> SRV (barrier recorded)   mip0 -> COPY_SOURCE (pending)
+*   Submission:   fix-up barriers { mip1 SRV -> RTV, mip0 SRV -> COPY_SOURCE }, then Global: mip0 = COPY_SOURCE, mip1 = SRV
+*
+* Resolution only reads and writes the SubresourceStates of the resources, it does not need a device.
+*/
+namespace RHI
+{
+	// State of every subresource of a resource. All subresources are in m_State, except those that have their own state
+	class SubresourceStates
+	{
+	public:
+		SubresourceStates(D3D12_RESOURCE_STATES state = D3D12_RESOURCE_STATE_COMMON) :
+			m_State{ state }
+		{
+		}
+
+		// D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES sets the state of all subresources
+		void SetState(D3D12_RESOURCE_STATES state, UINT subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES)
+		{
+			if (subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES)
+			{
+				m_State = state;
+				m_Subresources.clear();
+			}
+			else if (state == m_State)
+				m_Subresources.erase(subresource);
+			else
+				m_Subresources[subresource] = state;
+		}
+
+		// The state of all subresources can only be queried if they are in the same state
+		D3D12_RESOURCE_STATES GetState(UINT subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES) const
+		{
+			if (subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES)
+			{
+				assert(IsUniform());
+				return m_State;
+			}
+
+			auto subresourceIt = m_Subresources.find(subresource);
+			return subresourceIt != m_Subresources.end() ? subresourceIt->second : m_State;
+		}
+
+		bool IsUniform() const { return m_Subresources.empty(); }
+
+	private:
+		D3D12_RESOURCE_STATES m_State;
+		std::map<UINT, D3D12_RESOURCE_STATES> m_Subresources;
+	};
+
+	class ResourceStateTracker
+	{
+	public:
+		// A resource as seen by the tracker, GlobalState identifies the resource. The tracker shares the global state with the
+		// resource: a resource destroyed before the command list is submitted leaves its state to the tracker until Reset()
+		struct TrackedResource
+		{
+			ID3D12Resource* Resource = nullptr;
+			std::shared_ptr<SubresourceStates> GlobalState;
+			UINT NumSubresources = 1;
+		};
+
+		// Records the transition in the command list. The barriers of the subresources whose state is known in this command list
+		// are appended to 'barriers', the first use of a subresource is only remembered and resolved at submission
+		void TransitionResource(const TrackedResource& resource, D3D12_RESOURCE_STATES stateAfter, UINT subresource,
+			std::vector<D3D12_RESOURCE_BARRIER>& barriers);
+
+		// State of the subresource in the command list, false if it is not known yet.
+		// The state of D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES is only known if all the subresources are in the same known state
+		bool GetLocalState(const TrackedResource& resource, UINT subresource, D3D12_RESOURCE_STATES& state) const;
+
+		// The 2 functions below must be called with the global state mutex locked, in the order of submission.
+		// Appends the barriers that bring the global states to the states needed by the first uses of this command list
+		void ResolvePendingBarriers(std::vector<D3D12_RESOURCE_BARRIER>& barriers) const;
+		// The states left by this command list become the global states
+		void CommitFinalStates();
+
+		void Reset();
+
+		bool HasPendingTransitions() const { return !m_PendingTransitions.empty(); }
+
+		// Guards the global states of all resources
+		static std::mutex& GetGlobalStateMutex();
+
+	private:
+		struct LocalState
+		{
+			TrackedResource Resource;
+			// All the subresources are known, their state is in States
+			bool AllKnown = false;
+			SubresourceStates States;
+			// Known subresources when AllKnown is false
+			std::map<UINT, D3D12_RESOURCE_STATES> KnownSubresources;
+		};
+
+		struct PendingTransition
+		{
+			TrackedResource Resource;
+			UINT Subresource;
+			D3D12_RESOURCE_STATES StateAfter;
+		};
+
+		// Barriers of the subresources (all of them for D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES) that are not in stateAfter
+		static void AppendTransitions(const TrackedResource& resource, const SubresourceStates& states,
+			D3D12_RESOURCE_STATES stateAfter, UINT subresource, std::vector<D3D12_RESOURCE_BARRIER>& barriers);
+
+		std::unordered_map<const SubresourceStates*, LocalState> m_LocalStates;
+		std::vector<PendingTransition> m_PendingTransitions;
+	};
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+/* https://n9.cl/35kho  DiligentCore RingBuffer.hpp
+* http://diligentgraphics.com/diligent-engine/architecture/d3d12/managing-descriptor-heaps/
+* Linear allocator over a fixed range, used for data that only lives for one frame.
+* Allocations are taken at the tail, memory is reclaimed at the head: when a frame is finished, the tail position is recorded
+* with the fence value signaled after the frame, and once the GPU has reached that fence everything up to the recorded tail is released at once.
+* An allocation never wraps around, if it does not fit at the end of the range the remaining tail space is skipped.
+*
+*         Head                     Tail
+*          |                        |
+*  [       | frame 0 | frame 1 | cur |                 ]     m_Tail >= m_Head
+*
+*               Tail               Head
+*                |                  |
+*  [ frame 2 |cur|                  | frame 0 | frame 1 ]    m_Tail < m_Head
+*
+*  m_FrameTails = { {fence 0, end of frame 0}, {fence 1, end of frame 1}, ... }
+*/
+namespace RHI
+{
+    class RingAllocationsManager
+    {
+    public:
+        static constexpr size_t InvalidOffset = static_cast<size_t>(-1);
+
+        RingAllocationsManager(size_t maxSize) :
+            m_MaxSize(maxSize)
+        {
+        }
+
+        ~RingAllocationsManager()
+        {
+
+        }
+
+        RingAllocationsManager(RingAllocationsManager&& rhs) noexcept :
+            m_FrameTails{ std::move(rhs.m_FrameTails) },
+            m_Head{ rhs.m_Head },
+            m_Tail{ rhs.m_Tail },
+            m_MaxSize{ rhs.m_MaxSize },
+            m_UsedSize{ rhs.m_UsedSize },
+            m_CurrFrameSize{ rhs.m_CurrFrameSize },
+            m_PeakUsedSize{ rhs.m_PeakUsedSize }
+        {
+            rhs.m_Head = 0;
+            rhs.m_Tail = 0;
+            rhs.m_MaxSize = 0;
+            rhs.m_UsedSize = 0;
+            rhs.m_CurrFrameSize = 0;
+            rhs.m_PeakUsedSize = 0;
+        }
+
+        RingAllocationsManager& operator = (RingAllocationsManager&& rhs) = delete;
+        RingAllocationsManager(const RingAllocationsManager&) = delete;
+        RingAllocationsManager& operator = (const RingAllocationsManager&) = delete;
+
+        // Returns the offset of the allocation or InvalidOffset if there is not enough contiguous space
+        size_t Allocate(size_t size)
+        {
+            assert(size > 0);
+
+            if (IsFull())
+                return InvalidOffset;
+
+            size_t offset = InvalidOffset;
+            size_t addSize = size;
+            if (m_Tail >= m_Head)
+            {
+                //                     Head             Tail     MaxSize
+                //                     |                |        |
+                //  [                  xxxxxxxxxxxxxxxxx         ]
+                if (m_Tail + size <= m_MaxSize)
+                {
+                    offset = m_Tail;
+                }
+                else if (size <= m_Head)
+                {
+                    // Does not fit at the end, skip the tail space and allocate from the beginning
+                    addSize = (m_MaxSize - m_Tail) + size;
+                    offset = 0;
+                }
+            }
+            else if (m_Tail + size <= m_Head)
+            {
+                //       Tail          Head
+                //       |             |
+                //  [xxxx              xxxxxxxxxxxxxxxxxxxxxxxxxx]
+                offset = m_Tail;
+            }
+
+            if (offset == InvalidOffset)
+                return InvalidOffset;
+
+            m_Tail = offset + size;
+            m_UsedSize += addSize;
+            m_CurrFrameSize += addSize;
+            m_PeakUsedSize = std::max(m_PeakUsedSize, m_UsedSize);
+
+            return offset;
+        }
+
+        // Everything allocated since the previous call is released when the GPU reaches fenceValue
+        void FinishCurrentFrame(UINT64 fenceValue)
+        {
+            if (m_CurrFrameSize == 0)
+                return;
+
+            m_FrameTails.push_back({ fenceValue, m_Tail, m_CurrFrameSize });
+            m_CurrFrameSize = 0;
+        }
+
+        void ReleaseCompletedFrames(UINT64 completedFenceValue)
+        {
+            while (!m_FrameTails.empty() && m_FrameTails.front().FenceValue <= completedFenceValue)
+            {
+                const auto& oldestFrame = m_FrameTails.front();
+                assert(oldestFrame.Size <= m_UsedSize);
+                m_UsedSize -= oldestFrame.Size;
+                m_Head = oldestFrame.Tail;
+                m_FrameTails.pop_front();
+            }
+
+            // Start again from the beginning, so that the next allocations do not need to skip the end of the range
+            if (IsEmpty())
+            {
+                m_Head = 0;
+                m_Tail = 0;
+            }
+        }
+
+        bool IsFull() const { return m_UsedSize == m_MaxSize; }
+        bool IsEmpty() const { return m_UsedSize == 0; }
+        size_t GetMaxSize() const { return m_MaxSize; }
+        size_t GetUsedSize() const { return m_UsedSize; }
+        size_t GetPeakUsedSize() const { return m_PeakUsedSize; }
+
+    private:
+        struct FrameTailAttribs
+        {
+            UINT64 FenceValue;
+            // Tail position at the end of the frame
+            size_t Tail;
+            // Size allocated during the frame, including skipped space
+            size_t Size;
+        };
+
+        std::deque<FrameTailAttribs> m_FrameTails;
+
+        size_t m_Head = 0;
+        size_t m_Tail = 0;
+        size_t m_MaxSize = 0;
+        size_t m_UsedSize = 0;
+        size_t m_CurrFrameSize = 0;
+        size_t m_PeakUsedSize = 0;
+    };
+}
@@ -70,6 +70,18 @@ namespace RHI
 		return hash;
 	}
 
+	std::vector<UINT32> RootSignature::RootParamsManager::GetKey() const
+	{
+		std::vector<UINT32> key{ static_cast<UINT32>(m_RootTables.size()), static_cast<UINT32>(m_RootDescriptors.size()) };
+		for (const auto& rootView : m_RootDescriptors)
+			rootView.AppendKey(key);
+
+		for (const auto& rootTable : m_RootTables)
+			rootTable.AppendKey(key);
+
+		return key;
+	}
+
 	// ------------------- Root Signature -------------------------------
 	RootSignature::RootSignature(RenderDevice* renderDevice)
 		:m_RenderDevice(renderDevice)
@@ -79,6 +91,8 @@ namespace RHI
 
 	void RootSignature::Finalize(ID3D12Device* pd3d12Device)
 	{
+		assert(m_pd3d12RootSignature == nullptr && "The root signature is already finalized");
+
 		// Root Table
 		for (UINT32 i = 0; i < m_RootParams.GetRootTableNum(); ++i)
 		{
@@ -99,6 +113,11 @@ namespace RHI
 			++m_NumRootDescriptor[RootView.GetShaderVariableType()];
 		}
 
+		m_pd3d12RootSignature = m_RenderDevice->GetRootSignatureCache().Acquire(*this, pd3d12Device);
+	}
+
+	Microsoft::WRL::ComPtr<ID3DBlob> RootSignature::Serialize() const
+	{
 		// Root Signature Desc
 		D3D12_ROOT_SIGNATURE_DESC rootSignatureDesc;
 		rootSignatureDesc.Flags = D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT;
@@ -141,13 +160,14 @@ namespace RHI
 		}
 		ThrowIfFailed(hr);
 
-		ThrowIfFailed(pd3d12Device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(), IID_PPV_ARGS(m_pd3d12RootSignature.GetAddressOf())));
+		return signature;
 	}
 
 	RootSignature::~RootSignature()
 	{
+		// The cache releases the D3D12 root signature when no other RootSignature uses it
 		if (m_pd3d12RootSignature)
-			m_RenderDevice->SafeReleaseDeviceObject(std::move(m_pd3d12RootSignature));
+			m_RenderDevice->GetRootSignatureCache().Release(*this);
 	}
 
 	std::array<const CD3DX12_STATIC_SAMPLER_DESC, 7> RootSignature::GetStaticSamplers()
@@ -243,6 +243,47 @@ namespace RHI
             return hash;
         }
 
+        // The fields compared by operator==, the key is the same from one run to the next (see RootSignatureCache)
+        void AppendKey(std::vector<UINT32>& key) const
+        {
+            key.insert(key.end(), { static_cast<UINT32>(m_ShaderVarType), m_DescriptorTableSize, m_RootIndex,
+                static_cast<UINT32>(m_RootParam.ParameterType), static_cast<UINT32>(m_RootParam.ShaderVisibility) });
+
+            switch (m_RootParam.ParameterType)
+            {
+            case D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE:
+            {
+                const auto& tbl = m_RootParam.DescriptorTable;
+                key.push_back(tbl.NumDescriptorRanges);
+                for (UINT r = 0; r < tbl.NumDescriptorRanges; ++r)
+                {
+                    const auto& rng = tbl.pDescriptorRanges[r];
+                    key.insert(key.end(), { static_cast<UINT32>(rng.RangeType), rng.NumDescriptors, rng.BaseShaderRegister, rng.RegisterSpace,
+                        rng.OffsetInDescriptorsFromTableStart });
+                }
+            }
+            break;
+
+            case D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS:
+            {
+                const auto& cnst = m_RootParam.Constants;
+                key.insert(key.end(), { cnst.ShaderRegister, cnst.RegisterSpace, cnst.Num32BitValues });
+            }
+            break;
+
+            case D3D12_ROOT_PARAMETER_TYPE_CBV:
+            case D3D12_ROOT_PARAMETER_TYPE_SRV:
+            case D3D12_ROOT_PARAMETER_TYPE_UAV:
+            {
+                const auto& dscr = m_RootParam.Descriptor;
+                key.insert(key.end(), { dscr.ShaderRegister, dscr.RegisterSpace });
+            }
+            break;
+
+            default: LOG_ERROR("Unexpected root parameter type");
+            }
+        }
+
 	private:
 		SHADER_RESOURCE_VARIABLE_TYPE m_ShaderVarType = static_cast<SHADER_RESOURCE_VARIABLE_TYPE>(-1);
 		D3D12_ROOT_PARAMETER m_RootParam = {};
@@ -254,15 +295,19 @@ namespace RHI
 	};
 
 	// A roor Signature define the data that the shader in current PSO
+	// The D3D12 root signature is shared by all the RootSignature objects with the same parameters, see RootSignatureCache
 	class RootSignature
 	{
+		friend class RootSignatureCache;
 	public:
 		RootSignature(RenderDevice* renderDevice);
 		~RootSignature();
 
 		ID3D12RootSignature* GetD3D12RootSignature() const { return m_pd3d12RootSignature.Get(); }
+		// Same value in every run, used in the keys of the pipeline state cache
+		size_t GetHash() const { return m_RootParams.GetHash(); }
 
-        // Complete the construction of Root Signature and create Root Signature of Direct3D 12
+        // Complete the construction of Root Signature and get the Root Signature of Direct3D 12 from the cache of the device
         void Finalize(ID3D12Device* pd3d12Device);
 
         // Allocated for each ShaderResource in the Shader
@@ -293,7 +338,10 @@ namespace RHI
 		}
 		
     private:
-        std::array<const CD3DX12_STATIC_SAMPLER_DESC, 7> GetStaticSamplers();
+        // D3D12SerializeRootSignature of the parameters, only called by the cache when no root signature matches
+        Microsoft::WRL::ComPtr<ID3DBlob> Serialize() const;
+
+        static std::array<const CD3DX12_STATIC_SAMPLER_DESC, 7> GetStaticSamplers();
 
     private:
         // Class to help manage RootParam
@@ -350,6 +398,8 @@ namespace RHI
 
             bool   operator==(const RootParamsManager& RootParams) const;
             size_t GetHash() const;
+            // Two parameter sets are equal if their keys are equal, unlike the hash
+            std::vector<UINT32> GetKey() const;
         private:
             std::vector<RootParameter> m_RootTables;
             std::vector<RootParameter> m_RootDescriptors;
@@ -0,0 +1,208 @@
+#include "../pch.h"
+#include "RootSignatureCache.h"
+#include "RenderDevice.h"
+
+namespace RHI
+{
+	// Header of the blob file, the version changes with the static samplers and the flags of RootSignature::Serialize
+	static constexpr UINT32 BlobFileMagic = 0x43535452; // "RTSC"
+	static constexpr UINT32 BlobFileVersion = 2;
+
+	RootSignatureCache::RootSignatureCache(RenderDevice& renderDevice) :
+		m_RenderDevice{ renderDevice }
+	{
+	}
+
+	RootSignatureCache::~RootSignatureCache()
+	{
+		for (const auto& entry : m_Entries)
+		{
+			if (entry.second.RefCount != 0)
+				LOG_WARNING("Root signatures are still referenced when the cache is destroyed");
+		}
+	}
+
+	Microsoft::WRL::ComPtr<ID3D12RootSignature> RootSignatureCache::Acquire(const RootSignature& signature, ID3D12Device* d3d12Device)
+	{
+		const auto& params = signature.m_RootParams;
+		size_t hash = params.GetHash();
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		++m_Stats.NumRequests;
+
+		auto range = m_Entries.equal_range(hash);
+		for (auto it = range.first; it != range.second; ++it)
+		{
+			if (it->second.Params == params)
+			{
+				++it->second.RefCount;
+				++m_Stats.NumHits;
+				return it->second.D3D12RootSignature;
+			}
+		}
+
+		Microsoft::WRL::ComPtr<ID3D12RootSignature> d3d12RootSignature;
+
+		// The blob of a previous run only needs to be created if it was made for the same parameters
+		std::vector<UINT32> paramsKey = params.GetKey();
+		auto blobIt = m_Blobs.find(hash);
+		bool isBlobMatching = blobIt != m_Blobs.end() && blobIt->second.ParamsKey == paramsKey;
+		if (blobIt != m_Blobs.end() && !isBlobMatching)
+			++m_Stats.NumBlobMismatches;
+
+		if (isBlobMatching)
+		{
+			const auto& blobData = blobIt->second.Data;
+			ThrowIfFailed(d3d12Device->CreateRootSignature(0, blobData.data(), blobData.size(), IID_PPV_ARGS(d3d12RootSignature.GetAddressOf())));
+			++m_Stats.NumBlobHits;
+		}
+		else
+		{
+			auto serializeStart = std::chrono::steady_clock::now();
+			Microsoft::WRL::ComPtr<ID3DBlob> blob = signature.Serialize();
+			m_Stats.SerializationMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - serializeStart).count();
+			++m_Stats.NumSerializations;
+
+			ThrowIfFailed(d3d12Device->CreateRootSignature(0, blob->GetBufferPointer(), blob->GetBufferSize(), IID_PPV_ARGS(d3d12RootSignature.GetAddressOf())));
+
+			// One parameter set per hash is saved: the first one of this run, it replaces a blob of the file made for other parameters
+			if (range.first == range.second)
+			{
+				const UINT8* blobData = static_cast<const UINT8*>(blob->GetBufferPointer());
+				Blob& savedBlob = m_Blobs[hash];
+				savedBlob.ParamsKey = std::move(paramsKey);
+				savedBlob.Data.assign(blobData, blobData + blob->GetBufferSize());
+			}
+		}
+
+		wchar_t name[48];
+		swprintf(name, 48, L"Cached RootSignature %zu", m_Entries.size());
+		d3d12RootSignature->SetName(name);
+
+		auto entryIt = m_Entries.emplace(hash, Entry{ params, d3d12RootSignature, 1 });
+		++m_Stats.NumRootSignatures;
+
+		return entryIt->second.D3D12RootSignature;
+	}
+
+	void RootSignatureCache::Release(const RootSignature& signature)
+	{
+		const auto& params = signature.m_RootParams;
+		size_t hash = params.GetHash();
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		auto range = m_Entries.equal_range(hash);
+		for (auto it = range.first; it != range.second; ++it)
+		{
+			if (!(it->second.Params == params))
+				continue;
+
+			assert(it->second.RefCount > 0);
+			if (--it->second.RefCount == 0)
+			{
+				m_RenderDevice.SafeReleaseDeviceObject(std::move(it->second.D3D12RootSignature), COMMAND_QUEUE_MASK_GRAPHICS | COMMAND_QUEUE_MASK_COMPUTE);
+				m_Entries.erase(it);
+				--m_Stats.NumRootSignatures;
+			}
+			return;
+		}
+
+		assert(false && "The root signature was not acquired from the cache");
+	}
+
+	bool RootSignatureCache::LoadFromFile(const std::wstring& fileName)
+	{
+		std::ifstream file(fileName, std::ios::binary);
+		if (!file)
+			return false;
+
+		UINT32 magic = 0, version = 0, numBlobs = 0;
+		file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+		file.read(reinterpret_cast<char*>(&version), sizeof(version));
+		file.read(reinterpret_cast<char*>(&numBlobs), sizeof(numBlobs));
+		if (!file || magic != BlobFileMagic || version != BlobFileVersion)
+		{
+			LOG_WARNING("The root signature cache file is invalid or outdated, it is ignored");
+			return false;
+		}
+
+		std::unordered_map<size_t, Blob> blobs;
+		for (UINT32 i = 0; i < numBlobs; ++i)
+		{
+			UINT64 hash = 0;
+			UINT32 keySize = 0;
+			file.read(reinterpret_cast<char*>(&hash), sizeof(hash));
+			file.read(reinterpret_cast<char*>(&keySize), sizeof(keySize));
+			if (!file)
+				break;
+
+			Blob blob;
+			blob.ParamsKey.resize(keySize);
+			file.read(reinterpret_cast<char*>(blob.ParamsKey.data()), keySize * sizeof(UINT32));
+
+			UINT32 size = 0;
+			file.read(reinterpret_cast<char*>(&size), sizeof(size));
+			if (!file)
+				break;
+
+			blob.Data.resize(size);
+			file.read(reinterpret_cast<char*>(blob.Data.data()), size);
+			if (!file)
+				break;
+
+			blobs.emplace(static_cast<size_t>(hash), std::move(blob));
+		}
+
+		if (blobs.size() != numBlobs)
+		{
+			LOG_WARNING("The root signature cache file is truncated, it is ignored");
+			return false;
+		}
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		// The blobs serialized in this run are kept
+		for (auto& blob : blobs)
+			m_Blobs.emplace(blob.first, std::move(blob.second));
+
+		return true;
+	}
+
+	bool RootSignatureCache::SaveToFile(const std::wstring& fileName)
+	{
+		std::ofstream file(fileName, std::ios::binary | std::ios::trunc);
+		if (!file)
+			return false;
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		UINT32 numBlobs = static_cast<UINT32>(m_Blobs.size());
+		file.write(reinterpret_cast<const char*>(&BlobFileMagic), sizeof(BlobFileMagic));
+		file.write(reinterpret_cast<const char*>(&BlobFileVersion), sizeof(BlobFileVersion));
+		file.write(reinterpret_cast<const char*>(&numBlobs), sizeof(numBlobs));
+
+		for (const auto& blob : m_Blobs)
+		{
+			UINT64 hash = blob.first;
+			UINT32 keySize = static_cast<UINT32>(blob.second.ParamsKey.size());
+			UINT32 size = static_cast<UINT32>(blob.second.Data.size());
+			file.write(reinterpret_cast<const char*>(&hash), sizeof(hash));
+			file.write(reinterpret_cast<const char*>(&keySize), sizeof(keySize));
+			file.write(reinterpret_cast<const char*>(blob.second.ParamsKey.data()), keySize * sizeof(UINT32));
+			file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+			file.write(reinterpret_cast<const char*>(blob.second.Data.data()), size);
+		}
+
+		return static_cast<bool>(file);
+	}
+
+	RootSignatureCache::Stats RootSignatureCache::GetStats()
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		Stats stats = m_Stats;
+		if (stats.NumSerializations > 0)
+			stats.SavedMilliseconds = stats.SerializationMilliseconds / stats.NumSerializations * (stats.NumHits + stats.NumBlobHits);
+		return stats;
+	}
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include "RootSignature.h"
+
+/*
+* Device-level cache of the D3D12 root signatures. Pipelines with the same root parameters share one ID3D12RootSignature:
+* the entries are looked up with RootParamsManager::GetHash() and compared with RootParamsManager::operator==, and
+* every RootSignature that finalizes with the parameters holds a reference to the entry.
+* When the last reference is released the D3D12 object goes to the release queue of the render device.
+*
+* The serialized blobs can be saved to a file and loaded at startup: a request that misses the in-memory entries but finds
+* the blob of its hash only calls CreateRootSignature, D3D12SerializeRootSignature is skipped. The hash only combines
+* integer fields, it is the same from one run to the next. Each blob is stored with the key of its parameters
+* (RootParamsManager::GetKey), a blob whose key differs from the request was made for other parameters with the same hash
+* and is serialized again.
+*
+*   hash -> { Params, ID3D12RootSignature, RefCount }        hash -> { params key, serialized blob } (memory and file)
+*/
+namespace RHI
+{
+	class RenderDevice;
+
+	class RootSignatureCache
+	{
+	public:
+		RootSignatureCache(RenderDevice& renderDevice);
+		~RootSignatureCache();
+
+		RootSignatureCache(const RootSignatureCache&) = delete;
+		RootSignatureCache& operator = (const RootSignatureCache&) = delete;
+
+		// Returns the D3D12 root signature matching the parameters of signature, it is created on the first request.
+		// Every Acquire must be matched by a Release
+		Microsoft::WRL::ComPtr<ID3D12RootSignature> Acquire(const RootSignature& signature, ID3D12Device* d3d12Device);
+		void Release(const RootSignature& signature);
+
+		// Serialized blobs of the previous runs. A file written by another version is ignored
+		bool LoadFromFile(const std::wstring& fileName);
+		bool SaveToFile(const std::wstring& fileName);
+
+		struct Stats
+		{
+			UINT32 NumRequests = 0;
+			// Requests served by an existing root signature
+			UINT32 NumHits = 0;
+			// Requests created from a blob loaded from the file
+			UINT32 NumBlobHits = 0;
+			// Blobs of the request hash made for other parameters
+			UINT32 NumBlobMismatches = 0;
+			UINT32 NumSerializations = 0;
+			UINT32 NumRootSignatures = 0;
+			double SerializationMilliseconds = 0.0;
+			// Estimated with the average serialization time
+			double SavedMilliseconds = 0.0;
+
+			float GetHitRate() const { return NumRequests > 0 ? static_cast<float>(NumHits + NumBlobHits) / NumRequests : 0.0f; }
+		};
+		Stats GetStats();
+
+	private:
+		struct Entry
+		{
+			RootSignature::RootParamsManager Params;
+			Microsoft::WRL::ComPtr<ID3D12RootSignature> D3D12RootSignature;
+			UINT32 RefCount = 0;
+		};
+
+		struct Blob
+		{
+			std::vector<UINT32> ParamsKey;
+			std::vector<UINT8> Data;
+		};
+
+		RenderDevice& m_RenderDevice;
+
+		std::mutex m_Mutex;
+		std::unordered_multimap<size_t, Entry> m_Entries;
+		std::unordered_map<size_t, Blob> m_Blobs;
+		Stats m_Stats;
+	};
+}
@@ -1,5 +1,6 @@
 #include "../pch.h"
 #include "Shader.h"
+#include "ShaderCache.h"
 
 using namespace std;
 using namespace Microsoft::WRL;
@@ -74,8 +75,41 @@ namespace RHI
         }
     }
 
-    // Build the source code of Shader
-    string BuildHLSLSourceString(const ShaderCreateInfo& shaderCI)
+    static string WStringToAnsi(const wstring& str)
+    {
+        int size = WideCharToMultiByte(CP_ACP, 0, str.c_str(), static_cast<int>(str.size()), nullptr, 0, nullptr, nullptr);
+        string ansi(size, '\0');
+        WideCharToMultiByte(CP_ACP, 0, str.c_str(), static_cast<int>(str.size()), &ansi[0], size, nullptr, nullptr);
+        return ansi;
+    }
+
+    // Resolves the includes with the tracker of the shader cache, so that the files read by the compilation are recorded
+    class ShaderIncludeHandler : public ID3DInclude
+    {
+    public:
+        ShaderIncludeHandler(ShaderIncludeTracker& tracker) : m_Tracker{ tracker } {}
+
+        HRESULT __stdcall Open(D3D_INCLUDE_TYPE includeType, LPCSTR pFileName, LPCVOID pParentData, LPCVOID* ppData, UINT* pBytes) override
+        {
+            const string* content = m_Tracker.Open(pFileName, pParentData);
+            if (content == nullptr)
+                return E_FAIL;
+
+            *ppData = content->data();
+            *pBytes = static_cast<UINT>(content->size());
+            return S_OK;
+        }
+
+        // The contents are owned by the tracker
+        HRESULT __stdcall Close(LPCVOID pData) override { return S_OK; }
+
+    private:
+        ShaderIncludeTracker& m_Tracker;
+    };
+
+    // Build the source code of Shader. The #line directive after the macros keeps the line numbers and the file name of
+    // the compiler errors those of the shader file
+    string BuildHLSLSourceString(const ShaderCreateInfo& shaderCI, const string& sourcePath, const string& fileContent)
     {
         string HLSLSource;
 
@@ -90,33 +124,102 @@ namespace RHI
             AppendShaderMacros(HLSLSource, shaderCI.Macros);
         }
         // Add Shader code
-         // TODO: Read Shader file
+        HLSLSource += "\n#line 1 \"";
+        for (char c : sourcePath)
+        {
+            if (c == '\\' || c == '"')
+                HLSLSource += '\\';
+            HLSLSource += c;
+        }
+        HLSLSource += "\"\n";
+        HLSLSource += fileContent;
         return HLSLSource;
     }
 
-    Shader::Shader(const ShaderCreateInfo& shaderCI) :
-        m_Desc{ shaderCI.Desc }
+    bool CreateShaderCompileTask(const ShaderCreateInfo& shaderCI, const ReadFileFunc& readFile, ShaderCompileTask& task)
     {
-        string strShaderProfile = GetHLSLProfileString(shaderCI.Desc.ShaderType, shaderCI.SM);
+        task.SourcePath = WStringToAnsi(shaderCI.FilePath);
+
+        string fileContent;
+        if (!readFile(task.SourcePath, fileContent))
+        {
+            LOG_ERROR("Failed to read the shader file " + task.SourcePath);
+            return false;
+        }
+
+        // The macros are in the source, the includes are checked by the cache record
+        task.Source = BuildHLSLSourceString(shaderCI, task.SourcePath, fileContent);
+        task.EntryPoint = shaderCI.entryPoint;
+        task.Profile = GetHLSLProfileString(shaderCI.Desc.ShaderType, shaderCI.SM);
+        task.ShaderType = shaderCI.Desc.ShaderType;
 
-        UINT compileFlags = 0;
+        task.Flags = 0;
 #if defined(DEBUG) || defined(_DEBUG)  
-        compileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+        task.Flags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
 #endif
+        return true;
+    }
 
-        // Compile directly from the Shader file
-        ComPtr<ID3DBlob> errors;
-        HRESULT hr = S_OK;
+    HRESULT CompileShaderTask(const ShaderCompileTask& task, ShaderIncludeTracker& includes, ComPtr<ID3DBlob>& byteCode,
+        vector<UINT8>& reflection, ComPtr<ID3DBlob>& errors)
+    {
+        UINT64 cacheKey = task.GetKey();
+        reflection.clear();
+
+        ShaderCache* shaderCache = ShaderCache::GetSingletonPtr();
+        if (shaderCache != nullptr && shaderCache->Find(cacheKey, byteCode, reflection))
+            return S_OK;
+
+        ShaderIncludeHandler includeHandler(includes);
+        HRESULT hr = D3DCompile(task.Source.data(), task.Source.size(), task.SourcePath.c_str(), nullptr, &includeHandler,
+            task.EntryPoint.c_str(), task.Profile.c_str(), task.Flags, 0, byteCode.ReleaseAndGetAddressOf(), errors.ReleaseAndGetAddressOf());
+
+        // The resources are reflected once here, the next runs load the snapshot
+        if (SUCCEEDED(hr) && shaderCache != nullptr)
+        {
+            ShaderDesc desc{ static_cast<SHADER_TYPE>(task.ShaderType) };
+            reflection = ShaderResource(byteCode.Get(), desc).CreateSnapshot();
+            shaderCache->Add(cacheKey, byteCode.Get(), reflection, includes.GetDependencies());
+        }
 
-        hr = D3DCompileFromFile(shaderCI.FilePath.c_str(), nullptr, D3D_COMPILE_STANDARD_FILE_INCLUDE,
-            shaderCI.entryPoint.c_str(), strShaderProfile.c_str(), compileFlags, 0, &m_ShaderByteCode, &errors);
+        return hr;
+    }
+
+    Shader::Shader(const ShaderCreateInfo& shaderCI) :
+        m_Desc{ shaderCI.Desc }
+    {
+        ShaderCompileTask task;
+        if (!CreateShaderCompileTask(shaderCI, &ShaderCache::ReadFile, task))
+            ThrowIfFailed(HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND));
+
+        ShaderIncludeTracker includes(ShaderIncludeTracker::GetDirectory(task.SourcePath), &ShaderCache::ReadFile);
+
+        ComPtr<ID3DBlob> errors;
+        vector<UINT8> reflection;
+        HRESULT hr = CompileShaderTask(task, includes, m_ShaderByteCode, reflection, errors);
 
         if (errors != nullptr)
             LOG_ERROR((char*)errors->GetBufferPointer());
 
         ThrowIfFailed(hr);
 
+        LoadShaderResource(reflection);
+    }
+
+    Shader::Shader(const ShaderDesc& desc, ID3DBlob* byteCode, const vector<UINT8>& reflection) :
+        m_Desc{ desc },
+        m_ShaderByteCode{ byteCode }
+    {
+        LoadShaderResource(reflection);
+    }
+
+    void Shader::LoadShaderResource(const vector<UINT8>& reflection)
+    {
+        if (!reflection.empty())
+            m_ShaderResource = ShaderResource::CreateFromSnapshot(reflection.data(), reflection.size());
+
         // Use the Shader reflection system to collect the resources used by the Shader
-        m_ShaderResource = make_unique<const ShaderResource>(m_ShaderByteCode.Get(), shaderCI.Desc);
+        if (m_ShaderResource == nullptr)
+            m_ShaderResource = make_unique<const ShaderResource>(m_ShaderByteCode.Get(), m_Desc);
     }
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 #include "ShaderObject/ShaderResource.h"
+#include "ShaderBatchScheduler.h"
 
 namespace RHI
 {
@@ -32,7 +33,10 @@ namespace RHI
     // Responsible for compiling the Shader file of HLSL
     class Shader
     {
+    public:
         Shader(const ShaderCreateInfo& shaderCI);
+        // Shader of bytecode already compiled, see ShaderCompileBatch. The resources are loaded from the reflection snapshot if it is valid
+        Shader(const ShaderDesc& desc, ID3DBlob* byteCode, const std::vector<UINT8>& reflection);
 
         // Getters
         const ShaderResource* GetShaderResources() const { return m_ShaderResource.get(); }
@@ -40,10 +44,21 @@ namespace RHI
         SHADER_TYPE GetShaderType() const { return m_Desc.ShaderType; }
 
     private:
+        // From the reflection snapshot of the shader cache, or with D3DReflect if there is no valid snapshot
+        void LoadShaderResource(const std::vector<UINT8>& reflection);
+
         ShaderDesc m_Desc;
         // Shader Resource
         std::unique_ptr<const ShaderResource> m_ShaderResource;
 
         Microsoft::WRL::ComPtr<ID3DBlob> m_ShaderByteCode;
     };
+
+    // Source and compiler arguments of the shader, the file is read with readFile. Returns false if it cannot be read
+    bool CreateShaderCompileTask(const ShaderCreateInfo& shaderCI, const ReadFileFunc& readFile, ShaderCompileTask& task);
+
+    // Takes the bytecode and its reflection snapshot from the shader cache, or compiles the bytecode with the includes of the tracker,
+    // reflects it and adds both to the cache. The snapshot is empty when there is no shader cache
+    HRESULT CompileShaderTask(const ShaderCompileTask& task, ShaderIncludeTracker& includes, Microsoft::WRL::ComPtr<ID3DBlob>& byteCode,
+        std::vector<UINT8>& reflection, Microsoft::WRL::ComPtr<ID3DBlob>& errors);
 }
\ No newline at end of file
@@ -0,0 +1,245 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+#include "ShaderCacheFormat.h"
+
+/*
+* Include scanning and scheduling of ShaderCompileBatch. Like ShaderCacheFormat.h this file only uses the standard library,
+* the compiler is a ShaderCompilerBackend: D3DCompile for the batches of the engine, any fake compiler elsewhere.
+*
+*   tasks --Add()--> unique tasks (by key) --Run()--> worker threads --backend.Compile()--> outputs
+*                                                        \-- includes read from ShaderIncludeScanner, each file once per batch
+*/
+namespace RHI
+{
+	// One compilation: the source with its macros and the arguments of the compiler
+	struct ShaderCompileTask
+	{
+		std::string SourcePath;
+		std::string Source;
+		std::string EntryPoint;
+		std::string Profile;
+		uint32_t Flags = 0;
+		// SHADER_TYPE, the profile and the macros of the source already depend on it
+		uint32_t ShaderType = 0;
+
+		// Key of the compilation in the shader cache, identical tasks have the same key
+		uint64_t GetKey() const
+		{
+			return ShaderCacheKey().Add(Source).Add(EntryPoint).Add(Profile).Add(static_cast<uint64_t>(Flags))
+				.Add(ShaderIncludeTracker::GetDirectory(SourcePath)).GetHash();
+		}
+	};
+
+	struct ShaderCompileOutput
+	{
+		bool Succeeded = false;
+		std::vector<uint8_t> ByteCode;
+		// Snapshot of the resources used by the bytecode, may be empty
+		std::vector<uint8_t> Reflection;
+		std::string Errors;
+	};
+
+	class ShaderCompilerBackend
+	{
+	public:
+		virtual ~ShaderCompilerBackend() = default;
+
+		// Called by several threads at once. The includes are opened with includes, the messages of the compiler go to output.Errors
+		virtual bool Compile(const ShaderCompileTask& task, ShaderIncludeTracker& includes, ShaderCompileOutput& output) = 0;
+	};
+
+	// Reads the shader files and their includes once for all the compilations of a batch. Thread safe
+	class ShaderIncludeScanner
+	{
+	public:
+		explicit ShaderIncludeScanner(ReadFileFunc readFile) :
+			m_ReadFile{ std::move(readFile) }
+		{
+		}
+
+		// Content of the file, it is only read from the disk the first time
+		bool ReadFile(const std::string& path, std::string& content)
+		{
+			const File* file = GetFile(path);
+			if (!file->Found)
+				return false;
+			content = file->Content;
+			return true;
+		}
+
+		// Reads the file and the files it includes, recursively, resolved like ShaderIncludeTracker does.
+		// The #include of the inactive #if branches are read too, the files missing are skipped
+		void Scan(const std::string& sourcePath)
+		{
+			std::string sourceDirectory = ShaderIncludeTracker::GetDirectory(sourcePath);
+
+			std::vector<std::string> pending{ sourcePath };
+			std::unordered_set<std::string> visited{ sourcePath };
+			while (!pending.empty())
+			{
+				std::string path = std::move(pending.back());
+				pending.pop_back();
+
+				const File* file = GetFile(path);
+				if (!file->Found)
+					continue;
+
+				std::string directory = ShaderIncludeTracker::GetDirectory(path);
+				for (const std::string& include : file->Includes)
+				{
+					std::string includePath = ShaderIncludeTracker::JoinPath(directory, include);
+					if (!GetFile(includePath)->Found)
+						includePath = ShaderIncludeTracker::JoinPath(sourceDirectory, include);
+					if (visited.insert(includePath).second)
+						pending.push_back(std::move(includePath));
+				}
+			}
+		}
+
+		size_t GetNumFilesRead()
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			return m_Files.size();
+		}
+
+		// Names of the #include "..." and #include <...> directives of a source
+		static void ParseIncludes(const std::string& source, std::vector<std::string>& includes)
+		{
+			size_t lineStart = 0;
+			while (lineStart < source.size())
+			{
+				size_t lineEnd = source.find('\n', lineStart);
+				if (lineEnd == std::string::npos)
+					lineEnd = source.size();
+
+				size_t i = SkipSpaces(source, lineStart, lineEnd);
+				if (i < lineEnd && source[i] == '#')
+				{
+					i = SkipSpaces(source, i + 1, lineEnd);
+					if (source.compare(i, 7, "include") == 0)
+					{
+						i = SkipSpaces(source, i + 7, lineEnd);
+						char closing = i < lineEnd && source[i] == '"' ? '"' : (i < lineEnd && source[i] == '<' ? '>' : 0);
+						size_t nameEnd = closing != 0 ? source.find(closing, i + 1) : std::string::npos;
+						if (nameEnd != std::string::npos && nameEnd < lineEnd)
+							includes.push_back(source.substr(i + 1, nameEnd - i - 1));
+					}
+				}
+
+				lineStart = lineEnd + 1;
+			}
+		}
+
+	private:
+		struct File
+		{
+			bool Found = false;
+			std::string Content;
+			std::vector<std::string> Includes;
+		};
+
+		static size_t SkipSpaces(const std::string& source, size_t i, size_t end)
+		{
+			while (i < end && (source[i] == ' ' || source[i] == '\t' || source[i] == '\r'))
+				++i;
+			return i;
+		}
+
+		// The files are never removed, the pointers stay valid
+		const File* GetFile(const std::string& path)
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				auto it = m_Files.find(path);
+				if (it != m_Files.end())
+					return it->second.get();
+			}
+
+			// Read without the lock, two threads may read the same file and the first one is kept
+			auto file = std::make_unique<File>();
+			file->Found = m_ReadFile(path, file->Content);
+			if (file->Found)
+				ParseIncludes(file->Content, file->Includes);
+
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			return m_Files.emplace(path, std::move(file)).first->second.get();
+		}
+
+		ReadFileFunc m_ReadFile;
+
+		std::mutex m_Mutex;
+		std::unordered_map<std::string, std::unique_ptr<File>> m_Files;
+	};
+
+	// Compiles the unique tasks of a batch on worker threads
+	class ShaderBatchScheduler
+	{
+	public:
+		ShaderBatchScheduler(ShaderCompilerBackend& backend, ShaderIncludeScanner& scanner) :
+			m_Backend{ backend },
+			m_Scanner{ scanner }
+		{
+		}
+
+		// Index of the output of the task, the tasks with the same key share one output
+		size_t Add(ShaderCompileTask task)
+		{
+			uint64_t key = task.GetKey();
+			auto it = m_UniqueTasks.find(key);
+			if (it != m_UniqueTasks.end())
+				return it->second;
+
+			m_Tasks.push_back(std::move(task));
+			m_UniqueTasks.emplace(key, m_Tasks.size() - 1);
+			return m_Tasks.size() - 1;
+		}
+
+		// The calling thread compiles too, numThreads includes it
+		void Run(uint32_t numThreads)
+		{
+			m_Outputs.clear();
+			m_Outputs.resize(m_Tasks.size());
+
+			std::atomic<size_t> nextTask{ 0 };
+			auto compileTasks = [this, &nextTask]()
+			{
+				for (size_t i = nextTask++; i < m_Tasks.size(); i = nextTask++)
+				{
+					const ShaderCompileTask& task = m_Tasks[i];
+					ShaderIncludeTracker includes(ShaderIncludeTracker::GetDirectory(task.SourcePath),
+						[this](const std::string& path, std::string& content) { return m_Scanner.ReadFile(path, content); });
+
+					ShaderCompileOutput& output = m_Outputs[i];
+					output.Succeeded = m_Backend.Compile(task, includes, output);
+				}
+			};
+
+			size_t numWorkers = std::min<size_t>(numThreads > 0 ? numThreads - 1 : 0, m_Tasks.size() > 0 ? m_Tasks.size() - 1 : 0);
+			std::vector<std::thread> workers;
+			workers.reserve(numWorkers);
+			for (size_t i = 0; i < numWorkers; ++i)
+				workers.emplace_back(compileTasks);
+
+			compileTasks();
+
+			for (auto& worker : workers)
+				worker.join();
+		}
+
+		size_t GetNumUniqueTasks() const { return m_Tasks.size(); }
+		const ShaderCompileTask& GetTask(size_t index) const { return m_Tasks[index]; }
+		const ShaderCompileOutput& GetOutput(size_t index) const { return m_Outputs[index]; }
+
+	private:
+		ShaderCompilerBackend& m_Backend;
+		ShaderIncludeScanner& m_Scanner;
+
+		std::vector<ShaderCompileTask> m_Tasks;
+		std::unordered_map<uint64_t, size_t> m_UniqueTasks;
+		std::vector<ShaderCompileOutput> m_Outputs;
+	};
+}
@@ -0,0 +1,145 @@
+#include "../pch.h"
+#include "ShaderCache.h"
+
+namespace RHI
+{
+	bool ShaderCache::LoadFromFile(const std::wstring& fileName)
+	{
+		std::ifstream file(fileName, std::ios::binary | std::ios::ate);
+		if (!file)
+			return false;
+
+		std::vector<uint8_t> bytes(static_cast<size_t>(file.tellg()));
+		file.seekg(0);
+		file.read(reinterpret_cast<char*>(bytes.data()), bytes.size());
+		if (!file)
+			return false;
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Archive.Close();
+		m_FileBytes = std::move(bytes);
+		if (!m_Archive.Open(m_FileBytes.data(), m_FileBytes.size()))
+		{
+			LOG_WARNING("The shader cache file is invalid or outdated, it is ignored");
+			m_FileBytes.clear();
+			return false;
+		}
+
+		return true;
+	}
+
+	bool ShaderCache::SaveToFile(const std::wstring& fileName)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		// The records compiled in this run come first, they replace the outdated records of the file
+		std::vector<ShaderCacheArchive::BlobRef> records;
+		records.reserve(m_NewRecords.size() + m_Archive.GetNumEntries());
+		for (const auto& record : m_NewRecords)
+			records.push_back({ record.first, record.second.data(), record.second.size() });
+		for (size_t i = 0; i < m_Archive.GetNumEntries(); ++i)
+			records.push_back(m_Archive.GetBlob(i));
+
+		std::vector<uint8_t> bytes = ShaderCacheArchive::Build(std::move(records));
+
+		std::ofstream file(fileName, std::ios::binary | std::ios::trunc);
+		if (!file)
+			return false;
+		file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+		return static_cast<bool>(file);
+	}
+
+	bool ShaderCache::Find(UINT64 key, Microsoft::WRL::ComPtr<ID3DBlob>& byteCode, std::vector<UINT8>& reflection)
+	{
+		// The record and the known hashes of its files are copied under the lock, the files are read and hashed without it
+		std::vector<uint8_t> recordBytes;
+		ShaderCacheRecord record;
+		std::unordered_map<std::string, uint64_t> fileHashes;
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			++m_Stats.NumRequests;
+
+			auto it = m_NewRecords.find(key);
+			if (it != m_NewRecords.end())
+			{
+				recordBytes = it->second;
+			}
+			else
+			{
+				size_t recordSize = 0;
+				const uint8_t* recordData = static_cast<const uint8_t*>(m_Archive.Find(key, recordSize));
+				if (recordData != nullptr)
+					recordBytes.assign(recordData, recordData + recordSize);
+			}
+
+			if (recordBytes.empty() || !record.Parse(recordBytes.data(), recordBytes.size()))
+				return false;
+
+			for (const ShaderDependency& dependency : record.Dependencies)
+			{
+				auto hashIt = m_FileHashes.find(dependency.Path);
+				if (hashIt != m_FileHashes.end())
+					fileHashes.insert(*hashIt);
+			}
+		}
+
+		bool isUpToDate = AreShaderDependenciesUpToDate(record.Dependencies, &ShaderCache::ReadFile, fileHashes);
+
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			// A hash added by a compilation meanwhile is newer than the one read here
+			for (const auto& fileHash : fileHashes)
+				m_FileHashes.insert(fileHash);
+
+			if (!isUpToDate)
+			{
+				++m_Stats.NumOutdated;
+				return false;
+			}
+			++m_Stats.NumHits;
+		}
+
+		ThrowIfFailed(D3DCreateBlob(record.ByteCodeSize, byteCode.ReleaseAndGetAddressOf()));
+		memcpy(byteCode->GetBufferPointer(), record.ByteCode, record.ByteCodeSize);
+
+		const UINT8* reflectionBytes = static_cast<const UINT8*>(record.Reflection);
+		reflection.assign(reflectionBytes, reflectionBytes + record.ReflectionSize);
+
+		return true;
+	}
+
+	void ShaderCache::Add(UINT64 key, ID3DBlob* byteCode, const std::vector<UINT8>& reflection, const std::vector<ShaderDependency>& dependencies)
+	{
+		std::vector<uint8_t> record = ShaderCacheRecord::Serialize(dependencies, byteCode->GetBufferPointer(), byteCode->GetBufferSize(),
+			reflection.data(), reflection.size());
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_NewRecords[key] = std::move(record);
+
+		// The files were just read by the compilation
+		for (const ShaderDependency& dependency : dependencies)
+			m_FileHashes[dependency.Path] = dependency.ContentHash;
+	}
+
+	void ShaderCache::InvalidateFileHashes()
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_FileHashes.clear();
+	}
+
+	bool ShaderCache::ReadFile(const std::string& path, std::string& content)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file)
+			return false;
+
+		content.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		return !file.bad();
+	}
+
+	ShaderCache::Stats ShaderCache::GetStats()
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return m_Stats;
+	}
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include "ShaderCacheFormat.h"
+
+namespace RHI
+{
+	/*
+	* Compiled bytecode of the shaders, found by the key of their compilation (see ShaderCacheFormat.h).
+	* The records of the previous runs are loaded from a ShaderCacheArchive file, the records compiled in this run are
+	* added to them by SaveToFile. Created by the application like UploadManager, the shaders are always compiled without it.
+	* Thread safe, shaders can be created by several loader threads.
+	*/
+	class ShaderCache : public Singleton<ShaderCache>
+	{
+	public:
+		// A file written by another version is ignored
+		bool LoadFromFile(const std::wstring& fileName);
+		bool SaveToFile(const std::wstring& fileName);
+
+		// Bytecode and reflection snapshot of the key. Returns false if there is none or if one of the files it includes was edited
+		bool Find(UINT64 key, Microsoft::WRL::ComPtr<ID3DBlob>& byteCode, std::vector<UINT8>& reflection);
+		void Add(UINT64 key, ID3DBlob* byteCode, const std::vector<UINT8>& reflection, const std::vector<ShaderDependency>& dependencies);
+
+		// The included files are hashed once per run, this reads them again after they are edited
+		void InvalidateFileHashes();
+
+		// Reads the shader files and their includes from the disk
+		static bool ReadFile(const std::string& path, std::string& content);
+
+		struct Stats
+		{
+			UINT32 NumRequests = 0;
+			UINT32 NumHits = 0;
+			// Records found whose includes were edited
+			UINT32 NumOutdated = 0;
+		};
+		Stats GetStats();
+
+	private:
+		std::mutex m_Mutex;
+
+		// Bytes of the file loaded, the archive points into them
+		std::vector<uint8_t> m_FileBytes;
+		ShaderCacheArchive m_Archive;
+
+		// Serialized records compiled in this run
+		std::unordered_map<UINT64, std::vector<uint8_t>> m_NewRecords;
+
+		// Content hash of the included files read in this run
+		std::unordered_map<std::string, uint64_t> m_FileHashes;
+
+		Stats m_Stats;
+	};
+}
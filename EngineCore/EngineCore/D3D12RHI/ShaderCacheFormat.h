@@ -0,0 +1,247 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <deque>
+#include <functional>
+#include <unordered_map>
+#include "../Utility/HashUtils.hpp"
+#include "../Common/BlobArchive.h"
+
+/*
+* Keys, records and include tracking of the shader cache. Like BlobArchive, this file only uses the standard library:
+* the files are read through a ReadFileFunc, ShaderCache gives one that reads the disk.
+*
+* The key of a compilation hashes what is given to the compiler: the source with its macros, the entry point, the profile,
+* the flags and the directory the includes are resolved from. The included files are not known before the compilation,
+* the record stores them with the hash of their content, and a record is only used if they all still have that content.
+* Editing an include only invalidates the shaders that read it.
+*
+*   key --archive--> record = | NumDependencies | { ContentHash, PathLength, Path }... | ByteCodeSize | ByteCode | ReflectionSize | Reflection |
+*
+* The reflection is the snapshot of the resources of the bytecode (ShaderResource::CreateSnapshot), loading it skips D3DReflect.
+*/
+namespace RHI
+{
+	using ShaderCacheArchive = BlobArchive<0x43444853, 2>; // "SHDC"
+
+	// Returns false if the file cannot be read
+	using ReadFileFunc = std::function<bool(const std::string& path, std::string& content)>;
+
+	// A file read by the compilation of a shader
+	struct ShaderDependency
+	{
+		std::string Path;
+		uint64_t ContentHash = 0;
+	};
+
+	class ShaderCacheKey
+	{
+	public:
+		ShaderCacheKey& Add(const std::string& str)
+		{
+			// The length separates the strings, "ab" + "c" and "a" + "bc" give different keys
+			Add(static_cast<uint64_t>(str.size()));
+			m_Hash = ComputeFNV1aHash(str.data(), str.size(), m_Hash);
+			return *this;
+		}
+
+		ShaderCacheKey& Add(uint64_t value)
+		{
+			m_Hash = ComputeFNV1aHash(&value, sizeof(value), m_Hash);
+			return *this;
+		}
+
+		uint64_t GetHash() const { return m_Hash; }
+
+	private:
+		uint64_t m_Hash = ComputeFNV1aHash(nullptr, 0);
+	};
+
+	struct ShaderCacheRecord
+	{
+		std::vector<ShaderDependency> Dependencies;
+		// Point into the parsed bytes
+		const void* ByteCode = nullptr;
+		size_t ByteCodeSize = 0;
+		const void* Reflection = nullptr;
+		size_t ReflectionSize = 0;
+
+		static std::vector<uint8_t> Serialize(const std::vector<ShaderDependency>& dependencies, const void* byteCode, size_t byteCodeSize,
+			const void* reflection, size_t reflectionSize)
+		{
+			std::vector<uint8_t> bytes;
+			Write(bytes, static_cast<uint32_t>(dependencies.size()));
+			for (const ShaderDependency& dependency : dependencies)
+			{
+				Write(bytes, dependency.ContentHash);
+				Write(bytes, static_cast<uint32_t>(dependency.Path.size()));
+				bytes.insert(bytes.end(), dependency.Path.begin(), dependency.Path.end());
+			}
+			Write(bytes, static_cast<uint64_t>(byteCodeSize));
+			const uint8_t* byteCodeBytes = static_cast<const uint8_t*>(byteCode);
+			bytes.insert(bytes.end(), byteCodeBytes, byteCodeBytes + byteCodeSize);
+			Write(bytes, static_cast<uint64_t>(reflectionSize));
+			const uint8_t* reflectionBytes = static_cast<const uint8_t*>(reflection);
+			bytes.insert(bytes.end(), reflectionBytes, reflectionBytes + reflectionSize);
+			return bytes;
+		}
+
+		// Returns false if the bytes are truncated or malformed
+		bool Parse(const void* data, size_t size)
+		{
+			const uint8_t* bytes = static_cast<const uint8_t*>(data);
+			size_t offset = 0;
+
+			Dependencies.clear();
+			ByteCode = nullptr;
+			ByteCodeSize = 0;
+			Reflection = nullptr;
+			ReflectionSize = 0;
+
+			uint32_t numDependencies = 0;
+			if (!Read(bytes, size, offset, numDependencies))
+				return false;
+			for (uint32_t i = 0; i < numDependencies; ++i)
+			{
+				ShaderDependency dependency;
+				uint32_t pathLength = 0;
+				if (!Read(bytes, size, offset, dependency.ContentHash) || !Read(bytes, size, offset, pathLength) || pathLength > size - offset)
+					return false;
+				dependency.Path.assign(reinterpret_cast<const char*>(bytes + offset), pathLength);
+				offset += pathLength;
+				Dependencies.push_back(std::move(dependency));
+			}
+
+			uint64_t byteCodeSize = 0;
+			if (!Read(bytes, size, offset, byteCodeSize) || byteCodeSize > size - offset)
+				return false;
+			ByteCode = bytes + offset;
+			ByteCodeSize = static_cast<size_t>(byteCodeSize);
+			offset += ByteCodeSize;
+
+			uint64_t reflectionSize = 0;
+			if (!Read(bytes, size, offset, reflectionSize) || reflectionSize != size - offset)
+				return false;
+			Reflection = bytes + offset;
+			ReflectionSize = static_cast<size_t>(reflectionSize);
+			return true;
+		}
+
+	private:
+		template <typename T>
+		static void Write(std::vector<uint8_t>& bytes, T value)
+		{
+			const uint8_t* valueBytes = reinterpret_cast<const uint8_t*>(&value);
+			bytes.insert(bytes.end(), valueBytes, valueBytes + sizeof(T));
+		}
+
+		template <typename T>
+		static bool Read(const uint8_t* bytes, size_t size, size_t& offset, T& value)
+		{
+			if (sizeof(T) > size - offset)
+				return false;
+			memcpy(&value, bytes + offset, sizeof(T));
+			offset += sizeof(T);
+			return true;
+		}
+	};
+
+	// Resolves the includes of one compilation like D3D_COMPILE_STANDARD_FILE_INCLUDE, relative to the including file and then
+	// to the shader file, and records the files read
+	class ShaderIncludeTracker
+	{
+	public:
+		ShaderIncludeTracker(const std::string& sourceDirectory, ReadFileFunc readFile) :
+			m_SourceDirectory{ sourceDirectory },
+			m_ReadFile{ std::move(readFile) }
+		{
+		}
+
+		// Content of the include, nullptr if it cannot be read. parentData is the content of the including file,
+		// it is nullptr or unknown for the shader file. The content stays valid as long as the tracker
+		const std::string* Open(const std::string& fileName, const void* parentData)
+		{
+			std::string parentDirectory = m_SourceDirectory;
+			for (const IncludedFile& file : m_Files)
+			{
+				if (file.Content.data() == parentData)
+					parentDirectory = file.Directory;
+			}
+
+			std::string path = JoinPath(parentDirectory, fileName);
+			std::string content;
+			bool found = m_ReadFile(path, content);
+			if (!found && parentDirectory != m_SourceDirectory)
+			{
+				path = JoinPath(m_SourceDirectory, fileName);
+				found = m_ReadFile(path, content);
+			}
+			if (!found)
+				return nullptr;
+
+			bool recorded = false;
+			for (const ShaderDependency& dependency : m_Dependencies)
+				recorded |= dependency.Path == path;
+			if (!recorded)
+				m_Dependencies.push_back(ShaderDependency{ path, ComputeFNV1aHash(content.data(), content.size()) });
+
+			m_Files.push_back(IncludedFile{ GetDirectory(path), std::move(content) });
+			return &m_Files.back().Content;
+		}
+
+		const std::vector<ShaderDependency>& GetDependencies() const { return m_Dependencies; }
+
+		static std::string GetDirectory(const std::string& path)
+		{
+			size_t separator = path.find_last_of("/\\");
+			return separator == std::string::npos ? std::string() : path.substr(0, separator);
+		}
+
+		static std::string JoinPath(const std::string& directory, const std::string& fileName)
+		{
+			bool isAbsolute = !fileName.empty() && (fileName[0] == '/' || fileName[0] == '\\' || fileName.find(':') != std::string::npos);
+			if (directory.empty() || isAbsolute)
+				return fileName;
+			return directory + '/' + fileName;
+		}
+
+	private:
+
+		struct IncludedFile
+		{
+			std::string Directory;
+			std::string Content;
+		};
+
+		std::string m_SourceDirectory;
+		ReadFileFunc m_ReadFile;
+		// A deque keeps the contents in place while the compiler reads them
+		std::deque<IncludedFile> m_Files;
+		std::vector<ShaderDependency> m_Dependencies;
+	};
+
+	// True if the files still have the content they had when the record was compiled. fileHashes keeps the hashes
+	// computed by the earlier checks, an include shared by many shaders is only read once
+	inline bool AreShaderDependenciesUpToDate(const std::vector<ShaderDependency>& dependencies, const ReadFileFunc& readFile,
+		std::unordered_map<std::string, uint64_t>& fileHashes)
+	{
+		for (const ShaderDependency& dependency : dependencies)
+		{
+			auto it = fileHashes.find(dependency.Path);
+			if (it == fileHashes.end())
+			{
+				std::string content;
+				// A missing file gets the hash 0, it does not match any content
+				uint64_t hash = readFile(dependency.Path, content) ? ComputeFNV1aHash(content.data(), content.size()) : 0;
+				it = fileHashes.emplace(dependency.Path, hash).first;
+			}
+
+			if (it->second != dependency.ContentHash)
+				return false;
+		}
+		return true;
+	}
+}
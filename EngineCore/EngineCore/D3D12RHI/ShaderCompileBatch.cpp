@@ -0,0 +1,122 @@
+#include "../pch.h"
+#include "ShaderCompileBatch.h"
+#include "ShaderCache.h"
+
+using namespace Microsoft::WRL;
+
+namespace RHI
+{
+	class D3DShaderCompilerBackend : public ShaderCompilerBackend
+	{
+	public:
+		bool Compile(const ShaderCompileTask& task, ShaderIncludeTracker& includes, ShaderCompileOutput& output) override
+		{
+			ComPtr<ID3DBlob> byteCodeBlob, errorBlob;
+			HRESULT hr = CompileShaderTask(task, includes, byteCodeBlob, output.Reflection, errorBlob);
+
+			if (errorBlob != nullptr)
+				output.Errors.assign(static_cast<const char*>(errorBlob->GetBufferPointer()), errorBlob->GetBufferSize());
+			if (FAILED(hr))
+				return false;
+
+			const uint8_t* bytes = static_cast<const uint8_t*>(byteCodeBlob->GetBufferPointer());
+			output.ByteCode.assign(bytes, bytes + byteCodeBlob->GetBufferSize());
+			return true;
+		}
+	};
+
+	size_t ShaderCompileBatch::Add(const ShaderCreateInfo& shaderCI, const std::vector<std::vector<ShaderMacro>>& permutations)
+	{
+		size_t firstIndex = m_Entries.size();
+		for (const auto& permutation : permutations)
+		{
+			Entry entry{ shaderCI, {} };
+			for (const ShaderMacro* macro = shaderCI.Macros; macro != nullptr && !macro->Name.empty() && !macro->Definition.empty(); ++macro)
+				entry.Macros.push_back(*macro);
+			for (const ShaderMacro& macro : permutation)
+				entry.Macros.push_back(macro);
+			entry.Macros.push_back(ShaderMacro{});
+
+			m_Entries.push_back(std::move(entry));
+		}
+		return firstIndex;
+	}
+
+	size_t ShaderCompileBatch::Add(const ShaderCreateInfo& shaderCI)
+	{
+		return Add(shaderCI, { {} });
+	}
+
+	void ShaderCompileBatch::Compile(UINT32 numThreads)
+	{
+		auto compileStart = std::chrono::steady_clock::now();
+
+		ShaderIncludeScanner scanner(&ShaderCache::ReadFile);
+		auto readFile = [&scanner](const std::string& path, std::string& content) { return scanner.ReadFile(path, content); };
+
+		D3DShaderCompilerBackend backend;
+		ShaderBatchScheduler scheduler(backend, scanner);
+
+		// The include graph of each source file is read before the compilations, they only read memory
+		const size_t NoTask = std::numeric_limits<size_t>::max();
+		std::vector<size_t> taskIndices(m_Entries.size(), NoTask);
+		for (size_t i = 0; i < m_Entries.size(); ++i)
+		{
+			ShaderCreateInfo shaderCI = m_Entries[i].CreateInfo;
+			shaderCI.Macros = m_Entries[i].Macros.data();
+
+			ShaderCompileTask task;
+			if (!CreateShaderCompileTask(shaderCI, readFile, task))
+				continue;
+
+			scanner.Scan(task.SourcePath);
+			taskIndices[i] = scheduler.Add(std::move(task));
+		}
+
+		scheduler.Run(numThreads);
+
+		// The permutations of one task share its shader
+		std::vector<std::shared_ptr<Shader>> taskShaders(scheduler.GetNumUniqueTasks());
+		std::vector<bool> taskLogged(scheduler.GetNumUniqueTasks(), false);
+		m_Shaders.assign(m_Entries.size(), nullptr);
+		m_Stats = Stats{};
+
+		for (size_t i = 0; i < m_Entries.size(); ++i)
+		{
+			size_t taskIndex = taskIndices[i];
+			if (taskIndex == NoTask)
+			{
+				++m_Stats.NumFailed;
+				continue;
+			}
+
+			const ShaderCompileOutput& output = scheduler.GetOutput(taskIndex);
+			if (!output.Errors.empty() && !taskLogged[taskIndex])
+			{
+				LOG_ERROR(scheduler.GetTask(taskIndex).SourcePath + ": " + output.Errors);
+				taskLogged[taskIndex] = true;
+			}
+
+			if (!output.Succeeded)
+			{
+				++m_Stats.NumFailed;
+				continue;
+			}
+
+			if (taskShaders[taskIndex] == nullptr)
+			{
+				ComPtr<ID3DBlob> byteCode;
+				ThrowIfFailed(D3DCreateBlob(output.ByteCode.size(), byteCode.GetAddressOf()));
+				memcpy(byteCode->GetBufferPointer(), output.ByteCode.data(), output.ByteCode.size());
+
+				taskShaders[taskIndex] = std::make_shared<Shader>(m_Entries[i].CreateInfo.Desc, byteCode.Get(), output.Reflection);
+			}
+			m_Shaders[i] = taskShaders[taskIndex];
+		}
+
+		m_Stats.NumShaders = static_cast<UINT32>(m_Entries.size());
+		m_Stats.NumCompilations = static_cast<UINT32>(scheduler.GetNumUniqueTasks());
+		m_Stats.NumFilesRead = static_cast<UINT32>(scanner.GetNumFilesRead());
+		m_Stats.CompileMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - compileStart).count();
+	}
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include "Shader.h"
+
+namespace RHI
+{
+	/*
+	* Compiles many shaders and their permutations at once, e.g. all the variants of a material:
+	*  - the shader files and their includes are read and scanned once for the whole batch (ShaderIncludeScanner),
+	*  - the permutations that give the same compilation (same key in the shader cache) are compiled once and share one Shader,
+	*  - the compilations run on several threads (ShaderBatchScheduler), the shader cache is used like by Shader.
+	*/
+	class ShaderCompileBatch
+	{
+	public:
+		// Adds one shader for each permutation, the macros of a permutation follow the macros of shaderCI.
+		// Like ShaderCreateInfo::Macros, every macro needs a definition. Returns the index of the first shader
+		size_t Add(const ShaderCreateInfo& shaderCI, const std::vector<std::vector<ShaderMacro>>& permutations);
+		size_t Add(const ShaderCreateInfo& shaderCI);
+
+		// numThreads includes the calling thread. A shader that fails to compile is nullptr, the errors are logged
+		void Compile(UINT32 numThreads = std::max(1u, std::thread::hardware_concurrency()));
+
+		size_t GetNumShaders() const { return m_Entries.size(); }
+		// Valid after Compile, index is returned by Add
+		std::shared_ptr<Shader> GetShader(size_t index) const { return m_Shaders[index]; }
+
+		struct Stats
+		{
+			UINT32 NumShaders = 0;
+			// Unique compilations, taken from the shader cache or compiled
+			UINT32 NumCompilations = 0;
+			UINT32 NumFailed = 0;
+			UINT32 NumFilesRead = 0;
+			double CompileMilliseconds = 0.0;
+		};
+		const Stats& GetStats() const { return m_Stats; }
+
+	private:
+		struct Entry
+		{
+			ShaderCreateInfo CreateInfo;
+			// Macros of shaderCI and of the permutation, terminated by an empty macro
+			std::vector<ShaderMacro> Macros;
+		};
+
+		std::vector<Entry> m_Entries;
+		std::vector<std::shared_ptr<Shader>> m_Shaders;
+
+		Stats m_Stats;
+	};
+}
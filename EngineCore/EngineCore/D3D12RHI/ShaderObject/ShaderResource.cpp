@@ -1,23 +1,71 @@
 ﻿#include "../../pch.h"
 #include "ShaderResource.h"
 #include "../Shader.h"
+#include "ShaderVariableTable.h"
 
 namespace RHI
 {
+	// Header of the reflection snapshot, the version changes with the layout of ShaderResourceAttribs
+	static constexpr UINT32 SnapshotMagic = 0x46525253; // "SRRF"
+	static constexpr UINT32 SnapshotVersion = 2;
+
+	struct SnapshotHeader
+	{
+		UINT32 Magic;
+		UINT32 Version;
+		UINT32 ShaderType;
+		UINT32 ShaderVersion;
+		UINT16 TexSRVOffset;
+		UINT16 TexUAVOffset;
+		UINT16 BufSRVOffset;
+		UINT16 BufUAVOffset;
+		UINT16 NumResources;
+		UINT16 Padding;
+		UINT32 NamePoolSize;
+	};
+
+	struct SnapshotResource
+	{
+		UINT64 NameHash;
+		UINT32 NameOffset;
+		UINT16 BindPoint;
+		UINT16 BindCount;
+		// InputType | SRVDimension << ShaderInputTypeBits
+		UINT32 PackedType;
+		UINT32 Padding;
+	};
+
+	ShaderResource::ShaderResource(SHADER_TYPE shaderType) :
+		m_ShaderType{ shaderType }
+	{
+	}
+
 	ShaderResource::ShaderResource(ID3DBlob* pShaderBytecode, const ShaderDesc& shaderDesc) :
 		m_ShaderType{ shaderDesc.ShaderType }
 	{
 		// Use reflection to get the resources that this Shader needs to bind
-		ID3D12ShaderReflection* pShaderReflection;
+		Microsoft::WRL::ComPtr<ID3D12ShaderReflection> pShaderReflection;
 		ThrowIfFailed(D3DReflect(pShaderBytecode->GetBufferPointer(),
 			pShaderBytecode->GetBufferSize(),
-			__uuidof(pShaderReflection), reinterpret_cast<void**>(&pShaderReflection)));
+			IID_PPV_ARGS(pShaderReflection.GetAddressOf())));
 
 		D3D12_SHADER_DESC DXshaderDesc = {};
 		pShaderReflection->GetDesc(&DXshaderDesc);
 
 		m_ShaderVersion = DXshaderDesc.Version;
 
+		// The resources are grouped before the memory is allocated: CBV, TexSRV, TexUAV, BufferSRV, BufferUAV
+		struct ReflectedResource
+		{
+			std::string Name;
+			UINT BindPoint;
+			UINT BindCount;
+			D3D_SHADER_INPUT_TYPE Type;
+			D3D_SRV_DIMENSION Dimension;
+		};
+		enum { CB = 0, TexSRV, TexUAV, BufSRV, BufUAV, NumGroups };
+		std::vector<ReflectedResource> groups[NumGroups];
+
 		// Record every resource used by Shader
 		UINT skipCount = 1;
 		for (UINT i = 0; i < DXshaderDesc.BoundResources; i += skipCount)
@@ -28,6 +76,7 @@ namespace RHI
 			std::string name = bindingDesc.Name;
 
 			UINT bindCount = bindingDesc.BindCount;
+			skipCount = 1;
 
 			// Process the array
 			// In Shader Model 5_0 and previous versions, each array resource is listed separately.
@@ -43,7 +92,7 @@ namespace RHI
 			//
 			// If some of the elements of the array resource are not used by the Shader, they will not be listed
 			auto openBracketPos = name.find('[');
-			if (-1 != openBracketPos)
+			if (openBracketPos != std::string::npos)
 			{
 				assert((bindCount == 1) && "When array elements are enumerated individually, BindCount is expected to always be 1");
 
@@ -76,41 +125,26 @@ namespace RHI
 					}
 				}
 			}
-			std::unique_ptr<ShaderResourceAttribs> shaderResourceAttribs = std::make_unique<ShaderResourceAttribs>(name, bindingDesc.BindPoint,
-				bindCount, bindingDesc.Type, bindingDesc.Dimension);
+			ReflectedResource resource{ std::move(name), bindingDesc.BindPoint, bindCount, bindingDesc.Type, bindingDesc.Dimension };
 			// SIT: Shader Input Type
 			switch (bindingDesc.Type)
 			{
 			case D3D_SIT_CBUFFER:
-				m_CBs.push_back(std::move(shaderResourceAttribs));
+				groups[CB].push_back(std::move(resource));
 				break;
 			case D3D_SIT_TEXTURE:
-				if (bindingDesc.Dimension == D3D_SRV_DIMENSION_BUFFER)
-				{
-					m_BufferSRVs.push_back(std::move(shaderResourceAttribs));
-				}
-				else
-				{
-					m_TextureSRVs.push_back(std::move(shaderResourceAttribs));
-				}
+				groups[bindingDesc.Dimension == D3D_SRV_DIMENSION_BUFFER ? BufSRV : TexSRV].push_back(std::move(resource));
 				break;
 			case D3D_SIT_UAV_RWTYPED:
-				if (bindingDesc.Dimension == D3D_SRV_DIMENSION_BUFFER)
-				{
-					m_BufferUAVs.push_back(std::move(shaderResourceAttribs));
-				}
-				else
-				{
-					m_TextureUAVs.push_back(std::move(shaderResourceAttribs));
-				}
+				groups[bindingDesc.Dimension == D3D_SRV_DIMENSION_BUFFER ? BufUAV : TexUAV].push_back(std::move(resource));
 				break;
 			case D3D_SIT_STRUCTURED:
 			case D3D_SIT_BYTEADDRESS:
-				m_BufferSRVs.push_back(std::move(shaderResourceAttribs));
+				groups[BufSRV].push_back(std::move(resource));
 				break;
 			case D3D_SIT_UAV_RWSTRUCTURED:
 			case D3D_SIT_UAV_RWBYTEADDRESS:
-				m_BufferUAVs.push_back(std::move(shaderResourceAttribs));
+				groups[BufUAV].push_back(std::move(resource));
 				break;
 			default:
 				LOG_ERROR("Not Supported Resource Type.");
@@ -119,37 +153,159 @@ namespace RHI
 		}
 
 		// TODO TEXTURE SAMPLER 
+
+		m_TexSRVOffset = static_cast<UINT16>(groups[CB].size());
+		m_TexUAVOffset = static_cast<UINT16>(m_TexSRVOffset + groups[TexSRV].size());
+		m_BufSRVOffset = static_cast<UINT16>(m_TexUAVOffset + groups[TexUAV].size());
+		m_BufUAVOffset = static_cast<UINT16>(m_BufSRVOffset + groups[BufSRV].size());
+		m_NumResources = static_cast<UINT16>(m_BufUAVOffset + groups[BufUAV].size());
+
+		size_t namePoolSize = 0;
+		for (const auto& group : groups)
+		{
+			for (const auto& resource : group)
+				namePoolSize += resource.Name.size() + 1;
+		}
+
+		AllocateMemory(namePoolSize);
+
+		auto* pResources = reinterpret_cast<ShaderResourceAttribs*>(m_MemoryBuffer.get());
+		char* pName = GetNamePool();
+		for (const auto& group : groups)
+		{
+			for (const auto& resource : group)
+			{
+				memcpy(pName, resource.Name.c_str(), resource.Name.size() + 1);
+				new (pResources++) ShaderResourceAttribs(pName, ShaderVariableTable::ComputeNameHash(pName), resource.BindPoint, resource.BindCount,
+					resource.Type, resource.Dimension);
+				pName += resource.Name.size() + 1;
+			}
+		}
+	}
+
+	void ShaderResource::AllocateMemory(size_t namePoolSize)
+	{
+		m_NamePoolSize = namePoolSize;
+		m_MemoryBuffer.reset(new UINT8[m_NumResources * sizeof(ShaderResourceAttribs) + namePoolSize]);
+	}
+
+	std::vector<UINT8> ShaderResource::CreateSnapshot() const
+	{
+		SnapshotHeader header = {};
+		header.Magic = SnapshotMagic;
+		header.Version = SnapshotVersion;
+		header.ShaderType = m_ShaderType;
+		header.ShaderVersion = m_ShaderVersion;
+		header.TexSRVOffset = m_TexSRVOffset;
+		header.TexUAVOffset = m_TexUAVOffset;
+		header.BufSRVOffset = m_BufSRVOffset;
+		header.BufUAVOffset = m_BufUAVOffset;
+		header.NumResources = m_NumResources;
+		header.NamePoolSize = static_cast<UINT32>(m_NamePoolSize);
+
+		std::vector<UINT8> snapshot(sizeof(SnapshotHeader) + m_NumResources * sizeof(SnapshotResource) + m_NamePoolSize);
+		memcpy(snapshot.data(), &header, sizeof(SnapshotHeader));
+
+		const char* pNamePool = GetNamePool();
+		UINT8* pRecord = snapshot.data() + sizeof(SnapshotHeader);
+		for (UINT32 i = 0; i < m_NumResources; ++i, pRecord += sizeof(SnapshotResource))
+		{
+			const ShaderResourceAttribs& attribs = GetResource(i);
+
+			SnapshotResource record = {};
+			record.NameHash = attribs.NameHash;
+			record.NameOffset = static_cast<UINT32>(attribs.Name - pNamePool);
+			record.BindPoint = attribs.BindPoint;
+			record.BindCount = attribs.BindCount;
+			record.PackedType = static_cast<UINT32>(attribs.GetInputType()) | (static_cast<UINT32>(attribs.GetSRVDimension()) << ShaderResourceAttribs::ShaderInputTypeBits);
+			memcpy(pRecord, &record, sizeof(SnapshotResource));
+		}
+
+		if (m_NamePoolSize > 0)
+			memcpy(pRecord, pNamePool, m_NamePoolSize);
+		return snapshot;
+	}
+
+	std::unique_ptr<const ShaderResource> ShaderResource::CreateFromSnapshot(const void* pData, size_t size)
+	{
+		SnapshotHeader header;
+		if (pData == nullptr || size < sizeof(SnapshotHeader))
+			return nullptr;
+		memcpy(&header, pData, sizeof(SnapshotHeader));
+
+		if (header.Magic != SnapshotMagic || header.Version != SnapshotVersion)
+			return nullptr;
+		if (header.TexSRVOffset > header.TexUAVOffset || header.TexUAVOffset > header.BufSRVOffset ||
+			header.BufSRVOffset > header.BufUAVOffset || header.BufUAVOffset > header.NumResources)
+			return nullptr;
+		if (size != sizeof(SnapshotHeader) + header.NumResources * sizeof(SnapshotResource) + header.NamePoolSize)
+			return nullptr;
+
+		const UINT8* pRecord = static_cast<const UINT8*>(pData) + sizeof(SnapshotHeader);
+		const UINT8* pSnapshotNames = pRecord + header.NumResources * sizeof(SnapshotResource);
+		// Every name ends in the pool
+		if (header.NamePoolSize > 0 && pSnapshotNames[header.NamePoolSize - 1] != '\0')
+			return nullptr;
+
+		std::unique_ptr<ShaderResource> shaderResource(new ShaderResource(static_cast<SHADER_TYPE>(header.ShaderType)));
+		shaderResource->m_ShaderVersion = header.ShaderVersion;
+		shaderResource->m_TexSRVOffset = header.TexSRVOffset;
+		shaderResource->m_TexUAVOffset = header.TexUAVOffset;
+		shaderResource->m_BufSRVOffset = header.BufSRVOffset;
+		shaderResource->m_BufUAVOffset = header.BufUAVOffset;
+		shaderResource->m_NumResources = header.NumResources;
+		shaderResource->AllocateMemory(header.NamePoolSize);
+
+		char* pNamePool = shaderResource->GetNamePool();
+		if (header.NamePoolSize > 0)
+			memcpy(pNamePool, pSnapshotNames, header.NamePoolSize);
+
+		auto* pResources = reinterpret_cast<ShaderResourceAttribs*>(shaderResource->m_MemoryBuffer.get());
+		for (UINT32 i = 0; i < header.NumResources; ++i, pRecord += sizeof(SnapshotResource))
+		{
+			SnapshotResource record;
+			memcpy(&record, pRecord, sizeof(SnapshotResource));
+			if (record.NameOffset >= header.NamePoolSize)
+				return nullptr;
+
+			auto inputType = static_cast<D3D_SHADER_INPUT_TYPE>(record.PackedType & ((1u << ShaderResourceAttribs::ShaderInputTypeBits) - 1));
+			auto srvDimension = static_cast<D3D_SRV_DIMENSION>(record.PackedType >> ShaderResourceAttribs::ShaderInputTypeBits);
+			new (pResources + i) ShaderResourceAttribs(pNamePool + record.NameOffset, record.NameHash, record.BindPoint, record.BindCount,
+				inputType, srvDimension);
+		}
+
+		return shaderResource;
 	}
 
 	size_t ShaderResource::GetHash() const
 	{
 		size_t hash = ComputeHash(GetCBNum(), GetTexSRVNum(), GetTexUAVNum(), GetBufSRVNum(), GetBufUAVNum());
 
-		for (UINT32 i = 0; i < m_CBs.size(); ++i)
+		for (UINT32 i = 0; i < GetCBNum(); ++i)
 		{
 			const auto& cb = GetCB(i);
 			HashCombine(hash, cb);
 		}
 
-		for (UINT32 i = 0; i < m_TextureSRVs.size(); ++i)
+		for (UINT32 i = 0; i < GetTexSRVNum(); ++i)
 		{
 			const auto& texSRV = GetTexSRV(i);
 			HashCombine(hash, texSRV);
 		}
 
-		for (UINT32 i = 0; i < m_TextureUAVs.size(); ++i)
+		for (UINT32 i = 0; i < GetTexUAVNum(); ++i)
 		{
 			const auto& texUAV = GetTexUAV(i);
 			HashCombine(hash, texUAV);
 		}
 
-		for (UINT32 i = 0; i < m_BufferSRVs.size(); ++i)
+		for (UINT32 i = 0; i < GetBufSRVNum(); ++i)
 		{
 			const auto& bufSRV = GetBufSRV(i);
 			HashCombine(hash, bufSRV);
 		}
 
-		for (UINT32 i = 0; i < m_BufferUAVs.size(); ++i)
+		for (UINT32 i = 0; i < GetBufUAVNum(); ++i)
 		{
 			const auto& bufUAV = GetBufUAV(i);
 			HashCombine(hash, bufUAV);
@@ -201,8 +357,8 @@ namespace RHI
 	}
 
 	SHADER_RESOURCE_VARIABLE_TYPE ShaderResource::FindVariableType(const ShaderResourceAttribs& ResourceAttribs,
-		const ShaderVariableConfig& shaderVariableConfig) const
+		const ShaderVariableTable& shaderVariableTable) const
 	{
-		return GetShaderVariableType(m_ShaderType, ResourceAttribs.Name, shaderVariableConfig);
+		return GetShaderVariableType(m_ShaderType, ResourceAttribs.Name, ResourceAttribs.NameHash, shaderVariableTable);
 	}
 }
\ No newline at end of file
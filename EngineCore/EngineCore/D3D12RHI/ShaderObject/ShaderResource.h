@@ -5,21 +5,28 @@
 // ShaderResources class uses continuous chunk of memory to store all resources, as follows:
 //
 //
-//       m_MemoryBuffer            m_TexSRVOffset                      m_TexUAVOffset                      m_BufSRVOffset                      m_BufUAVOffset                      m_SamplersOffset                            m_MemorySize
-//        |                         |                                   |                                   |                                   |                                   |                           |                  |
-//        |  CB[0]  ...  CB[Ncb-1]  |  TexSRV[0]  ...  TexSRV[Ntsrv-1]  |  TexUAV[0]  ...  TexUAV[Ntuav-1]  |  BufSRV[0]  ...  BufSRV[Nbsrv-1]  |  BufUAV[0]  ...  BufUAV[Nbuav-1]  |  Sam[0]  ...  Sam[Nsam-1] |  Resource Names  |
+//       m_MemoryBuffer            m_TexSRVOffset                      m_TexUAVOffset                      m_BufSRVOffset                      m_BufUAVOffset                      m_NumResources
+//        |                         |                                   |                                   |                                   |                                   |                  |
+//        |  CB[0]  ...  CB[Ncb-1]  |  TexSRV[0]  ...  TexSRV[Ntsrv-1]  |  TexUAV[0]  ...  TexUAV[Ntuav-1]  |  BufSRV[0]  ...  BufSRV[Nbsrv-1]  |  BufUAV[0]  ...  BufUAV[Nbuav-1]  |  Resource Names  |
+//
+// The reflection snapshot (CreateSnapshot) has the same layout after a header, with the names of the resources as offsets
+// in the name pool next to their hashes. Loading it is one allocation, one copy of the names and one pass over the resources,
+// D3DReflect is skipped and the names are not hashed again.
+//
+//        | SnapshotHeader |  SnapshotResource[0]  ...  SnapshotResource[m_NumResources-1]  |  Resource Names  |
 //
 
 namespace RHI
 {
 	struct ShaderDesc;
-	struct ShaderVariableConfig;
+	class ShaderVariableTable;
 
 	// Indicate the resource used in Shaders
 	struct ShaderResourceAttribs
 	{
 		// Texture2D g_Tex, and Texture2D g_Tex[4],the name will be deduced as"g_Tex". cbuffer cbBuff0 : register(b5), the name "cbBuffer0"
-		const std::string Name; // Name is the name of the resource.
+		const char* const Name; // Name is the name of the resource, stored in the name pool of the ShaderResource.
+		const UINT64 NameHash; // ShaderVariableTable::ComputeNameHash(Name), the variable type is found without hashing the name again
 		const UINT16 BindPoint; // The register number of variable such as CBuffer. cbBuffer0 : register(b5), BindPoint = 5
 		const UINT16 BindCount; // Number of the binding slots taken by resource (array res= array size, non-array res = 1)
 
@@ -49,16 +56,18 @@ namespace RHI
 		static constexpr const UINT16 MaxBindPoint = InvalidBindPoint - 1;
 		static constexpr const UINT16 MaxBindCount = std::numeric_limits<UINT16>::max();
 
-		ShaderResourceAttribs(const std::string& name,
+		ShaderResourceAttribs(const char* name,
+			UINT64 nameHash,
 			UINT bindPoint,
 			UINT bindCount,
 			D3D_SHADER_INPUT_TYPE inputType,
 			D3D_SRV_DIMENSION srvDimension) noexcept :
 			Name{ name },
-			BindPoint{ static_cast<decltype(BindPoint)>(bindPoint) },
-			BindCount{ static_cast<decltype(BindCount)>(bindCount) },
-			InputType{ static_cast<decltype(InputType)>(inputType) },
-			SRVDimension{ static_cast<decltype(SRVDimension)>(srvDimension) }
+			NameHash{ nameHash },
+			BindPoint{ static_cast<UINT16>(bindPoint) },
+			BindCount{ static_cast<UINT16>(bindCount) },
+			InputType{ static_cast<UINT32>(inputType) },
+			SRVDimension{ static_cast<UINT32>(srvDimension) }
 		{
 
 		}
@@ -95,6 +104,8 @@ namespace RHI
 		}
 	};
 
+	static_assert(std::is_trivially_destructible<ShaderResourceAttribs>::value, "The attributes are stored in the raw memory of ShaderResource");
+
 	// Describe all resources used by a Shader, implemented using DX Shader Reflection system (ID3D12ShaderReflection).
 	// The class allocates continueos chunck of memory to store all resource in follwing order : 
 	// 1 - CBV, 2 - Texture SRVs, 3 - Texture UAVs, 4 - Buffer SRVs, 5 - Buffer UAVs, 6 - Sampler
@@ -106,22 +117,27 @@ namespace RHI
 	public:
 		ShaderResource(ID3DBlob* pShaderBytecode, const ShaderDesc& shaderDesc);
 
+		// The snapshot of the resources, stored next to the bytecode in the shader cache
+		std::vector<UINT8> CreateSnapshot() const;
+		// nullptr if the bytes are not a snapshot of this version
+		static std::unique_ptr<const ShaderResource> CreateFromSnapshot(const void* pData, size_t size);
+
 		ShaderResource(const ShaderResource&) = delete;
 		ShaderResource(ShaderResource&&) = delete;
 		ShaderResource& operator = (const ShaderResource&) = delete;
 		ShaderResource& operator = (ShaderResource&&) = delete;
 
-		UINT32 GetCBNum() const noexcept { return (UINT32)m_CBs.size(); }
-		UINT32 GetTexSRVNum() const noexcept { return (UINT32)m_TextureSRVs.size(); }
-		UINT32 GetTexUAVNum() const noexcept { return (UINT32)m_TextureUAVs.size(); }
-		UINT32 GetBufSRVNum() const noexcept { return (UINT32)m_BufferSRVs.size(); }
-		UINT32 GetBufUAVNum() const noexcept { return (UINT32)m_BufferUAVs.size(); }
+		UINT32 GetCBNum() const noexcept { return m_TexSRVOffset; }
+		UINT32 GetTexSRVNum() const noexcept { return m_TexUAVOffset - m_TexSRVOffset; }
+		UINT32 GetTexUAVNum() const noexcept { return m_BufSRVOffset - m_TexUAVOffset; }
+		UINT32 GetBufSRVNum() const noexcept { return m_BufUAVOffset - m_BufSRVOffset; }
+		UINT32 GetBufUAVNum() const noexcept { return m_NumResources - m_BufUAVOffset; }
 
-		const ShaderResourceAttribs& GetCB(UINT32 n) const noexcept { assert(n >= 0 && n < m_CBs.size()); return *m_CBs[n].get(); }
-		const ShaderResourceAttribs& GetTexSRV(UINT32 n) const noexcept { assert(n >= 0 && n < m_TextureSRVs.size()); return *m_TextureSRVs[n].get(); }
-		const ShaderResourceAttribs& GetTexUAV(UINT32 n) const noexcept { assert(n >= 0 && n < m_TextureUAVs.size()); return *m_TextureUAVs[n].get(); }
-		const ShaderResourceAttribs& GetBufSRV(UINT32 n) const noexcept { assert(n >= 0 && n < m_BufferSRVs.size()); return *m_BufferSRVs[n].get(); }
-		const ShaderResourceAttribs& GetBufUAV(UINT32 n) const noexcept { assert(n >= 0 && n < m_BufferUAVs.size()); return *m_BufferUAVs[n].get(); }
+		const ShaderResourceAttribs& GetCB(UINT32 n) const noexcept { assert(n < GetCBNum()); return GetResource(n); }
+		const ShaderResourceAttribs& GetTexSRV(UINT32 n) const noexcept { assert(n < GetTexSRVNum()); return GetResource(m_TexSRVOffset + n); }
+		const ShaderResourceAttribs& GetTexUAV(UINT32 n) const noexcept { assert(n < GetTexUAVNum()); return GetResource(m_TexUAVOffset + n); }
+		const ShaderResourceAttribs& GetBufSRV(UINT32 n) const noexcept { assert(n < GetBufSRVNum()); return GetResource(m_BufSRVOffset + n); }
+		const ShaderResourceAttribs& GetBufUAV(UINT32 n) const noexcept { assert(n < GetBufUAVNum()); return GetResource(m_BufUAVOffset + n); }
 
 		SHADER_TYPE GetShaderType() const noexcept { return m_ShaderType; }
 
@@ -136,19 +152,19 @@ namespace RHI
 				THandleBufSRV HandleBufSRV,
 				THandleBufUAV HandleBufUAV) const
 		{
-			for (UINT32 i = 0; i < m_CBs.size(); ++i)
+			for (UINT32 i = 0; i < GetCBNum(); ++i)
 				HandleCB(GetCB(i), i);
 
-			for (UINT32 i = 0; i < m_TextureSRVs.size(); ++i)
+			for (UINT32 i = 0; i < GetTexSRVNum(); ++i)
 				HandleTexSRV(GetTexSRV(i), i);
 
-			for (UINT32 i = 0; i < m_TextureUAVs.size(); ++i)
+			for (UINT32 i = 0; i < GetTexUAVNum(); ++i)
 				HandleTexUAV(GetTexUAV(i), i);
 
-			for (UINT32 i = 0; i < m_BufferSRVs.size(); ++i)
+			for (UINT32 i = 0; i < GetBufSRVNum(); ++i)
 				HandleBufSRV(GetBufSRV(i), i);
 
-			for (UINT32 i = 0; i < m_BufferUAVs.size(); ++i)
+			for (UINT32 i = 0; i < GetBufUAVNum(); ++i)
 				HandleBufUAV(GetBufUAV(i), i);
 		}
 
@@ -156,9 +172,9 @@ namespace RHI
 		const std::string& GetShaderName() const { return m_ShaderName; }
 
 		// Find the Variable Type (Static, Mutable, Dynamic) corresponding to ShaderResource 
-		// from the ShaderVariableConfig of the PSO configured in the upper layer
+		// from the ShaderVariableTable of the PSO configured in the upper layer
 		SHADER_RESOURCE_VARIABLE_TYPE FindVariableType(const ShaderResourceAttribs& ResourceAttribs,
-			const ShaderVariableConfig& shaderVariableConfig) const;
+			const ShaderVariableTable& shaderVariableTable) const;
 
 		size_t GetHash() const;
 
@@ -169,12 +185,31 @@ namespace RHI
 		}
 
 	private:
+		explicit ShaderResource(SHADER_TYPE shaderType);
+
+		// Allocates the resources and the name pool in one chunk, the offsets must be set
+		void AllocateMemory(size_t namePoolSize);
+
+		const ShaderResourceAttribs& GetResource(UINT32 n) const noexcept
+		{
+			return reinterpret_cast<const ShaderResourceAttribs*>(m_MemoryBuffer.get())[n];
+		}
+
+		char* GetNamePool() const noexcept
+		{
+			return reinterpret_cast<char*>(m_MemoryBuffer.get() + m_NumResources * sizeof(ShaderResourceAttribs));
+		}
+
+		// The attributes are trivially destructible, the memory is released without calling their destructors
+		std::unique_ptr<UINT8[]> m_MemoryBuffer;
+		size_t m_NamePoolSize = 0;
+
 		// The purpose of grouping here is to convert the different types in D3D into these types: CBV, TexSRV, TexUAV, BufferSRV, BufferUAV
-		std::vector<std::unique_ptr<ShaderResourceAttribs>> m_CBs;
-		std::vector<std::unique_ptr<ShaderResourceAttribs>> m_TextureSRVs;
-		std::vector<std::unique_ptr<ShaderResourceAttribs>> m_TextureUAVs;
-		std::vector<std::unique_ptr<ShaderResourceAttribs>> m_BufferSRVs;
-		std::vector<std::unique_ptr<ShaderResourceAttribs>> m_BufferUAVs;
+		UINT16 m_TexSRVOffset = 0;
+		UINT16 m_TexUAVOffset = 0;
+		UINT16 m_BufSRVOffset = 0;
+		UINT16 m_BufUAVOffset = 0;
+		UINT16 m_NumResources = 0;
 
 		// Shader Type (Vertex, Pixel...)
 		const SHADER_TYPE m_ShaderType;
@@ -1,6 +1,6 @@
 ﻿#include "../../pch.h"
 #include "ShaderResourceBindingUtility.h"
-#include "../PipelineState.h"
+#include "ShaderVariableTable.h"
 
 namespace RHI
 {
@@ -47,7 +47,7 @@ namespace RHI
 		}
 	}
 
-	INT32 GetShaderTypePipelineIndex(SHADER_TYPE ShaderType, PIPELINE_TYPE PipelineType)
+	INT32 GetShaderTypePipelineIndex(SHADER_TYPE ShaderType, [[maybe_unused]] PIPELINE_TYPE PipelineType)
 	{
 		assert(IsConsistentShaderType(ShaderType, PipelineType) && "Shader Type and Pipeline Type is Not Compatible");
 		assert(IsPowerOfTwoD(UINT32(ShaderType)) && "Only single shader stage should be provided");
@@ -83,21 +83,11 @@ namespace RHI
 	}
 
 	SHADER_RESOURCE_VARIABLE_TYPE GetShaderVariableType(SHADER_TYPE shaderType,
-		const std::string& name,
-		const ShaderVariableConfig& shaderVariableConfig)
+		const char* name,
+		UINT64 nameHash,
+		const ShaderVariableTable& shaderVariableTable)
 	{
-		for (UINT32 i = 0; i < shaderVariableConfig.Variables.size(); ++i)
-		{
-			const auto& curVarDesc = shaderVariableConfig.Variables[i];
-
-			if (((curVarDesc.ShaderType & shaderType) != 0) && (name == curVarDesc.Name))
-			{
-				return curVarDesc.Type;
-			}
-
-		}
-
-		return shaderVariableConfig.DefaultVariableType;
+		return shaderVariableTable.Find(shaderType, name, nameHash);
 	}
 
 	D3D12_DESCRIPTOR_RANGE_TYPE GetDescriptorRangeType(BindingResourceType cachedResType)
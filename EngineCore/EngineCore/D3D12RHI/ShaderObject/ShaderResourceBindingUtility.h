@@ -12,10 +12,12 @@ namespace RHI
     // Use Shader Type as an index, which will be used when constructing Root Table
     INT32 GetShaderTypePipelineIndex(SHADER_TYPE ShaderType, PIPELINE_TYPE PipelineType);
 
-    // Find the Variable Type (Static, Mutable, Dynamic) of a ShaderResource from ShaderVariableConfig
+    // Find the Variable Type (Static, Mutable, Dynamic) of a ShaderResource from the ShaderVariableTable of the PSO,
+    // nameHash is ShaderVariableTable::ComputeNameHash(name)
     SHADER_RESOURCE_VARIABLE_TYPE GetShaderVariableType(SHADER_TYPE shaderType,
-        const std::string& name,
-        const struct ShaderVariableConfig& shaderVariableConfig);
+        const char* name,
+        UINT64 nameHash,
+        const class ShaderVariableTable& shaderVariableTable);
 
     // CachedResourceType to D3D12_DESCRIPTOR_RANGE_TYPE
     D3D12_DESCRIPTOR_RANGE_TYPE GetDescriptorRangeType(BindingResourceType cachedResType);
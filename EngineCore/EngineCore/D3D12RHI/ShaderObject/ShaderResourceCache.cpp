@@ -100,7 +100,10 @@ namespace RHI
         for (const auto& [rootIndex, rootDescriptor] : m_RootDescriptors)
         {
             if (rootDescriptor.ConstantBuffer == nullptr)
+            {
                 LOG_ERROR("No Resource Binding");
+                continue;
+            }
 
             GpuDynamicBuffer* dynamicBuffer = dynamic_cast<GpuDynamicBuffer*>(rootDescriptor.ConstantBuffer.get());
 
@@ -110,33 +113,76 @@ namespace RHI
 
         if (m_NumDynamicDescriptor > 0)
         {
-           // Assign dynamic Descriptor Allocation
-            DescriptorHeapAllocation dynamicAllocation = cmdContext.AllocateDynamicGPUVisibleDescriptor(m_NumDynamicDescriptor);
-            UINT32 dynamicTableOffset = 0;
+            RenderDevice& renderDevice = RenderDevice::GetSingleton();
+            DescriptorTableCache& tableCache = cmdContext.GetDynamicDescriptorTableCache();
+            tableCache.Validate(cmdContext.GetDynamicDescriptorGeneration(),
+                renderDevice.GetCPUDescriptorHeap(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV));
+
+            m_CopySrcHandles.clear();
+            m_CopyDstHandles.clear();
+            m_CopyDstSizes.clear();
 
             for (const auto& [rootIndex, rootTable] : m_RootTables)
             {
                 if (rootTable.VariableType == SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC)
                 {
-                    for (INT32 i = 0; i < rootTable.Descriptors.size(); ++i)
+                    UINT32 tableSize = static_cast<UINT32>(rootTable.Descriptors.size());
+                    size_t firstSrcHandle = m_CopySrcHandles.size();
+
+                    bool allBound = true;
+                    for (UINT32 i = 0; i < tableSize && allBound; ++i)
+                    {
+                        allBound = rootTable.Descriptors[i] != nullptr;
+                        if (allBound)
+                            m_CopySrcHandles.push_back(rootTable.Descriptors[i]->GetCpuHandle());
+                    }
+
+                    // The table is not bound, the draw reads whatever the root parameter held before
+                    if (!allBound)
                     {
-                        if (rootTable.Descriptors[i] == nullptr)
-                            LOG_ERROR("No Resource Binding");
+                        LOG_ERROR("No Resource Binding");
+                        m_CopySrcHandles.resize(firstSrcHandle);
+                        continue;
                     }
 
-                    // Bind first and then Copy, because you want to bind the starting position of this Table, 
-                     // you have to use the dynamicTableOffset before Copy
-                    cmdContext.GetGraphicsContext().SetDescriptorTable(rootIndex, dynamicAllocation.GetGpuHandle(dynamicTableOffset));
+                    const D3D12_CPU_DESCRIPTOR_HANDLE* tableHandles = &m_CopySrcHandles[firstSrcHandle];
+                    size_t tableHash = DescriptorTableCache::ComputeTableHash(tableHandles, tableSize);
 
-                    // Copy the CPU Descriptor of the resource to the GPU Descriptor Heap
-                    for (UINT32 i = 0; i < rootTable.Descriptors.size(); i++)
+                    D3D12_GPU_DESCRIPTOR_HANDLE tableGPUHandle;
+                    if (tableCache.Find(tableHash, tableHandles, tableSize, tableGPUHandle))
                     {
-                        m_D3D12Device->CopyDescriptorsSimple(1, dynamicAllocation.GetCpuHandle(dynamicTableOffset),
-                            rootTable.Descriptors[i]->GetCpuHandle(), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-                        dynamicTableOffset++;
+                        // Same descriptors already uploaded in this frame, nothing to copy
+                        m_CopySrcHandles.resize(firstSrcHandle);
                     }
+                    else
+                    {
+                        // Assign dynamic Descriptor Allocation, the copy is done after the loop together with the other tables
+                        DescriptorHeapAllocation dynamicAllocation = cmdContext.AllocateDynamicGPUVisibleDescriptor(tableSize);
+                        if (dynamicAllocation.IsNull())
+                        {
+                            m_CopySrcHandles.resize(firstSrcHandle);
+                            continue;
+                        }
+
+                        tableGPUHandle = dynamicAllocation.GetGpuHandle();
+                        m_CopyDstHandles.push_back(dynamicAllocation.GetCpuHandle());
+                        m_CopyDstSizes.push_back(tableSize);
+
+                        tableCache.Insert(tableHash, tableHandles, tableSize, tableGPUHandle);
+                    }
+
+                    // Binding before the copy is fine, the copy is done on the CPU timeline before the command list is executed
+                    cmdContext.GetGraphicsContext().SetDescriptorTable(rootIndex, tableGPUHandle);
                 }
             }
+
+            // Copy the CPU Descriptor of the resources to the GPU Descriptor Heap, one source range per descriptor
+            if (!m_CopyDstHandles.empty())
+            {
+                m_D3D12Device->CopyDescriptors(static_cast<UINT>(m_CopyDstHandles.size()), m_CopyDstHandles.data(), m_CopyDstSizes.data(),
+                    static_cast<UINT>(m_CopySrcHandles.size()), m_CopySrcHandles.data(), nullptr, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+                tableCache.AddCopiedDescriptors(static_cast<UINT32>(m_CopySrcHandles.size()));
+            }
         }
     }
 
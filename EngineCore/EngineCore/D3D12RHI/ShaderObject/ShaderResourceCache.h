@@ -112,6 +112,8 @@ namespace RHI
          * Dynamic Resource is not equal to Dynamic Shader Variable, Dynamic Resource represents the frequency
          * at which the resource itself is modified, and Dynamic Shader Variable represents the frequency at which resource binding is switched
          * For example, the Shader Variable type of Transform's Constant Buffer is Static, but this Buffer is Dynamic Buffer
+         * Dynamic tables whose descriptors were already uploaded in the current frame (see DescriptorTableCache) are not copied again,
+         * the others are copied with a single CopyDescriptors call
          */
         void CommitDynamic(CommandContext& cmdContext);
 
@@ -125,5 +127,10 @@ namespace RHI
         std::unordered_map<UINT32/*RootIndex*/, RootTable> m_RootTables;
 
         ID3D12Device* m_D3D12Device;
+
+        // Scratch arrays of CommitDynamic, kept to avoid allocations on every draw
+        std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> m_CopySrcHandles;
+        std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> m_CopyDstHandles;
+        std::vector<UINT> m_CopyDstSizes;
     };
 }
\ No newline at end of file
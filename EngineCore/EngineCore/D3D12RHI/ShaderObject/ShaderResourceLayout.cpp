@@ -1,52 +1,74 @@
 #include "../../pch.h"
 #include "ShaderResourceLayout.h"
-#include "ShaderResourceBindingUtility.h"
-#include "../RootSignature.h"
-#include "../RenderDevice.h"
 
 namespace RHI
 {
 	ShaderResourceLayout::ShaderResourceLayout(ID3D12Device* pd3d12Device,
-		PIPELINE_TYPE pipelineType,
-		const ShaderVariableConfig& shaderVariableConfig,
+		PIPELINE_TYPE /*pipelineType*/,
+		const ShaderVariableTable& shaderVariableTable,
 		const ShaderResource* shaderResource,
-		RootSignature* rootSignature) :
+		[[maybe_unused]] RootSignature* rootSignature) :
 		m_D3D12Device(pd3d12Device)
 	{
-		// Determine RootIndex and OffsetFromTableStart through RootSignature for each resource in ShaderResource, and then store it
-		auto AddResource = [&](const ShaderResourceAttribs& Attribs, BindingResourceType ResType, SHADER_RESOURCE_VARIABLE_TYPE VarType)
+		// The variable types are found once, the resources are counted before the memory is allocated
+		struct PendingResource
 		{
-			assert(rootSignature != nullptr);
+			const ShaderResourceAttribs* Attribs;
+			BindingResourceType ResType;
+			SHADER_RESOURCE_VARIABLE_TYPE VarType;
+		};
+		std::vector<PendingResource> pendingResources;
+		pendingResources.reserve(shaderResource->GetCBNum() + shaderResource->GetTexSRVNum() + shaderResource->GetTexUAVNum() +
+			shaderResource->GetBufSRVNum() + shaderResource->GetBufUAVNum());
 
-			// TODO
+		auto AddResource = [&](const ShaderResourceAttribs& Attribs, BindingResourceType ResType, SHADER_RESOURCE_VARIABLE_TYPE VarType)
+		{
+			pendingResources.push_back({ &Attribs, ResType, VarType });
+			++m_SrvCbvUavOffsets[VarType + 1];
 		};
 
 		shaderResource->ProcessResources(
 			[&](const ShaderResourceAttribs& CB, UINT32)
 			{
-				auto VarType = shaderResource->FindVariableType(CB, shaderVariableConfig);
+				auto VarType = shaderResource->FindVariableType(CB, shaderVariableTable);
 				AddResource(CB, BindingResourceType::CBV, VarType);
 			},
 			[&](const ShaderResourceAttribs& TexSRV, UINT32)
 			{
-				auto VarType = shaderResource->FindVariableType(TexSRV, shaderVariableConfig);
+				auto VarType = shaderResource->FindVariableType(TexSRV, shaderVariableTable);
 				AddResource(TexSRV, BindingResourceType::TexSRV, VarType);
 			},
 				[&](const ShaderResourceAttribs& TexUAV, UINT32)
 			{
-				auto VarType = shaderResource->FindVariableType(TexUAV, shaderVariableConfig);
+				auto VarType = shaderResource->FindVariableType(TexUAV, shaderVariableTable);
 				AddResource(TexUAV, BindingResourceType::TexUAV, VarType);
 			},
 				[&](const ShaderResourceAttribs& BufSRV, UINT32)
 			{
-				auto VarType = shaderResource->FindVariableType(BufSRV, shaderVariableConfig);
+				auto VarType = shaderResource->FindVariableType(BufSRV, shaderVariableTable);
 				AddResource(BufSRV, BindingResourceType::BufSRV, VarType);
 			},
 				[&](const ShaderResourceAttribs& BufUAV, UINT32)
 			{
-				auto VarType = shaderResource->FindVariableType(BufUAV, shaderVariableConfig);
+				auto VarType = shaderResource->FindVariableType(BufUAV, shaderVariableTable);
 				AddResource(BufUAV, BindingResourceType::BufUAV, VarType);
 			}
 			);
+
+		for (UINT32 i = 0; i < SHADER_RESOURCE_VARIABLE_TYPE_NUM_TYPES; ++i)
+			m_SrvCbvUavOffsets[i + 1] += m_SrvCbvUavOffsets[i];
+
+		m_ResourceBuffer.reset(new UINT8[pendingResources.size() * sizeof(Resource)]);
+
+		// The root signature does not allocate the slots of the resources yet, they are created without one (see Resource::HasRootSlot)
+		assert(rootSignature != nullptr);
+		auto* pResources = reinterpret_cast<Resource*>(m_ResourceBuffer.get());
+		std::array<UINT32, SHADER_RESOURCE_VARIABLE_TYPE_NUM_TYPES> nextResource;
+		std::copy(m_SrvCbvUavOffsets.begin(), m_SrvCbvUavOffsets.end() - 1, nextResource.begin());
+		for (const PendingResource& resource : pendingResources)
+		{
+			new (pResources + nextResource[resource.VarType]++) Resource(*resource.Attribs, resource.VarType, resource.ResType,
+				Resource::InvalidRootIndex, Resource::InvalidOffset);
+		}
 	}
 }
\ No newline at end of file
@@ -0,0 +1,83 @@
+#include "../../pch.h"
+#include "ShaderVariableTable.h"
+
+namespace RHI
+{
+	ShaderVariableTable::ShaderVariableTable(const ShaderVariableConfig& shaderVariableConfig) :
+		m_DefaultVariableType{ shaderVariableConfig.DefaultVariableType }
+	{
+		const auto& variables = shaderVariableConfig.Variables;
+		if (variables.empty())
+			return;
+
+		UINT32 numSlots = 4;
+		while (numSlots < variables.size() * 2)
+			numSlots *= 2;
+		m_Slots.resize(numSlots);
+
+		for (const ShaderResourceVariableDesc& variable : variables)
+		{
+			UINT64 nameHash = ComputeNameHash(variable.Name.c_str());
+
+			UINT32 slotIndex = static_cast<UINT32>(nameHash) & (numSlots - 1);
+			while (m_Slots[slotIndex].NameOffset != EmptySlot && m_Slots[slotIndex].NameHash != nameHash)
+				slotIndex = (slotIndex + 1) & (numSlots - 1);
+
+			Slot& slot = m_Slots[slotIndex];
+			assert((slot.NameOffset == EmptySlot || variable.Name == &m_NamePool[slot.NameOffset]) && "Two variable names have the same hash");
+			if (slot.NameOffset == EmptySlot)
+			{
+				slot.NameHash = nameHash;
+				slot.NameOffset = static_cast<UINT32>(m_NamePool.size());
+				slot.StageTypes.fill(NoVariableType);
+				m_NamePool.insert(m_NamePool.end(), variable.Name.c_str(), variable.Name.c_str() + variable.Name.size() + 1);
+				++m_NumNames;
+			}
+
+			// A variable may list several stages, the stages already set by a previous variable are kept
+			for (UINT32 stage = 0; stage < NumShaderStages; ++stage)
+			{
+				if ((variable.ShaderType & (1 << stage)) != 0 && slot.StageTypes[stage] == NoVariableType)
+					slot.StageTypes[stage] = static_cast<UINT8>(variable.Type);
+			}
+		}
+	}
+
+	SHADER_RESOURCE_VARIABLE_TYPE ShaderVariableTable::Find(SHADER_TYPE shaderType, [[maybe_unused]] const char* name, UINT64 nameHash) const
+	{
+		assert(nameHash == ComputeNameHash(name));
+		if (m_Slots.empty())
+			return m_DefaultVariableType;
+
+		UINT32 stage = GetShaderStageIndex(shaderType);
+		UINT32 numSlots = static_cast<UINT32>(m_Slots.size());
+		for (UINT32 slotIndex = static_cast<UINT32>(nameHash) & (numSlots - 1); m_Slots[slotIndex].NameOffset != EmptySlot;
+			slotIndex = (slotIndex + 1) & (numSlots - 1))
+		{
+			const Slot& slot = m_Slots[slotIndex];
+			if (slot.NameHash == nameHash)
+			{
+				assert(strcmp(&m_NamePool[slot.NameOffset], name) == 0 && "Two variable names have the same hash");
+				UINT8 type = stage < NumShaderStages ? slot.StageTypes[stage] : NoVariableType;
+				return type != NoVariableType ? static_cast<SHADER_RESOURCE_VARIABLE_TYPE>(type) : m_DefaultVariableType;
+			}
+		}
+
+		return m_DefaultVariableType;
+	}
+
+	UINT64 ShaderVariableTable::ComputeNameHash(const char* name)
+	{
+		return ComputeFNV1aHash(name, strlen(name));
+	}
+
+	UINT32 ShaderVariableTable::GetShaderStageIndex(SHADER_TYPE shaderType)
+	{
+		assert(IsPowerOfTwoD(UINT32(shaderType)) && "Only single shader stage should be provided");
+
+		UINT32 stage = 0;
+		while (stage < NumShaderStages && (shaderType & (1 << stage)) == 0)
+			++stage;
+		return stage;
+	}
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+namespace RHI
+{
+	// Variable type of the resources named Name in the stages of ShaderType (a combination of SHADER_TYPE bits)
+	struct ShaderResourceVariableDesc
+	{
+		SHADER_TYPE ShaderType = SHADER_TYPE_UNKNOWN;
+		std::string Name;
+		SHADER_RESOURCE_VARIABLE_TYPE Type;
+	};
+
+	// Variable types given to the shader resources by a PipelineStateDesc, the resources that are not listed get DefaultVariableType.
+	// Kept next to ShaderVariableTable so that the table can be built without the pipeline state headers
+	struct ShaderVariableConfig
+	{
+		SHADER_RESOURCE_VARIABLE_TYPE DefaultVariableType = SHADER_RESOURCE_VARIABLE_TYPE_STATIC;
+
+		std::vector<ShaderResourceVariableDesc> Variables;
+	};
+
+	// The variable types of a ShaderVariableConfig indexed by name, built once when the pipeline state is created.
+	// Open addressing with linear probing on the 64-bit hash of the name: a name is identified by its hash, the names
+	// are only compared by the asserts that check for collisions. A lookup does not depend on the number of variables
+	class ShaderVariableTable
+	{
+	public:
+		ShaderVariableTable() = default;
+		explicit ShaderVariableTable(const ShaderVariableConfig& shaderVariableConfig);
+
+		// Type of the variable in one shader stage, the default type of the config if the variable is not listed.
+		// Like the variables of the config, the first variable that matches the name and the stage is used
+		SHADER_RESOURCE_VARIABLE_TYPE Find(SHADER_TYPE shaderType, const char* name) const
+		{
+			return Find(shaderType, name, ComputeNameHash(name));
+		}
+
+		// With the hash of ComputeNameHash, for the callers that keep the hash of their names (ShaderResourceAttribs::NameHash)
+		SHADER_RESOURCE_VARIABLE_TYPE Find(SHADER_TYPE shaderType, const char* name, UINT64 nameHash) const;
+
+		static UINT64 ComputeNameHash(const char* name);
+
+		UINT32 GetNumNames() const { return m_NumNames; }
+		SHADER_RESOURCE_VARIABLE_TYPE GetDefaultVariableType() const { return m_DefaultVariableType; }
+
+	private:
+		// One type for each bit of SHADER_TYPE
+		static constexpr UINT32 NumShaderStages = 8;
+		static constexpr UINT8 NoVariableType = 0xFF;
+		static constexpr UINT32 EmptySlot = static_cast<UINT32>(-1);
+
+		struct Slot
+		{
+			UINT64 NameHash = 0;
+			// Offset of the name in m_NamePool, EmptySlot if the slot is not used
+			UINT32 NameOffset = EmptySlot;
+			std::array<UINT8, NumShaderStages> StageTypes;
+		};
+
+		static UINT32 GetShaderStageIndex(SHADER_TYPE shaderType);
+
+		// The number of slots is a power of two, at most half of them are used
+		std::vector<Slot> m_Slots;
+		// Names of the slots, null terminated. Only read by the asserts
+		std::vector<char> m_NamePool;
+		UINT32 m_NumNames = 0;
+		SHADER_RESOURCE_VARIABLE_TYPE m_DefaultVariableType = SHADER_RESOURCE_VARIABLE_TYPE_STATIC;
+	};
+}
@@ -0,0 +1,2 @@
+#include "../pch.h"
+#include "TLSFAllocationsManager.h"
\ No newline at end of file
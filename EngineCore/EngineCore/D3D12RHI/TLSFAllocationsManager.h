@@ -0,0 +1,527 @@
+#pragma once
+
+#include "VariableSizeAllocationsManager.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+/* http://www.gii.upv.es/tlsf/files/papers/ecrts04_tlsf.pdf  TLSF: a New Dynamic Memory Allocator for Real-Time Systems
+* Two-Level Segregated Fit manager, same contract as VariableSizeAllocationsManager (Allocate(size, alignment) / Free(offset, size))
+* but without node-based maps: Allocate and Free are O(1) and do not touch the heap in steady state.
+* Free blocks are grouped into size classes. The first level splits sizes by power of two,
+* the second level splits every power of two range into SLIndexCount linear sub-ranges.
+* Every class keeps an intrusive doubly linked list of free blocks, and one bit in the bitmaps tells if the list is empty.
+*
+*   m_FLBitmap             |  1  |  0  |  1  |  0  | ...     fl = log2(size)
+*                             |           |
+*   m_SLBitmap[fl]     | 0 1 0 0 ... |  | 0 0 0 1 ... |      sl = next SLIndexCountLog2 bits of size
+*                          |                    |
+*   m_FreeLists          [fl][sl] --> block --> block --> InvalidIndex
+*
+* All free block nodes live in one contiguous pool (m_Blocks), unused nodes are recycled through m_UnusedBlock.
+* Neighbour blocks are found through two open addressing tables (block begin -> node, block end -> node),
+* so a released range is merged with the adjacent free blocks without any ordered container.
+*/
+namespace RHI
+{
+    class TLSFAllocationsManager
+    {
+    public:
+        // Use the same Allocation as VariableSizeAllocationsManager, so that both managers are interchangeable
+        using Allocation = VariableSizeAllocationsManager::Allocation;
+
+        TLSFAllocationsManager(size_t maxSize) :
+            m_MaxSize(maxSize),
+            m_FreeSize(maxSize)
+        {
+            m_SLBitmap.fill(0);
+            m_FreeLists.fill(InvalidIndex);
+
+            // Initialize the free memory block as one block, the size is maxSize
+            if (maxSize > 0)
+                InsertFreeBlock(AcquireBlock(0, maxSize));
+        }
+
+        ~TLSFAllocationsManager()
+        {
+
+        }
+
+        TLSFAllocationsManager(TLSFAllocationsManager&& rhs) noexcept :
+            m_Blocks{ std::move(rhs.m_Blocks) },
+            m_UnusedBlock{ rhs.m_UnusedBlock },
+            m_FLBitmap{ rhs.m_FLBitmap },
+            m_SLBitmap(rhs.m_SLBitmap),
+            m_FreeLists(rhs.m_FreeLists),
+            m_BlocksByBegin{ std::move(rhs.m_BlocksByBegin) },
+            m_BlocksByEnd{ std::move(rhs.m_BlocksByEnd) },
+            m_MaxSize{ rhs.m_MaxSize },
+            m_FreeSize{ rhs.m_FreeSize },
+            m_FreeBlocksNum{ rhs.m_FreeBlocksNum }
+        {
+            rhs.m_UnusedBlock = InvalidIndex;
+            rhs.m_FLBitmap = 0;
+            rhs.m_SLBitmap.fill(0);
+            rhs.m_FreeLists.fill(InvalidIndex);
+            rhs.m_MaxSize = 0;
+            rhs.m_FreeSize = 0;
+            rhs.m_FreeBlocksNum = 0;
+        }
+
+        TLSFAllocationsManager& operator = (TLSFAllocationsManager&& rhs) = delete;
+        TLSFAllocationsManager(const TLSFAllocationsManager&) = delete;
+        TLSFAllocationsManager& operator = (const TLSFAllocationsManager&) = delete;
+
+        Allocation Allocate(size_t size, size_t alignment)
+        {
+            assert(size > 0);
+            assert(IsPowerOfTwoD(alignment));
+
+            size = Align(size, alignment);
+            if (m_FreeSize < size)
+                return Allocation::InvalidAllocation();
+
+            // Any block of the class found by the good-fit search can hold Size + alignmentReserve
+            size_t alignmentReserve = alignment - 1;
+            UINT32 blockIndex = FindSuitableBlock(size + alignmentReserve);
+
+            // The good-fit search rounds the size up to the next class, so a block in the class of the size itself may still fit
+            if (blockIndex == InvalidIndex)
+                blockIndex = FindBlockInExactClass(size, alignment);
+
+            if (blockIndex == InvalidIndex)
+                return Allocation::InvalidAllocation();
+
+            RemoveFreeBlock(blockIndex);
+
+            //     Block.Offset
+            //        |                                  |
+            //        |<-----------Block.Size----------->|
+            //        |<------Size------>|<---NewSize--->|
+            //        |                  |
+            //      Offset              NewOffset
+            //
+            FreeBlock& block = m_Blocks[blockIndex];
+            size_t offset = block.Offset;
+            size_t alignedOffset = Align(offset, alignment);
+            size_t adjustedSize = size + (alignedOffset - offset);
+            assert(adjustedSize <= block.Size);
+
+            if (block.Size > adjustedSize)
+            {
+                // Reuse the node for the remaining part of the block
+                block.Offset += adjustedSize;
+                block.Size -= adjustedSize;
+                InsertFreeBlock(blockIndex);
+            }
+            else
+            {
+                ReleaseBlock(blockIndex);
+            }
+
+            m_FreeSize -= adjustedSize;
+
+            return Allocation(offset, adjustedSize);
+        }
+
+        void Free(Allocation&& allocation)
+        {
+            Free(allocation.unalignedOffset, allocation.size);
+            allocation = Allocation{};
+        }
+
+        void Free(size_t offset, size_t size)
+        {
+            assert(size > 0 && offset + size <= m_MaxSize);
+
+            size_t newOffset = offset;
+            size_t newSize = size;
+
+            // The memory block to be released is adjacent to the previous free memory block
+            //
+            //  PrevBlock.Offset             Offset
+            //       |                          |
+            //       |<-----PrevBlock.Size----->|<------Size-------->|
+            //
+            UINT32 prevBlockIndex = m_BlocksByEnd.Find(offset);
+            if (prevBlockIndex != InvalidIndex)
+            {
+                newOffset = m_Blocks[prevBlockIndex].Offset;
+                newSize += m_Blocks[prevBlockIndex].Size;
+                RemoveFreeBlock(prevBlockIndex);
+                ReleaseBlock(prevBlockIndex);
+            }
+
+            // The memory block to be released is adjacent to the next free memory block
+            //
+            //         Offset            NextBlock.Offset
+            //           |                    |
+            //           |<------Size-------->|<-----NextBlock.Size----->|
+            //
+            UINT32 nextBlockIndex = m_BlocksByBegin.Find(offset + size);
+            if (nextBlockIndex != InvalidIndex)
+            {
+                newSize += m_Blocks[nextBlockIndex].Size;
+                RemoveFreeBlock(nextBlockIndex);
+                ReleaseBlock(nextBlockIndex);
+            }
+
+            InsertFreeBlock(AcquireBlock(newOffset, newSize));
+
+            m_FreeSize += size;
+
+            assert(!IsEmpty() || GetFreeBlocksNum() == 1);
+        }
+
+        bool IsFull() const { return m_FreeSize == 0; }
+        bool IsEmpty() const { return m_FreeSize == m_MaxSize; }
+        size_t GetMaxSize() const { return m_MaxSize; }
+        size_t GetFreeSize() const { return m_FreeSize; }
+        size_t GetUsedSize() const { return m_MaxSize - m_FreeSize; }
+
+        size_t GetFreeBlocksNum() const
+        {
+            return m_FreeBlocksNum;
+        }
+
+        // Size of the largest free block, GetFreeSize() / GetLargestFreeBlockSize() shows how fragmented the free space is
+        size_t GetLargestFreeBlockSize() const
+        {
+            if (m_FLBitmap == 0)
+                return 0;
+
+            UINT32 fl = HighestBit(m_FLBitmap);
+            UINT32 sl = HighestBit(m_SLBitmap[fl]);
+
+            size_t largestSize = 0;
+            for (UINT32 blockIndex = m_FreeLists[fl * SLIndexCount + sl]; blockIndex != InvalidIndex; blockIndex = m_Blocks[blockIndex].NextFree)
+                largestSize = std::max(largestSize, m_Blocks[blockIndex].Size);
+
+            return largestSize;
+        }
+
+        void Extend(size_t extraSize)
+        {
+            // The new range is released as a regular block, so it is merged with the last free block if they are adjacent
+            size_t newBlockOffset = m_MaxSize;
+            m_MaxSize += extraSize;
+            Free(newBlockOffset, extraSize);
+        }
+
+    private:
+        static constexpr UINT32 InvalidIndex = static_cast<UINT32>(-1);
+
+        // Every power of two range is split into 16 classes
+        static constexpr UINT32 SLIndexCountLog2 = 4;
+        static constexpr UINT32 SLIndexCount = 1 << SLIndexCountLog2;
+        // Sizes smaller than SLIndexCount all go to the first level 0, one class per size
+        static constexpr UINT32 FLIndexCount = sizeof(size_t) * 8 - SLIndexCountLog2 + 1;
+
+        static_assert(FLIndexCount <= 64, "First level bitmap is 64 bits wide");
+        static_assert(SLIndexCount <= 32, "Second level bitmap is 32 bits wide");
+
+        struct FreeBlock
+        {
+            size_t Offset;
+            size_t Size;
+
+            // Intrusive links in the free list of the size class
+            UINT32 PrevFree;
+            UINT32 NextFree;
+        };
+
+        // Open addressing hash table (linear probing, backward shift deletion) that maps an offset to a free block node.
+        // The storage is a single vector which only grows, erasing an element never releases memory
+        class BlockIndexTable
+        {
+        public:
+            BlockIndexTable()
+            {
+                m_Entries.resize(16);
+            }
+
+            BlockIndexTable(BlockIndexTable&&) = default;
+
+            UINT32 Find(size_t key) const
+            {
+                size_t mask = m_Entries.size() - 1;
+                for (size_t slot = HomeSlot(key); m_Entries[slot].BlockIndex != InvalidIndex; slot = (slot + 1) & mask)
+                {
+                    if (m_Entries[slot].Key == key)
+                        return m_Entries[slot].BlockIndex;
+                }
+                return InvalidIndex;
+            }
+
+            void Insert(size_t key, UINT32 blockIndex)
+            {
+                // Keep the load factor below 1/2
+                if ((m_Count + 1) * 2 > m_Entries.size())
+                    Grow();
+
+                size_t mask = m_Entries.size() - 1;
+                size_t slot = HomeSlot(key);
+                while (m_Entries[slot].BlockIndex != InvalidIndex)
+                {
+                    assert(m_Entries[slot].Key != key && "Two free blocks can not share the same offset");
+                    slot = (slot + 1) & mask;
+                }
+
+                m_Entries[slot] = Entry{ key, blockIndex };
+                ++m_Count;
+            }
+
+            void Erase(size_t key)
+            {
+                size_t mask = m_Entries.size() - 1;
+                size_t slot = HomeSlot(key);
+                while (m_Entries[slot].Key != key || m_Entries[slot].BlockIndex == InvalidIndex)
+                {
+                    assert(m_Entries[slot].BlockIndex != InvalidIndex && "Key is not in the table");
+                    slot = (slot + 1) & mask;
+                }
+
+                // Shift the following entries of the cluster back, so that no tombstone is needed
+                size_t next = slot;
+                for (;;)
+                {
+                    m_Entries[slot].BlockIndex = InvalidIndex;
+                    for (;;)
+                    {
+                        next = (next + 1) & mask;
+                        if (m_Entries[next].BlockIndex == InvalidIndex)
+                        {
+                            --m_Count;
+                            return;
+                        }
+
+                        // The entry can stay where it is if its home slot is cyclically in (slot, next]
+                        size_t home = HomeSlot(m_Entries[next].Key);
+                        bool stays = (slot <= next) ? (slot < home && home <= next) : (slot < home || home <= next);
+                        if (!stays)
+                            break;
+                    }
+
+                    m_Entries[slot] = m_Entries[next];
+                    slot = next;
+                }
+            }
+
+        private:
+            struct Entry
+            {
+                size_t Key = 0;
+                UINT32 BlockIndex = InvalidIndex;
+            };
+
+            size_t HomeSlot(size_t key) const
+            {
+                // Fibonacci hashing, offsets are often multiples of the same stride
+                return static_cast<size_t>((static_cast<UINT64>(key) * 0x9E3779B97F4A7C15ull) >> 32) & (m_Entries.size() - 1);
+            }
+
+            void Grow()
+            {
+                std::vector<Entry> oldEntries(m_Entries.size() * 2);
+                std::swap(oldEntries, m_Entries);
+                m_Count = 0;
+                for (const auto& entry : oldEntries)
+                {
+                    if (entry.BlockIndex != InvalidIndex)
+                        Insert(entry.Key, entry.BlockIndex);
+                }
+            }
+
+            std::vector<Entry> m_Entries;
+            size_t m_Count = 0;
+        };
+
+        static UINT32 LowestBit(UINT64 value)
+        {
+            assert(value != 0);
+#if defined(_MSC_VER)
+            unsigned long index;
+#if defined(_WIN64)
+            _BitScanForward64(&index, value);
+#else
+            if (!_BitScanForward(&index, static_cast<unsigned long>(value)))
+            {
+                _BitScanForward(&index, static_cast<unsigned long>(value >> 32));
+                index += 32;
+            }
+#endif
+            return static_cast<UINT32>(index);
+#else
+            return static_cast<UINT32>(__builtin_ctzll(value));
+#endif
+        }
+
+        static UINT32 HighestBit(UINT64 value)
+        {
+            assert(value != 0);
+#if defined(_MSC_VER)
+            unsigned long index;
+#if defined(_WIN64)
+            _BitScanReverse64(&index, value);
+#else
+            if (_BitScanReverse(&index, static_cast<unsigned long>(value >> 32)))
+                index += 32;
+            else
+                _BitScanReverse(&index, static_cast<unsigned long>(value));
+#endif
+            return static_cast<UINT32>(index);
+#else
+            return static_cast<UINT32>(63 - __builtin_clzll(value));
+#endif
+        }
+
+        // Size class that contains blocks of the given size
+        static void MappingInsert(size_t size, UINT32& fl, UINT32& sl)
+        {
+            if (size < SLIndexCount)
+            {
+                fl = 0;
+                sl = static_cast<UINT32>(size);
+            }
+            else
+            {
+                UINT32 msb = HighestBit(size);
+                fl = msb - SLIndexCountLog2 + 1;
+                sl = static_cast<UINT32>(size >> (msb - SLIndexCountLog2)) ^ SLIndexCount;
+            }
+        }
+
+        // First free block whose class only contains blocks that are not smaller than the given size
+        UINT32 FindSuitableBlock(size_t size) const
+        {
+            // Round the size up to the next class boundary
+            if (size >= SLIndexCount)
+                size += (static_cast<size_t>(1) << (HighestBit(size) - SLIndexCountLog2)) - 1;
+
+            UINT32 fl, sl;
+            MappingInsert(size, fl, sl);
+            if (fl >= FLIndexCount)
+                return InvalidIndex;
+
+            UINT32 slMap = m_SLBitmap[fl] & (~0u << sl);
+            if (slMap == 0)
+            {
+                // No block in this power of two range, take the smallest non-empty range above
+                UINT64 flMap = (fl + 1 < 64) ? m_FLBitmap & (~0ull << (fl + 1)) : 0;
+                if (flMap == 0)
+                    return InvalidIndex;
+
+                fl = LowestBit(flMap);
+                slMap = m_SLBitmap[fl];
+                assert(slMap != 0);
+            }
+
+            sl = LowestBit(slMap);
+            return m_FreeLists[fl * SLIndexCount + sl];
+        }
+
+        UINT32 FindBlockInExactClass(size_t size, size_t alignment) const
+        {
+            UINT32 fl, sl;
+            MappingInsert(size, fl, sl);
+
+            for (UINT32 blockIndex = m_FreeLists[fl * SLIndexCount + sl]; blockIndex != InvalidIndex; blockIndex = m_Blocks[blockIndex].NextFree)
+            {
+                const FreeBlock& block = m_Blocks[blockIndex];
+                if (size + (Align(block.Offset, alignment) - block.Offset) <= block.Size)
+                    return blockIndex;
+            }
+            return InvalidIndex;
+        }
+
+        UINT32 AcquireBlock(size_t offset, size_t size)
+        {
+            UINT32 blockIndex = m_UnusedBlock;
+            if (blockIndex != InvalidIndex)
+            {
+                m_UnusedBlock = m_Blocks[blockIndex].NextFree;
+            }
+            else
+            {
+                blockIndex = static_cast<UINT32>(m_Blocks.size());
+                m_Blocks.emplace_back();
+            }
+
+            m_Blocks[blockIndex] = FreeBlock{ offset, size, InvalidIndex, InvalidIndex };
+            return blockIndex;
+        }
+
+        void ReleaseBlock(UINT32 blockIndex)
+        {
+            m_Blocks[blockIndex].NextFree = m_UnusedBlock;
+            m_UnusedBlock = blockIndex;
+        }
+
+        void InsertFreeBlock(UINT32 blockIndex)
+        {
+            FreeBlock& block = m_Blocks[blockIndex];
+
+            UINT32 fl, sl;
+            MappingInsert(block.Size, fl, sl);
+
+            UINT32& head = m_FreeLists[fl * SLIndexCount + sl];
+            block.PrevFree = InvalidIndex;
+            block.NextFree = head;
+            if (head != InvalidIndex)
+                m_Blocks[head].PrevFree = blockIndex;
+            head = blockIndex;
+
+            m_FLBitmap |= 1ull << fl;
+            m_SLBitmap[fl] |= 1u << sl;
+
+            m_BlocksByBegin.Insert(block.Offset, blockIndex);
+            m_BlocksByEnd.Insert(block.Offset + block.Size, blockIndex);
+            ++m_FreeBlocksNum;
+        }
+
+        void RemoveFreeBlock(UINT32 blockIndex)
+        {
+            FreeBlock& block = m_Blocks[blockIndex];
+
+            UINT32 fl, sl;
+            MappingInsert(block.Size, fl, sl);
+
+            if (block.PrevFree != InvalidIndex)
+                m_Blocks[block.PrevFree].NextFree = block.NextFree;
+            else
+                m_FreeLists[fl * SLIndexCount + sl] = block.NextFree;
+
+            if (block.NextFree != InvalidIndex)
+                m_Blocks[block.NextFree].PrevFree = block.PrevFree;
+
+            // The class became empty
+            if (m_FreeLists[fl * SLIndexCount + sl] == InvalidIndex)
+            {
+                m_SLBitmap[fl] &= ~(1u << sl);
+                if (m_SLBitmap[fl] == 0)
+                    m_FLBitmap &= ~(1ull << fl);
+            }
+
+            m_BlocksByBegin.Erase(block.Offset);
+            m_BlocksByEnd.Erase(block.Offset + block.Size);
+            --m_FreeBlocksNum;
+        }
+
+        // Pool of free block nodes, nodes are referenced by index so that the pool can grow
+        std::vector<FreeBlock> m_Blocks;
+        // Head of the list of nodes that can be reused
+        UINT32 m_UnusedBlock = InvalidIndex;
+
+        UINT64 m_FLBitmap = 0;
+        std::array<UINT32, FLIndexCount> m_SLBitmap;
+        std::array<UINT32, FLIndexCount * SLIndexCount> m_FreeLists;
+
+        BlockIndexTable m_BlocksByBegin;
+        BlockIndexTable m_BlocksByEnd;
+
+        size_t m_MaxSize = 0;
+        size_t m_FreeSize = 0;
+        size_t m_FreeBlocksNum = 0;
+    };
+}
@@ -0,0 +1,211 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+* Per-thread caches of the items of one owner, e.g. the descriptors of a CPUDescriptorHeap cached by the loader threads.
+* Every thread finds its cache through thread_local storage and uses it without any lock: the only synchronization is the
+* uncontended Busy flag of the cache, which Disable() takes to drain a cache that belongs to another thread.
+*
+*   thread_local t_Objects: [ slot 0: owner id 7 -> cache A | slot 1: owner id 9 -> cache C ]      (one table per thread)
+*
+*   owner (id 7, slot 0):  m_Objects = { cache A (thread 0), cache B (thread 1), ... }   (registration under a mutex, once per thread)
+*
+* The caches are owned by the owner, not by the threads, so that Disable() can return the cached items. The per-thread
+* registration is ThreadLocalObjects, also used for the command allocators of each thread (CommandAllocatorPool).
+* Only uses the standard library, see Tests.
+*/
+namespace RHI
+{
+	// One object of an owner per thread that asks for it. The thread_local table of a thread is indexed by the slot of the owner,
+	// a destroyed owner gives its slot to the next one: the tables do not grow with the number of owners ever created. The owner
+	// ids are never reused, the entry left by the previous owner of a slot does not match and is replaced.
+	template <typename ObjectType>
+	class ThreadLocalObjects
+	{
+	public:
+		ThreadLocalObjects() :
+			m_OwnerId{ s_NextOwnerId.fetch_add(1, std::memory_order_relaxed) },
+			m_Slot{ GetSlotTable().Acquire() }
+		{
+		}
+
+		~ThreadLocalObjects()
+		{
+			GetSlotTable().Release(m_Slot);
+		}
+
+		ThreadLocalObjects(const ThreadLocalObjects&) = delete;
+		ThreadLocalObjects& operator = (const ThreadLocalObjects&) = delete;
+
+		// Object of the calling thread, created the first time the thread asks for it
+		ObjectType& GetThreadObject()
+		{
+			thread_local std::vector<ThreadEntry> t_Objects;
+			if (m_Slot < t_Objects.size() && t_Objects[m_Slot].OwnerId == m_OwnerId)
+				return *t_Objects[m_Slot].Object;
+
+			ObjectType* object = nullptr;
+			{
+				std::lock_guard<std::mutex> lock(m_ObjectsMutex);
+				m_Objects.push_back(std::make_unique<ObjectType>());
+				object = m_Objects.back().get();
+			}
+
+			if (t_Objects.size() <= m_Slot)
+				t_Objects.resize(m_Slot + 1);
+			t_Objects[m_Slot] = { m_OwnerId, object };
+			return *object;
+		}
+
+		// Calls func(ObjectType&) for the object of every thread, with the registration locked
+		template <typename FuncType>
+		void ForEach(FuncType&& func)
+		{
+			std::lock_guard<std::mutex> lock(m_ObjectsMutex);
+			for (auto& object : m_Objects)
+				func(*object);
+		}
+
+		size_t GetNumObjects()
+		{
+			std::lock_guard<std::mutex> lock(m_ObjectsMutex);
+			return m_Objects.size();
+		}
+
+	private:
+		struct ThreadEntry
+		{
+			uint64_t OwnerId = 0;
+			ObjectType* Object = nullptr;
+		};
+
+		class SlotTable
+		{
+		public:
+			uint32_t Acquire()
+			{
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				if (m_FreeSlots.empty())
+					return m_NumSlots++;
+
+				uint32_t slot = m_FreeSlots.back();
+				m_FreeSlots.pop_back();
+				return slot;
+			}
+
+			void Release(uint32_t slot)
+			{
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				m_FreeSlots.push_back(slot);
+			}
+
+		private:
+			std::mutex m_Mutex;
+			std::vector<uint32_t> m_FreeSlots;
+			uint32_t m_NumSlots = 0;
+		};
+
+		// Created by the first owner, so it is destroyed after the owners that are static objects
+		static SlotTable& GetSlotTable()
+		{
+			static SlotTable slotTable;
+			return slotTable;
+		}
+
+		// 0 is the id of an empty entry
+		static inline std::atomic<uint64_t> s_NextOwnerId{ 1 };
+		const uint64_t m_OwnerId;
+		const uint32_t m_Slot;
+
+		// Guards m_Objects, the objects are guarded by their users
+		std::mutex m_ObjectsMutex;
+		std::vector<std::unique_ptr<ObjectType>> m_Objects;
+	};
+
+	template <typename ItemType>
+	class ThreadLocalCaches
+	{
+	public:
+		ThreadLocalCaches() = default;
+
+		ThreadLocalCaches(const ThreadLocalCaches&) = delete;
+		ThreadLocalCaches& operator = (const ThreadLocalCaches&) = delete;
+
+		bool IsEnabled() const { return m_Enabled.load(std::memory_order_acquire); }
+
+		// Enable() and Disable() are called by one control thread, Pop() by any thread
+		void Enable() { m_Enabled.store(true, std::memory_order_seq_cst); }
+
+		// Waits for the Pop() in progress (including their refill), then gives the items of every cache to drain(std::vector<ItemType>&).
+		// When Disable() returns, no cache holds an item and Pop() fails until Enable()
+		template <typename DrainFuncType>
+		void Disable(DrainFuncType&& drain)
+		{
+			m_Enabled.store(false, std::memory_order_seq_cst);
+
+			m_Caches.ForEach([&drain](Cache& cache)
+			{
+				while (cache.Busy.exchange(true, std::memory_order_seq_cst))
+					std::this_thread::yield();
+
+				if (!cache.Items.empty())
+				{
+					drain(cache.Items);
+					cache.Items.clear();
+				}
+				cache.Busy.store(false, std::memory_order_release);
+			});
+		}
+
+		// Item from the cache of the calling thread. An empty cache is refilled by refill(std::vector<ItemType>&).
+		// Returns false if the caches are disabled or the refill gave nothing, the caller then uses the shared path
+		template <typename RefillFuncType>
+		bool Pop(ItemType& item, RefillFuncType&& refill)
+		{
+			if (!m_Enabled.load(std::memory_order_acquire))
+				return false;
+
+			Cache& cache = m_Caches.GetThreadObject();
+			if (cache.Busy.exchange(true, std::memory_order_seq_cst))
+				return false; // Drained by Disable()
+
+			// Checked again with the flag taken: either Disable() sees the flag and waits, or this sees the cache disabled
+			bool found = false;
+			if (m_Enabled.load(std::memory_order_seq_cst))
+			{
+				if (cache.Items.empty())
+					refill(cache.Items);
+
+				if (!cache.Items.empty())
+				{
+					item = std::move(cache.Items.back());
+					cache.Items.pop_back();
+					found = true;
+				}
+			}
+
+			cache.Busy.store(false, std::memory_order_release);
+			return found;
+		}
+
+		size_t GetNumCaches() { return m_Caches.GetNumObjects(); }
+
+	private:
+		struct Cache
+		{
+			std::atomic<bool> Busy{ false };
+			std::vector<ItemType> Items;
+		};
+
+		std::atomic<bool> m_Enabled{ false };
+
+		// The caches are guarded by their Busy flag
+		ThreadLocalObjects<Cache> m_Caches;
+	};
+}
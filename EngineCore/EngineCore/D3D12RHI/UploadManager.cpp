@@ -0,0 +1,287 @@
+#include "../pch.h"
+#include "UploadManager.h"
+#include "CommandContext.h"
+#include "CommandListManager.h"
+#include "RenderDevice.h"
+
+namespace RHI
+{
+	UploadManager::UploadManager(ID3D12Device* device, size_t stagingRingSize) :
+		m_StagingRing{ stagingRingSize }
+	{
+		D3D12_HEAP_PROPERTIES HeapProps;
+		HeapProps.Type = D3D12_HEAP_TYPE_UPLOAD;
+		HeapProps.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+		HeapProps.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+		HeapProps.CreationNodeMask = 1;
+		HeapProps.VisibleNodeMask = 1;
+
+		D3D12_RESOURCE_DESC ResourceDesc = CD3DX12_RESOURCE_DESC::Buffer(stagingRingSize);
+		ThrowIfFailed(device->CreateCommittedResource(&HeapProps, D3D12_HEAP_FLAG_NONE, &ResourceDesc,
+			D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&m_StagingBuffer)));
+		m_StagingBuffer->SetName(L"UploadManager Staging Ring");
+
+		// Upload heap resources can stay mapped
+		ThrowIfFailed(m_StagingBuffer->Map(0, nullptr, reinterpret_cast<void**>(&m_StagingCpuAddress)));
+	}
+
+	UploadManager::~UploadManager()
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		FlushBatch();
+		while (!m_SubmittedBatches.empty())
+		{
+			WaitForBatch(m_SubmittedBatches.front());
+			m_SubmittedBatches.pop_front();
+		}
+
+		m_StagingBuffer->Unmap(0, nullptr);
+	}
+
+	UploadToken UploadManager::UploadBuffer(GpuBuffer& Dest, const void* Data, size_t NumBytes, size_t DestOffset)
+	{
+		assert(CanUpload(NumBytes));
+		if (NumBytes == 0)
+			return UploadToken{};
+
+		std::unique_lock<std::mutex> lock(m_Mutex);
+
+		size_t StagingOffset = AllocateStaging(NumBytes, 16, lock);
+		memcpy(m_StagingCpuAddress + StagingOffset, Data, NumBytes);
+
+		CommandContext& Context = GetBatchContext(Dest);
+		if (&Context == m_GraphicsContext)
+		{
+			Context.TransitionResource(Dest, D3D12_RESOURCE_STATE_COPY_DEST, true);
+			Context.m_CommandList->CopyBufferRegion(Dest.GetResource(), Dest.GetBufferOffset() + DestOffset,
+				m_StagingBuffer.Get(), StagingOffset, NumBytes);
+			Context.TransitionResource(Dest, D3D12_RESOURCE_STATE_GENERIC_READ);
+		}
+		else
+		{
+			Context.m_CommandList->CopyBufferRegion(Dest.GetResource(), Dest.GetBufferOffset() + DestOffset,
+				m_StagingBuffer.Get(), StagingOffset, NumBytes);
+		}
+
+		++m_Stats.NumUploads;
+		m_Stats.UploadedBytes += NumBytes;
+
+		return UploadToken{ m_CurrentBatchId };
+	}
+
+	UploadToken UploadManager::UploadTexture(GpuResource& Dest, UINT FirstSubresource, UINT NumSubresources, const D3D12_SUBRESOURCE_DATA* SubData)
+	{
+		UINT64 UploadSize = GetRequiredIntermediateSize(Dest.GetResource(), FirstSubresource, NumSubresources);
+		assert(CanUpload(UploadSize));
+
+		std::unique_lock<std::mutex> lock(m_Mutex);
+
+		size_t StagingOffset = AllocateStaging((size_t)UploadSize, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT, lock);
+
+		// UpdateSubresources writes the rows to the staging memory with the footprints of the texture
+		CommandContext& Context = GetBatchContext(Dest);
+		if (&Context == m_GraphicsContext)
+		{
+			Context.TransitionResource(Dest, D3D12_RESOURCE_STATE_COPY_DEST, true);
+			UpdateSubresources(Context.m_CommandList.Get(), Dest.GetResource(), m_StagingBuffer.Get(), StagingOffset, FirstSubresource, NumSubresources, SubData);
+			Context.TransitionResource(Dest, D3D12_RESOURCE_STATE_GENERIC_READ);
+		}
+		else
+		{
+			UpdateSubresources(Context.m_CommandList.Get(), Dest.GetResource(), m_StagingBuffer.Get(), StagingOffset, FirstSubresource, NumSubresources, SubData);
+		}
+
+		++m_Stats.NumUploads;
+		m_Stats.UploadedBytes += UploadSize;
+
+		return UploadToken{ m_CurrentBatchId };
+	}
+
+	UploadToken UploadManager::Flush()
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return FlushBatch();
+	}
+
+	bool UploadManager::IsUploadComplete(UploadToken Token)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		if (Token.BatchId >= m_CurrentBatchId)
+			return false;
+
+		ReleaseCompletedBatches();
+		return Token.BatchId <= m_LastCompletedBatchId;
+	}
+
+	void UploadManager::WaitOnGPU(CommandQueue& Queue, UploadToken Token)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		if (Token.BatchId >= m_CurrentBatchId)
+			FlushBatch();
+
+		ReleaseCompletedBatches();
+		if (Token.BatchId <= m_LastCompletedBatchId)
+			return;
+
+		CommandListManager& ListManager = CommandListManager::GetSingleton();
+		for (const Batch& batch : m_SubmittedBatches)
+		{
+			if (batch.BatchId != Token.BatchId)
+				continue;
+
+			// The lists of a queue are executed in order, a queue does not wait for itself
+			if (batch.CopyFenceValue != 0 && &Queue != &ListManager.GetCopyQueue())
+				Queue.WaitForQueue(ListManager.GetCopyQueue(), batch.CopyFenceValue);
+			if (batch.GraphicsFenceValue != 0 && &Queue != &ListManager.GetGraphicsQueue())
+				Queue.WaitForQueue(ListManager.GetGraphicsQueue(), batch.GraphicsFenceValue);
+			break;
+		}
+	}
+
+	void UploadManager::WaitForUpload(UploadToken Token)
+	{
+		Batch WaitedBatch;
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+
+			if (Token.BatchId >= m_CurrentBatchId)
+				FlushBatch();
+
+			ReleaseCompletedBatches();
+			for (const Batch& batch : m_SubmittedBatches)
+			{
+				if (batch.BatchId == Token.BatchId)
+					WaitedBatch = batch;
+			}
+		}
+
+		// The other uploads can be recorded while the CPU waits
+		WaitForBatch(WaitedBatch);
+	}
+
+	UploadManager::Stats UploadManager::GetStats()
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		Stats stats = m_Stats;
+		stats.PeakStagingSize = m_StagingRing.GetPeakUsedSize();
+		return stats;
+	}
+
+	size_t UploadManager::AllocateStaging(size_t Size, size_t Alignment, std::unique_lock<std::mutex>& Lock)
+	{
+		// The ring does not align the allocations
+		size_t PaddedSize = Size + Alignment - 1;
+
+		ReleaseCompletedBatches();
+		size_t Offset = m_StagingRing.Allocate(PaddedSize);
+		while (Offset == RingAllocationsManager::InvalidOffset)
+		{
+			// The ring is full: submit the current batch and wait for the oldest one
+			++m_Stats.NumStagingStalls;
+
+			FlushBatch();
+			assert(!m_SubmittedBatches.empty());
+			Batch OldestBatch = m_SubmittedBatches.front();
+
+			// Another thread may release the batch or allocate the freed memory first, the allocation is retried
+			Lock.unlock();
+			WaitForBatch(OldestBatch);
+			Lock.lock();
+
+			ReleaseCompletedBatches();
+			Offset = m_StagingRing.Allocate(PaddedSize);
+		}
+
+		return Align(Offset, Alignment);
+	}
+
+	CommandContext& UploadManager::GetBatchContext(GpuResource& Dest)
+	{
+		bool IsCommonState = false;
+		{
+			std::lock_guard<std::mutex> StateLock(ResourceStateTracker::GetGlobalStateMutex());
+			IsCommonState = Dest.m_UsageState->IsUniform() && Dest.m_UsageState->GetState() == D3D12_RESOURCE_STATE_COMMON;
+		}
+
+		m_HasPendingUploads = true;
+
+		if (IsCommonState)
+		{
+			if (m_CopyContext == nullptr)
+				m_CopyContext = &CommandContext::BeginUnderLock(D3D12_COMMAND_LIST_TYPE_COPY, L"Upload Batch");
+			return *m_CopyContext;
+		}
+
+		if (m_GraphicsContext == nullptr)
+			m_GraphicsContext = &CommandContext::BeginUnderLock(D3D12_COMMAND_LIST_TYPE_DIRECT, L"Upload Batch");
+		return *m_GraphicsContext;
+	}
+
+	UploadToken UploadManager::FlushBatch()
+	{
+		if (!m_HasPendingUploads)
+			return UploadToken{ m_CurrentBatchId - 1 };
+
+		// Cleared first, finishing the graphics context must not flush the uploads again
+		m_HasPendingUploads = false;
+
+		CommandListManager& ListManager = CommandListManager::GetSingleton();
+
+		Batch batch;
+		batch.BatchId = m_CurrentBatchId;
+		if (m_CopyContext != nullptr)
+		{
+			batch.CopyFenceValue = m_CopyContext->Finish();
+			m_CopyContext = nullptr;
+
+			// The graphics queue does not use the resources before the copies are done
+			ListManager.GetGraphicsQueue().WaitForQueue(ListManager.GetCopyQueue(), batch.CopyFenceValue);
+		}
+		if (m_GraphicsContext != nullptr)
+		{
+			batch.GraphicsFenceValue = m_GraphicsContext->Finish();
+			m_GraphicsContext = nullptr;
+		}
+
+		// The staging memory of the batch is reclaimed when the batch is complete
+		m_StagingRing.FinishCurrentFrame(batch.BatchId);
+		m_SubmittedBatches.push_back(batch);
+		++m_Stats.NumBatches;
+
+		return UploadToken{ m_CurrentBatchId++ };
+	}
+
+	void UploadManager::ReleaseCompletedBatches()
+	{
+		// The fence values of both lanes grow with the batch id, the batches complete in order
+		while (!m_SubmittedBatches.empty() && IsBatchComplete(m_SubmittedBatches.front()))
+		{
+			m_LastCompletedBatchId = m_SubmittedBatches.front().BatchId;
+			m_SubmittedBatches.pop_front();
+		}
+
+		m_StagingRing.ReleaseCompletedFrames(m_LastCompletedBatchId);
+	}
+
+	bool UploadManager::IsBatchComplete(const Batch& batch)
+	{
+		CommandListManager& ListManager = CommandListManager::GetSingleton();
+
+		return (batch.CopyFenceValue == 0 || ListManager.IsFenceComplete(batch.CopyFenceValue, D3D12_COMMAND_LIST_TYPE_COPY)) &&
+			(batch.GraphicsFenceValue == 0 || ListManager.IsFenceComplete(batch.GraphicsFenceValue, D3D12_COMMAND_LIST_TYPE_DIRECT));
+	}
+
+	void UploadManager::WaitForBatch(const Batch& batch)
+	{
+		CommandListManager& ListManager = CommandListManager::GetSingleton();
+
+		if (batch.CopyFenceValue != 0)
+			ListManager.WaitForFence(batch.CopyFenceValue, D3D12_COMMAND_LIST_TYPE_COPY);
+		if (batch.GraphicsFenceValue != 0)
+			ListManager.WaitForFence(batch.GraphicsFenceValue, D3D12_COMMAND_LIST_TYPE_DIRECT);
+	}
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include "RingAllocationsManager.h"
+
+/*
+* Resource uploads without CPU stalls.
+* The data is copied to a persistently mapped staging ring in the upload heap, and the copies are recorded in a batch that is
+* submitted by Flush. A resource in the COMMON state is uploaded by the copy queue (it is promoted to COPY_DEST and decays back
+* to COMMON), the other resources (the buffers sharing a block in GENERIC_READ) by the graphics queue.
+* Every upload returns the token of its batch. The graphics queue waits for the copy queue on the GPU when a batch is submitted,
+* and CommandContext submits the pending uploads before its own command lists, so the graphics queue never sees a resource
+* before its data. Other queues use WaitOnGPU.
+*
+*         Head                                   Tail
+*          |                                      |
+*  [       | batch 3 | batch 4 |  current batch   |          ]   a batch is reclaimed once its copy and graphics lanes are done
+*/
+namespace RHI
+{
+	class CommandContext;
+	class CommandQueue;
+	class GpuBuffer;
+	class GpuResource;
+
+	struct UploadToken
+	{
+		// 0 : nothing to wait for
+		UINT64 BatchId = 0;
+	};
+
+	class UploadManager : public Singleton<UploadManager>
+	{
+	public:
+		UploadManager(ID3D12Device* device, size_t stagingRingSize = UPLOAD_STAGING_RING_SIZE);
+		~UploadManager();
+
+		// Larger uploads do not fit in the staging ring
+		bool CanUpload(UINT64 NumBytes) const { return NumBytes + D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT <= m_StagingRing.GetMaxSize(); }
+
+		// The data is copied to the staging ring before the function returns
+		UploadToken UploadBuffer(GpuBuffer& Dest, const void* Data, size_t NumBytes, size_t DestOffset = 0);
+		UploadToken UploadTexture(GpuResource& Dest, UINT FirstSubresource, UINT NumSubresources, const D3D12_SUBRESOURCE_DATA* SubData);
+
+		// Submits the batched uploads, returns the token of the last submitted batch
+		UploadToken Flush();
+		bool HasPendingUploads() const { return m_HasPendingUploads; }
+
+		bool IsUploadComplete(UploadToken Token);
+		// The command lists submitted to Queue after this call wait for the upload on the GPU
+		void WaitOnGPU(CommandQueue& Queue, UploadToken Token);
+		// The CPU waits for the upload
+		void WaitForUpload(UploadToken Token);
+
+		struct Stats
+		{
+			UINT32 NumUploads = 0;
+			UINT32 NumBatches = 0;
+			UINT64 UploadedBytes = 0;
+			// Uploads that waited for the GPU because the staging ring was full
+			UINT32 NumStagingStalls = 0;
+			size_t PeakStagingSize = 0;
+		};
+		Stats GetStats();
+
+	private:
+		struct Batch
+		{
+			UINT64 BatchId = 0;
+			// 0 if nothing was uploaded on the lane
+			UINT64 CopyFenceValue = 0;
+			UINT64 GraphicsFenceValue = 0;
+		};
+
+		// The functions below must be called with m_Mutex locked
+		// Staging memory for the current batch, returns the aligned offset. If the ring is full, the lock is released while
+		// the CPU waits for the oldest batch, the other threads keep recording uploads meanwhile
+		size_t AllocateStaging(size_t Size, size_t Alignment, std::unique_lock<std::mutex>& Lock);
+		// Uploads to a resource in the COMMON state are recorded on the copy queue. Called with m_Mutex locked, the batch
+		// contexts are begun without waiting for the GPU
+		CommandContext& GetBatchContext(GpuResource& Dest);
+		UploadToken FlushBatch();
+		void ReleaseCompletedBatches();
+		bool IsBatchComplete(const Batch& batch);
+		void WaitForBatch(const Batch& batch);
+
+		std::mutex m_Mutex;
+
+		Microsoft::WRL::ComPtr<ID3D12Resource> m_StagingBuffer;
+		UINT8* m_StagingCpuAddress = nullptr;
+		RingAllocationsManager m_StagingRing;
+
+		// Batch being recorded
+		UINT64 m_CurrentBatchId = 1;
+		CommandContext* m_CopyContext = nullptr;
+		CommandContext* m_GraphicsContext = nullptr;
+		std::atomic<bool> m_HasPendingUploads{ false };
+
+		// Submitted batches, oldest first
+		std::deque<Batch> m_SubmittedBatches;
+		UINT64 m_LastCompletedBatchId = 0;
+
+		Stats m_Stats;
+	};
+}
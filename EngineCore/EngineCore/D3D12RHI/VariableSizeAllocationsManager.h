@@ -286,6 +286,12 @@ namespace RHI
             return m_FreeBlocksByOffset.size();
         }
 
+        // Size of the largest free block, GetFreeSize() / GetLargestFreeBlockSize() shows how fragmented the free space is
+        size_t GetLargestFreeBlockSize() const
+        {
+            return m_FreeBlocksBySize.empty() ? 0 : m_FreeBlocksBySize.rbegin()->first;
+        }
+
         void Extend(size_t extraSize)
         {
             size_t newBlockOffset = m_MaxSize;
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+* Threads started once and kept for the parallel recording of command contexts (CommandContext::RecordParallel), so that
+* a frame recorded on N threads does not create and join N threads.
+*
+*   ParallelFor(count, func):  job { next index, done count } --> m_Jobs <-- workers take one index at a time
+*                              the calling thread takes indices too, then waits until every index is done
+*
+* Several threads may call ParallelFor at the same time, their jobs are served in order. func must not call ParallelFor.
+* Only uses the standard library, see Tests.
+*/
+namespace RHI
+{
+	class WorkerPool
+	{
+	public:
+		explicit WorkerPool(uint32_t numThreads)
+		{
+			m_Workers.reserve(numThreads);
+			for (uint32_t i = 0; i < numThreads; ++i)
+				m_Workers.emplace_back(&WorkerPool::WorkerThread, this);
+		}
+
+		~WorkerPool()
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				assert(m_Jobs.empty());
+				m_Shutdown = true;
+			}
+			m_JobAvailable.notify_all();
+
+			for (auto& worker : m_Workers)
+				worker.join();
+		}
+
+		WorkerPool(const WorkerPool&) = delete;
+		WorkerPool& operator = (const WorkerPool&) = delete;
+
+		uint32_t GetNumThreads() const { return static_cast<uint32_t>(m_Workers.size()); }
+
+		// Calls func(index) for every index in [0, count) and returns once all the calls returned.
+		// The calling thread runs index 0, the other indices go to the first thread free, the calling thread included
+		void ParallelFor(uint32_t count, const std::function<void(uint32_t)>& func)
+		{
+			if (count == 0)
+				return;
+
+			Job job{ &func, count };
+			job.NextIndex = 1;
+
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			if (count > 1)
+				m_Jobs.push_back(&job);
+			lock.unlock();
+			m_JobAvailable.notify_all();
+
+			func(0);
+
+			lock.lock();
+			++job.NumDone;
+			while (job.NextIndex < job.Count)
+				RunNextIndex(job, lock);
+
+			m_JobDone.wait(lock, [&job]() { return job.NumDone == job.Count; });
+		}
+
+	private:
+		struct Job
+		{
+			Job(const std::function<void(uint32_t)>* func, uint32_t count) :
+				Func{ func },
+				Count{ count }
+			{
+			}
+
+			const std::function<void(uint32_t)>* Func;
+			const uint32_t Count;
+			// Protected by m_Mutex
+			uint32_t NextIndex = 0;
+			uint32_t NumDone = 0;
+		};
+
+		// Takes the next index of the job and runs it outside the lock. The job leaves the queue with its last index
+		void RunNextIndex(Job& job, std::unique_lock<std::mutex>& lock)
+		{
+			uint32_t index = job.NextIndex++;
+			if (job.NextIndex == job.Count)
+				m_Jobs.erase(std::find(m_Jobs.begin(), m_Jobs.end(), &job));
+
+			lock.unlock();
+			(*job.Func)(index);
+			lock.lock();
+
+			if (++job.NumDone == job.Count)
+				m_JobDone.notify_all();
+		}
+
+		void WorkerThread()
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			while (true)
+			{
+				m_JobAvailable.wait(lock, [this]() { return m_Shutdown || !m_Jobs.empty(); });
+				if (m_Jobs.empty())
+					return;
+
+				RunNextIndex(*m_Jobs.front(), lock);
+			}
+		}
+
+		std::mutex m_Mutex;
+		std::condition_variable m_JobAvailable;
+		std::condition_variable m_JobDone;
+		// Jobs with indices left to take, in the order of the ParallelFor calls
+		std::deque<Job*> m_Jobs;
+		bool m_Shutdown = false;
+
+		std::vector<std::thread> m_Workers;
+	};
+}
@@ -41,4 +41,4 @@ private:
     do                                                                                    \
     {                                                                                     \
         Debug::Log(LOG_LEVEL::LOG_LEVEL_ERROR, __FUNCTION__, __FILE__, __LINE__, message); \
-    } while(false)
\ No newline at end of file
+    } while(false)
@@ -3,6 +3,7 @@
 #include <functional>
 #include <memory>
 #include <cstring>
+#include <cstdint>
 
 
 #define LOG_HASH_CONFLICTS 1
@@ -29,3 +30,17 @@ std::size_t ComputeHash(const ArgsType&... Args)
     return Seed;
 }
 
+
+
+// 64-bit FNV-1a of a range of bytes. Unlike std::hash, the result does not depend on the platform or the run,
+// so it can be used as a key in the files of the caches
+inline std::uint64_t ComputeFNV1aHash(const void* Data, std::size_t Size, std::uint64_t Hash = 14695981039346656037ull)
+{
+    const unsigned char* Bytes = static_cast<const unsigned char*>(Data);
+    for (std::size_t i = 0; i < Size; ++i)
+    {
+        Hash ^= Bytes[i];
+        Hash *= 1099511628211ull;
+    }
+    return Hash;
+}
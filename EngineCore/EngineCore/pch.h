@@ -56,6 +56,13 @@
 #include <cassert>
 #include <iostream>
 #include <limits>
+#include <numeric>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
+#include <functional>
+#include <chrono>
 
 // ENGINE
 #include "Common/Align.h"
@@ -67,7 +74,21 @@
 #define D3D12_GPU_VIRTUAL_ADDRESS_NULL      ((D3D12_GPU_VIRTUAL_ADDRESS)0)
 #define D3D12_GPU_VIRTUAL_ADDRESS_UNKNOWN   ((D3D12_GPU_VIRTUAL_ADDRESS)-1)
 
+// Free range manager of the descriptor heaps: 1 for TLSFAllocationsManager, 0 for the map based VariableSizeAllocationsManager.
+// Both have the same contract, Tests/DescriptorAllocatorBenchmark compares them
+#define DESCRIPTOR_HEAP_TLSF_ALLOCATOR 1
+
 // Dynamic resource page
 #define DYNAMIC_RESOURCE_PAGE_SIZE 1048576
+// Released dynamic pages are destroyed instead of pooled while more upload memory than this is resident
+#define DYNAMIC_RESOURCE_MAX_RESIDENT_SIZE 268435456
+// Pooled dynamic pages not reused for this number of frames are destroyed
+#define DYNAMIC_RESOURCE_PAGE_IDLE_FRAMES 120
+
+// Staging memory of the upload manager
+#define UPLOAD_STAGING_RING_SIZE 33554432
+
+// Command allocators per queue. Past this number the queue waits for the GPU to reuse one instead of creating more
+#define COMMAND_ALLOCATOR_POOL_MAX_SIZE 64
 
 #endif //PCH_H
@@ -0,0 +1,186 @@
+#include "TestCommon.h"
+#include "Common/BlobArchive.h"
+
+#include <random>
+
+using namespace RHI;
+
+/*
+* The file format of the pipeline state and shader caches: archives built from blobs are found again by hash, from bytes
+* that are not aligned too (a mapped file at any offset), and Open() rejects the bytes of another format, version or a
+* truncated or corrupted file instead of reading past them.
+*/
+namespace
+{
+    using TestArchive = BlobArchive<0x54534554, 3>; // "TEST"
+
+    std::vector<uint8_t> BuildArchive(const std::vector<std::pair<uint64_t, std::string>>& blobs)
+    {
+        std::vector<TestArchive::BlobRef> refs;
+        for (const auto& blob : blobs)
+            refs.push_back(TestArchive::BlobRef{ blob.first, blob.second.data(), blob.second.size() });
+        return TestArchive::Build(std::move(refs));
+    }
+
+    std::string FindString(const TestArchive& archive, uint64_t hash)
+    {
+        size_t size = 0;
+        const void* data = archive.Find(hash, size);
+        CHECK(data != nullptr || size == 0);
+        return data != nullptr ? std::string(static_cast<const char*>(data), size) : std::string("<none>");
+    }
+
+    void TestFind()
+    {
+        std::vector<uint8_t> bytes = BuildArchive({ { 30, "thirty" }, { 10, "ten" }, { 20, "" }, { 0xFFFFFFFFFFFFFFFFull, "max" } });
+        CHECK(bytes.size() % 8 == 0);
+
+        TestArchive archive;
+        CHECK(archive.Open(bytes.data(), bytes.size()));
+        CHECK(archive.GetNumEntries() == 4);
+        CHECK(FindString(archive, 10) == "ten");
+        CHECK(FindString(archive, 30) == "thirty");
+        CHECK(FindString(archive, 0xFFFFFFFFFFFFFFFFull) == "max");
+        CHECK(FindString(archive, 15) == "<none>");
+
+        // An empty blob is found, with a size of 0
+        size_t size = 1;
+        CHECK(archive.Find(20, size) != nullptr && size == 0);
+
+        // GetBlob lists the blobs in hash order
+        for (size_t i = 1; i < archive.GetNumEntries(); ++i)
+            CHECK(archive.GetBlob(i - 1).Hash < archive.GetBlob(i).Hash);
+
+        archive.Close();
+        CHECK(!archive.IsOpen() && archive.GetNumEntries() == 0);
+        CHECK(FindString(archive, 10) == "<none>");
+    }
+
+    // Blobs of the same hash: the first one given to Build is kept
+    void TestDuplicateHashes()
+    {
+        std::vector<uint8_t> bytes = BuildArchive({ { 5, "new" }, { 7, "other" }, { 5, "old" } });
+        TestArchive archive;
+        CHECK(archive.Open(bytes.data(), bytes.size()));
+        CHECK(archive.GetNumEntries() == 2);
+        CHECK(FindString(archive, 5) == "new");
+    }
+
+    // A mapped file is not aligned for the entries, the archive copies them
+    void TestUnalignedBytes()
+    {
+        std::vector<uint8_t> bytes = BuildArchive({ { 1, "one" }, { 2, "two" } });
+        std::vector<uint8_t> shifted(bytes.size() + 3);
+        memcpy(shifted.data() + 3, bytes.data(), bytes.size());
+
+        TestArchive archive;
+        CHECK(archive.Open(shifted.data() + 3, bytes.size()));
+        CHECK(FindString(archive, 2) == "two");
+    }
+
+    void TestEmptyArchive()
+    {
+        std::vector<uint8_t> bytes = TestArchive::Build({});
+        TestArchive archive;
+        CHECK(archive.Open(bytes.data(), bytes.size()));
+        CHECK(archive.GetNumEntries() == 0);
+        CHECK(FindString(archive, 0) == "<none>");
+    }
+
+    // Header = { Magic, Version, NumEntries }, Entry = { Hash, Offset, Size }
+    void TestRejectedBytes()
+    {
+        const std::vector<uint8_t> valid = BuildArchive({ { 1, "one" }, { 2, "two" }, { 3, "three" } });
+        constexpr size_t HeaderSize = 16;
+        constexpr size_t EntrySize = 24;
+
+        auto open = [](const std::vector<uint8_t>& bytes)
+        {
+            TestArchive archive;
+            return archive.Open(bytes.data(), bytes.size());
+        };
+
+        CHECK(open(valid));
+
+        TestArchive archive;
+        CHECK(!archive.Open(nullptr, 0));
+        CHECK(!archive.Open(valid.data(), HeaderSize - 1));
+
+        // The archive of another cache, or of another version of this one
+        std::vector<uint8_t> bytes = BlobArchive<0x54534554, 4>::Build({});
+        CHECK(!open(bytes));
+        bytes = BlobArchive<0x43444853, 3>::Build({});
+        CHECK(!open(bytes));
+
+        // More entries than the bytes hold
+        bytes = valid;
+        bytes.resize(HeaderSize + 2 * EntrySize);
+        CHECK(!open(bytes));
+
+        // A blob past the end of a truncated file
+        bytes = valid;
+        bytes.resize(bytes.size() - 8);
+        CHECK(!open(bytes));
+
+        // Entries out of hash order, Find could not search them
+        bytes = valid;
+        uint64_t hash = 9;
+        memcpy(bytes.data() + HeaderSize, &hash, sizeof(hash));
+        CHECK(!open(bytes));
+
+        // An offset that overflows with the size
+        bytes = valid;
+        uint64_t offset = std::numeric_limits<uint64_t>::max() - 1;
+        memcpy(bytes.data() + HeaderSize + EntrySize + 8, &offset, sizeof(offset));
+        CHECK(!open(bytes));
+
+        // A failed Open leaves the archive closed
+        CHECK(archive.Open(valid.data(), valid.size()));
+        CHECK(!archive.Open(bytes.data(), bytes.size()));
+        CHECK(!archive.IsOpen());
+    }
+
+    // Random blobs with random hashes are all found, random hashes that are not in the archive are not
+    void TestRandomBlobs()
+    {
+        std::mt19937_64 random(19);
+        std::map<uint64_t, std::string> expected;
+        std::vector<std::pair<uint64_t, std::string>> blobs;
+        for (int i = 0; i < 2000; ++i)
+        {
+            uint64_t hash = random();
+            std::string blob(random() % 300, '\0');
+            for (char& c : blob)
+                c = static_cast<char>(random());
+            if (expected.emplace(hash, blob).second)
+                blobs.emplace_back(hash, blob);
+        }
+
+        std::vector<uint8_t> bytes = BuildArchive(blobs);
+        TestArchive archive;
+        CHECK(archive.Open(bytes.data(), bytes.size()));
+        CHECK(archive.GetNumEntries() == expected.size());
+
+        for (const auto& blob : expected)
+            CHECK(FindString(archive, blob.first) == blob.second);
+        for (int i = 0; i < 2000; ++i)
+        {
+            uint64_t hash = random();
+            if (expected.count(hash) == 0)
+                CHECK(FindString(archive, hash) == "<none>");
+        }
+    }
+}
+
+int main()
+{
+    TestFind();
+    TestDuplicateHashes();
+    TestUnalignedBytes();
+    TestEmptyArchive();
+    TestRejectedBytes();
+    TestRandomBlobs();
+
+    std::printf("Blob archive: find, duplicate hashes, unaligned bytes, empty archive, rejected bytes and random blobs passed\n");
+    return 0;
+}
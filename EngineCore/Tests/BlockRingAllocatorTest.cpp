@@ -0,0 +1,200 @@
+#include "TestCommon.h"
+#include "D3D12RHI/BlockRingAllocator.h"
+
+#include <random>
+
+using namespace RHI;
+
+/*
+* Dynamic descriptor chunks of command contexts recorded for two queues. The chunks are retired out of order, each with the
+* fence of its own queue, and must only be reclaimed once that queue has reached it and every older chunk is reclaimed.
+*/
+namespace
+{
+    // Two queue timelines, like FenceTimelinePoint
+    struct TwoQueuePoint
+    {
+        UINT64 Values[2] = {};
+
+        bool IsCompleted(const TwoQueuePoint& completed) const
+        {
+            return Values[0] <= completed.Values[0] && Values[1] <= completed.Values[1];
+        }
+    };
+
+    TwoQueuePoint MakePoint(UINT64 graphics, UINT64 compute)
+    {
+        TwoQueuePoint point;
+        point.Values[0] = graphics;
+        point.Values[1] = compute;
+        return point;
+    }
+
+    using Ring = BlockRingAllocator<TwoQueuePoint>;
+
+    void TestOutOfOrderRetirement()
+    {
+        Ring ring(100);
+
+        Ring::Block graphics, recording, compute;
+        CHECK(ring.Allocate(30, graphics));
+        CHECK(ring.Allocate(30, recording));
+        CHECK(ring.Allocate(30, compute));
+        CHECK(graphics.Offset == 0 && recording.Offset == 30 && compute.Offset == 60);
+
+        ring.Retire(compute.Id, MakePoint(0, 5));
+        ring.Retire(graphics.Id, MakePoint(12, 0));
+
+        // The compute fence alone does not release anything, the graphics chunk is first
+        ring.ReleaseCompleted(MakePoint(11, 5));
+        CHECK(ring.GetUsedSize() == 90);
+
+        // The chunk still recorded holds back the compute chunk
+        ring.ReleaseCompleted(MakePoint(12, 5));
+        CHECK(ring.GetUsedSize() == 60);
+        CHECK(ring.GetNumBlocks() == 2);
+
+        // The graphics fence does not release the compute chunk
+        ring.Retire(recording.Id, MakePoint(13, 0));
+        ring.ReleaseCompleted(MakePoint(13, 4));
+        CHECK(ring.GetUsedSize() == 30);
+
+        ring.ReleaseCompleted(MakePoint(13, 5));
+        CHECK(ring.IsEmpty());
+        CHECK(ring.GetNumBlocks() == 0);
+    }
+
+    void TestWrapAround()
+    {
+        Ring ring(100);
+
+        Ring::Block first, second;
+        CHECK(ring.Allocate(60, first));
+        CHECK(ring.Allocate(30, second));
+        ring.Retire(first.Id, MakePoint(1, 0));
+        ring.ReleaseCompleted(MakePoint(1, 0));
+
+        // 10 free at the end, 60 at the beginning: the end is skipped and counted with the new block
+        Ring::Block wrapped;
+        CHECK(ring.Allocate(20, wrapped));
+        CHECK(wrapped.Offset == 0);
+        CHECK(ring.GetUsedSize() == 30 + 10 + 20);
+
+        Ring::Block tooLarge;
+        CHECK(!ring.Allocate(50, tooLarge));
+
+        // A default point is always completed: chunks of a context that was never submitted
+        ring.Retire(second.Id, TwoQueuePoint{});
+        ring.Retire(wrapped.Id, MakePoint(0, 2));
+        ring.ReleaseCompleted(MakePoint(0, 0));
+        CHECK(ring.GetUsedSize() == 30);
+        ring.ReleaseCompleted(MakePoint(0, 2));
+        CHECK(ring.IsEmpty());
+
+        // The empty ring starts again from the beginning
+        Ring::Block whole;
+        CHECK(ring.Allocate(100, whole));
+        CHECK(whole.Offset == 0);
+    }
+
+    // Contexts of both queues allocate, submit and retire in a random order, the GPU timelines progress randomly.
+    // Live blocks must never overlap, and a block must not be released before its fence is completed
+    void TestRandomSubmissions()
+    {
+        constexpr size_t RingSize = 1000;
+        Ring ring(RingSize);
+
+        std::mt19937 random(7);
+        std::vector<int> owner(RingSize, -1);
+
+        struct LiveBlock
+        {
+            Ring::Block Block;
+            bool Retired = false;
+            TwoQueuePoint Point;
+        };
+        std::vector<LiveBlock> live;
+        UINT64 nextFence[2] = { 1, 1 };
+        TwoQueuePoint completed;
+        int nextOwner = 0;
+
+        for (int step = 0; step < 200000; ++step)
+        {
+            switch (random() % 4)
+            {
+            case 0:
+            case 1:
+            {
+                Ring::Block block;
+                if (ring.Allocate(1 + random() % 64, block))
+                {
+                    for (size_t i = block.Offset; i < block.Offset + block.Size; ++i)
+                    {
+                        CHECK(owner[i] == -1);
+                        owner[i] = nextOwner;
+                    }
+                    ++nextOwner;
+                    LiveBlock liveBlock;
+                    liveBlock.Block = block;
+                    live.push_back(liveBlock);
+                }
+                break;
+            }
+            case 2:
+                if (!live.empty())
+                {
+                    LiveBlock& block = live[random() % live.size()];
+                    if (!block.Retired)
+                    {
+                        UINT32 queue = random() % 2;
+                        block.Point.Values[queue] = nextFence[queue]++;
+                        block.Retired = true;
+                        ring.Retire(block.Block.Id, block.Point);
+                    }
+                }
+                break;
+            default:
+            {
+                UINT32 queue = random() % 2;
+                if (completed.Values[queue] + 1 < nextFence[queue])
+                    ++completed.Values[queue];
+                ring.ReleaseCompleted(completed);
+
+                // Blocks are released from the oldest, live is in allocation order
+                size_t numReleased = live.size() - ring.GetNumBlocks();
+                for (size_t b = 0; b < numReleased; ++b)
+                {
+                    const LiveBlock& block = live[b];
+                    CHECK(block.Retired && block.Point.IsCompleted(completed));
+                    for (size_t i = block.Block.Offset; i < block.Block.Offset + block.Block.Size; ++i)
+                        owner[i] = -1;
+                }
+                live.erase(live.begin(), live.begin() + numReleased);
+
+                // The oldest block left is not releasable yet
+                if (!live.empty())
+                    CHECK(!live.front().Retired || !live.front().Point.IsCompleted(completed));
+                break;
+            }
+            }
+        }
+
+        for (LiveBlock& block : live)
+        {
+            if (!block.Retired)
+                ring.Retire(block.Block.Id, TwoQueuePoint{});
+        }
+        ring.ReleaseCompleted(MakePoint(~0ull, ~0ull));
+        CHECK(ring.IsEmpty());
+    }
+}
+
+int main()
+{
+    TestOutOfOrderRetirement();
+    TestWrapAround();
+    TestRandomSubmissions();
+
+    std::printf("Block ring: out of order retirement, wrap around and random submissions passed\n");
+    return 0;
+}
@@ -0,0 +1,193 @@
+#include "TestCommon.h"
+#include "D3D12RHI/BufferBlockAllocator.h"
+
+#include <random>
+
+using namespace RHI;
+
+/*
+* Block and range logic of GpuBufferAllocator with a CPU-only block device: every block is plain memory, the live buffers are
+* filled with their slot index and checked before they are freed, so an overlap between two ranges is detected.
+*/
+namespace
+{
+    class CpuBlockDevice
+    {
+    public:
+        struct BlockType
+        {
+            BlockType() = default;
+            BlockType(BlockType&& rhs) noexcept :
+                Memory{ std::move(rhs.Memory) },
+                Device{ rhs.Device }
+            {
+                rhs.Device = nullptr;
+            }
+            BlockType& operator = (BlockType&&) = delete;
+
+            ~BlockType()
+            {
+                if (Device != nullptr)
+                    --Device->m_NumLiveBlocks;
+            }
+
+            std::unique_ptr<UINT32[]> Memory;
+            CpuBlockDevice* Device = nullptr;
+        };
+
+        BlockType CreateBlock(UINT64 blockSize)
+        {
+            BlockType block;
+            block.Memory.reset(new UINT32[static_cast<size_t>(blockSize / sizeof(UINT32))]);
+            block.Device = this;
+            ++m_NumLiveBlocks;
+            ++m_NumCreatedBlocks;
+            return block;
+        }
+
+        UINT32 m_NumLiveBlocks = 0;
+        UINT32 m_NumCreatedBlocks = 0;
+    };
+
+    constexpr UINT64 BlockSize = 64 * 1024;
+    using Allocator = BufferBlockAllocator<CpuBlockDevice>;
+
+    void Fill(Allocator& allocator, UINT32 slot, UINT64 size)
+    {
+        const auto& range = allocator.GetRange(slot);
+        UINT32* memory = allocator.GetBlock(range.BlockId).Memory.get();
+        for (UINT64 i = range.Offset / 4; i < (range.Offset + size) / 4; ++i)
+            memory[i] = slot;
+    }
+
+    void Check(Allocator& allocator, UINT32 slot, UINT64 size)
+    {
+        const auto& range = allocator.GetRange(slot);
+        const UINT32* memory = allocator.GetBlock(range.BlockId).Memory.get();
+        for (UINT64 i = range.Offset / 4; i < (range.Offset + size) / 4; ++i)
+            CHECK(memory[i] == slot);
+    }
+
+    void TestAlignmentAndLimits()
+    {
+        CpuBlockDevice device;
+        Allocator allocator(device, BlockSize, BlockSize / 4);
+
+        CHECK(allocator.Allocate(BlockSize / 4 + 1, 256) == Allocator::InvalidSlot);
+        CHECK(!allocator.CanSubAllocate(0));
+        CHECK(device.m_NumCreatedBlocks == 0);
+
+        // Structured buffer of 12 byte elements in a constant buffer aligned range: lcm(256, 12) = 768
+        UINT32 first = allocator.Allocate(100, 256);
+        UINT32 structured = allocator.Allocate(12 * 10, 768);
+        CHECK(allocator.GetRange(first).Offset % 256 == 0);
+        CHECK(allocator.GetRange(structured).Offset % 768 == 0);
+        CHECK(allocator.GetRange(structured).Offset + 120 <= allocator.GetRange(structured).UnalignedOffset + allocator.GetRange(structured).Size);
+        CHECK(device.m_NumLiveBlocks == 1);
+
+        allocator.Free(first);
+        allocator.Free(structured);
+
+        // One empty block is kept for the next buffers
+        CHECK(device.m_NumLiveBlocks == 1);
+        CHECK(allocator.GetStats().NumAllocations == 0);
+    }
+
+    void TestFullestBlockFirst()
+    {
+        CpuBlockDevice device;
+        Allocator allocator(device, BlockSize, BlockSize);
+
+        // Fill two blocks, then free most of the second one
+        std::vector<UINT32> slots;
+        for (int i = 0; i < 32; ++i)
+            slots.push_back(allocator.Allocate(BlockSize / 16, 256));
+        CHECK(device.m_NumLiveBlocks == 2);
+
+        UINT32 secondBlock = allocator.GetRange(slots.back()).BlockId;
+        for (int i = 16; i < 31; ++i)
+            allocator.Free(slots[i]);
+
+        // The first block has a hole, the new range goes there and not to the nearly empty second block
+        UINT32 firstBlock = allocator.GetRange(slots[0]).BlockId;
+        allocator.Free(slots[3]);
+        UINT32 slot = allocator.Allocate(BlockSize / 32, 256);
+        CHECK(allocator.GetRange(slot).BlockId == firstBlock);
+
+        // The last range of the second block is freed: one empty block is kept, no other block is released
+        allocator.Free(slots[31]);
+        CHECK(device.m_NumLiveBlocks == 2);
+        CHECK(!allocator.IsBlockAlive(secondBlock) || allocator.GetBlockStats(secondBlock).NumAllocations == 0);
+
+        // The live ranges are walked in offset order, like a compaction pass
+        UINT64 previousOffset = 0;
+        bool firstRange = true;
+        allocator.ForEachLiveRange(firstBlock, [&](UINT32 liveSlot)
+        {
+            UINT64 offset = allocator.GetRange(liveSlot).UnalignedOffset;
+            CHECK(firstRange || offset > previousOffset);
+            previousOffset = offset;
+            firstRange = false;
+        });
+
+        allocator.Free(slot);
+        for (int i = 0; i < 16; ++i)
+        {
+            if (i != 3)
+                allocator.Free(slots[i]);
+        }
+        CHECK(device.m_NumLiveBlocks == 1);
+    }
+
+    // Random buffers of random sizes and alignments are created and released, the data of each one must survive the others
+    void TestRandomBuffers()
+    {
+        CpuBlockDevice device;
+        Allocator allocator(device, BlockSize, BlockSize / 2);
+
+        std::mt19937 random(11);
+        std::vector<std::pair<UINT32, UINT64>> live;
+        const UINT64 alignments[] = { 4, 16, 256, 512, 12, 20, 768 };
+
+        for (int step = 0; step < 50000; ++step)
+        {
+            if (live.size() < 200 && random() % 3 != 0)
+            {
+                UINT64 size = 4 * (1 + random() % 2048);
+                UINT64 alignment = alignments[random() % (sizeof(alignments) / sizeof(alignments[0]))];
+                UINT32 slot = allocator.Allocate(size, alignment);
+                CHECK(slot != Allocator::InvalidSlot);
+                CHECK(allocator.GetRange(slot).Offset % alignment == 0);
+                Fill(allocator, slot, size);
+                live.emplace_back(slot, size);
+            }
+            else if (!live.empty())
+            {
+                size_t index = random() % live.size();
+                Check(allocator, live[index].first, live[index].second);
+                allocator.Free(live[index].first);
+                live[index] = live.back();
+                live.pop_back();
+            }
+        }
+
+        for (const auto& buffer : live)
+        {
+            Check(allocator, buffer.first, buffer.second);
+            allocator.Free(buffer.first);
+        }
+
+        auto stats = allocator.GetStats();
+        CHECK(stats.NumAllocations == 0 && stats.UsedSize == 0);
+        CHECK(device.m_NumLiveBlocks == 1);
+        std::printf("Random buffers: %u blocks created, 1 kept\n", device.m_NumCreatedBlocks);
+    }
+}
+
+int main()
+{
+    TestAlignmentAndLimits();
+    TestFullestBlockFirst();
+    TestRandomBuffers();
+    return 0;
+}
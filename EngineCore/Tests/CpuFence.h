@@ -0,0 +1,108 @@
+#pragma once
+#include "TestCommon.h"
+#include "D3D12Types.h"
+#include "D3D12RHI/FenceWait.h"
+
+// Stand-in for ID3D12Fence completed by a CPU thread, and the events FenceWait.h blocks on. The events are auto-reset like the
+// Win32 events of the engine, a wait consumes them
+class CpuFenceEvent
+{
+public:
+    void Set()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_IsSet = true;
+        }
+        m_Condition.notify_all();
+    }
+
+    // Returns false if the deadline passed before the event was set
+    bool WaitUntil(std::chrono::steady_clock::time_point deadline, bool noTimeout)
+    {
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        if (noTimeout)
+            m_Condition.wait(lock, [this]() { return m_IsSet; });
+        else if (!m_Condition.wait_until(lock, deadline, [this]() { return m_IsSet; }))
+            return false;
+
+        m_IsSet = false;
+        return true;
+    }
+
+private:
+    std::mutex m_Mutex;
+    std::condition_variable m_Condition;
+    bool m_IsSet = false;
+};
+
+class CpuFence
+{
+public:
+    UINT64 GetCompletedValue() const { return m_CompletedValue.load(std::memory_order_acquire); }
+
+    // The fence keeps the event alive until it is set, like a fence holding a Win32 event after the wait closed its handle
+    void SetEventOnCompletion(UINT64 value, std::shared_ptr<CpuFenceEvent> event)
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if (m_CompletedValue.load(std::memory_order_relaxed) >= value)
+            event->Set();
+        else
+            m_Events.emplace_back(value, std::move(event));
+    }
+
+    void Signal(UINT64 value)
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_CompletedValue.store(value, std::memory_order_release);
+
+        auto completed = std::partition(m_Events.begin(), m_Events.end(), [value](const auto& entry) { return entry.first > value; });
+        for (auto it = completed; it != m_Events.end(); ++it)
+            it->second->Set();
+        m_Events.erase(completed, m_Events.end());
+    }
+
+    size_t GetNumRegisteredEvents()
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        return m_Events.size();
+    }
+
+private:
+    std::atomic<UINT64> m_CompletedValue{ 0 };
+    std::mutex m_Mutex;
+    std::vector<std::pair<UINT64, std::shared_ptr<CpuFenceEvent>>> m_Events;
+};
+
+// The events of one waiting thread
+struct CpuFenceEvents
+{
+    static constexpr UINT32 MaxEvents = 64;
+
+    std::shared_ptr<CpuFenceEvent> Events[MaxEvents];
+
+    void SetEventOnCompletion(UINT32 index, CpuFence& fence, UINT64 value)
+    {
+        if (Events[index] == nullptr)
+            Events[index] = std::make_shared<CpuFenceEvent>();
+        fence.SetEventOnCompletion(value, Events[index]);
+    }
+
+    RHI::FenceEventResult Wait(UINT32 numEvents, UINT32 timeoutMilliseconds)
+    {
+        bool noTimeout = timeoutMilliseconds == RHI::FENCE_WAIT_NO_TIMEOUT;
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(noTimeout ? 0 : timeoutMilliseconds);
+        for (UINT32 i = 0; i < numEvents; ++i)
+        {
+            if (!Events[i]->WaitUntil(deadline, noTimeout))
+                return RHI::FenceEventResult::Timeout;
+        }
+        return RHI::FenceEventResult::Signaled;
+    }
+
+    void Discard()
+    {
+        for (auto& event : Events)
+            event.reset();
+    }
+};
@@ -0,0 +1,224 @@
+#pragma once
+
+// The D3D12 types used by the engine sources compiled in the tests (see engine_core_source_test), without a device.
+// Windows builds use the real headers
+#if defined(_WIN32)
+#include <wrl.h>
+#include <d3d12.h>
+#include <d3d12shader.h>
+#include <D3Dcompiler.h>
+#include "Common/d3dx12.h"
+#else
+struct ID3D12Device;
+struct ID3D12Resource;
+struct ID3D12Fence;
+
+using HRESULT = long;
+#define S_OK ((HRESULT)0L)
+#define SUCCEEDED(hr) (((HRESULT)(hr)) >= 0)
+#define FAILED(hr) (((HRESULT)(hr)) < 0)
+
+enum D3D12_COMMAND_LIST_TYPE
+{
+    D3D12_COMMAND_LIST_TYPE_DIRECT = 0,
+    D3D12_COMMAND_LIST_TYPE_BUNDLE = 1,
+    D3D12_COMMAND_LIST_TYPE_COMPUTE = 2,
+    D3D12_COMMAND_LIST_TYPE_COPY = 3
+};
+
+enum D3D12_RESOURCE_STATES
+{
+    D3D12_RESOURCE_STATE_COMMON = 0,
+    D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER = 0x1,
+    D3D12_RESOURCE_STATE_INDEX_BUFFER = 0x2,
+    D3D12_RESOURCE_STATE_RENDER_TARGET = 0x4,
+    D3D12_RESOURCE_STATE_UNORDERED_ACCESS = 0x8,
+    D3D12_RESOURCE_STATE_DEPTH_WRITE = 0x10,
+    D3D12_RESOURCE_STATE_DEPTH_READ = 0x20,
+    D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE = 0x40,
+    D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE = 0x80,
+    D3D12_RESOURCE_STATE_STREAM_OUT = 0x100,
+    D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT = 0x200,
+    D3D12_RESOURCE_STATE_COPY_DEST = 0x400,
+    D3D12_RESOURCE_STATE_COPY_SOURCE = 0x800,
+    D3D12_RESOURCE_STATE_GENERIC_READ = 0x1 | 0x2 | 0x40 | 0x80 | 0x200 | 0x800
+};
+
+inline D3D12_RESOURCE_STATES operator | (D3D12_RESOURCE_STATES a, D3D12_RESOURCE_STATES b)
+{
+    return static_cast<D3D12_RESOURCE_STATES>(static_cast<int>(a) | static_cast<int>(b));
+}
+
+inline D3D12_RESOURCE_STATES operator & (D3D12_RESOURCE_STATES a, D3D12_RESOURCE_STATES b)
+{
+    return static_cast<D3D12_RESOURCE_STATES>(static_cast<int>(a) & static_cast<int>(b));
+}
+
+inline D3D12_RESOURCE_STATES operator ~ (D3D12_RESOURCE_STATES a)
+{
+    return static_cast<D3D12_RESOURCE_STATES>(~static_cast<int>(a));
+}
+
+constexpr UINT D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES = 0xffffffff;
+
+enum D3D12_RESOURCE_BARRIER_TYPE
+{
+    D3D12_RESOURCE_BARRIER_TYPE_TRANSITION = 0,
+    D3D12_RESOURCE_BARRIER_TYPE_ALIASING = 1,
+    D3D12_RESOURCE_BARRIER_TYPE_UAV = 2
+};
+
+enum D3D12_RESOURCE_BARRIER_FLAGS
+{
+    D3D12_RESOURCE_BARRIER_FLAG_NONE = 0,
+    D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY = 0x1,
+    D3D12_RESOURCE_BARRIER_FLAG_END_ONLY = 0x2
+};
+
+struct D3D12_RESOURCE_TRANSITION_BARRIER
+{
+    ID3D12Resource* pResource;
+    UINT Subresource;
+    D3D12_RESOURCE_STATES StateBefore;
+    D3D12_RESOURCE_STATES StateAfter;
+};
+
+struct D3D12_RESOURCE_UAV_BARRIER
+{
+    ID3D12Resource* pResource;
+};
+
+struct D3D12_RESOURCE_BARRIER
+{
+    D3D12_RESOURCE_BARRIER_TYPE Type;
+    D3D12_RESOURCE_BARRIER_FLAGS Flags;
+    union
+    {
+        D3D12_RESOURCE_TRANSITION_BARRIER Transition;
+        D3D12_RESOURCE_UAV_BARRIER UAV;
+    };
+};
+
+struct CD3DX12_RESOURCE_BARRIER : public D3D12_RESOURCE_BARRIER
+{
+    static CD3DX12_RESOURCE_BARRIER Transition(ID3D12Resource* pResource, D3D12_RESOURCE_STATES stateBefore, D3D12_RESOURCE_STATES stateAfter,
+        UINT subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, D3D12_RESOURCE_BARRIER_FLAGS flags = D3D12_RESOURCE_BARRIER_FLAG_NONE)
+    {
+        CD3DX12_RESOURCE_BARRIER result;
+        // The static function hides the Transition member
+        D3D12_RESOURCE_BARRIER& barrier = result;
+        barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+        barrier.Flags = flags;
+        barrier.Transition.pResource = pResource;
+        barrier.Transition.StateBefore = stateBefore;
+        barrier.Transition.StateAfter = stateAfter;
+        barrier.Transition.Subresource = subresource;
+        return result;
+    }
+};
+
+enum D3D12_DESCRIPTOR_RANGE_TYPE
+{
+    D3D12_DESCRIPTOR_RANGE_TYPE_SRV = 0,
+    D3D12_DESCRIPTOR_RANGE_TYPE_UAV = 1,
+    D3D12_DESCRIPTOR_RANGE_TYPE_CBV = 2,
+    D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER = 3
+};
+
+enum D3D12_SHADER_VISIBILITY
+{
+    D3D12_SHADER_VISIBILITY_ALL = 0,
+    D3D12_SHADER_VISIBILITY_VERTEX = 1,
+    D3D12_SHADER_VISIBILITY_HULL = 2,
+    D3D12_SHADER_VISIBILITY_DOMAIN = 3,
+    D3D12_SHADER_VISIBILITY_GEOMETRY = 4,
+    D3D12_SHADER_VISIBILITY_PIXEL = 5
+};
+
+// Shader reflection, without a compiler: the bytecode given to D3DReflect by the tests is their ID3D12ShaderReflection
+enum D3D_SHADER_INPUT_TYPE
+{
+    D3D_SIT_CBUFFER = 0,
+    D3D_SIT_TBUFFER,
+    D3D_SIT_TEXTURE,
+    D3D_SIT_SAMPLER,
+    D3D_SIT_UAV_RWTYPED,
+    D3D_SIT_STRUCTURED,
+    D3D_SIT_UAV_RWSTRUCTURED,
+    D3D_SIT_BYTEADDRESS,
+    D3D_SIT_UAV_RWBYTEADDRESS,
+    D3D_SIT_UAV_APPEND_STRUCTURED,
+    D3D_SIT_UAV_CONSUME_STRUCTURED,
+    D3D_SIT_UAV_RWSTRUCTURED_WITH_COUNTER
+};
+
+enum D3D_SRV_DIMENSION
+{
+    D3D_SRV_DIMENSION_UNKNOWN = 0,
+    D3D_SRV_DIMENSION_BUFFER,
+    D3D_SRV_DIMENSION_TEXTURE1D,
+    D3D_SRV_DIMENSION_TEXTURE1DARRAY,
+    D3D_SRV_DIMENSION_TEXTURE2D,
+    D3D_SRV_DIMENSION_TEXTURE2DARRAY,
+    D3D_SRV_DIMENSION_TEXTURE2DMS,
+    D3D_SRV_DIMENSION_TEXTURE2DMSARRAY,
+    D3D_SRV_DIMENSION_TEXTURE3D,
+    D3D_SRV_DIMENSION_TEXTURECUBE,
+    D3D_SRV_DIMENSION_TEXTURECUBEARRAY,
+    D3D_SRV_DIMENSION_BUFFEREX
+};
+
+struct D3D12_SHADER_DESC
+{
+    UINT Version;
+    UINT BoundResources;
+};
+
+struct D3D12_SHADER_INPUT_BIND_DESC
+{
+    const char* Name;
+    D3D_SHADER_INPUT_TYPE Type;
+    UINT BindPoint;
+    UINT BindCount;
+    D3D_SRV_DIMENSION Dimension;
+};
+
+struct ID3DBlob
+{
+    virtual void* GetBufferPointer() = 0;
+    virtual SIZE_T GetBufferSize() = 0;
+};
+
+struct ID3D12ShaderReflection
+{
+    virtual HRESULT GetDesc(D3D12_SHADER_DESC* pDesc) = 0;
+    virtual HRESULT GetResourceBindingDesc(UINT ResourceIndex, D3D12_SHADER_INPUT_BIND_DESC* pDesc) = 0;
+};
+
+#define IID_PPV_ARGS(ppType) reinterpret_cast<void**>(ppType)
+
+inline HRESULT D3DReflect(const void* pSrcData, SIZE_T, void** ppReflector)
+{
+    *ppReflector = const_cast<void*>(pSrcData);
+    return S_OK;
+}
+
+namespace Microsoft
+{
+    namespace WRL
+    {
+        // Holds the pointer without reference counting, nothing is created through it
+        template<typename T>
+        class ComPtr
+        {
+        public:
+            T* Get() const { return m_Ptr; }
+            T* operator -> () const { return m_Ptr; }
+            T** GetAddressOf() { return &m_Ptr; }
+
+        private:
+            T* m_Ptr = nullptr;
+        };
+    }
+}
+#endif
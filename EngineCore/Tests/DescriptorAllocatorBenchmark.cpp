@@ -0,0 +1,100 @@
+#include "TestCommon.h"
+#include "D3D12RHI/TLSFAllocationsManager.h"
+
+#include <random>
+
+using namespace RHI;
+
+/*
+* Compares the two free range managers of the descriptor heaps (DESCRIPTOR_HEAP_TLSF_ALLOCATOR) on the same random sequence
+* of allocations and releases of 1 to 64 descriptors, the sizes of the descriptor tables and of the view arrays.
+* Every range handed out is checked against a map of the heap, so the benchmark also tests that no range is given twice.
+*/
+namespace
+{
+    struct BenchmarkResult
+    {
+        double NanosecondsPerOperation = 0.0;
+        size_t NumFailedAllocations = 0;
+        // Largest free range / free descriptors after the run, 1 means no fragmentation
+        double LargestFreeRatio = 0.0;
+    };
+
+    // With verify, every range is checked against the map of the heap and the run is not timed
+    template <typename ManagerType>
+    BenchmarkResult RunBenchmark(size_t heapSize, size_t numOperations, unsigned seed, bool verify)
+    {
+        ManagerType manager(heapSize);
+        std::vector<bool> used(heapSize, false);
+        std::vector<typename ManagerType::Allocation> live;
+        live.reserve(heapSize);
+
+        std::mt19937 rng(seed);
+        std::uniform_int_distribution<size_t> sizeDist(1, 64);
+
+        BenchmarkResult result;
+        BenchmarkTimer timer;
+        for (size_t i = 0; i < numOperations; ++i)
+        {
+            // Keep the heap around three quarters full, where the managers have to search
+            bool allocate = live.empty() || (manager.GetUsedSize() < heapSize * 3 / 4 && rng() % 2 == 0);
+            if (allocate)
+            {
+                auto allocation = manager.Allocate(sizeDist(rng), 1);
+                if (!allocation.IsValid())
+                {
+                    ++result.NumFailedAllocations;
+                    continue;
+                }
+
+                for (size_t d = allocation.unalignedOffset; verify && d < allocation.unalignedOffset + allocation.size; ++d)
+                {
+                    CHECK(d < heapSize && !used[d]);
+                    used[d] = true;
+                }
+                live.push_back(std::move(allocation));
+            }
+            else
+            {
+                size_t index = rng() % live.size();
+                std::swap(live[index], live.back());
+
+                for (size_t d = live.back().unalignedOffset; verify && d < live.back().unalignedOffset + live.back().size; ++d)
+                    used[d] = false;
+
+                manager.Free(std::move(live.back()));
+                live.pop_back();
+            }
+        }
+        result.NanosecondsPerOperation = timer.GetMilliseconds() * 1e6 / numOperations;
+        result.LargestFreeRatio = static_cast<double>(manager.GetLargestFreeBlockSize()) / std::max<size_t>(manager.GetFreeSize(), 1);
+
+        for (auto& allocation : live)
+            manager.Free(std::move(allocation));
+        CHECK(manager.GetFreeSize() == heapSize);
+        CHECK(manager.GetLargestFreeBlockSize() == heapSize);
+        return result;
+    }
+
+    template <typename ManagerType>
+    void Report(const char* name, size_t heapSize, size_t numOperations)
+    {
+        RunBenchmark<ManagerType>(heapSize, std::min<size_t>(numOperations, 100000), 7, true);
+        BenchmarkResult result = RunBenchmark<ManagerType>(heapSize, numOperations, 42, false);
+        std::printf("%-32s heap %6zu: %8.1f ns/op, %zu failed allocations, largest free range %.2f of the free space\n",
+            name, heapSize, result.NanosecondsPerOperation, result.NumFailedAllocations, result.LargestFreeRatio);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    size_t numOperations = IsFullBenchmark(argc, argv) ? 2000000 : 50000;
+
+    // The CPU heaps of the render device have 1024 to 8192 descriptors, the static part of the GPU heap 16384
+    for (size_t heapSize : { 1024, 8192, 16384 })
+    {
+        Report<VariableSizeAllocationsManager>("VariableSizeAllocationsManager", heapSize, numOperations);
+        Report<TLSFAllocationsManager>("TLSFAllocationsManager", heapSize, numOperations);
+    }
+    return 0;
+}
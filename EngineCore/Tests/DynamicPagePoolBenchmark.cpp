@@ -0,0 +1,207 @@
+#include "TestCommon.h"
+#include "D3D12RHI/DynamicPagePool.h"
+
+#include <random>
+
+using namespace RHI;
+
+/*
+* Throughput of the upload page pool of DynamicResourceAllocator with 1 to 16 threads, each one standing for a command context:
+* take a page, write a few constants in it, give it back. Compared with the pool it replaced, a multimap of pages behind a mutex.
+* Each page records the thread using it, so the benchmark also checks that a page is never handed out to two threads.
+*/
+namespace
+{
+    class CpuPageDevice
+    {
+    public:
+        class PageType
+        {
+        public:
+            PageType() = default;
+            PageType(UINT64 size) :
+                m_Memory{ new UINT32[static_cast<size_t>(size / sizeof(UINT32))] },
+                m_Size{ size }
+            {
+            }
+
+            PageType(PageType&& rhs) noexcept :
+                m_Memory{ std::move(rhs.m_Memory) },
+                m_Size{ rhs.m_Size },
+                m_User{ rhs.m_User.load(std::memory_order_relaxed) }
+            {
+                rhs.m_Size = 0;
+            }
+
+            PageType& operator = (PageType&& rhs) noexcept
+            {
+                m_Memory = std::move(rhs.m_Memory);
+                m_Size = rhs.m_Size;
+                m_User.store(rhs.m_User.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                rhs.m_Size = 0;
+                return *this;
+            }
+
+            UINT64 GetSize() const { return m_Size; }
+            bool IsValid() const { return m_Memory != nullptr; }
+            UINT32* GetMemory() { return m_Memory.get(); }
+
+            // Returns false if another thread uses the page
+            bool BeginUse(UINT32 user)
+            {
+                UINT32 noUser = InvalidUser;
+                return m_User.compare_exchange_strong(noUser, user);
+            }
+
+            bool EndUse(UINT32 user)
+            {
+                return m_User.compare_exchange_strong(user, InvalidUser);
+            }
+
+        private:
+            static constexpr UINT32 InvalidUser = static_cast<UINT32>(-1);
+
+            std::unique_ptr<UINT32[]> m_Memory;
+            UINT64 m_Size = 0;
+            std::atomic<UINT32> m_User{ InvalidUser };
+        };
+
+        PageType CreatePage(UINT64 size)
+        {
+            m_NumCreatedPages.fetch_add(1, std::memory_order_relaxed);
+            return PageType{ size };
+        }
+
+        std::atomic<UINT64> m_NumCreatedPages{ 0 };
+    };
+
+    using PageType = CpuPageDevice::PageType;
+
+    // The page pool before DynamicPagePool: pages sorted by size, one lock for every context
+    class MutexPagePool
+    {
+    public:
+        MutexPagePool(CpuPageDevice& device, UINT64 basePageSize) :
+            m_Device{ device },
+            m_BasePageSize{ basePageSize }
+        {
+        }
+
+        PageType AllocatePage(UINT64 sizeInBytes)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                auto pageIt = m_AvailablePages.lower_bound(sizeInBytes);
+                if (pageIt != m_AvailablePages.end())
+                {
+                    PageType page(std::move(pageIt->second));
+                    m_AvailablePages.erase(pageIt);
+                    return page;
+                }
+            }
+
+            UINT64 pageSize = m_BasePageSize;
+            while (pageSize < sizeInBytes)
+                pageSize *= 2;
+            return m_Device.CreatePage(pageSize);
+        }
+
+        void RecyclePage(PageType&& page)
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            UINT64 pageSize = page.GetSize();
+            m_AvailablePages.emplace(pageSize, std::move(page));
+        }
+
+        void FinishFrame() {}
+        void Destroy() { m_AvailablePages.clear(); }
+
+    private:
+        CpuPageDevice& m_Device;
+        const UINT64 m_BasePageSize;
+        std::mutex m_Mutex;
+        std::multimap<UINT64, PageType> m_AvailablePages;
+    };
+
+    constexpr UINT64 BasePageSize = 4096;
+
+    // A context writes a few constant buffers in its page, like a frame of draw calls
+    void WriteConstants(PageType& page, UINT32 user)
+    {
+        UINT32* memory = page.GetMemory();
+        for (UINT32 i = 0; i < 64; ++i)
+            memory[i] = user + i;
+        for (UINT32 i = 0; i < 64; ++i)
+            CHECK(memory[i] == user + i);
+    }
+
+    // Returns the pages per second of all threads together
+    template <typename PoolType>
+    double RunBenchmark(PoolType& pool, UINT32 numThreads, UINT32 numPagesPerThread)
+    {
+        std::atomic<bool> start{ false };
+        std::vector<std::thread> threads;
+        for (UINT32 t = 0; t < numThreads; ++t)
+        {
+            threads.emplace_back([&pool, &start, t, numPagesPerThread]()
+            {
+                std::mt19937 random(t);
+                while (!start.load(std::memory_order_acquire))
+                    std::this_thread::yield();
+
+                for (UINT32 i = 0; i < numPagesPerThread; ++i)
+                {
+                    // Mostly base pages, sometimes a context that needs a larger one
+                    UINT64 size = BasePageSize << ((random() % 8 == 0) ? random() % 3 : 0);
+                    PageType page = pool.AllocatePage(size);
+                    CHECK(page.IsValid() && page.GetSize() >= size);
+                    CHECK(page.BeginUse(t));
+                    WriteConstants(page, t);
+                    CHECK(page.EndUse(t));
+                    pool.RecyclePage(std::move(page));
+
+                    // The render thread ends frames while the other contexts record
+                    if (t == 0 && i % 256 == 255)
+                        pool.FinishFrame();
+                }
+            });
+        }
+
+        BenchmarkTimer timer;
+        start.store(true, std::memory_order_release);
+        for (auto& thread : threads)
+            thread.join();
+        double milliseconds = timer.GetMilliseconds();
+
+        return numThreads * static_cast<double>(numPagesPerThread) * 1000.0 / std::max(milliseconds, 1e-3);
+    }
+
+    void Report(UINT32 numThreads, UINT32 numPagesPerThread)
+    {
+        CpuPageDevice lockFreeDevice;
+        DynamicPagePool<CpuPageDevice> lockFreePool(lockFreeDevice, BasePageSize, 256 * BasePageSize, 120);
+        double lockFreeRate = RunBenchmark(lockFreePool, numThreads, numPagesPerThread);
+        auto stats = lockFreePool.GetStats();
+        CHECK(stats.NumResidentPages == stats.NumPooledPages);
+        lockFreePool.Destroy();
+        CHECK(lockFreePool.GetStats().ResidentSize == 0);
+
+        CpuPageDevice mutexDevice;
+        MutexPagePool mutexPool(mutexDevice, BasePageSize);
+        double mutexRate = RunBenchmark(mutexPool, numThreads, numPagesPerThread);
+        mutexPool.Destroy();
+
+        std::printf("%2u threads: DynamicPagePool %7.2f M pages/s (%3llu pages created), mutex + multimap %7.2f M pages/s (%3llu pages created)\n",
+            numThreads, lockFreeRate / 1e6, static_cast<unsigned long long>(lockFreeDevice.m_NumCreatedPages.load()),
+            mutexRate / 1e6, static_cast<unsigned long long>(mutexDevice.m_NumCreatedPages.load()));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    UINT32 numPagesPerThread = IsFullBenchmark(argc, argv) ? 1000000 : 20000;
+
+    for (UINT32 numThreads : { 1, 2, 4, 8, 16 })
+        Report(numThreads, numPagesPerThread);
+    return 0;
+}
@@ -0,0 +1,215 @@
+#include "TestCommon.h"
+#include "D3D12RHI/DynamicPagePool.h"
+
+using namespace RHI;
+
+/*
+* Page sizes, resident budget and idle page trimming of the upload page pool of DynamicResourceAllocator, with CPU pages.
+*/
+namespace
+{
+    class CpuPageDevice
+    {
+    public:
+        class PageType
+        {
+        public:
+            PageType() = default;
+            PageType(UINT64 size) :
+                m_Memory{ new UINT8[static_cast<size_t>(size)] },
+                m_Size{ size }
+            {
+            }
+
+            PageType(PageType&& rhs) noexcept :
+                m_Memory{ std::move(rhs.m_Memory) },
+                m_Size{ rhs.m_Size }
+            {
+                rhs.m_Size = 0;
+            }
+
+            PageType& operator = (PageType&& rhs) noexcept
+            {
+                m_Memory = std::move(rhs.m_Memory);
+                m_Size = rhs.m_Size;
+                rhs.m_Size = 0;
+                return *this;
+            }
+
+            UINT64 GetSize() const { return m_Size; }
+            bool IsValid() const { return m_Memory != nullptr; }
+
+        private:
+            std::unique_ptr<UINT8[]> m_Memory;
+            UINT64 m_Size = 0;
+        };
+
+        PageType CreatePage(UINT64 size) { return PageType{ size }; }
+    };
+
+    using Pool = DynamicPagePool<CpuPageDevice>;
+
+    constexpr UINT64 BasePageSize = 1024;
+
+    void TestPageSizes()
+    {
+        CpuPageDevice device;
+        Pool pool(device, BasePageSize, 1024 * BasePageSize, 10);
+
+        // A few base pages at most are pooled
+        CHECK(pool.GetMaxPageSize() == BasePageSize << (Pool::NumSizeClasses - 1));
+
+        auto page = pool.AllocatePage(BasePageSize + 1);
+        CHECK(page.GetSize() == 2 * BasePageSize);
+        pool.RecyclePage(std::move(page));
+        CHECK(pool.GetStats().NumPooledPages == 1);
+
+        // A smaller request takes the pooled page instead of creating one
+        page = pool.AllocatePage(10);
+        CHECK(page.GetSize() == 2 * BasePageSize);
+        CHECK(pool.GetStats().NumPagesCreated == 1);
+        pool.RecyclePage(std::move(page));
+
+        // A large upload gets a dedicated page of its size, which is not pooled
+        UINT64 largeSize = pool.GetMaxPageSize() * 3 + 100;
+        auto largePage = pool.AllocatePage(largeSize);
+        CHECK(largePage.GetSize() == largeSize);
+        pool.RecyclePage(std::move(largePage));
+
+        auto stats = pool.GetStats();
+        CHECK(stats.NumPooledPages == 1 && stats.NumResidentPages == 1);
+        CHECK(stats.ResidentSize == 2 * BasePageSize);
+        CHECK(stats.PeakResidentSize == 2 * BasePageSize + largeSize);
+
+        pool.Destroy();
+    }
+
+    void TestResidentBudget()
+    {
+        CpuPageDevice device;
+        const UINT64 maxResidentSize = 8 * BasePageSize;
+        Pool pool(device, BasePageSize, maxResidentSize, 10);
+
+        // Pooled pages make room for the new ones
+        std::vector<Pool::PageType> pages;
+        for (int i = 0; i < 8; ++i)
+            pages.push_back(pool.AllocatePage(BasePageSize));
+        for (auto& page : pages)
+            pool.RecyclePage(std::move(page));
+        pages.clear();
+
+        auto largePage = pool.AllocatePage(4 * BasePageSize);
+        CHECK(largePage.IsValid());
+        CHECK(pool.GetStats().ResidentSize == maxResidentSize);
+        CHECK(pool.GetStats().NumPooledPages == 4);
+
+        // The pages in use take the whole budget, the next page is not created
+        for (int i = 0; i < 4; ++i)
+            pages.push_back(pool.AllocatePage(BasePageSize));
+        CHECK(pool.GetStats().NumPooledPages == 0);
+
+        auto failedPage = pool.AllocatePage(BasePageSize);
+        CHECK(!failedPage.IsValid());
+        auto stats = pool.GetStats();
+        CHECK(stats.NumFailedPages == 1);
+        CHECK(stats.ResidentSize == maxResidentSize && stats.PeakResidentSize == maxResidentSize);
+
+        pool.RecyclePage(std::move(largePage));
+        for (auto& page : pages)
+            pool.RecyclePage(std::move(page));
+        pool.Destroy();
+        CHECK(pool.GetStats().ResidentSize == 0);
+    }
+
+    // Four pages are needed every frame, a burst needs twelve once: the eight pages of the burst are trimmed at the end
+    // of the next full period, the pages in use every frame stay
+    void TestIdleTrim()
+    {
+        CpuPageDevice device;
+        constexpr UINT32 PageIdleFrames = 10;
+        Pool pool(device, BasePageSize, 1024 * BasePageSize, PageIdleFrames);
+
+        auto RunFrame = [&pool](int numPages)
+        {
+            std::vector<Pool::PageType> pages;
+            for (int i = 0; i < numPages; ++i)
+                pages.push_back(pool.AllocatePage(BasePageSize));
+            for (auto& page : pages)
+                pool.RecyclePage(std::move(page));
+            pool.FinishFrame();
+        };
+
+        RunFrame(12);
+        for (UINT32 frame = 1; frame < 3 * PageIdleFrames; ++frame)
+            RunFrame(4);
+
+        auto stats = pool.GetStats();
+        CHECK(stats.NumPagesCreated == 12);
+        CHECK(stats.NumPagesTrimmed == 8);
+        CHECK(stats.NumPooledPages == 4);
+
+        // Nothing is used anymore, everything is trimmed within two periods
+        for (UINT32 frame = 0; frame < 2 * PageIdleFrames; ++frame)
+            pool.FinishFrame();
+        CHECK(pool.GetStats().NumPooledPages == 0);
+        CHECK(pool.GetStats().ResidentSize == 0);
+
+        pool.Destroy();
+    }
+
+    // Contexts take and return pages while the render thread trims: the pages in use are never lost,
+    // and the resident memory never goes over the budget
+    void TestConcurrentTrim()
+    {
+        CpuPageDevice device;
+        const UINT64 maxResidentSize = 64 * BasePageSize;
+        Pool pool(device, BasePageSize, maxResidentSize, 2);
+
+        std::atomic<bool> done{ false };
+        std::vector<std::thread> threads;
+        for (UINT32 t = 0; t < 4; ++t)
+        {
+            threads.emplace_back([&pool, t]()
+            {
+                for (UINT32 i = 0; i < 20000; ++i)
+                {
+                    auto page = pool.AllocatePage(BasePageSize << ((i + t) % 3));
+                    CHECK(page.IsValid());
+                    pool.RecyclePage(std::move(page));
+                }
+            });
+        }
+
+        std::thread renderThread([&pool, &done, maxResidentSize]()
+        {
+            while (!done.load())
+            {
+                pool.FinishFrame();
+                CHECK(pool.GetStats().ResidentSize <= maxResidentSize);
+                std::this_thread::yield();
+            }
+        });
+
+        for (auto& thread : threads)
+            thread.join();
+        done.store(true);
+        renderThread.join();
+
+        auto stats = pool.GetStats();
+        CHECK(stats.NumResidentPages == stats.NumPooledPages);
+        CHECK(stats.PeakResidentSize <= maxResidentSize);
+        pool.Destroy();
+        CHECK(pool.GetStats().ResidentSize == 0);
+    }
+}
+
+int main()
+{
+    TestPageSizes();
+    TestResidentBudget();
+    TestIdleTrim();
+    TestConcurrentTrim();
+
+    std::printf("Dynamic page pool: page sizes, resident budget and idle trim passed\n");
+    return 0;
+}
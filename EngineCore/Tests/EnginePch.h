@@ -0,0 +1,10 @@
+#pragma once
+
+// Replaces the precompiled header of the engine for the sources compiled by engine_core_source_test:
+// they are copied to the build directory, where this file is their "../pch.h"
+#include "TestCommon.h"
+#include "D3D12Types.h"
+#include "Common/GraphicsEnums.h"
+
+// A failed call ends the test, the engine throws a DxException
+#define ThrowIfFailed(x) CHECK(SUCCEEDED(x))
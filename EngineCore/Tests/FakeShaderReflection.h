@@ -0,0 +1,54 @@
+#pragma once
+
+#include "D3D12Types.h"
+
+// Reflection of a shader without a compiler: the bindings are listed like D3DReflect lists them, and the blob of the
+// "bytecode" is the reflection itself, which D3DReflect of D3D12Types.h hands back
+class FakeShaderReflection final : public ID3D12ShaderReflection, public ID3DBlob
+{
+public:
+    void AddBinding(const std::string& name, D3D_SHADER_INPUT_TYPE type, D3D_SRV_DIMENSION dimension, UINT bindPoint, UINT bindCount = 1)
+    {
+        m_Bindings.push_back({ name, type, bindPoint, bindCount, dimension });
+    }
+
+    // Like the reflection of Shader Model 5.0, every element of the array is listed as "name[i]"
+    void AddArrayBinding(const std::string& name, D3D_SHADER_INPUT_TYPE type, D3D_SRV_DIMENSION dimension, UINT bindPoint, UINT arraySize)
+    {
+        for (UINT i = 0; i < arraySize; ++i)
+            AddBinding(name + "[" + std::to_string(i) + "]", type, dimension, bindPoint + i);
+    }
+
+    HRESULT GetDesc(D3D12_SHADER_DESC* pDesc) override
+    {
+        pDesc->Version = 0x51;
+        pDesc->BoundResources = static_cast<UINT>(m_Bindings.size());
+        return S_OK;
+    }
+
+    HRESULT GetResourceBindingDesc(UINT ResourceIndex, D3D12_SHADER_INPUT_BIND_DESC* pDesc) override
+    {
+        const Binding& binding = m_Bindings.at(ResourceIndex);
+        pDesc->Name = binding.Name.c_str();
+        pDesc->Type = binding.Type;
+        pDesc->BindPoint = binding.BindPoint;
+        pDesc->BindCount = binding.BindCount;
+        pDesc->Dimension = binding.Dimension;
+        return S_OK;
+    }
+
+    void* GetBufferPointer() override { return static_cast<ID3D12ShaderReflection*>(this); }
+    SIZE_T GetBufferSize() override { return sizeof(*this); }
+
+private:
+    struct Binding
+    {
+        std::string Name;
+        D3D_SHADER_INPUT_TYPE Type;
+        UINT BindPoint;
+        UINT BindCount;
+        D3D_SRV_DIMENSION Dimension;
+    };
+
+    std::vector<Binding> m_Bindings;
+};
@@ -0,0 +1,270 @@
+#include "TestCommon.h"
+#include "D3D12Types.h"
+#include "D3D12RHI/FenceTimeline.h"
+
+#include <random>
+
+using namespace RHI;
+
+/*
+* Deferred release of the objects used by the command lists of three queues, with simulated fences. The objects are released
+* through DeferredReleaseQueue like RenderDevice::SafeReleaseDeviceObject, and an object must never be handed back while a command
+* list that used it, executed or still being recorded, has not completed on the GPU.
+*/
+namespace
+{
+    // A queue like CommandQueue, whose GPU completes the fence values when the test says so
+    struct SimulatedQueue
+    {
+        UINT64 NextFenceValue = 1;
+        UINT64 CompletedFenceValue = 0;
+        RecordingLists Recording;
+
+        UINT64 GetRecordingTicket() { return Recording.GetNextTicket(); }
+        bool AreListsExecuted(UINT64 ticket) { return Recording.AreExecuted(ticket); }
+        UINT64 GetLastExecutedFenceValue() const { return NextFenceValue - 1; }
+
+        void BeginList(UINT32 list) { Recording.Begin(GetKey(list)); }
+
+        // Returns the fence value signaled after the list
+        UINT64 ExecuteList(UINT32 list)
+        {
+            UINT64 fenceValue = NextFenceValue++;
+            Recording.End(GetKey(list));
+            return fenceValue;
+        }
+
+        // An empty signal, like IncrementFence
+        UINT64 Signal() { return NextFenceValue++; }
+
+        static const void* GetKey(UINT32 list) { return reinterpret_cast<const void*>(static_cast<uintptr_t>(list) + 1); }
+    };
+
+    struct Simulation
+    {
+        SimulatedQueue Queues[COMMAND_QUEUE_COUNT];
+        SimulatedQueue* QueuePointers[COMMAND_QUEUE_COUNT] = { &Queues[0], &Queues[1], &Queues[2] };
+        DeferredReleaseQueue<UINT32> ReleaseQueue;
+
+        void Release(UINT32 object, UINT32 queueMask = COMMAND_QUEUE_MASK_ALL)
+        {
+            ReleaseQueue.Release(queueMask, QueuePointers, UINT32{ object });
+        }
+
+        // Like RenderDevice::PurgeReleaseQueue
+        std::vector<UINT32> Purge()
+        {
+            FenceTimelinePoint completed;
+            for (UINT32 i = 0; i < COMMAND_QUEUE_COUNT; ++i)
+                completed.Values[i] = Queues[i].CompletedFenceValue;
+
+            std::vector<UINT32> objects;
+            ReleaseQueue.ResolvePending(QueuePointers);
+            ReleaseQueue.PopCompleted(completed, objects);
+            return objects;
+        }
+    };
+
+    // An object used by two compute lists being recorded is released: it waits for both lists, not for the last executed one
+    void TestReleaseWhileRecording()
+    {
+        Simulation sim;
+        SimulatedQueue& compute = sim.Queues[COMMAND_QUEUE_COMPUTE];
+
+        compute.BeginList(0);
+        compute.CompletedFenceValue = compute.ExecuteList(0);
+        compute.BeginList(1);
+        compute.BeginList(2);
+        sim.Release(7);
+        CHECK(sim.Purge().empty());
+
+        // An empty signal while the lists are recorded does not end the wait
+        compute.CompletedFenceValue = compute.Signal();
+        CHECK(sim.Purge().empty());
+
+        compute.CompletedFenceValue = compute.ExecuteList(2);
+        CHECK(sim.Purge().empty());
+
+        UINT64 fenceValue = compute.ExecuteList(1);
+        CHECK(sim.Purge().empty());
+
+        compute.CompletedFenceValue = fenceValue;
+        std::vector<UINT32> objects = sim.Purge();
+        CHECK(objects.size() == 1 && objects[0] == 7);
+    }
+
+    // The graphics queue records every frame, the copy queue stays idle: the object does not wait for a copy list
+    void TestIdleQueue()
+    {
+        Simulation sim;
+        SimulatedQueue& graphics = sim.Queues[COMMAND_QUEUE_GRAPHICS];
+        SimulatedQueue& copy = sim.Queues[COMMAND_QUEUE_COPY];
+
+        copy.BeginList(0);
+        copy.CompletedFenceValue = copy.ExecuteList(0);
+
+        graphics.BeginList(1);
+        sim.Release(1);
+        graphics.CompletedFenceValue = graphics.ExecuteList(1);
+
+        CHECK(sim.Purge().size() == 1);
+        CHECK(sim.ReleaseQueue.IsEmpty());
+
+        // Nothing is recorded, the object only waits for the lists already executed
+        graphics.BeginList(2);
+        graphics.ExecuteList(2);
+        sim.Release(2);
+        CHECK(sim.Purge().empty());
+        graphics.CompletedFenceValue = graphics.GetLastExecutedFenceValue();
+        CHECK(sim.Purge().size() == 1);
+    }
+
+    // An object released with the graphics queue only does not wait for a compute list being recorded
+    void TestQueueMask()
+    {
+        Simulation sim;
+        sim.Queues[COMMAND_QUEUE_COMPUTE].BeginList(0);
+        sim.Release(3, COMMAND_QUEUE_MASK_COMPUTE);
+        sim.Release(4, COMMAND_QUEUE_MASK_GRAPHICS);
+
+        std::vector<UINT32> objects = sim.Purge();
+        CHECK(objects.size() == 1 && objects[0] == 4);
+        CHECK(sim.ReleaseQueue.GetSize() == 1);
+
+        sim.Queues[COMMAND_QUEUE_COMPUTE].CompletedFenceValue = sim.Queues[COMMAND_QUEUE_COMPUTE].ExecuteList(0);
+        objects = sim.Purge();
+        CHECK(objects.size() == 1 && objects[0] == 3);
+    }
+
+    // Random lists on random queues use random objects, which are released at random times while the GPU completes the fences
+    // in the background. Each object records the lists recording with it and the fence values of the executed ones
+    void TestRandomReleases()
+    {
+        constexpr UINT32 NumObjects = 256;
+
+        struct Object
+        {
+            // Lists recording with the object, per queue
+            UINT32 NumRecordingLists[COMMAND_QUEUE_COUNT] = {};
+            // Fence value of the last executed list that used the object, per queue
+            UINT64 LastUseFenceValue[COMMAND_QUEUE_COUNT] = {};
+            bool Released = false;
+        };
+
+        struct List
+        {
+            UINT32 Id;
+            UINT32 Queue;
+            std::vector<UINT32> Objects;
+        };
+
+        std::mt19937 random(11);
+        Simulation sim;
+        std::vector<Object> objects(NumObjects);
+        std::vector<List> recordingLists;
+        std::vector<UINT32> liveObjects;
+        for (UINT32 i = 0; i < NumObjects; ++i)
+            liveObjects.push_back(i);
+
+        UINT32 nextListId = 0;
+        size_t numHandedBack = 0;
+        for (int step = 0; step < 50000 && !liveObjects.empty(); ++step)
+        {
+            switch (random() % 7)
+            {
+            case 0:
+            {
+                UINT32 queue = random() % COMMAND_QUEUE_COUNT;
+                sim.Queues[queue].BeginList(nextListId);
+                recordingLists.push_back(List{ nextListId++, queue, {} });
+                break;
+            }
+            case 1:
+            {
+                // A recording list uses a live object
+                if (recordingLists.empty())
+                    break;
+                List& list = recordingLists[random() % recordingLists.size()];
+                UINT32 object = liveObjects[random() % liveObjects.size()];
+                list.Objects.push_back(object);
+                objects[object].NumRecordingLists[list.Queue]++;
+                break;
+            }
+            case 2:
+            {
+                if (recordingLists.empty())
+                    break;
+                size_t index = random() % recordingLists.size();
+                List list = std::move(recordingLists[index]);
+                recordingLists.erase(recordingLists.begin() + index);
+
+                UINT64 fenceValue = sim.Queues[list.Queue].ExecuteList(list.Id);
+                for (UINT32 object : list.Objects)
+                {
+                    objects[object].NumRecordingLists[list.Queue]--;
+                    objects[object].LastUseFenceValue[list.Queue] = fenceValue;
+                }
+                break;
+            }
+            case 3:
+            {
+                // Released by the CPU, the lists recording with it may still use it
+                if (random() % 4 != 0)
+                    break;
+                size_t index = random() % liveObjects.size();
+                UINT32 object = liveObjects[index];
+                liveObjects.erase(liveObjects.begin() + index);
+                sim.Release(object);
+                objects[object].Released = true;
+                break;
+            }
+            case 4:
+                sim.Queues[random() % COMMAND_QUEUE_COUNT].Signal();
+                break;
+            default:
+            {
+                // The GPU progresses
+                SimulatedQueue& queue = sim.Queues[random() % COMMAND_QUEUE_COUNT];
+                if (queue.CompletedFenceValue < queue.GetLastExecutedFenceValue())
+                    ++queue.CompletedFenceValue;
+                break;
+            }
+            }
+
+            for (UINT32 object : sim.Purge())
+            {
+                const Object& state = objects[object];
+                CHECK(state.Released);
+                for (UINT32 queue = 0; queue < COMMAND_QUEUE_COUNT; ++queue)
+                {
+                    CHECK(state.NumRecordingLists[queue] == 0);
+                    CHECK(state.LastUseFenceValue[queue] <= sim.Queues[queue].CompletedFenceValue);
+                }
+                ++numHandedBack;
+            }
+        }
+
+        // The last lists are executed, the GPU catches up, everything is handed back
+        for (List& list : recordingLists)
+            sim.Queues[list.Queue].ExecuteList(list.Id);
+        for (UINT32 object : liveObjects)
+            sim.Release(object);
+        for (SimulatedQueue& queue : sim.Queues)
+            queue.CompletedFenceValue = queue.GetLastExecutedFenceValue();
+
+        numHandedBack += sim.Purge().size();
+        CHECK(sim.ReleaseQueue.IsEmpty());
+        CHECK(numHandedBack == NumObjects);
+    }
+}
+
+int main()
+{
+    TestReleaseWhileRecording();
+    TestIdleQueue();
+    TestQueueMask();
+    TestRandomReleases();
+
+    std::printf("Fence timeline: release while recording, idle queue, queue mask and random releases passed\n");
+    return 0;
+}
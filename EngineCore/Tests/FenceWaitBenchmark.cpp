@@ -0,0 +1,96 @@
+#include "TestCommon.h"
+#include "CpuFence.h"
+
+using namespace RHI;
+
+/*
+* Wake-up latency of the fence wait policies: a CPU thread completes a stand-in fence after a delay, like a GPU finishing a
+* command list, and the latency is the time between the signal and the return of the wait. Short delays show the gain of the
+* spin phase, long delays its cost: the spin only burns CPU time before blocking.
+*/
+namespace
+{
+    struct LatencyResult
+    {
+        double MedianMicroseconds = 0.0;
+        double P99Microseconds = 0.0;
+        double SpinWakeUpRatio = 0.0;
+    };
+
+    LatencyResult MeasureLatency(UINT32 spinMicroseconds, std::chrono::microseconds delay, UINT32 numWaits)
+    {
+        using Clock = std::chrono::steady_clock;
+
+        FenceWaitPolicy policy;
+        policy.SpinMicroseconds = spinMicroseconds;
+
+        CpuFence fence;
+        CpuFenceEvents events;
+        FenceWaitCounters counters;
+
+        // Written before the signal, read once the fence value is seen complete
+        Clock::time_point signalTime;
+        std::atomic<UINT64> requestedValue{ 0 };
+
+        std::thread signaler([&]()
+        {
+            for (UINT64 value = 1; value <= numWaits; ++value)
+            {
+                while (requestedValue.load(std::memory_order_acquire) < value)
+                    std::this_thread::yield();
+
+                // Busy wait, a sleep is far coarser than the delays measured
+                const auto signalAt = Clock::now() + delay;
+                while (Clock::now() < signalAt)
+                {
+                }
+
+                signalTime = Clock::now();
+                fence.Signal(value);
+            }
+        });
+
+        std::vector<double> latencies;
+        latencies.reserve(numWaits);
+        for (UINT64 value = 1; value <= numWaits; ++value)
+        {
+            requestedValue.store(value, std::memory_order_release);
+
+            CpuFence* fencePointer = &fence;
+            CHECK(WaitForFences(1, &fencePointer, &value, policy, events, counters) == FenceWaitResult::Complete);
+            auto wakeUpTime = Clock::now();
+            latencies.push_back(std::chrono::duration<double, std::micro>(wakeUpTime - signalTime).count());
+        }
+        signaler.join();
+
+        std::sort(latencies.begin(), latencies.end());
+        LatencyResult result;
+        result.MedianMicroseconds = latencies[latencies.size() / 2];
+        result.P99Microseconds = latencies[std::min(latencies.size() - 1, latencies.size() * 99 / 100)];
+        result.SpinWakeUpRatio = static_cast<double>(counters.GetStats().NumSpinWakeUps) / numWaits;
+        return result;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    UINT32 numWaits = IsFullBenchmark(argc, argv) ? 5000 : 200;
+
+    const UINT32 spinPolicies[] = { 0, 50, 200 };
+    const std::chrono::microseconds delays[] = { std::chrono::microseconds(0), std::chrono::microseconds(20), std::chrono::microseconds(100),
+        std::chrono::microseconds(1000) };
+
+    for (auto delay : delays)
+    {
+        for (UINT32 spin : spinPolicies)
+        {
+            LatencyResult result = MeasureLatency(spin, delay, numWaits);
+            std::printf("delay %5lld us, spin %4u us: wake-up latency median %8.2f us, p99 %8.2f us, %5.1f%% spin wake-ups\n",
+                static_cast<long long>(delay.count()), spin, result.MedianMicroseconds, result.P99Microseconds, result.SpinWakeUpRatio * 100.0);
+        }
+    }
+
+    if (std::thread::hardware_concurrency() < 2)
+        std::printf("One core: the spin yields to the signaling thread, the spin wake-ups of the long delays are not representative\n");
+    return 0;
+}
@@ -0,0 +1,136 @@
+#include "TestCommon.h"
+#include "CpuFence.h"
+
+using namespace RHI;
+
+/*
+* The fence wait of FenceWait.h against fences completed by CPU threads: spin wake-ups, blocking on the events of several
+* fences, the timeout, and a wait after a timeout that must not be woken up by the events of the timed out one.
+*/
+namespace
+{
+    FenceWaitResult Wait(std::initializer_list<CpuFence*> fences, std::initializer_list<UINT64> values, const FenceWaitPolicy& policy,
+        FenceWaitCounters& counters)
+    {
+        static thread_local CpuFenceEvents events;
+        std::vector<CpuFence*> fencePointers(fences);
+        std::vector<UINT64> fenceValues(values);
+        return WaitForFences(static_cast<UINT32>(fencePointers.size()), fencePointers.data(), fenceValues.data(), policy, events, counters);
+    }
+
+    FenceWaitPolicy MakePolicy(UINT32 spinMicroseconds, UINT32 timeoutMilliseconds = FENCE_WAIT_NO_TIMEOUT)
+    {
+        FenceWaitPolicy policy;
+        policy.SpinMicroseconds = spinMicroseconds;
+        policy.TimeoutMilliseconds = timeoutMilliseconds;
+        return policy;
+    }
+
+    // A completed fence, and a fence completed during the spin, do not block
+    void TestSpinWakeUp()
+    {
+        FenceWaitCounters counters;
+        CpuFence fence;
+        fence.Signal(3);
+        CHECK(Wait({ &fence }, { 3 }, MakePolicy(0), counters) == FenceWaitResult::Complete);
+
+        std::thread signaler([&fence]() { fence.Signal(4); });
+        CHECK(Wait({ &fence }, { 4 }, MakePolicy(2000000), counters) == FenceWaitResult::Complete);
+        signaler.join();
+
+        FenceWaitStats stats = counters.GetStats();
+        CHECK(stats.NumWaits == 2 && stats.NumSpinWakeUps == 2 && stats.NumBlockingWaits == 0);
+    }
+
+    // Three fences completed one after the other: the wait blocks until the last one
+    void TestBlockingWait()
+    {
+        FenceWaitCounters counters;
+        CpuFence fences[3];
+
+        std::thread signaler([&fences]()
+        {
+            for (UINT64 value = 1; value <= 4; ++value)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                for (UINT32 i = 0; i < 3; ++i)
+                {
+                    if (value >= i + 2)
+                        fences[i].Signal(value);
+                }
+            }
+        });
+
+        CHECK(Wait({ &fences[0], &fences[1], &fences[2] }, { 2, 3, 4 }, MakePolicy(0), counters) == FenceWaitResult::Complete);
+        CHECK(fences[0].GetCompletedValue() >= 2 && fences[1].GetCompletedValue() >= 3 && fences[2].GetCompletedValue() >= 4);
+        signaler.join();
+
+        FenceWaitStats stats = counters.GetStats();
+        CHECK(stats.NumBlockingWaits == 1 && stats.NumTimeouts == 0);
+    }
+
+    // A fence that is never completed times out, the fence keeps the discarded event. The next wait on the same thread
+    // registers new events, it returns once its own value is reached even when the old event is set first
+    void TestTimeout()
+    {
+        FenceWaitCounters counters;
+        CpuFence fence;
+
+        BenchmarkTimer timer;
+        CHECK(Wait({ &fence }, { 1 }, MakePolicy(0, 20), counters) == FenceWaitResult::Timeout);
+        CHECK(timer.GetMilliseconds() >= 19.0);
+        CHECK(fence.GetNumRegisteredEvents() == 1);
+        CHECK(counters.GetStats().NumTimeouts == 1);
+
+        std::thread signaler([&fence]()
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            fence.Signal(1);
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            fence.Signal(2);
+        });
+
+        CHECK(Wait({ &fence }, { 2 }, MakePolicy(0), counters) == FenceWaitResult::Complete);
+        CHECK(fence.GetCompletedValue() >= 2);
+        signaler.join();
+        CHECK(fence.GetNumRegisteredEvents() == 0);
+    }
+
+    // Several threads wait on the same fence with their own events
+    void TestConcurrentWaits()
+    {
+        FenceWaitCounters counters;
+        CpuFence fence;
+
+        std::vector<std::thread> waiters;
+        for (UINT64 i = 1; i <= 4; ++i)
+        {
+            waiters.emplace_back([&fence, &counters, i]()
+            {
+                CHECK(Wait({ &fence }, { i * 10 }, MakePolicy(i % 2 == 0 ? 0 : 100), counters) == FenceWaitResult::Complete);
+                CHECK(fence.GetCompletedValue() >= i * 10);
+            });
+        }
+
+        for (UINT64 value = 1; value <= 40; ++value)
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+            fence.Signal(value);
+        }
+
+        for (auto& waiter : waiters)
+            waiter.join();
+        CHECK(counters.GetStats().NumWaits == 4);
+    }
+}
+
+int main()
+{
+    TestSpinWakeUp();
+    TestBlockingWait();
+    TestTimeout();
+    TestConcurrentWaits();
+
+    std::printf("Fence wait: spin wake-up, blocking wait, timeout and concurrent waits passed\n");
+    return 0;
+}
@@ -0,0 +1,253 @@
+#include "TestCommon.h"
+#include "D3D12Types.h"
+#include "D3D12RHI/ResourceStateTracker.h"
+
+#include <random>
+
+using namespace RHI;
+
+/*
+* Resource state tracking of command lists recorded in parallel and submitted in order, without a GPU. The barriers of each
+* submission (fix-up barriers, then the barriers recorded in the list) are executed on a model of the subresource states: every
+* barrier must start from the state the subresource is really in, and the global states must match the model after the submission.
+*/
+namespace
+{
+    struct FakeResource
+    {
+        FakeResource(UINT numSubresources, D3D12_RESOURCE_STATES state) :
+            GlobalState{ std::make_shared<SubresourceStates>(state) },
+            States(numSubresources, state)
+        {
+        }
+
+        ID3D12Resource* GetHandle() { return reinterpret_cast<ID3D12Resource*>(this); }
+
+        ResourceStateTracker::TrackedResource Track()
+        {
+            ResourceStateTracker::TrackedResource tracked;
+            tracked.Resource = GetHandle();
+            tracked.GlobalState = GlobalState;
+            tracked.NumSubresources = static_cast<UINT>(States.size());
+            return tracked;
+        }
+
+        std::shared_ptr<SubresourceStates> GlobalState;
+        // State the GPU would see
+        std::vector<D3D12_RESOURCE_STATES> States;
+    };
+
+    struct CommandList
+    {
+        ResourceStateTracker Tracker;
+        std::vector<D3D12_RESOURCE_BARRIER> Barriers;
+
+        void Transition(FakeResource& resource, D3D12_RESOURCE_STATES state, UINT subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES)
+        {
+            Tracker.TransitionResource(resource.Track(), state, subresource, Barriers);
+        }
+    };
+
+    FakeResource* FindResource(std::vector<FakeResource*>& resources, ID3D12Resource* handle)
+    {
+        for (FakeResource* resource : resources)
+        {
+            if (resource->GetHandle() == handle)
+                return resource;
+        }
+
+        TestFailure("barrier on an unknown resource", __FILE__, __LINE__);
+    }
+
+    void ExecuteBarriers(std::vector<FakeResource*>& resources, const std::vector<D3D12_RESOURCE_BARRIER>& barriers)
+    {
+        for (const D3D12_RESOURCE_BARRIER& barrier : barriers)
+        {
+            CHECK(barrier.Type == D3D12_RESOURCE_BARRIER_TYPE_TRANSITION);
+            CHECK(barrier.Transition.StateBefore != barrier.Transition.StateAfter);
+
+            FakeResource* resource = FindResource(resources, barrier.Transition.pResource);
+            UINT subresource = barrier.Transition.Subresource;
+            for (UINT i = 0; i < resource->States.size(); ++i)
+            {
+                if (subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES || subresource == i)
+                {
+                    CHECK(resource->States[i] == barrier.Transition.StateBefore);
+                    resource->States[i] = barrier.Transition.StateAfter;
+                }
+            }
+        }
+    }
+
+    // Submits the lists in order like CommandContext::Submit, returns the number of fix-up barriers
+    size_t Submit(std::vector<FakeResource*>& resources, CommandList* const* lists, size_t numLists)
+    {
+        std::lock_guard<std::mutex> stateLock(ResourceStateTracker::GetGlobalStateMutex());
+
+        size_t numFixupBarriers = 0;
+        for (size_t l = 0; l < numLists; ++l)
+        {
+            CommandList& list = *lists[l];
+
+            std::vector<D3D12_RESOURCE_BARRIER> fixupBarriers;
+            list.Tracker.ResolvePendingBarriers(fixupBarriers);
+            numFixupBarriers += fixupBarriers.size();
+
+            ExecuteBarriers(resources, fixupBarriers);
+            ExecuteBarriers(resources, list.Barriers);
+
+            list.Tracker.CommitFinalStates();
+            list.Tracker.Reset();
+            list.Barriers.clear();
+        }
+
+        for (FakeResource* resource : resources)
+        {
+            for (UINT i = 0; i < resource->States.size(); ++i)
+                CHECK(resource->GlobalState->GetState(i) == resource->States[i]);
+        }
+
+        return numFixupBarriers;
+    }
+
+    // The example of ResourceStateTracker.h
+    void TestFirstUses()
+    {
+        FakeResource texture(2, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+        std::vector<FakeResource*> resources = { &texture };
+
+        CommandList list;
+        list.Transition(texture, D3D12_RESOURCE_STATE_RENDER_TARGET, 1);
+        CHECK(list.Barriers.empty());
+
+        D3D12_RESOURCE_STATES state;
+        CHECK(list.Tracker.GetLocalState(texture.Track(), 1, state) && state == D3D12_RESOURCE_STATE_RENDER_TARGET);
+        CHECK(!list.Tracker.GetLocalState(texture.Track(), 0, state));
+        CHECK(!list.Tracker.GetLocalState(texture.Track(), D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, state));
+
+        list.Transition(texture, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, 1);
+        CHECK(list.Barriers.size() == 1);
+        list.Transition(texture, D3D12_RESOURCE_STATE_COPY_SOURCE, 0);
+
+        CommandList* lists[] = { &list };
+        CHECK(Submit(resources, lists, 1) == 2);
+        CHECK(texture.GlobalState->GetState(0) == D3D12_RESOURCE_STATE_COPY_SOURCE);
+        CHECK(texture.GlobalState->GetState(1) == D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+
+        // A first use in the global state needs no barrier
+        list.Transition(texture, D3D12_RESOURCE_STATE_COPY_SOURCE, 0);
+        CHECK(Submit(resources, lists, 1) == 0);
+    }
+
+    // Two lists recorded at the same time use the same buffer, each one is resolved against the states left by the previous
+    void TestParallelLists()
+    {
+        FakeResource buffer(1, D3D12_RESOURCE_STATE_COMMON);
+        std::vector<FakeResource*> resources = { &buffer };
+
+        CommandList writer, reader;
+        reader.Transition(buffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        writer.Transition(buffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
+        CommandList* lists[] = { &writer, &reader };
+        CHECK(Submit(resources, lists, 2) == 2);
+        CHECK(buffer.GlobalState->GetState() == D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    }
+
+    // A whole resource transition after some subresources are known: the known ones get a barrier, the others are first uses
+    void TestAllSubresourcesAfterKnown()
+    {
+        FakeResource texture(4, D3D12_RESOURCE_STATE_COMMON);
+        texture.GlobalState->SetState(D3D12_RESOURCE_STATE_RENDER_TARGET, 2);
+        texture.States[2] = D3D12_RESOURCE_STATE_RENDER_TARGET;
+        std::vector<FakeResource*> resources = { &texture };
+
+        CommandList list;
+        list.Transition(texture, D3D12_RESOURCE_STATE_COPY_DEST, 0);
+        list.Transition(texture, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+        CHECK(list.Barriers.size() == 1);
+
+        D3D12_RESOURCE_STATES state;
+        CHECK(list.Tracker.GetLocalState(texture.Track(), D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, state));
+        CHECK(state == D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+
+        CommandList* lists[] = { &list };
+        CHECK(Submit(resources, lists, 1) == 4);
+        CHECK(texture.GlobalState->IsUniform());
+    }
+
+    // A resource destroyed after its first use in a list and before the submission: the tracker keeps its state until Reset()
+    void TestResourceDestroyedBeforeSubmit()
+    {
+        auto texture = std::make_unique<FakeResource>(2, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+        std::weak_ptr<SubresourceStates> textureState = texture->GlobalState;
+
+        CommandList list;
+        list.Transition(*texture, D3D12_RESOURCE_STATE_RENDER_TARGET, 1);
+        list.Transition(*texture, D3D12_RESOURCE_STATE_COPY_SOURCE);
+        texture.reset();
+        CHECK(!textureState.expired());
+
+        std::lock_guard<std::mutex> stateLock(ResourceStateTracker::GetGlobalStateMutex());
+        std::vector<D3D12_RESOURCE_BARRIER> fixupBarriers;
+        list.Tracker.ResolvePendingBarriers(fixupBarriers);
+        CHECK(fixupBarriers.size() == 2 && list.Barriers.size() == 1);
+        list.Tracker.CommitFinalStates();
+        CHECK(textureState.lock()->GetState() == D3D12_RESOURCE_STATE_COPY_SOURCE);
+
+        list.Tracker.Reset();
+        CHECK(textureState.expired());
+    }
+
+    // Random transitions of random subresources in lists recorded together, submitted in a random order
+    void TestRandomLists()
+    {
+        const D3D12_RESOURCE_STATES states[] =
+        {
+            D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+            D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_COPY_SOURCE,
+            D3D12_RESOURCE_STATE_GENERIC_READ
+        };
+        constexpr size_t NumStates = sizeof(states) / sizeof(states[0]);
+
+        std::mt19937 random(3);
+
+        std::vector<std::unique_ptr<FakeResource>> ownedResources;
+        std::vector<FakeResource*> resources;
+        for (int r = 0; r < 12; ++r)
+        {
+            ownedResources.push_back(std::make_unique<FakeResource>(1 + random() % 6, states[random() % NumStates]));
+            resources.push_back(ownedResources.back().get());
+        }
+
+        std::vector<CommandList> lists(4);
+        size_t numFixupBarriers = 0;
+        for (int submission = 0; submission < 2000; ++submission)
+        {
+            for (int t = 0; t < 40; ++t)
+            {
+                FakeResource& resource = *resources[random() % resources.size()];
+                UINT subresource = (random() % 3 == 0) ? D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES : static_cast<UINT>(random() % resource.States.size());
+                lists[random() % lists.size()].Transition(resource, states[random() % NumStates], subresource);
+            }
+
+            std::vector<CommandList*> order = { &lists[0], &lists[1], &lists[2], &lists[3] };
+            std::shuffle(order.begin(), order.end(), random);
+            numFixupBarriers += Submit(resources, order.data(), order.size());
+        }
+
+        std::printf("Random lists: %zu fix-up barriers in 2000 submissions\n", numFixupBarriers);
+    }
+}
+
+int main()
+{
+    TestFirstUses();
+    TestParallelLists();
+    TestAllSubresourcesAfterKnown();
+    TestResourceDestroyedBeforeSubmit();
+    TestRandomLists();
+
+    std::printf("Resource state tracker: first uses, parallel lists and random submissions passed\n");
+    return 0;
+}
@@ -0,0 +1,118 @@
+#include "TestCommon.h"
+#include "Common/RingQueue.h"
+
+#include <random>
+
+/*
+* The ring of the release queues and of the shader batches: FIFO order across the wrap of the indices and the growths, every
+* element destroyed once, and no growth once the queue reached the peak size it is filled to.
+*/
+namespace
+{
+    // Counts the live instances, the moved-from ones included
+    struct Tracked
+    {
+        static int NumAlive;
+
+        explicit Tracked(int value) : Value{ std::make_unique<int>(value) } { ++NumAlive; }
+        Tracked(Tracked&& rhs) noexcept : Value{ std::move(rhs.Value) } { ++NumAlive; }
+        Tracked(const Tracked&) = delete;
+        ~Tracked() { --NumAlive; }
+
+        std::unique_ptr<int> Value;
+    };
+
+    int Tracked::NumAlive = 0;
+
+    void TestFifoOrder()
+    {
+        {
+            RingQueue<Tracked> queue;
+            CHECK(queue.IsEmpty() && queue.GetCapacity() == 0);
+
+            // The head moves forward while the queue grows, the elements are moved across the wrap
+            int nextPush = 0, nextPop = 0;
+            for (int round = 0; round < 200; ++round)
+            {
+                for (int i = 0; i < 3; ++i)
+                    queue.EmplaceBack(nextPush++);
+                CHECK(*queue.Front().Value == nextPop);
+                CHECK(*queue.Back().Value == nextPush - 1);
+                queue.PopFront();
+                ++nextPop;
+            }
+            CHECK(queue.GetSize() == static_cast<size_t>(nextPush - nextPop));
+            CHECK(Tracked::NumAlive == static_cast<int>(queue.GetSize()));
+
+            while (!queue.IsEmpty())
+            {
+                CHECK(*queue.Front().Value == nextPop++);
+                queue.PopFront();
+            }
+            CHECK(Tracked::NumAlive == 0);
+
+            for (int i = 0; i < 5; ++i)
+                queue.EmplaceBack(i);
+        }
+
+        // The destructor destroys the elements left
+        CHECK(Tracked::NumAlive == 0);
+    }
+
+    // Filled and drained every frame: the capacity stops growing at the peak size
+    void TestSteadyCapacity()
+    {
+        RingQueue<int> queue;
+        std::mt19937 random(14);
+
+        for (int frame = 0; frame < 100; ++frame)
+        {
+            size_t count = 100 + random() % 900;
+            for (size_t i = 0; i < count; ++i)
+                queue.EmplaceBack(static_cast<int>(i));
+            for (size_t i = 0; i < count; ++i)
+                queue.PopFront();
+        }
+
+        size_t capacity = queue.GetCapacity();
+        CHECK(capacity == 1024);
+        for (int frame = 0; frame < 100; ++frame)
+        {
+            for (int i = 0; i < 1000; ++i)
+                queue.EmplaceBack(i);
+            for (int i = 0; i < 1000; ++i)
+            {
+                CHECK(queue.Front() == i);
+                queue.PopFront();
+            }
+        }
+        CHECK(queue.GetCapacity() == capacity);
+    }
+
+    void TestMoveAndClear()
+    {
+        RingQueue<Tracked> queue;
+        for (int i = 0; i < 20; ++i)
+            queue.EmplaceBack(i);
+        queue.PopFront();
+
+        RingQueue<Tracked> moved(std::move(queue));
+        CHECK(queue.IsEmpty() && queue.GetCapacity() == 0);
+        CHECK(moved.GetSize() == 19 && *moved.Front().Value == 1);
+
+        moved.Clear();
+        CHECK(moved.IsEmpty() && Tracked::NumAlive == 0);
+        moved.EmplaceBack(7);
+        CHECK(*moved.Front().Value == 7);
+    }
+}
+
+int main()
+{
+    TestFifoOrder();
+    TestSteadyCapacity();
+    TestMoveAndClear();
+
+    std::printf("Ring queue: FIFO order, steady capacity, move and clear passed\n");
+    return 0;
+}
@@ -0,0 +1,289 @@
+#include "TestCommon.h"
+#include "D3D12RHI/ShaderBatchScheduler.h"
+
+using namespace RHI;
+
+/*
+* ShaderBatchScheduler with a fake compiler backend: identical tasks are compiled once, the includes of a batch are read
+* from the disk once whatever the number of compilations and threads, the failures are reported per task, and the tasks
+* run on no more threads than asked for.
+*/
+namespace
+{
+    // Shader files kept in memory, the reads are counted. Thread safe once filled
+    struct MemoryFiles
+    {
+        std::map<std::string, std::string> Files;
+        std::atomic<size_t> NumReads{ 0 };
+
+        ReadFileFunc GetReader()
+        {
+            return [this](const std::string& path, std::string& content)
+            {
+                ++NumReads;
+                auto it = Files.find(path);
+                if (it == Files.end())
+                    return false;
+                content = it->second;
+                return true;
+            };
+        }
+    };
+
+    // "Compiles" a source by appending the contents of its includes, opened through the tracker like D3DCompile does.
+    // A source with #error fails
+    class FakeCompilerBackend : public ShaderCompilerBackend
+    {
+    public:
+        bool Compile(const ShaderCompileTask& task, ShaderIncludeTracker& includes, ShaderCompileOutput& output) override
+        {
+            uint32_t numRunning = ++m_NumRunning;
+            uint32_t maxRunning = m_MaxRunning.load();
+            while (numRunning > maxRunning && !m_MaxRunning.compare_exchange_weak(maxRunning, numRunning))
+            {
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                ++m_NumCompilations[task.GetKey()];
+                m_Threads.insert(std::this_thread::get_id());
+            }
+
+            if (SimulatedMicroseconds > 0)
+                std::this_thread::sleep_for(std::chrono::microseconds(SimulatedMicroseconds));
+
+            std::string code = task.Source;
+            bool succeeded = AppendIncludes(task.Source, nullptr, includes, code, output.Errors);
+            if (succeeded && code.find("#error") != std::string::npos)
+            {
+                output.Errors = task.SourcePath + ": #error";
+                succeeded = false;
+            }
+
+            if (succeeded)
+                output.ByteCode.assign(code.begin(), code.end());
+
+            --m_NumRunning;
+            return succeeded;
+        }
+
+        uint32_t GetNumCompilations(uint64_t key)
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            return m_NumCompilations[key];
+        }
+
+        size_t GetNumTotalCompilations()
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            size_t total = 0;
+            for (const auto& compilations : m_NumCompilations)
+                total += compilations.second;
+            return total;
+        }
+
+        size_t GetNumThreads()
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            return m_Threads.size();
+        }
+
+        uint32_t GetMaxRunning() const { return m_MaxRunning.load(); }
+
+        uint32_t SimulatedMicroseconds = 0;
+
+    private:
+        static bool AppendIncludes(const std::string& source, const void* parentData, ShaderIncludeTracker& includes, std::string& code,
+            std::string& errors)
+        {
+            std::vector<std::string> names;
+            ShaderIncludeScanner::ParseIncludes(source, names);
+            for (const std::string& name : names)
+            {
+                const std::string* content = includes.Open(name, parentData);
+                if (content == nullptr)
+                {
+                    errors = "cannot open " + name;
+                    return false;
+                }
+
+                code += *content;
+                if (!AppendIncludes(*content, content->data(), includes, code, errors))
+                    return false;
+            }
+            return true;
+        }
+
+        std::atomic<uint32_t> m_NumRunning{ 0 };
+        std::atomic<uint32_t> m_MaxRunning{ 0 };
+        std::mutex m_Mutex;
+        std::unordered_map<uint64_t, uint32_t> m_NumCompilations;
+        std::set<std::thread::id> m_Threads;
+    };
+
+    ShaderCompileTask MakeTask(const std::string& path, const std::string& macros, const std::string& fileContent,
+        const std::string& entryPoint = "main")
+    {
+        ShaderCompileTask task;
+        task.SourcePath = path;
+        task.Source = macros + fileContent;
+        task.EntryPoint = entryPoint;
+        task.Profile = "ps_5_1";
+        return task;
+    }
+
+    void TestParseIncludes()
+    {
+        std::vector<std::string> includes;
+        ShaderIncludeScanner::ParseIncludes(
+            "#include \"A.hlsli\"\n"
+            "  #  include <B.hlsli>\r\n"
+            "\t#include\t\"Dir/C.hlsli\"\n"
+            "// #include \"Comment.hlsli\"\n"
+            "#include \"Unterminated.hlsli\n"
+            "#define INCLUDE \"D.hlsli\"\n"
+            "#if 0\n#include \"Inactive.hlsli\"\n#endif\n"
+            "#include \"Last.hlsli\"", includes);
+
+        std::vector<std::string> expected = { "A.hlsli", "B.hlsli", "Dir/C.hlsli", "Inactive.hlsli", "Last.hlsli" };
+        CHECK(includes == expected);
+    }
+
+    // The permutations of one shader differ by their macros, two of them are identical and share one compilation
+    void TestDuplicateTasks()
+    {
+        MemoryFiles files;
+        files.Files["Shaders/Lit.hlsl"] = "float4 main() : SV_Target { return 0; }";
+
+        ShaderIncludeScanner scanner(files.GetReader());
+        FakeCompilerBackend backend;
+        ShaderBatchScheduler scheduler(backend, scanner);
+
+        const std::string& content = files.Files["Shaders/Lit.hlsl"];
+        size_t shadowed = scheduler.Add(MakeTask("Shaders/Lit.hlsl", "#define SHADOWS 1\n", content));
+        size_t unshadowed = scheduler.Add(MakeTask("Shaders/Lit.hlsl", "#define SHADOWS 0\n", content));
+        size_t shadowedAgain = scheduler.Add(MakeTask("Shaders/Lit.hlsl", "#define SHADOWS 1\n", content));
+        size_t otherEntry = scheduler.Add(MakeTask("Shaders/Lit.hlsl", "#define SHADOWS 1\n", content, "mainAlpha"));
+
+        CHECK(shadowed == shadowedAgain);
+        CHECK(shadowed != unshadowed && shadowed != otherEntry);
+        CHECK(scheduler.GetNumUniqueTasks() == 3);
+
+        scheduler.Run(4);
+        CHECK(backend.GetNumTotalCompilations() == 3);
+        CHECK(backend.GetNumCompilations(scheduler.GetTask(shadowed).GetKey()) == 1);
+        CHECK(scheduler.GetOutput(shadowed).Succeeded && scheduler.GetOutput(unshadowed).Succeeded);
+    }
+
+    // 64 permutations of 4 shaders sharing their includes: every file is read from the disk once, the compilations read
+    // the contents kept by the scanner
+    void TestIncludesReadOnce()
+    {
+        MemoryFiles files;
+        files.Files["Shaders/Common.hlsli"] = "/*common*/";
+        files.Files["Shaders/Lighting/Light.hlsli"] = "#include \"Math.hlsli\"\n#include \"Common.hlsli\"\n/*light*/";
+        files.Files["Shaders/Lighting/Math.hlsli"] = "/*math*/";
+        for (int shader = 0; shader < 4; ++shader)
+            files.Files["Shaders/Shader" + std::to_string(shader) + ".hlsl"] = "#include \"Lighting/Light.hlsli\"\n/*shader*/";
+
+        ShaderIncludeScanner scanner(files.GetReader());
+        FakeCompilerBackend backend;
+        ShaderBatchScheduler scheduler(backend, scanner);
+
+        std::vector<size_t> taskIndices;
+        for (int permutation = 0; permutation < 64; ++permutation)
+        {
+            std::string path = "Shaders/Shader" + std::to_string(permutation % 4) + ".hlsl";
+            std::string content;
+            CHECK(scanner.ReadFile(path, content));
+            scanner.Scan(path);
+            taskIndices.push_back(scheduler.Add(MakeTask(path, "#define VARIANT " + std::to_string(permutation) + "\n", content)));
+        }
+
+        // The 4 shaders, the 3 includes, and Lighting/Common.hlsli that is looked for first and does not exist
+        CHECK(scanner.GetNumFilesRead() == 8);
+        CHECK(files.NumReads.load() == 8);
+
+        scheduler.Run(8);
+        CHECK(files.NumReads.load() == 8);
+        CHECK(backend.GetNumTotalCompilations() == 64);
+
+        for (size_t taskIndex : taskIndices)
+        {
+            const ShaderCompileOutput& output = scheduler.GetOutput(taskIndex);
+            CHECK(output.Succeeded && output.Errors.empty());
+            std::string code(output.ByteCode.begin(), output.ByteCode.end());
+            CHECK(code.find("/*shader*/") != std::string::npos && code.find("/*light*//*math*//*common*/") != std::string::npos);
+        }
+    }
+
+    // A failed task does not stop the others, each output keeps its own errors
+    void TestFailures()
+    {
+        MemoryFiles files;
+        files.Files["Shaders/Good.hlsl"] = "/*good*/";
+        files.Files["Shaders/Error.hlsl"] = "#error broken";
+        files.Files["Shaders/MissingInclude.hlsl"] = "#include \"Missing.hlsli\"";
+
+        ShaderIncludeScanner scanner(files.GetReader());
+        FakeCompilerBackend backend;
+        ShaderBatchScheduler scheduler(backend, scanner);
+
+        size_t good = scheduler.Add(MakeTask("Shaders/Good.hlsl", "", files.Files["Shaders/Good.hlsl"]));
+        size_t error = scheduler.Add(MakeTask("Shaders/Error.hlsl", "", files.Files["Shaders/Error.hlsl"]));
+        size_t missing = scheduler.Add(MakeTask("Shaders/MissingInclude.hlsl", "", files.Files["Shaders/MissingInclude.hlsl"]));
+        scanner.Scan("Shaders/MissingInclude.hlsl");
+
+        scheduler.Run(3);
+        CHECK(scheduler.GetOutput(good).Succeeded && scheduler.GetOutput(good).Errors.empty());
+        CHECK(!scheduler.GetOutput(error).Succeeded && scheduler.GetOutput(error).Errors == "Shaders/Error.hlsl: #error");
+        CHECK(!scheduler.GetOutput(missing).Succeeded && scheduler.GetOutput(missing).Errors == "cannot open Missing.hlsli");
+        CHECK(scheduler.GetOutput(missing).ByteCode.empty());
+    }
+
+    // Run(numThreads) counts the calling thread, and no more threads than tasks are started
+    void TestThreadCount()
+    {
+        MemoryFiles files;
+        ShaderIncludeScanner scanner(files.GetReader());
+
+        for (uint32_t numThreads : { 1u, 4u })
+        {
+            FakeCompilerBackend backend;
+            backend.SimulatedMicroseconds = 500;
+            ShaderBatchScheduler scheduler(backend, scanner);
+            for (int i = 0; i < 32; ++i)
+                scheduler.Add(MakeTask("Shaders/Shader.hlsl", "#define I " + std::to_string(i) + "\n", ""));
+
+            scheduler.Run(numThreads);
+            CHECK(backend.GetNumTotalCompilations() == 32);
+            CHECK(backend.GetMaxRunning() <= numThreads);
+            CHECK(backend.GetNumThreads() <= numThreads);
+            for (size_t i = 0; i < scheduler.GetNumUniqueTasks(); ++i)
+                CHECK(scheduler.GetOutput(i).Succeeded);
+        }
+
+        FakeCompilerBackend backend;
+        ShaderBatchScheduler scheduler(backend, scanner);
+        scheduler.Add(MakeTask("Shaders/Shader.hlsl", "", ""));
+        scheduler.Run(16);
+        CHECK(backend.GetNumThreads() == 1);
+
+        // An empty batch
+        ShaderBatchScheduler emptyScheduler(backend, scanner);
+        emptyScheduler.Run(4);
+        CHECK(emptyScheduler.GetNumUniqueTasks() == 0);
+    }
+}
+
+int main()
+{
+    TestParseIncludes();
+    TestDuplicateTasks();
+    TestIncludesReadOnce();
+    TestFailures();
+    TestThreadCount();
+
+    std::printf("Shader batch scheduler: include parsing, duplicate tasks, includes read once, failures and thread count passed\n");
+    return 0;
+}
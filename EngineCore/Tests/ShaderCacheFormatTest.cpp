@@ -0,0 +1,197 @@
+#include "TestCommon.h"
+#include "D3D12RHI/ShaderCacheFormat.h"
+
+using namespace RHI;
+
+/*
+* Keys, records and include tracking of the shader cache, on files kept in memory: a record read back is the record written,
+* a damaged record is rejected, the includes resolve like the standard include handler, and a record is only up to date
+* while every file it read keeps its content.
+*/
+namespace
+{
+    // Files of a shader directory, the reads are counted
+    struct MemoryFiles
+    {
+        std::map<std::string, std::string> Files;
+        size_t NumReads = 0;
+
+        ReadFileFunc GetReader()
+        {
+            return [this](const std::string& path, std::string& content)
+            {
+                ++NumReads;
+                auto it = Files.find(path);
+                if (it == Files.end())
+                    return false;
+                content = it->second;
+                return true;
+            };
+        }
+    };
+
+    void TestKeys()
+    {
+        // The lengths separate the strings
+        CHECK(ShaderCacheKey().Add("ab").Add("c").GetHash() != ShaderCacheKey().Add("a").Add("bc").GetHash());
+        CHECK(ShaderCacheKey().Add("main").Add(uint64_t{ 1 }).GetHash() == ShaderCacheKey().Add("main").Add(uint64_t{ 1 }).GetHash());
+        CHECK(ShaderCacheKey().Add("main").Add(uint64_t{ 1 }).GetHash() != ShaderCacheKey().Add("main").Add(uint64_t{ 2 }).GetHash());
+        CHECK(ShaderCacheKey().Add("").GetHash() != ShaderCacheKey().GetHash());
+    }
+
+    void TestRecordRoundTrip()
+    {
+        std::vector<ShaderDependency> dependencies = { { "Shaders/Common.hlsli", 0x1234 }, { "Shaders/Lighting.hlsli", 0xABCDEF0123456789ull } };
+        const std::string byteCode = "DXBC bytecode";
+        const std::string reflection = "resources";
+
+        std::vector<uint8_t> bytes = ShaderCacheRecord::Serialize(dependencies, byteCode.data(), byteCode.size(), reflection.data(), reflection.size());
+
+        ShaderCacheRecord record;
+        CHECK(record.Parse(bytes.data(), bytes.size()));
+        CHECK(record.Dependencies.size() == 2);
+        CHECK(record.Dependencies[1].Path == "Shaders/Lighting.hlsli" && record.Dependencies[1].ContentHash == 0xABCDEF0123456789ull);
+        CHECK(std::string(static_cast<const char*>(record.ByteCode), record.ByteCodeSize) == byteCode);
+        CHECK(std::string(static_cast<const char*>(record.Reflection), record.ReflectionSize) == reflection);
+
+        // Without dependencies nor reflection
+        bytes = ShaderCacheRecord::Serialize({}, byteCode.data(), byteCode.size(), nullptr, 0);
+        CHECK(record.Parse(bytes.data(), bytes.size()));
+        CHECK(record.Dependencies.empty() && record.ByteCodeSize == byteCode.size() && record.ReflectionSize == 0);
+    }
+
+    // Every truncation of a record is rejected, and so are extra bytes at its end
+    void TestDamagedRecords()
+    {
+        std::vector<ShaderDependency> dependencies = { { "a.hlsli", 1 } };
+        const std::string byteCode = "code";
+        const std::string reflection = "refl";
+        std::vector<uint8_t> bytes = ShaderCacheRecord::Serialize(dependencies, byteCode.data(), byteCode.size(), reflection.data(), reflection.size());
+
+        ShaderCacheRecord record;
+        for (size_t size = 0; size < bytes.size(); ++size)
+            CHECK(!record.Parse(bytes.data(), size));
+
+        bytes.push_back(0);
+        CHECK(!record.Parse(bytes.data(), bytes.size()));
+
+        // A path length past the end of the record
+        bytes.pop_back();
+        uint32_t pathLength = 0xFFFFFFF0u;
+        memcpy(bytes.data() + sizeof(uint32_t) + sizeof(uint64_t), &pathLength, sizeof(pathLength));
+        CHECK(!record.Parse(bytes.data(), bytes.size()));
+        CHECK(record.ByteCode == nullptr && record.Dependencies.empty());
+    }
+
+    // Includes resolve from the including file first, then from the shader directory, and each file is recorded once
+    void TestIncludeTracker()
+    {
+        MemoryFiles files;
+        files.Files["Shaders/Lit.hlsl"] = "#include \"Common/Light.hlsli\"";
+        files.Files["Shaders/Common/Light.hlsli"] = "#include \"Math.hlsli\"\n#include \"Constants.hlsli\"";
+        files.Files["Shaders/Common/Math.hlsli"] = "float Square(float x) { return x * x; }";
+        files.Files["Shaders/Constants.hlsli"] = "cbuffer Constants {};";
+
+        ShaderIncludeTracker tracker("Shaders", files.GetReader());
+
+        const std::string* light = tracker.Open("Common/Light.hlsli", nullptr);
+        CHECK(light != nullptr && *light == files.Files["Shaders/Common/Light.hlsli"]);
+
+        // Relative to Common/, the directory of the including file
+        const std::string* math = tracker.Open("Math.hlsli", light->data());
+        CHECK(math != nullptr && *math == files.Files["Shaders/Common/Math.hlsli"]);
+
+        // Not in Common/, found in the shader directory
+        const std::string* constants = tracker.Open("Constants.hlsli", light->data());
+        CHECK(constants != nullptr && *constants == files.Files["Shaders/Constants.hlsli"]);
+
+        CHECK(tracker.Open("Missing.hlsli", light->data()) == nullptr);
+
+        // Included a second time
+        CHECK(tracker.Open("Math.hlsli", light->data()) != nullptr);
+
+        // The contents stay in place while more files are opened
+        CHECK(*light == files.Files["Shaders/Common/Light.hlsli"]);
+
+        const auto& dependencies = tracker.GetDependencies();
+        CHECK(dependencies.size() == 3);
+        CHECK(dependencies[0].Path == "Shaders/Common/Light.hlsli");
+        CHECK(dependencies[1].Path == "Shaders/Common/Math.hlsli");
+        CHECK(dependencies[2].Path == "Shaders/Constants.hlsli");
+        const std::string& mathContent = files.Files["Shaders/Common/Math.hlsli"];
+        CHECK(dependencies[1].ContentHash == ComputeFNV1aHash(mathContent.data(), mathContent.size()));
+
+        CHECK(ShaderIncludeTracker::JoinPath("Shaders", "/abs/File.hlsli") == "/abs/File.hlsli");
+        CHECK(ShaderIncludeTracker::JoinPath("Shaders", "C:\\File.hlsli") == "C:\\File.hlsli");
+        CHECK(ShaderIncludeTracker::GetDirectory("Shaders\\Common\\Light.hlsli") == "Shaders\\Common");
+        CHECK(ShaderIncludeTracker::GetDirectory("Light.hlsli").empty());
+    }
+
+    // Editing an include invalidates the records that read it, the file hashes are shared by the checks
+    void TestDependenciesUpToDate()
+    {
+        MemoryFiles files;
+        files.Files["Common.hlsli"] = "common";
+        files.Files["Sky.hlsli"] = "sky";
+
+        auto hashOf = [&files](const std::string& path) { return ComputeFNV1aHash(files.Files[path].data(), files.Files[path].size()); };
+        std::vector<ShaderDependency> skyShader = { { "Common.hlsli", hashOf("Common.hlsli") }, { "Sky.hlsli", hashOf("Sky.hlsli") } };
+        std::vector<ShaderDependency> litShader = { { "Common.hlsli", hashOf("Common.hlsli") } };
+
+        std::unordered_map<std::string, uint64_t> fileHashes;
+        CHECK(AreShaderDependenciesUpToDate(skyShader, files.GetReader(), fileHashes));
+        CHECK(AreShaderDependenciesUpToDate(litShader, files.GetReader(), fileHashes));
+        CHECK(files.NumReads == 2);
+
+        files.Files["Sky.hlsli"] = "sky edited";
+        fileHashes.clear();
+        CHECK(!AreShaderDependenciesUpToDate(skyShader, files.GetReader(), fileHashes));
+        CHECK(AreShaderDependenciesUpToDate(litShader, files.GetReader(), fileHashes));
+
+        files.Files.erase("Common.hlsli");
+        fileHashes.clear();
+        CHECK(!AreShaderDependenciesUpToDate(litShader, files.GetReader(), fileHashes));
+    }
+
+    // Records written in a ShaderCacheArchive are read back from the archive bytes
+    void TestArchiveRecords()
+    {
+        std::vector<std::vector<uint8_t>> records;
+        std::vector<ShaderCacheArchive::BlobRef> blobs;
+        for (uint64_t i = 0; i < 16; ++i)
+        {
+            std::string byteCode(static_cast<size_t>(i * 7 + 1), static_cast<char>('a' + i));
+            std::vector<ShaderDependency> dependencies = { { "File" + std::to_string(i) + ".hlsli", i } };
+            records.push_back(ShaderCacheRecord::Serialize(dependencies, byteCode.data(), byteCode.size(), nullptr, 0));
+        }
+        for (uint64_t i = 0; i < records.size(); ++i)
+            blobs.push_back(ShaderCacheArchive::BlobRef{ ShaderCacheKey().Add(i).GetHash(), records[i].data(), records[i].size() });
+
+        std::vector<uint8_t> bytes = ShaderCacheArchive::Build(blobs);
+        ShaderCacheArchive archive;
+        CHECK(archive.Open(bytes.data(), bytes.size()));
+
+        for (uint64_t i = 0; i < records.size(); ++i)
+        {
+            size_t size = 0;
+            const void* data = archive.Find(ShaderCacheKey().Add(i).GetHash(), size);
+            ShaderCacheRecord record;
+            CHECK(data != nullptr && record.Parse(data, size));
+            CHECK(record.ByteCodeSize == i * 7 + 1 && static_cast<const char*>(record.ByteCode)[0] == static_cast<char>('a' + i));
+            CHECK(record.Dependencies.size() == 1 && record.Dependencies[0].ContentHash == i);
+        }
+    }
+}
+
+int main()
+{
+    TestKeys();
+    TestRecordRoundTrip();
+    TestDamagedRecords();
+    TestIncludeTracker();
+    TestDependenciesUpToDate();
+    TestArchiveRecords();
+
+    std::printf("Shader cache format: keys, records, damaged records, includes, dependencies and archive records passed\n");
+    return 0;
+}
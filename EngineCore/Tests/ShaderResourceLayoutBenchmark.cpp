@@ -0,0 +1,205 @@
+#include "EnginePch.h"
+#include "FakeShaderReflection.h"
+#include "D3D12RHI/Shader.h"
+#include "D3D12RHI/ShaderObject/ShaderResourceLayout.h"
+#include "D3D12RHI/ShaderObject/ShaderVariableTable.h"
+
+#include <new>
+
+using namespace RHI;
+
+/*
+* Construction of ShaderResource and ShaderResourceLayout for the pixel shader of a material: 55 resources, one of them an
+* array listed per element. ShaderResource is built from its reflection and from its reflection snapshot, the layout is
+* compared with the storage it replaced: one heap allocation per resource in a vector per variable type. The heap
+* allocations of the whole process are counted.
+*/
+namespace
+{
+    std::atomic<size_t> g_NumHeapAllocations{ 0 };
+}
+
+void* operator new(size_t size)
+{
+    g_NumHeapAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* memory = std::malloc(size != 0 ? size : 1))
+        return memory;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+    std::free(memory);
+}
+
+namespace
+{
+    void BuildMaterialShader(FakeShaderReflection& reflection, ShaderVariableConfig& config)
+    {
+        reflection.AddBinding("cbPass", D3D_SIT_CBUFFER, D3D_SRV_DIMENSION_UNKNOWN, 0);
+        reflection.AddBinding("cbObject", D3D_SIT_CBUFFER, D3D_SRV_DIMENSION_UNKNOWN, 1);
+        reflection.AddBinding("cbMaterial", D3D_SIT_CBUFFER, D3D_SRV_DIMENSION_UNKNOWN, 2);
+        reflection.AddBinding("cbLights", D3D_SIT_CBUFFER, D3D_SRV_DIMENSION_UNKNOWN, 3);
+        reflection.AddArrayBinding("g_ShadowMaps", D3D_SIT_TEXTURE, D3D_SRV_DIMENSION_TEXTURE2D, 0, 4);
+        for (UINT i = 0; i < 32; ++i)
+            reflection.AddBinding("g_MaterialTexture" + std::to_string(i), D3D_SIT_TEXTURE, D3D_SRV_DIMENSION_TEXTURE2D, 4 + i);
+        reflection.AddBinding("g_EnvironmentMap", D3D_SIT_TEXTURE, D3D_SRV_DIMENSION_TEXTURECUBE, 36);
+        for (UINT i = 0; i < 4; ++i)
+            reflection.AddBinding("g_OutputTexture" + std::to_string(i), D3D_SIT_UAV_RWTYPED, D3D_SRV_DIMENSION_TEXTURE2D, i);
+        for (UINT i = 0; i < 8; ++i)
+            reflection.AddBinding("g_InstanceBuffer" + std::to_string(i), D3D_SIT_STRUCTURED, D3D_SRV_DIMENSION_UNKNOWN, 37 + i);
+        reflection.AddBinding("g_LightIndices", D3D_SIT_TEXTURE, D3D_SRV_DIMENSION_BUFFER, 45);
+        for (UINT i = 0; i < 4; ++i)
+            reflection.AddBinding("g_Counters" + std::to_string(i), D3D_SIT_UAV_RWBYTEADDRESS, D3D_SRV_DIMENSION_UNKNOWN, 4 + i);
+
+        // The frame resources are static, the material textures mutable and the outputs dynamic
+        config.DefaultVariableType = SHADER_RESOURCE_VARIABLE_TYPE_STATIC;
+        for (UINT i = 0; i < 32; ++i)
+            config.Variables.push_back({ SHADER_TYPE_PIXEL, "g_MaterialTexture" + std::to_string(i), SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE });
+        config.Variables.push_back({ SHADER_TYPE_PIXEL, "cbObject", SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC });
+        config.Variables.push_back({ SHADER_TYPE_PIXEL, "cbMaterial", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE });
+        for (UINT i = 0; i < 4; ++i)
+            config.Variables.push_back({ SHADER_TYPE_PIXEL, "g_OutputTexture" + std::to_string(i), SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC });
+    }
+
+    // The storage of the layout before the single buffer
+    struct HeapLayout
+    {
+        HeapLayout(const ShaderVariableTable& shaderVariableTable, const ShaderResource& shaderResource)
+        {
+            auto AddResource = [&](const ShaderResourceAttribs& attribs, BindingResourceType resType)
+            {
+                SHADER_RESOURCE_VARIABLE_TYPE varType = shaderResource.FindVariableType(attribs, shaderVariableTable);
+                Resources[varType].push_back(std::make_unique<ShaderResourceLayout::Resource>(attribs, varType, resType,
+                    ShaderResourceLayout::Resource::InvalidRootIndex, ShaderResourceLayout::Resource::InvalidOffset));
+            };
+
+            shaderResource.ProcessResources(
+                [&](const ShaderResourceAttribs& CB, UINT32) { AddResource(CB, BindingResourceType::CBV); },
+                [&](const ShaderResourceAttribs& TexSRV, UINT32) { AddResource(TexSRV, BindingResourceType::TexSRV); },
+                [&](const ShaderResourceAttribs& TexUAV, UINT32) { AddResource(TexUAV, BindingResourceType::TexUAV); },
+                [&](const ShaderResourceAttribs& BufSRV, UINT32) { AddResource(BufSRV, BindingResourceType::BufSRV); },
+                [&](const ShaderResourceAttribs& BufUAV, UINT32) { AddResource(BufUAV, BindingResourceType::BufUAV); });
+        }
+
+        std::vector<std::unique_ptr<ShaderResourceLayout::Resource>> Resources[SHADER_RESOURCE_VARIABLE_TYPE_NUM_TYPES];
+    };
+
+    void CheckShaderResource(const ShaderResource& shaderResource)
+    {
+        CHECK(shaderResource.GetCBNum() == 4 && shaderResource.GetTexSRVNum() == 34 && shaderResource.GetTexUAVNum() == 4);
+        CHECK(shaderResource.GetBufSRVNum() == 9 && shaderResource.GetBufUAVNum() == 4);
+
+        // The elements of the array are one resource
+        const ShaderResourceAttribs& shadowMaps = shaderResource.GetTexSRV(0);
+        CHECK(std::strcmp(shadowMaps.Name, "g_ShadowMaps") == 0 && shadowMaps.BindPoint == 0 && shadowMaps.BindCount == 4);
+        CHECK(std::strcmp(shaderResource.GetBufSRV(8).Name, "g_LightIndices") == 0);
+
+        // The name hashes are kept by the snapshot, the layout looks the variable types up with them
+        for (UINT32 i = 0; i < shaderResource.GetTexSRVNum(); ++i)
+            CHECK(shaderResource.GetTexSRV(i).NameHash == ShaderVariableTable::ComputeNameHash(shaderResource.GetTexSRV(i).Name));
+    }
+
+    void CheckLayout(const ShaderResourceLayout& layout, const ShaderVariableTable& shaderVariableTable)
+    {
+        CHECK(layout.GetCbvSrvUavCount(SHADER_RESOURCE_VARIABLE_TYPE_STATIC) == 17);
+        CHECK(layout.GetCbvSrvUavCount(SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE) == 33);
+        CHECK(layout.GetCbvSrvUavCount(SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC) == 5);
+        CHECK(layout.GetTotalCbvSrvUavCount() == 55);
+
+        for (UINT32 type = 0; type < SHADER_RESOURCE_VARIABLE_TYPE_NUM_TYPES; ++type)
+        {
+            auto varType = static_cast<SHADER_RESOURCE_VARIABLE_TYPE>(type);
+            for (UINT32 i = 0; i < layout.GetCbvSrvUavCount(varType); ++i)
+            {
+                const ShaderResourceLayout::Resource& resource = layout.GetSrvCbvUav(varType, i);
+                CHECK(resource.VariableType == varType);
+                CHECK(shaderVariableTable.Find(SHADER_TYPE_PIXEL, resource.Attribs.Name) == varType);
+                CHECK(!resource.HasRootSlot());
+            }
+        }
+    }
+
+    struct BenchmarkResult
+    {
+        double Microseconds = 0.0;
+        double AllocationsPerObject = 0.0;
+    };
+
+    template<typename TCreate>
+    BenchmarkResult Measure(UINT32 numIterations, TCreate Create)
+    {
+        size_t allocations = g_NumHeapAllocations.load();
+        BenchmarkTimer timer;
+        for (UINT32 i = 0; i < numIterations; ++i)
+            Create();
+        double milliseconds = timer.GetMilliseconds();
+
+        BenchmarkResult result;
+        result.Microseconds = milliseconds * 1000.0 / numIterations;
+        result.AllocationsPerObject = static_cast<double>(g_NumHeapAllocations.load() - allocations) / numIterations;
+        return result;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    UINT32 numIterations = IsFullBenchmark(argc, argv) ? 200000 : 5000;
+
+    FakeShaderReflection reflection;
+    ShaderVariableConfig config;
+    BuildMaterialShader(reflection, config);
+    ShaderVariableTable shaderVariableTable(config);
+
+    ShaderDesc shaderDesc = { SHADER_TYPE_PIXEL };
+    ShaderResource shaderResource(&reflection, shaderDesc);
+    CheckShaderResource(shaderResource);
+
+    std::vector<UINT8> snapshot = shaderResource.CreateSnapshot();
+    std::unique_ptr<const ShaderResource> loadedResource = ShaderResource::CreateFromSnapshot(snapshot.data(), snapshot.size());
+    CHECK(loadedResource != nullptr && loadedResource->IsCompatibleWith(shaderResource));
+    CheckShaderResource(*loadedResource);
+
+    // The layout does not use the root signature until it assigns the slots of the resources
+    alignas(std::max_align_t) UINT8 rootSignaturePlaceholder[1] = {};
+    RootSignature* rootSignature = reinterpret_cast<RootSignature*>(rootSignaturePlaceholder);
+
+    ShaderResourceLayout layout(nullptr, PIPELINE_TYPE_GRAPHIC, shaderVariableTable, &shaderResource, rootSignature);
+    CheckLayout(layout, shaderVariableTable);
+
+    BenchmarkResult fromReflection = Measure(numIterations, [&]()
+    {
+        ShaderResource resource(&reflection, shaderDesc);
+        CHECK(resource.GetTexSRVNum() == 34);
+    });
+    BenchmarkResult fromSnapshot = Measure(numIterations, [&]()
+    {
+        auto resource = ShaderResource::CreateFromSnapshot(snapshot.data(), snapshot.size());
+        CHECK(resource != nullptr);
+    });
+    BenchmarkResult singleBuffer = Measure(numIterations, [&]()
+    {
+        ShaderResourceLayout resourceLayout(nullptr, PIPELINE_TYPE_GRAPHIC, shaderVariableTable, &shaderResource, rootSignature);
+        CHECK(resourceLayout.GetTotalCbvSrvUavCount() == 55);
+    });
+    BenchmarkResult heapResources = Measure(numIterations, [&]()
+    {
+        HeapLayout resourceLayout(shaderVariableTable, shaderResource);
+        CHECK(resourceLayout.Resources[SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE].size() == 33);
+    });
+
+    // The resources of the layout are in one buffer, next to the list of the resources gathered before it is allocated
+    CHECK(singleBuffer.AllocationsPerObject <= 2.0);
+    CHECK(fromSnapshot.AllocationsPerObject <= 2.0);
+
+    std::printf("ShaderResource of 55 resources: from reflection %7.2f us (%.0f allocations), from snapshot %7.2f us (%.0f allocations)\n",
+        fromReflection.Microseconds, fromReflection.AllocationsPerObject, fromSnapshot.Microseconds, fromSnapshot.AllocationsPerObject);
+    std::printf("ShaderResourceLayout: single buffer %7.2f us (%.0f allocations), one allocation per resource %7.2f us (%.0f allocations)\n",
+        singleBuffer.Microseconds, singleBuffer.AllocationsPerObject, heapResources.Microseconds, heapResources.AllocationsPerObject);
+    return 0;
+}
@@ -0,0 +1,161 @@
+#include "EnginePch.h"
+#include "D3D12RHI/ShaderObject/ShaderVariableTable.h"
+
+#include <random>
+
+using namespace RHI;
+
+/*
+* Variable types of the resources of a shader looked up in the ShaderVariableConfig of large materials, from 64 to 16384
+* variables: the ShaderVariableTable with the hash kept by ShaderResourceAttribs, the table hashing the name, and the
+* linear scan with string compares it replaced. Half of the looked up names are in the config, the others get its default
+* type, which is the worst case of the scan.
+*/
+namespace
+{
+    constexpr UINT32 NumShaderResources = 64;
+
+    struct LookupName
+    {
+        std::string Name;
+        UINT64 NameHash;
+    };
+
+    // The variables of materials of 8 textures and 2 buffers, one variable in four is for the vertex shader
+    ShaderVariableConfig BuildMaterialConfig(UINT32 numVariables)
+    {
+        ShaderVariableConfig config;
+        config.DefaultVariableType = SHADER_RESOURCE_VARIABLE_TYPE_STATIC;
+
+        std::mt19937 random(25);
+        for (UINT32 i = 0; config.Variables.size() < numVariables; ++i)
+        {
+            UINT32 material = i / 10;
+            std::string name = i % 10 < 8 ? "g_Material" + std::to_string(material) + "_Texture" + std::to_string(i % 10) :
+                "g_Material" + std::to_string(material) + "_Buffer" + std::to_string(i % 10 - 8);
+            auto type = static_cast<SHADER_RESOURCE_VARIABLE_TYPE>(1 + random() % 2);
+            config.Variables.push_back({ i % 4 == 3 ? SHADER_TYPE_VERTEX : SHADER_TYPE_PIXEL, name, type });
+        }
+        return config;
+    }
+
+    // The resources of one pixel shader: the first half is spread over the config, the second half is not in it
+    std::vector<LookupName> BuildShaderResourceNames(const ShaderVariableConfig& config)
+    {
+        std::vector<LookupName> names;
+        for (UINT32 i = 0; i < NumShaderResources / 2; ++i)
+            names.push_back({ config.Variables[(i * 2 + 1) * config.Variables.size() / NumShaderResources].Name, 0 });
+        for (UINT32 i = 0; i < NumShaderResources / 2; ++i)
+            names.push_back({ "g_Frame_Texture" + std::to_string(i), 0 });
+
+        for (LookupName& name : names)
+            name.NameHash = ShaderVariableTable::ComputeNameHash(name.Name.c_str());
+        return names;
+    }
+
+    // The lookup before ShaderVariableTable
+    SHADER_RESOURCE_VARIABLE_TYPE FindByScan(SHADER_TYPE shaderType, const std::string& name, const ShaderVariableConfig& config)
+    {
+        for (const ShaderResourceVariableDesc& variable : config.Variables)
+        {
+            if ((variable.ShaderType & shaderType) != 0 && name == variable.Name)
+                return variable.Type;
+        }
+        return config.DefaultVariableType;
+    }
+
+    void TestFind()
+    {
+        ShaderVariableConfig config;
+        config.DefaultVariableType = SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE;
+        config.Variables.push_back({ SHADER_TYPE_PIXEL, "g_Albedo", SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC });
+        config.Variables.push_back({ static_cast<SHADER_TYPE>(SHADER_TYPE_VERTEX | SHADER_TYPE_PIXEL), "g_Albedo", SHADER_RESOURCE_VARIABLE_TYPE_STATIC });
+        config.Variables.push_back({ SHADER_TYPE_COMPUTE, "g_Output", SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC });
+
+        ShaderVariableTable table(config);
+        CHECK(table.GetNumNames() == 2);
+
+        // The first variable that matches the name and the stage
+        CHECK(table.Find(SHADER_TYPE_PIXEL, "g_Albedo") == SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC);
+        CHECK(table.Find(SHADER_TYPE_VERTEX, "g_Albedo") == SHADER_RESOURCE_VARIABLE_TYPE_STATIC);
+        CHECK(table.Find(SHADER_TYPE_GEOMETRY, "g_Albedo") == SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE);
+        CHECK(table.Find(SHADER_TYPE_PIXEL, "g_Output") == SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE);
+        CHECK(table.Find(SHADER_TYPE_COMPUTE, "g_Output", ShaderVariableTable::ComputeNameHash("g_Output")) == SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC);
+        CHECK(table.Find(SHADER_TYPE_PIXEL, "g_Missing") == SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE);
+
+        ShaderVariableTable emptyTable;
+        CHECK(emptyTable.Find(SHADER_TYPE_PIXEL, "g_Albedo") == SHADER_RESOURCE_VARIABLE_TYPE_STATIC);
+    }
+
+    struct BenchmarkResult
+    {
+        double BuildMicroseconds = 0.0;
+        double HashedNanoseconds = 0.0;
+        double NameNanoseconds = 0.0;
+        double ScanNanoseconds = 0.0;
+    };
+
+    BenchmarkResult RunConfig(UINT32 numVariables, UINT32 numLookups)
+    {
+        ShaderVariableConfig config = BuildMaterialConfig(numVariables);
+        std::vector<LookupName> names = BuildShaderResourceNames(config);
+
+        BenchmarkResult result;
+        BenchmarkTimer buildTimer;
+        ShaderVariableTable table(config);
+        result.BuildMicroseconds = buildTimer.GetMilliseconds() * 1000.0;
+
+        for (const LookupName& name : names)
+        {
+            SHADER_RESOURCE_VARIABLE_TYPE type = FindByScan(SHADER_TYPE_PIXEL, name.Name, config);
+            CHECK(table.Find(SHADER_TYPE_PIXEL, name.Name.c_str(), name.NameHash) == type);
+            CHECK(table.Find(SHADER_TYPE_PIXEL, name.Name.c_str()) == type);
+        }
+
+        // The sums keep the lookups from being optimized out
+        UINT32 numRounds = std::max(numLookups / NumShaderResources, 1u);
+        UINT64 typeSum = 0;
+        BenchmarkTimer hashedTimer;
+        for (UINT32 round = 0; round < numRounds; ++round)
+        {
+            for (const LookupName& name : names)
+                typeSum += table.Find(SHADER_TYPE_PIXEL, name.Name.c_str(), name.NameHash);
+        }
+        result.HashedNanoseconds = hashedTimer.GetMilliseconds() * 1e6 / (numRounds * NumShaderResources);
+
+        BenchmarkTimer nameTimer;
+        for (UINT32 round = 0; round < numRounds; ++round)
+        {
+            for (const LookupName& name : names)
+                typeSum += table.Find(SHADER_TYPE_PIXEL, name.Name.c_str());
+        }
+        result.NameNanoseconds = nameTimer.GetMilliseconds() * 1e6 / (numRounds * NumShaderResources);
+
+        // The scan is slow on the large configs, it runs fewer rounds
+        UINT32 numScanRounds = std::max(numRounds * 64 / numVariables, 1u);
+        BenchmarkTimer scanTimer;
+        for (UINT32 round = 0; round < numScanRounds; ++round)
+        {
+            for (const LookupName& name : names)
+                typeSum += FindByScan(SHADER_TYPE_PIXEL, name.Name, config);
+        }
+        result.ScanNanoseconds = scanTimer.GetMilliseconds() * 1e6 / (numScanRounds * NumShaderResources);
+
+        CHECK(typeSum > 0);
+        return result;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    TestFind();
+
+    UINT32 numLookups = IsFullBenchmark(argc, argv) ? 10000000 : 200000;
+    for (UINT32 numVariables : { 64u, 1024u, 16384u })
+    {
+        BenchmarkResult result = RunConfig(numVariables, numLookups);
+        std::printf("%5u variables: table built in %8.1f us, lookup with the name hash %6.1f ns, hashing the name %6.1f ns, linear scan %9.1f ns\n",
+            numVariables, result.BuildMicroseconds, result.HashedNanoseconds, result.NameNanoseconds, result.ScanNanoseconds);
+    }
+    return 0;
+}
@@ -0,0 +1,25 @@
+#include "TestCommon.h"
+
+std::string Debug::m_Message;
+
+void Debug::Log(LOG_LEVEL logLevel, const char* function, const char*, int line, const std::string& message)
+{
+    const char* level = logLevel == LOG_LEVEL::LOG_LEVEL_ERROR ? "ERROR" : (logLevel == LOG_LEVEL::LOG_LEVEL_WARNING ? "WARNING" : "INFO");
+    std::fprintf(stderr, "[%s] %s:%d %s\n", level, function, line, message.c_str());
+}
+
+void TestFailure(const char* condition, const char* file, int line)
+{
+    std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", file, line, condition);
+    std::exit(1);
+}
+
+bool IsFullBenchmark(int argc, char** argv)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--full") == 0)
+            return true;
+    }
+    return false;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+// Stand-in for the precompiled header of the engine: the standard headers and the Windows types used by the header-only code
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cassert>
+#include <array>
+#include <vector>
+#include <queue>
+#include <deque>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <limits>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
+#include <functional>
+#include <chrono>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+using UINT8 = std::uint8_t;
+using UINT16 = std::uint16_t;
+using UINT32 = std::uint32_t;
+using UINT64 = std::uint64_t;
+using INT32 = std::int32_t;
+using UINT = unsigned int;
+using SIZE_T = std::size_t;
+#endif
+
+#include "Utility/Debug.h"
+#include "Utility/HashUtils.hpp"
+#include "Common/Align.h"
+
+// Prints the failed condition and ends the test
+#define CHECK(condition)                                          \
+    do                                                            \
+    {                                                             \
+        if (!(condition))                                         \
+            TestFailure(#condition, __FILE__, __LINE__);          \
+    } while (false)
+
+[[noreturn]] void TestFailure(const char* condition, const char* file, int line);
+
+// The benchmarks run a short pass by default (under ctest), --full runs the complete measurements
+bool IsFullBenchmark(int argc, char** argv);
+
+class BenchmarkTimer
+{
+public:
+    BenchmarkTimer() : m_Start{ std::chrono::steady_clock::now() } {}
+
+    double GetMilliseconds() const
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_Start).count();
+    }
+
+private:
+    std::chrono::steady_clock::time_point m_Start;
+};
@@ -0,0 +1,196 @@
+#include "TestCommon.h"
+#include "D3D12RHI/ThreadLocalCaches.h"
+
+#include <random>
+
+using namespace RHI;
+
+/*
+* Stress test of the concurrent mode of CPUDescriptorHeap. The descriptor heap managers are replaced by a CPU-only stand-in
+* that hands out integer handles under a mutex, like CPUDescriptorHeap::AllocateFromPool. Loader threads allocate single
+* descriptors through the thread caches (refilled in batches) and release them, while a control thread keeps disabling and
+* enabling the concurrent mode. No handle may be owned twice, and every handle must be back in the pool at the end.
+*/
+namespace
+{
+    class StandInDescriptorPool
+    {
+    public:
+        explicit StandInDescriptorPool(UINT32 numDescriptors)
+        {
+            for (UINT32 i = numDescriptors; i > 0; --i)
+                m_FreeHandles.push_back(i - 1);
+        }
+
+        bool Allocate(UINT32 count, std::vector<UINT32>& handles)
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            if (m_FreeHandles.size() < count)
+                return false;
+            for (UINT32 i = 0; i < count; ++i)
+            {
+                handles.push_back(m_FreeHandles.back());
+                m_FreeHandles.pop_back();
+            }
+            ++m_NumLockedAllocations;
+            return true;
+        }
+
+        void Free(const std::vector<UINT32>& handles)
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_FreeHandles.insert(m_FreeHandles.end(), handles.begin(), handles.end());
+        }
+
+        size_t GetNumFree()
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            return m_FreeHandles.size();
+        }
+
+        size_t GetNumLockedAllocations()
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            return m_NumLockedAllocations;
+        }
+
+    private:
+        std::mutex m_Mutex;
+        std::vector<UINT32> m_FreeHandles;
+        size_t m_NumLockedAllocations = 0;
+    };
+
+    constexpr UINT32 NumDescriptors = 1 << 16;
+    constexpr UINT32 BatchSize = 32;
+
+    // Owners created and destroyed while the threads keep running, like the heaps of the levels of a game: the slots of the
+    // destroyed owners are reused, and the entry left in the thread tables by the previous owner of a slot is not used again
+    void TestOwnerSlotReuse()
+    {
+        auto liveCaches = std::make_unique<ThreadLocalCaches<UINT32>>();
+        liveCaches->Enable();
+
+        std::thread thread([&liveCaches]()
+        {
+            UINT32 item = 0;
+            for (UINT32 owner = 0; owner < 1000; ++owner)
+            {
+                ThreadLocalCaches<UINT32> caches;
+                caches.Enable();
+                CHECK(caches.Pop(item, [owner](std::vector<UINT32>& items) { items.push_back(owner); }));
+                CHECK(item == owner);
+                // The new owner has the slot of the previous one, its cache is registered again
+                CHECK(!caches.Pop(item, [](std::vector<UINT32>&) {}));
+                CHECK(caches.GetNumCaches() == 1);
+                caches.Disable([](std::vector<UINT32>&) {});
+
+                // An owner that lives across the others keeps its cache
+                CHECK(liveCaches->Pop(item, [](std::vector<UINT32>& items) { items.insert(items.end(), { 2u, 1u }); }));
+            }
+        });
+        thread.join();
+
+        CHECK(liveCaches->GetNumCaches() == 1);
+        liveCaches->Disable([](std::vector<UINT32>&) {});
+    }
+}
+
+int main()
+{
+    TestOwnerSlotReuse();
+
+    StandInDescriptorPool pool(NumDescriptors);
+    ThreadLocalCaches<UINT32> caches;
+    std::vector<std::atomic<bool>> owned(NumDescriptors);
+    for (auto& flag : owned)
+        flag.store(false);
+
+    caches.Enable();
+
+    const UINT32 numThreads = std::max(4u, std::min(16u, std::thread::hardware_concurrency()));
+    const UINT32 numAllocationsPerThread = 200000;
+    std::atomic<UINT64> numCached{ 0 };
+    std::atomic<UINT32> numRunning{ numThreads };
+
+    std::vector<std::thread> threads;
+    for (UINT32 t = 0; t < numThreads; ++t)
+    {
+        threads.emplace_back([&, t]()
+        {
+            std::mt19937 rng(t);
+            std::vector<UINT32> held;
+            std::vector<UINT32> handles;
+            for (UINT32 i = 0; i < numAllocationsPerThread; ++i)
+            {
+                UINT32 handle = 0;
+                bool cached = caches.Pop(handle, [&pool](std::vector<UINT32>& items)
+                {
+                    std::vector<UINT32> batch;
+                    if (pool.Allocate(BatchSize, batch))
+                        items.insert(items.end(), batch.rbegin(), batch.rend());
+                });
+
+                if (cached)
+                {
+                    ++numCached;
+                }
+                else
+                {
+                    // Concurrent mode disabled: the shared path of the heap
+                    handles.clear();
+                    CHECK(pool.Allocate(1, handles));
+                    handle = handles[0];
+                }
+
+                CHECK(!owned[handle].exchange(true));
+                held.push_back(handle);
+
+                // Views are created and released in bursts, like a streamed scene
+                if (held.size() > 64 || rng() % 8 == 0)
+                {
+                    for (UINT32 h : held)
+                        CHECK(owned[h].exchange(false));
+                    pool.Free(held);
+                    held.clear();
+                }
+            }
+
+            for (UINT32 h : held)
+                CHECK(owned[h].exchange(false));
+            pool.Free(held);
+            --numRunning;
+        });
+    }
+
+    // The mode is switched while the loader threads allocate and refill
+    UINT32 numSwitches = 0;
+    while (numRunning.load() > 0)
+    {
+        caches.Disable([&pool, &owned](std::vector<UINT32>& items)
+        {
+            for (UINT32 item : items)
+                CHECK(!owned[item].load());
+            pool.Free(items);
+        });
+        std::this_thread::yield();
+        caches.Enable();
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+        ++numSwitches;
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+
+    caches.Disable([&pool](std::vector<UINT32>& items) { pool.Free(items); });
+
+    CHECK(pool.GetNumFree() == NumDescriptors);
+    for (auto& flag : owned)
+        CHECK(!flag.load());
+
+    UINT64 numAllocations = static_cast<UINT64>(numThreads) * numAllocationsPerThread;
+    std::printf("%u threads, %llu allocations, %llu from the thread caches, %zu pool locks, %u mode switches, %zu caches\n",
+        numThreads, static_cast<unsigned long long>(numAllocations), static_cast<unsigned long long>(numCached.load()),
+        pool.GetNumLockedAllocations(), numSwitches, caches.GetNumCaches());
+    CHECK(numCached.load() > 0);
+    return 0;
+}
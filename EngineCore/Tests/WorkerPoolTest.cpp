@@ -0,0 +1,89 @@
+#include "TestCommon.h"
+#include "D3D12RHI/WorkerPool.h"
+
+using namespace RHI;
+
+/*
+* The worker threads of CommandContext::RecordParallel: every index runs once, index 0 on the calling thread, the other ones
+* only on the calling thread or the threads of the pool, and several threads can record in parallel at the same time.
+*/
+namespace
+{
+    void TestEveryIndexOnce()
+    {
+        WorkerPool pool(3);
+
+        for (uint32_t count : { 1u, 2u, 4u, 17u, 200u })
+        {
+            std::vector<std::atomic<uint32_t>> calls(count);
+            std::thread::id firstThread;
+            pool.ParallelFor(count, [&calls, &firstThread](uint32_t i)
+            {
+                calls[i].fetch_add(1);
+                if (i == 0)
+                    firstThread = std::this_thread::get_id();
+            });
+
+            for (auto& numCalls : calls)
+                CHECK(numCalls.load() == 1);
+            CHECK(firstThread == std::this_thread::get_id());
+        }
+    }
+
+    // The pool keeps its threads: after many frames, no more threads than the pool and the calling thread ran the indices
+    void TestPersistentThreads()
+    {
+        constexpr uint32_t NumThreads = 4;
+        WorkerPool pool(NumThreads);
+
+        std::mutex mutex;
+        std::set<std::thread::id> threads;
+        for (int frame = 0; frame < 500; ++frame)
+        {
+            pool.ParallelFor(8, [&mutex, &threads](uint32_t)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                threads.insert(std::this_thread::get_id());
+            });
+        }
+
+        CHECK(threads.size() <= NumThreads + 1);
+        CHECK(threads.count(std::this_thread::get_id()) == 1);
+    }
+
+    // Several threads record at the same time, each call returns once its own indices are done
+    void TestConcurrentCalls()
+    {
+        WorkerPool pool(2);
+
+        std::vector<std::thread> callers;
+        for (uint32_t c = 0; c < 4; ++c)
+        {
+            callers.emplace_back([&pool, c]()
+            {
+                for (uint32_t frame = 0; frame < 200; ++frame)
+                {
+                    uint32_t count = 1 + (frame + c) % 9;
+                    std::vector<uint32_t> recorded(count, 0);
+                    pool.ParallelFor(count, [&recorded, c](uint32_t i) { recorded[i] = c + i; });
+
+                    for (uint32_t i = 0; i < count; ++i)
+                        CHECK(recorded[i] == c + i);
+                }
+            });
+        }
+
+        for (auto& caller : callers)
+            caller.join();
+    }
+}
+
+int main()
+{
+    TestEveryIndexOnce();
+    TestPersistentThreads();
+    TestConcurrentCalls();
+
+    std::printf("Worker pool: every index once, persistent threads and concurrent calls passed\n");
+    return 0;
+}